@@ -0,0 +1,1520 @@
+/**
+ * @file    bench_filter.c
+ * @author  YRD
+ * @version 1.0
+ * @date    2026-10-18
+ * @brief   滤波器性能测试
+ * @details 逐个测量img_filter.h中的滤波器（单帧）、img_filter_bat.h中的批处理滤波器（k帧交织，编译器自动向量化）
+ *          和多线程滤波器(_mt)的运行时间，输出每帧时间(ns)、每像素时钟数、内存带宽(GB/s)，
+ *          以及带宽相对于img_copy（内存拷贝）的比例，接近1说明该滤波器受内存带宽限制。
+ *          图像尺寸在编译时确定（IMG_WID/IMG_HGT），CMake为320x240、512x424和640x480分别生成bench_filter_<宽>。
+ *          输入为合成深度图像，或用-i读入录制的原始深度数据文件（格式同filter程序）。
+ *          结果可以输出为csv或json，用-b指定上次保存的csv文件时，比较每个滤波器的时间，变慢超过门限时返回2。
+ *          -P打开硬件性能计数器(img_perf.h)，增加IPC、每像素L1D/LLC缺失、分支预测失败和内存流量(bytes/pixel)，
+ *          多线程滤波器只统计调用线程。
+ *          -C不测时间，检查批处理、多线程滤波器和单帧滤波器的结果逐位相同，
+ *          并用随机数据检查点云内核的结果（和逐点直接计算比较），有错误时返回1
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+#include "img_const.h"
+#include "img_algo.h"
+#include "img_filter.h"
+#include "img_filter_bat.h"
+#include "img_pool.h"
+#include "img_par.h"
+#include "img_perf.h"
+#include "img_rigid.h"
+#include "img_kdt.h"
+#include "img_outlier.h"
+#include "img_deproj.h"
+#include "img_normal.h"
+#include "img_proj.h"
+#include "img_reg.h"
+#include "img_pc.h"
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define bench_cycles()  __rdtsc()
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define bench_cycles()  __rdtsc()
+#else
+#define bench_cycles()  0
+#endif
+
+#define BENCH_FRM_N     8           // 输入图像帧数，轮流使用，避免全部数据留在缓存中
+#define BENCH_K_MAX     16          // 批处理最多帧数
+#define BENCH_REP_MAX   101         // 最多重复次数
+
+// 测试环境，所有滤波器共用
+struct bench_ctx_s
+{
+    float   *frm[BENCH_FRM_N];      // 输入图像
+    float   *frm_bat[BENCH_FRM_N];  // 交织后的输入图像（k帧）
+    float   *img_out;
+    float   *img_buf;               // 历史图像，最多5帧
+    float   *img_st1,*img_st2,*img_st3;
+    float   *img_w;
+    uint8_t *img_mask;
+    float   *rb_mem;
+    struct ring_buf_f32_s rbuf;
+    struct img_par_s *par;
+    struct img_perf_s perf;         // 硬件性能计数器，未打开时n为0
+    int      k;                     // 批处理帧数
+    int      state;
+    int      it;                    // 当前迭代序号，用于选择输入图像
+};
+
+// 被测滤波器
+struct bench_s
+{
+    const char *name;
+    const char *var;                // scalar, bat, mt
+    int         n_rd,n_wr;          // 每帧读、写的图像数，用于计算带宽
+    void      (*run)(struct bench_ctx_s *c);
+};
+
+static float coff5[5]={0.2f,0.2f,0.2f,0.2f,0.2f};
+static float coff9[9]={1.0f/16,2.0f/16,1.0f/16,2.0f/16,4.0f/16,2.0f/16,1.0f/16,2.0f/16,1.0f/16};
+static float coff3[3]={0.25f,0.5f,0.25f};
+static float sos[6]={0.2f,0.4f,0.2f,1.0f,-0.4f,0.2f};
+
+#define IN(c)   ((c)->frm[(c)->it%BENCH_FRM_N])
+#define INB(c)  ((c)->frm_bat[(c)->it%BENCH_FRM_N])
+
+static void b_copy         (struct bench_ctx_s *c) { img_copy(c->img_out,IN(c),IMG_SZ); }
+static void b_fir_cross    (struct bench_ctx_s *c) { img_fir_cross(c->img_out,IN(c),coff5); }
+static void b_fir_cross_sa (struct bench_ctx_s *c) { img_fir_cross_sa(c->img_st3,coff5,&c->rbuf); }
+static void b_fir_sqr3     (struct bench_ctx_s *c) { img_fir_sqr3(c->img_out,IN(c),coff9); }
+static void b_fir_sqr3_sa  (struct bench_ctx_s *c) { img_fir_sqr3_sa(c->img_st3,coff9,&c->rbuf); }
+static void b_mid_cross    (struct bench_ctx_s *c) { img_mid_cross(c->img_out,IN(c)); }
+static void b_mid_cross_sa (struct bench_ctx_s *c) { img_mid_cross_sa(c->img_st3,IN(c),&c->rbuf); }
+static void b_plane_mf     (struct bench_ctx_s *c) { img_plane_mf_sqr3(c->img_out,IN(c)); }
+static void b_plane_mf_sa  (struct bench_ctx_s *c) { img_plane_mf_sqr3_sa(c->img_st3,&c->rbuf); }
+static void b_nnf_sqr3     (struct bench_ctx_s *c) { img_nnf_sqr3(c->img_out,IN(c),0.05f); }
+static void b_nnd_sqr3     (struct bench_ctx_s *c) { img_nnd_sqr3(c->img_out,IN(c)); }
+static void b_iir_t        (struct bench_ctx_s *c) { img_iir_t(c->img_st1,IN(c),0.5f); }
+static void b_iir_sos      (struct bench_ctx_s *c) { img_iir_sos(c->img_out,IN(c),c->img_st1,c->img_st2,sos); }
+static void b_weighted_iir (struct bench_ctx_s *c) { img_weighted_iir(c->img_out,IN(c),c->img_st1,c->img_w,c->img_st2,0.5f); }
+static void b_fir3_t       (struct bench_ctx_s *c) { img_fir3_t(c->img_out,c->img_buf,IN(c),coff3,&c->state); }
+static void b_mid3_t       (struct bench_ctx_s *c) { img_mid3_t(c->img_out,c->img_buf,IN(c),&c->state); }
+static void b_max3_t       (struct bench_ctx_s *c) { img_max3_t(c->img_out,c->img_buf,IN(c),&c->state); }
+static void b_mid5_t       (struct bench_ctx_s *c) { img_mid5_t(c->img_out,c->img_buf,IN(c),&c->state); }
+static void b_minmax_avg5_t(struct bench_ctx_s *c) { img_minmax_avg5_t(c->img_out,c->img_buf,IN(c),&c->state); }
+static void b_max5_t       (struct bench_ctx_s *c) { img_max5_t(c->img_out,c->img_buf,IN(c),&c->state); }
+static void b_min5_t       (struct bench_ctx_s *c) { img_min5_t(c->img_out,c->img_buf,IN(c),&c->state); }
+static void b_fb_mid3_t    (struct bench_ctx_s *c) { img_fb_mid3_t(c->img_out,c->img_buf,IN(c),0.05f,&c->state); }
+static void b_nnf_sqr3_mid5(struct bench_ctx_s *c) { img_nnf_sqr3_mid5(c->img_out,c->img_buf,IN(c),&c->state,0.05f); }
+static void b_mid7_st      (struct bench_ctx_s *c) { img_mid7_st(c->img_out,c->img_buf,IN(c),&c->state); }
+
+static void b_hole_fill(struct bench_ctx_s *c)
+{
+    float *p=IN(c);
+    int n;
+    for (n=0;n<IMG_SZ;n++)
+        c->img_mask[n]=(p[n]!=0);
+    img_hole_fill(c->img_out,p,c->img_mask);
+}
+
+static void b_copy_bat           (struct bench_ctx_s *c) { img_copy(c->img_out,INB(c),IMG_SZ*c->k); }
+static void b_fir_sqr3_bat       (struct bench_ctx_s *c) { img_fir_sqr3_bat(c->img_out,INB(c),coff9,c->k); }
+static void b_plane_mf_bat       (struct bench_ctx_s *c) { img_plane_mf_sqr3_bat(c->img_out,INB(c),c->k); }
+static void b_iir_t_bat          (struct bench_ctx_s *c) { img_iir_t_bat(c->img_st1,INB(c),0.5f,c->k); }
+static void b_fir3_t_bat         (struct bench_ctx_s *c) { img_fir3_t_bat(c->img_out,c->img_buf,INB(c),coff3,c->k,&c->state); }
+static void b_mid3_t_bat         (struct bench_ctx_s *c) { img_mid3_t_bat(c->img_out,c->img_buf,INB(c),c->k,&c->state); }
+static void b_max3_t_bat         (struct bench_ctx_s *c) { img_max3_t_bat(c->img_out,c->img_buf,INB(c),c->k,&c->state); }
+static void b_mid5_t_bat         (struct bench_ctx_s *c) { img_mid5_t_bat(c->img_out,c->img_buf,INB(c),c->k,&c->state); }
+static void b_minmax_avg5_t_bat  (struct bench_ctx_s *c) { img_minmax_avg5_t_bat(c->img_out,c->img_buf,INB(c),c->k,&c->state); }
+static void b_max5_t_bat         (struct bench_ctx_s *c) { img_max5_t_bat(c->img_out,c->img_buf,INB(c),c->k,&c->state); }
+static void b_min5_t_bat         (struct bench_ctx_s *c) { img_min5_t_bat(c->img_out,c->img_buf,INB(c),c->k,&c->state); }
+
+static void b_fir_sqr3_mt        (struct bench_ctx_s *c) { img_fir_sqr3_bat_mt(c->img_out,IN(c),coff9,1,c->par); }
+static void b_plane_mf_mt        (struct bench_ctx_s *c) { img_plane_mf_sqr3_bat_mt(c->img_out,IN(c),1,c->par); }
+static void b_fir_sqr3_bat_mt    (struct bench_ctx_s *c) { img_fir_sqr3_bat_mt(c->img_out,INB(c),coff9,c->k,c->par); }
+static void b_plane_mf_bat_mt    (struct bench_ctx_s *c) { img_plane_mf_sqr3_bat_mt(c->img_out,INB(c),c->k,c->par); }
+
+// 被测滤波器表，原址滤波器(_sa)和IIR滤波器的状态图像算作读写各一次
+static const struct bench_s bench_tab[]=
+{
+    { "copy",               "scalar", 1, 1, b_copy              },
+    { "fir_cross",          "scalar", 1, 1, b_fir_cross         },
+    { "fir_cross_sa",       "scalar", 1, 1, b_fir_cross_sa      },
+    { "fir_sqr3",           "scalar", 1, 1, b_fir_sqr3          },
+    { "fir_sqr3_sa",        "scalar", 1, 1, b_fir_sqr3_sa       },
+    { "mid_cross",          "scalar", 1, 1, b_mid_cross         },
+    { "mid_cross_sa",       "scalar", 2, 1, b_mid_cross_sa      },
+    { "plane_mf_sqr3",      "scalar", 1, 1, b_plane_mf          },
+    { "plane_mf_sqr3_sa",   "scalar", 1, 1, b_plane_mf_sa       },
+    { "nnf_sqr3",           "scalar", 1, 1, b_nnf_sqr3          },
+    { "nnd_sqr3",           "scalar", 1, 1, b_nnd_sqr3          },
+    { "hole_fill",          "scalar", 1, 1, b_hole_fill         },
+    { "iir_t",              "scalar", 2, 1, b_iir_t             },
+    { "iir_sos",            "scalar", 3, 3, b_iir_sos           },
+    { "weighted_iir",       "scalar", 4, 3, b_weighted_iir      },
+    { "fir3_t",             "scalar", 3, 2, b_fir3_t            },
+    { "mid3_t",             "scalar", 3, 2, b_mid3_t            },
+    { "max3_t",             "scalar", 3, 2, b_max3_t            },
+    { "mid5_t",             "scalar", 5, 2, b_mid5_t            },
+    { "minmax_avg5_t",      "scalar", 5, 2, b_minmax_avg5_t     },
+    { "max5_t",             "scalar", 5, 2, b_max5_t            },
+    { "min5_t",             "scalar", 5, 2, b_min5_t            },
+    { "fb_mid3_t",          "scalar", 5, 2, b_fb_mid3_t         },
+    { "nnf_sqr3_mid5",      "scalar", 5, 2, b_nnf_sqr3_mid5     },
+    { "mid7_st",            "scalar", 3, 2, b_mid7_st           },
+
+    { "copy",               "bat",    1, 1, b_copy_bat          },
+    { "fir_sqr3",           "bat",    1, 1, b_fir_sqr3_bat      },
+    { "plane_mf_sqr3",      "bat",    1, 1, b_plane_mf_bat      },
+    { "iir_t",              "bat",    2, 1, b_iir_t_bat         },
+    { "fir3_t",             "bat",    3, 2, b_fir3_t_bat        },
+    { "mid3_t",             "bat",    3, 2, b_mid3_t_bat        },
+    { "max3_t",             "bat",    3, 2, b_max3_t_bat        },
+    { "mid5_t",             "bat",    5, 2, b_mid5_t_bat        },
+    { "minmax_avg5_t",      "bat",    5, 2, b_minmax_avg5_t_bat },
+    { "max5_t",             "bat",    5, 2, b_max5_t_bat        },
+    { "min5_t",             "bat",    5, 2, b_min5_t_bat        },
+
+    { "fir_sqr3",           "mt",     1, 1, b_fir_sqr3_mt       },
+    { "plane_mf_sqr3",      "mt",     1, 1, b_plane_mf_mt       },
+    { "fir_sqr3",           "bat_mt", 1, 1, b_fir_sqr3_bat_mt   },
+    { "plane_mf_sqr3",      "bat_mt", 1, 1, b_plane_mf_bat_mt   },
+};
+
+#define BENCH_TAB_SZ    ((int)(sizeof(bench_tab)/sizeof(bench_tab[0])))
+
+// 测试结果
+struct bench_res_s
+{
+    const struct bench_s *b;
+    int     k,n_thr;
+    double  ns_med,ns_min;          // 每帧时间（ns）
+    double  cyc_pix;                // 每像素时钟数
+    double  gbs;                    // 内存带宽（GB/s）
+    double  bw_frac;                // 相对于copy的带宽比例
+    double  ipc;                    // 每周期指令数
+    double  l1d,llc,brm;            // 每像素L1D缺失、LLC缺失、分支预测失败
+    double  bpp;                    // 每像素内存流量（bytes）
+};
+
+
+// 合成深度图像：倾斜平面加上起伏的物体，叠加噪声和随机空洞，单位m
+static void synth_frame(float *img, int seq, uint32_t *rnd)
+{
+    int x,y;
+    for (y=0;y<IMG_HGT;y++)
+        for (x=0;x<IMG_WID;x++)
+        {
+            float z=1.5f+0.5f*y/IMG_HGT;
+            float dx=x-IMG_WID*0.5f-10*sinf(seq*0.3f),dy=y-IMG_HGT*0.5f;
+            float n;
+
+            if (dx*dx+dy*dy<(IMG_HGT*IMG_HGT)/16)
+                z-=0.4f+0.05f*sinf(x*0.1f)*cosf(y*0.1f);
+
+            *rnd=*rnd*1664525u+1013904223u;
+            n=((*rnd>>8)&0xffff)/65536.0f-0.5f;
+            z+=0.01f*n;
+
+            *rnd=*rnd*1664525u+1013904223u;
+            if ((*rnd>>24)<8)                    // 约3%的空洞
+                z=0;
+            img[y*IMG_WID+x]=z;
+        }
+}
+
+
+// 从录制的原始数据文件读入BENCH_FRM_N帧，不足时循环使用
+static int load_frames(struct bench_ctx_s *c, const char *fname, int f32, float scale, long skip)
+{
+    FILE *fp=fopen(fname,"rb");
+    size_t esz=f32 ? sizeof(float) : sizeof(int16_t);
+    void *raw=malloc(esz*IMG_SZ);
+    int n,i;
+
+    if (fp==NULL || raw==NULL)
+    {
+        perror(fname);
+        if (fp) fclose(fp);
+        free(raw);
+        return -1;
+    }
+    for (n=0;n<BENCH_FRM_N;n++)
+    {
+        if (fread(raw,esz,IMG_SZ,fp)!=IMG_SZ)
+            break;
+        if (skip)
+            fseek(fp,skip,SEEK_CUR);
+        for (i=0;i<IMG_SZ;i++)
+            c->frm[n][i]=(f32 ? ((float *)raw)[i] : ((int16_t *)raw)[i])*scale;
+    }
+    fclose(fp);
+    free(raw);
+
+    if (n==0)
+    {
+        fprintf(stderr,"%s: less than one %dx%d frame\n",fname,IMG_WID,IMG_HGT);
+        return -1;
+    }
+    for (i=n;i<BENCH_FRM_N;i++)
+        img_copy(c->frm[i],c->frm[i%n],IMG_SZ);
+    return 0;
+}
+
+
+static int cmp_dbl(const void *a, const void *b)
+{
+    double x=*(const double *)a,y=*(const double *)b;
+    return x<y ? -1 : x>y;
+}
+
+
+// 测量一个滤波器：先预热，然后重复n_rep次，每次运行足够多的迭代使时间不少于t_min
+static void bench_one(struct bench_ctx_s *c, const struct bench_s *b, int n_rep, double t_min,
+                      struct bench_res_s *r)
+{
+    double t[BENCH_REP_MAX];
+    uint64_t t0,cyc0,cyc_sum=0,it_sum=0;
+    struct img_perf_cnt_s cnt;
+    int k=strncmp(b->var,"bat",3)==0 ? c->k : 1;
+    int n_it=1,i,j;
+
+    c->state=0;
+    c->it=0;
+    ring_buf_f32_init(&c->rbuf,c->rb_mem,3*IMG_WID);
+    img_copy(c->img_st3,c->frm[0],IMG_SZ);
+    memset(&cnt,0,sizeof(cnt));
+
+    // 预热并确定每次的迭代次数
+    for (;;)
+    {
+        t0=img_time_ns();
+        for (j=0;j<n_it;j++,c->it++)
+            b->run(c);
+        if (img_time_ns()-t0>=t_min*1e9 || n_it>=(1<<20))
+            break;
+        n_it*=2;
+    }
+
+    for (i=0;i<n_rep;i++)
+    {
+        img_perf_start(&c->perf);
+        cyc0=bench_cycles();
+        t0=img_time_ns();
+        for (j=0;j<n_it;j++,c->it++)
+            b->run(c);
+        t[i]=(double)(img_time_ns()-t0)/n_it/k;
+        cyc_sum+=bench_cycles()-cyc0;
+        img_perf_stop(&c->perf,&cnt);
+        it_sum+=n_it;
+    }
+    qsort(t,n_rep,sizeof(t[0]),cmp_dbl);
+
+    r->b=b;
+    r->k=k;
+    r->n_thr=strstr(b->var,"mt") ? img_par_threads(c->par) : 1;
+    r->ns_med=t[n_rep/2];
+    r->ns_min=t[0];
+    r->cyc_pix=(double)cyc_sum/it_sum/k/IMG_SZ;
+    r->gbs=(double)(b->n_rd+b->n_wr)*IMG_SZ*sizeof(float)/r->ns_med;
+    img_perf_derive(&cnt,(double)it_sum*k*IMG_SZ,&r->ipc,&r->l1d,&r->llc,&r->brm,&r->bpp);
+}
+
+
+static void print_res(FILE *fp, const char *fmt, const char *src, struct bench_res_s *r, int n, int perf)
+{
+    int i;
+
+    if (strcmp(fmt,"csv")==0)
+    {
+        fprintf(fp,"res,kernel,variant,k,threads,ns_frame_med,ns_frame_min,cyc_pix,gbs,bw_frac,"
+                   "ipc,l1d_pix,llc_pix,brm_pix,bytes_pix,src\n");
+        for (i=0;i<n;i++)
+            fprintf(fp,"%dx%d,%s,%s,%d,%d,%.0f,%.0f,%.3f,%.3f,%.3f,%.3f,%.4f,%.4f,%.4f,%.3f,%s\n",IMG_WID,IMG_HGT,
+                    r[i].b->name,r[i].b->var,r[i].k,r[i].n_thr,r[i].ns_med,r[i].ns_min,
+                    r[i].cyc_pix,r[i].gbs,r[i].bw_frac,r[i].ipc,r[i].l1d,r[i].llc,r[i].brm,r[i].bpp,src);
+    }
+    else if (strcmp(fmt,"json")==0)
+    {
+        fprintf(fp,"{\"res\":\"%dx%d\",\"src\":\"%s\",\"results\":[\n",IMG_WID,IMG_HGT,src);
+        for (i=0;i<n;i++)
+            fprintf(fp,"  {\"kernel\":\"%s\",\"variant\":\"%s\",\"k\":%d,\"threads\":%d,"
+                    "\"ns_frame_med\":%.0f,\"ns_frame_min\":%.0f,\"cyc_pix\":%.3f,\"gbs\":%.3f,\"bw_frac\":%.3f,"
+                    "\"ipc\":%.3f,\"l1d_pix\":%.4f,\"llc_pix\":%.4f,\"brm_pix\":%.4f,\"bytes_pix\":%.3f}%s\n",
+                    r[i].b->name,r[i].b->var,r[i].k,r[i].n_thr,r[i].ns_med,r[i].ns_min,
+                    r[i].cyc_pix,r[i].gbs,r[i].bw_frac,r[i].ipc,r[i].l1d,r[i].llc,r[i].brm,r[i].bpp,i+1<n ? "," : "");
+        fprintf(fp,"]}\n");
+    }
+    else
+    {
+        fprintf(fp,"%dx%d, %s\n",IMG_WID,IMG_HGT,src);
+        fprintf(fp,"%-18s %-7s %3s %3s %12s %12s %8s %8s %6s",
+                "kernel","variant","k","thr","ns/frame","min","cyc/pix","GB/s","bw");
+        if (perf)
+            fprintf(fp," %6s %8s %8s %8s %8s","ipc","l1d/pix","llc/pix","brm/pix","B/pix");
+        fprintf(fp,"\n");
+        for (i=0;i<n;i++)
+        {
+            fprintf(fp,"%-18s %-7s %3d %3d %12.0f %12.0f %8.2f %8.2f %6.2f",
+                    r[i].b->name,r[i].b->var,r[i].k,r[i].n_thr,r[i].ns_med,r[i].ns_min,
+                    r[i].cyc_pix,r[i].gbs,r[i].bw_frac);
+            if (perf)
+                fprintf(fp," %6.2f %8.4f %8.4f %8.4f %8.2f",r[i].ipc,r[i].l1d,r[i].llc,r[i].brm,r[i].bpp);
+            fprintf(fp,"\n");
+        }
+    }
+}
+
+
+// 和基准csv文件比较，返回变慢超过门限的滤波器个数
+static int compare_base(const char *fname, struct bench_res_s *r, int n, double tol)
+{
+    FILE *fp=fopen(fname,"r");
+    char line[512],res[32],name[64],var[16];
+    int k,n_thr,i,n_slow=0;
+    double ns;
+
+    if (fp==NULL)
+    {
+        perror(fname);
+        return -1;
+    }
+    while (fgets(line,sizeof(line),fp))
+    {
+        if (sscanf(line,"%31[^,],%63[^,],%15[^,],%d,%d,%lf",res,name,var,&k,&n_thr,&ns)!=6)
+            continue;
+        for (i=0;i<n;i++)
+        {
+            char res_cur[32];
+            sprintf(res_cur,"%dx%d",IMG_WID,IMG_HGT);
+            if (strcmp(res,res_cur) || strcmp(name,r[i].b->name) || strcmp(var,r[i].b->var)
+                || k!=r[i].k || n_thr!=r[i].n_thr)
+                continue;
+            if (r[i].ns_med>ns*(1+tol))
+            {
+                fprintf(stderr,"slower: %s %s k=%d thr=%d %.0f -> %.0f ns (%+.1f%%)\n",
+                        name,var,k,n_thr,ns,r[i].ns_med,(r[i].ns_med/ns-1)*100);
+                n_slow++;
+            }
+        }
+    }
+    fclose(fp);
+    return n_slow;
+}
+
+
+/*---------------------------------- 自检 -----------------------------------*/
+
+#define CHECK_N         4000        // 自检的随机点数
+
+// [-1,1)均匀分布的随机数
+static float rnd_f(uint32_t *rnd)
+{
+    *rnd=*rnd*1664525u+1013904223u;
+    return ((*rnd>>8)&0xffffff)/8388608.0f-1;
+}
+
+
+static float max_err(float e, float a, float b)
+{
+    float d=fabsf(a-b);
+    return d>e ? d : e;
+}
+
+
+#define CHECK_K         3           // 批处理自检的帧数
+#define CHECK_STEP      7           // 时间滤波自检的批数，多于历史帧数
+
+static float *c_fir3_t    (float *o, float *b, float *i, int *st)        { return img_fir3_t(o,b,i,coff3,st); }
+static float *c_fir3_t_bat(float *o, float *b, float *i, int k, int *st) { return img_fir3_t_bat(o,b,i,coff3,k,st); }
+
+// 时间滤波的单帧和批处理版本，历史图像最多4帧
+static const struct
+{
+    const char *name;
+    float    *(*one)(float *, float *, float *, int *);
+    float    *(*bat)(float *, float *, float *, int, int *);
+} chk_t_tab[]=
+{
+    { "fir3_t",         c_fir3_t,            c_fir3_t_bat            },
+    { "mid3_t",         img_mid3_t,          img_mid3_t_bat          },
+    { "max3_t",         img_max3_t,          img_max3_t_bat          },
+    { "mid5_t",         img_mid5_t,          img_mid5_t_bat          },
+    { "minmax_avg5_t",  img_minmax_avg5_t,   img_minmax_avg5_t_bat   },
+    { "max5_t",         img_max5_t,          img_max5_t_bat          },
+    { "min5_t",         img_min5_t,          img_min5_t_bat          },
+};
+
+#define CHK_T_SZ        ((int)(sizeof(chk_t_tab)/sizeof(chk_t_tab[0])))
+
+
+// 两帧图像去掉最外圈后不同的行数
+static int diff_inner(const float *a, const float *b)
+{
+    int y,n=0;
+
+    for (y=1;y<IMG_HGT-1;y++)
+        n+=memcmp(a+y*IMG_WID+1,b+y*IMG_WID+1,sizeof(float)*(IMG_WID-2))!=0;
+    return n;
+}
+
+
+// 批处理：k帧交织后的bat、bat_mt（以及k=1的mt）滤波结果拆分后和单帧滤波逐位相同，
+// 空间滤波不比较无效的最外圈；时间滤波每帧各自保存历史图像，连续比较CHECK_STEP批
+static int check_bat(uint32_t *rnd, struct img_par_s *par)
+{
+    float *mem=(float *)calloc((size_t)IMG_SZ*(14*CHECK_K+1),sizeof(float));
+    float *in[CHECK_K],*dout[CHECK_K],*obuf[CHECK_K],*ost[CHECK_K],*bin,*bout,*bbuf,*bst,*oout;
+    int st[CHECK_K],bs,n_bad=0,t,s,j;
+
+    if (mem==NULL)
+        return -1;
+    for (j=0;j<CHECK_K;j++)
+    {
+        in[j]  =mem+(size_t)IMG_SZ*j;
+        dout[j]=mem+(size_t)IMG_SZ*(CHECK_K+j);
+        ost[j] =mem+(size_t)IMG_SZ*(2*CHECK_K+j);
+        obuf[j]=mem+(size_t)IMG_SZ*(3*CHECK_K+4*j);
+    }
+    bin =mem+(size_t)IMG_SZ*7*CHECK_K;
+    bout=mem+(size_t)IMG_SZ*8*CHECK_K;
+    bst =mem+(size_t)IMG_SZ*9*CHECK_K;
+    bbuf=mem+(size_t)IMG_SZ*10*CHECK_K;
+    oout=mem+(size_t)IMG_SZ*14*CHECK_K;
+
+    // 空间滤波
+    for (j=0;j<CHECK_K;j++)
+        synth_frame(in[j],j,rnd);
+    img_interleave(bin,in,CHECK_K);
+    img_deinterleave(dout,img_fir_sqr3_bat(bout,bin,coff9,CHECK_K),CHECK_K);
+    for (j=0;j<CHECK_K;j++)
+        n_bad+=diff_inner(dout[j],img_fir_sqr3(oout,in[j],coff9));
+    img_deinterleave(dout,img_fir_sqr3_bat_mt(bout,bin,coff9,CHECK_K,par),CHECK_K);
+    for (j=0;j<CHECK_K;j++)
+        n_bad+=diff_inner(dout[j],img_fir_sqr3(oout,in[j],coff9));
+    n_bad+=diff_inner(img_fir_sqr3_bat_mt(bout,in[0],coff9,1,par),img_fir_sqr3(oout,in[0],coff9));
+    img_deinterleave(dout,img_plane_mf_sqr3_bat(bout,bin,CHECK_K),CHECK_K);
+    for (j=0;j<CHECK_K;j++)
+        n_bad+=diff_inner(dout[j],img_plane_mf_sqr3(oout,in[j]));
+    img_deinterleave(dout,img_plane_mf_sqr3_bat_mt(bout,bin,CHECK_K,par),CHECK_K);
+    for (j=0;j<CHECK_K;j++)
+        n_bad+=diff_inner(dout[j],img_plane_mf_sqr3(oout,in[j]));
+    n_bad+=diff_inner(img_plane_mf_sqr3_bat_mt(bout,in[0],1,par),img_plane_mf_sqr3(oout,in[0]));
+
+    // 1阶IIR，状态从第一批输入开始
+    for (s=0;s<CHECK_STEP;s++)
+    {
+        for (j=0;j<CHECK_K;j++)
+            synth_frame(in[j],s*CHECK_K+j,rnd);
+        img_interleave(bin,in,CHECK_K);
+        if (s==0)
+        {
+            img_copy(bst,bin,IMG_SZ*CHECK_K);
+            for (j=0;j<CHECK_K;j++)
+                img_copy(ost[j],in[j],IMG_SZ);
+        }
+        img_deinterleave(dout,img_iir_t_bat(bst,bin,0.5f,CHECK_K),CHECK_K);
+        for (j=0;j<CHECK_K;j++)
+            n_bad+=memcmp(dout[j],img_iir_t(ost[j],in[j],0.5f),sizeof(float)*IMG_SZ)!=0;
+    }
+
+    // 历史图像从0开始的时间滤波
+    for (t=0;t<CHK_T_SZ;t++)
+    {
+        memset(bbuf,0,sizeof(float)*IMG_SZ*4*CHECK_K);
+        memset(obuf[0],0,sizeof(float)*IMG_SZ*4*CHECK_K);
+        bs=0;
+        for (j=0;j<CHECK_K;j++)
+            st[j]=0;
+        for (s=0;s<CHECK_STEP;s++)
+        {
+            int n0=n_bad;
+
+            for (j=0;j<CHECK_K;j++)
+                synth_frame(in[j],s*CHECK_K+j,rnd);
+            img_interleave(bin,in,CHECK_K);
+            img_deinterleave(dout,chk_t_tab[t].bat(bout,bbuf,bin,CHECK_K,&bs),CHECK_K);
+            for (j=0;j<CHECK_K;j++)
+                n_bad+=memcmp(dout[j],chk_t_tab[t].one(oout,obuf[j],in[j],&st[j]),sizeof(float)*IMG_SZ)!=0;
+            if (n_bad>n0)
+                fprintf(stderr,"bat: %s differs at batch %d\n",chk_t_tab[t].name,s);
+        }
+    }
+    free(mem);
+
+    printf("bat: %d mismatches, k=%d, fir_sqr3/plane_mf_sqr3 bat/bat_mt/mt, iir_t and %d temporal kernels\n",
+           n_bad,CHECK_K,CHK_T_SZ);
+    return n_bad ? -1 : 0;
+}
+
+
+// 刚体变换：四元数->矩阵->四元数往返、T*T^-1为单位阵、
+// 输出和只有一个的位姿相同时的复合、img_rigid_apply和逐点矩阵乘法比较
+static int check_rigid(uint32_t *rnd, struct img_par_s *par)
+{
+    float qt[8*7],qt2[8*7],T[8*16],Ti[8*16],I[8*16],R[8*16],C[8*16],e_qt=0,e_inv=0,e_cmp=0,e_app=0;
+    int n=IMG_RIGID_MT_MIN,i,j;                 // 点数达到多线程门限，同时检查分段
+    float *x=malloc(sizeof(float)*n*6),*y=x+n,*z=y+n,*x0=z+n,*y0=x0+n,*z0=y0+n;
+
+    if (x==NULL)
+        return -1;
+    for (i=0;i<8;i++)
+    {
+        float *q=qt+i*7,s=0;
+        for (j=0;j<7;j++)
+            q[j]=rnd_f(rnd);
+        for (j=0;j<4;j++)
+            s+=q[j]*q[j];
+        s=(q[0]<0 ? -1 : 1)/sqrtf(s);           // 归一化，qw不小于0，和img_rigid_to_qt的输出比较
+        for (j=0;j<4;j++)
+            q[j]*=s;
+    }
+    img_rigid_from_qt(T,qt,8);
+    img_rigid_to_qt(qt2,T,8);
+    img_rigid_inverse(Ti,T,8);
+    img_rigid_compose(I,T,8,Ti,8);
+    for (i=0;i<8*7;i++)
+        e_qt=max_err(e_qt,qt[i],qt2[i]);
+    for (i=0;i<8*16;i++)
+        e_inv=max_err(e_inv,I[i],(i%16)%5==0);
+    img_rigid_compose(R,T,1,Ti,8);
+    memcpy(C,T,sizeof(C));
+    img_rigid_compose(C,C,1,Ti,8);
+    for (i=0;i<8*16;i++)
+        e_cmp=max_err(e_cmp,C[i],R[i]);
+    img_rigid_compose(R,T,8,Ti,1);
+    memcpy(C,Ti,sizeof(C));
+    img_rigid_compose(C,T,8,C,1);
+    for (i=0;i<8*16;i++)
+        e_cmp=max_err(e_cmp,C[i],R[i]);
+
+    for (i=0;i<n;i++)
+    {
+        x[i]=x0[i]=rnd_f(rnd)*4;
+        y[i]=y0[i]=rnd_f(rnd)*4;
+        z[i]=z0[i]=rnd_f(rnd)*4;
+    }
+    img_rigid_apply(x,y,z,NULL,NULL,NULL,n,T,par);
+    for (i=0;i<n;i++)
+    {
+        e_app=max_err(e_app,x[i],T[0]*x0[i]+T[1]*y0[i]+T[2] *z0[i]+T[3]);
+        e_app=max_err(e_app,y[i],T[4]*x0[i]+T[5]*y0[i]+T[6] *z0[i]+T[7]);
+        e_app=max_err(e_app,z[i],T[8]*x0[i]+T[9]*y0[i]+T[10]*z0[i]+T[11]);
+    }
+    free(x);
+
+    printf("rigid: qt round trip %.2g, T*inv(T) %.2g, aliased compose %.2g, apply %.2g\n",e_qt,e_inv,e_cmp,e_app);
+    return (e_qt<1e-5f && e_inv<1e-5f && e_cmp==0 && e_app<1e-5f) ? 0 : -1;
+}
+
+
+// 反投影：f32、u16和crop（距离过滤、变换、序号）与逐像素x=(u-cx-skew*y0)/fx*z、y=(v-cy)/fy*z比较，
+// 有畸变时射线表按Brown-Conrady模型重新投影，应回到像素中心
+static int check_deproj(uint32_t *rnd, struct img_par_s *par)
+{
+    struct img_cam_s cam={IMG_WID*0.7f,IMG_WID*0.71f,IMG_WID*0.5f-3.5f,IMG_HGT*0.5f+2.25f,0.5f,0,0,0,0,0};
+    struct img_deproj_s dp;
+    struct img_pool_s pool;
+    float qt[7],T[16],*mem=malloc(sizeof(float)*IMG_SZ*7),*dep=mem,*x=dep+IMG_SZ,*y=x+IMG_SZ,*z=y+IMG_SZ,*z16=z+IMG_SZ;
+    float dmin=1.4f,dmax=1.9f,e_xyz=0,e_crop=0,e_uv=0;
+    uint16_t *d16=(uint16_t *)(z16+IMG_SZ);
+    int32_t *idx=(int32_t *)(z16+2*IMG_SZ);
+    int n_bad=0,u16,n,i,j;
+
+    if (mem==NULL || img_pool_init(&pool,sizeof(float)*IMG_SZ*4+(1u<<20),0))
+    {
+        free(mem);
+        return -1;
+    }
+    synth_frame(dep,0,rnd);
+    for (i=0;i<IMG_SZ;i++)
+    {
+        d16[i]=(uint16_t)(dep[i]*1000+0.5f);
+        z16[i]=d16[i]*0.001f;
+    }
+    for (i=0;i<7;i++)
+        qt[i]=rnd_f(rnd);
+    img_rigid_from_qt(T,qt,1);
+    if (img_deproj_init(&dp,&cam,&pool))
+    {
+        n_bad=1;
+        goto done;
+    }
+
+    for (u16=0;u16<2;u16++)
+    {
+        const float *d=u16 ? z16 : dep;
+
+        if (u16)
+            img_deproj_u16(&dp,x,y,z,d16,0.001f,par);
+        else
+            img_deproj_f32(&dp,x,y,z,dep,par);
+        for (i=0;i<IMG_SZ;i++)
+        {
+            double y0=(i/IMG_WID-cam.cy)/(double)cam.fy,x0=(i%IMG_WID-cam.cx-cam.skew*y0)/cam.fx;
+            e_xyz=max_err(e_xyz,x[i],(float)(x0*d[i]));
+            e_xyz=max_err(e_xyz,y[i],(float)(y0*d[i]));
+            e_xyz=max_err(e_xyz,z[i],d[i]);
+        }
+
+        // 按像素顺序保留的点和变换后的坐标
+        n=u16 ? img_deproj_crop_u16(&dp,x,y,z,idx,d16,0.001f,dmin,dmax,T,par)
+              : img_deproj_crop_f32(&dp,x,y,z,idx,dep,dmin,dmax,T,par);
+        for (i=0,j=0;i<IMG_SZ;i++)
+        {
+            double y0=(i/IMG_WID-cam.cy)/(double)cam.fy,x0=(i%IMG_WID-cam.cx-cam.skew*y0)/cam.fx;
+            double px=x0*d[i],py=y0*d[i],pz=d[i];
+
+            if (!(d[i]>0 && d[i]>=dmin && d[i]<=dmax))
+                continue;
+            if (j>=n || idx[j]!=i)
+            {
+                n_bad++;
+                break;
+            }
+            e_crop=max_err(e_crop,x[j],(float)(T[0]*px+T[1]*py+T[2] *pz+T[3]));
+            e_crop=max_err(e_crop,y[j],(float)(T[4]*px+T[5]*py+T[6] *pz+T[7]));
+            e_crop=max_err(e_crop,z[j],(float)(T[8]*px+T[9]*py+T[10]*pz+T[11]));
+            j++;
+        }
+        n_bad+=(j!=n);
+    }
+    img_deproj_release(&dp);
+
+    // 畸变：射线(rx,ry)加上畸变再乘以内参，和像素坐标比较
+    cam.k1=-0.1f; cam.k2=0.05f; cam.p1=1e-3f; cam.p2=-5e-4f; cam.k3=0.01f;
+    if (img_deproj_init(&dp,&cam,&pool))
+    {
+        n_bad=1;
+        goto done;
+    }
+    for (i=0;i<IMG_SZ;i++)
+    {
+        double rx=dp.rx[i],ry=dp.ry[i],r2=rx*rx+ry*ry,rd=1+((cam.k3*r2+cam.k2)*r2+cam.k1)*r2;
+        double xd=rx*rd+2*cam.p1*rx*ry+cam.p2*(r2+2*rx*rx),yd=ry*rd+cam.p1*(r2+2*ry*ry)+2*cam.p2*rx*ry;
+        e_uv=max_err(e_uv,(float)(cam.fx*xd+cam.skew*yd+cam.cx),(float)(i%IMG_WID));
+        e_uv=max_err(e_uv,(float)(cam.fy*yd+cam.cy),(float)(i/IMG_WID));
+    }
+    img_deproj_release(&dp);
+
+done:
+    img_pool_destroy(&pool);
+    free(mem);
+    printf("deproj: xyz %.2g, crop %d mismatches %.2g, undistort %.2g px\n",e_xyz,n_bad,e_crop,e_uv);
+    return (n_bad==0 && e_xyz<1e-5f && e_crop<1e-5f && e_uv<1e-3f) ? 0 : -1;
+}
+
+
+// 法向量和真值的最大夹角（rad），平均夹角存入*avg；n0为NULL时真值为(x-cx,y-cy,z-cz)/R（球面），
+// 有效像素应覆盖离边沿b个像素以外的全部像素，否则记为出错
+static float normal_err(const float *nx, const float *ny, const float *nz, const float *x, const float *y, const float *z,
+                        const float *n0, const float *c, float R, int b, float *avg, int *n_bad)
+{
+    double sum=0;
+    float e=0;
+    int u,v;
+
+    for (v=b;v<IMG_HGT-b;v++)
+        for (u=b;u<IMG_WID-b;u++)
+        {
+            int p=v*IMG_WID+u;
+            float tx=n0 ? n0[0] : (x[p]-c[0])/R,ty=n0 ? n0[1] : (y[p]-c[1])/R,tz=n0 ? n0[2] : (z[p]-c[2])/R;
+            float d=nx[p]*tx+ny[p]*ty+nz[p]*tz,a=acosf(d<1 ? d : 1);
+
+            if (nx[p]==0 && ny[p]==0 && nz[p]==0)
+                (*n_bad)++;
+            e=(a>e) ? a : e;
+            sum+=a;
+        }
+    *avg=(float)(sum/((IMG_HGT-2*b)*(IMG_WID-2*b)));
+    return e;
+}
+
+
+// 法向量：平面和球面（相机在球外，整幅图像都在球面上）上CROSS、COV模式的法向量和真值的夹角，平面的曲率为0；
+// 有噪声的平面上COV窗口拟合的平均夹角应明显小于CROSS；
+// 平面上用平面匹配滤波斜率计算的法向量（img_normal_grad），以及ext版本输出的深度和img_plane_mf_sqr3逐位相同
+static int check_normal(uint32_t *rnd, struct img_par_s *par)
+{
+    struct img_cam_s cam={IMG_WID*0.7f,IMG_WID*0.7f,IMG_WID*0.5f,IMG_HGT*0.5f,0,0,0,0,0,0};
+    const float c[3]={0.3f,-0.2f,6},R=5,s=1/sqrtf(0.2f*0.2f+0.3f*0.3f+1);
+    const float n0[3]={0.2f*s,-0.3f*s,-s};
+    struct img_deproj_s dp;
+    struct img_normal_s ne[2];
+    struct img_pool_s pool;
+    float *mem=malloc(sizeof(float)*IMG_SZ*12),*x=mem,*y=x+IMG_SZ,*z=y+IMG_SZ,*nx=z+IMG_SZ,*ny=nx+IMG_SZ,*nz=ny+IMG_SZ;
+    float *gx=nz+IMG_SZ,*gy=gx+IMG_SZ,*res=gy+IMG_SZ,*out=res+IMG_SZ,*out2=out+IMG_SZ,*curv=out2+IMG_SZ;
+    float e_pl[2]={0,0},e_sp[2]={0,0},e_ns[2]={0,0},e_grad=0,c_max=0,avg;
+    int n_bad=0,m,i;
+
+    memset(ne,0,sizeof(ne));
+    if (mem==NULL || img_pool_init(&pool,sizeof(double)*(IMG_HGT+1)*(IMG_WID+1)*IMG_NORMAL_II+sizeof(float)*IMG_SZ*2+(4u<<20),0))
+    {
+        free(mem);
+        return -1;
+    }
+    if (img_deproj_init(&dp,&cam,&pool) || img_normal_init(&ne[0],IMG_NORMAL_CROSS,1,0.05f,&pool)
+        || img_normal_init(&ne[1],IMG_NORMAL_COV,3,0.05f,&pool))
+    {
+        n_bad=1;
+        goto done;
+    }
+
+    // 平面n0·p=n0·(0,0,2)：z=2*n0z/(n0·(rx,ry,1))
+    for (i=0;i<IMG_SZ;i++)
+        z[i]=2*n0[2]/(n0[0]*dp.rx[i]+n0[1]*dp.ry[i]+n0[2]);
+    img_deproj_f32(&dp,x,y,z,z,par);
+    for (m=0;m<2;m++)
+    {
+        img_normal_run(&ne[m],nx,ny,nz,curv,x,y,z,par);
+        e_pl[m]=normal_err(nx,ny,nz,x,y,z,n0,NULL,0,ne[m].r,&avg,&n_bad);
+    }
+    for (i=0;i<IMG_SZ;i++)
+        c_max=(curv[i]>c_max) ? curv[i] : c_max;
+    img_plane_mf_sqr3_ext_bat_mt(out,gx,gy,res,z,1,par);
+    n_bad+=diff_inner(out,img_plane_mf_sqr3(out2,z));
+    img_normal_grad(&dp,nx,ny,nz,z,gx,gy,par);
+    e_grad=normal_err(nx,ny,nz,x,y,z,n0,NULL,0,1,&avg,&n_bad);
+
+    // 同一平面加上±1mm的深度噪声，比较平均夹角
+    for (i=0;i<IMG_SZ;i++)
+        z[i]+=0.001f*rnd_f(rnd);
+    img_deproj_f32(&dp,x,y,z,z,par);
+    for (m=0;m<2;m++)
+    {
+        img_normal_run(&ne[m],nx,ny,nz,curv,x,y,z,par);
+        normal_err(nx,ny,nz,x,y,z,n0,NULL,0,ne[m].r,&e_ns[m],&n_bad);
+    }
+
+    // 球面的近侧交点：t^2|r|^2-2t(r·c)+|c|^2-R^2=0
+    for (i=0;i<IMG_SZ;i++)
+    {
+        double rx=dp.rx[i],ry=dp.ry[i],rr=rx*rx+ry*ry+1,rc=rx*c[0]+ry*c[1]+c[2];
+        z[i]=(float)((rc-sqrt(rc*rc-rr*((double)c[0]*c[0]+c[1]*c[1]+c[2]*c[2]-R*R)))/rr);
+    }
+    img_deproj_f32(&dp,x,y,z,z,par);
+    for (m=0;m<2;m++)
+    {
+        img_normal_run(&ne[m],nx,ny,nz,curv,x,y,z,par);
+        e_sp[m]=normal_err(nx,ny,nz,x,y,z,NULL,c,R,ne[m].r,&avg,&n_bad);
+    }
+
+done:
+    img_normal_release(&ne[0]);
+    img_normal_release(&ne[1]);
+    img_deproj_release(&dp);
+    img_pool_destroy(&pool);
+    free(mem);
+    printf("normal: plane cross %.2g cov %.2g (curvature %.2g) grad %.2g, sphere cross %.2g cov %.2g, "
+           "noisy plane mean cross %.2g cov %.2g rad, %d mismatches\n",
+           e_pl[0],e_pl[1],c_max,e_grad,e_sp[0],e_sp[1],e_ns[0],e_ns[1],n_bad);
+    return (n_bad==0 && e_pl[0]<2e-3f && e_pl[1]<2e-3f && c_max<1e-4f && e_grad<2e-3f && e_sp[0]<5e-3f && e_sp[1]<5e-3f
+            && e_ns[1]<0.5f*e_ns[0]) ? 0 : -1;
+}
+
+
+// 投影：反投影的点云投影回同一相机（针孔和有畸变）应得到原深度图和像素序号；
+// z缓冲检查把点云复制3份（远1.1倍、原位置、原位置重复）一起投影，每个像素应是原位置点中序号小的一份，
+// splat半径1时和3x3邻域内（深度，序号）最小的点比较；单线程和多线程结果相同
+static int check_proj(uint32_t *rnd, struct img_par_s *par)
+{
+    struct img_cam_s cam={IMG_WID*0.7f,IMG_WID*0.72f,IMG_WID*0.5f+1.5f,IMG_HGT*0.5f-2.5f,0,0,0,0,0,0};
+    struct img_deproj_s dp;
+    struct img_proj_s pj;
+    struct img_pool_s pool;
+    float *mem=malloc(sizeof(float)*IMG_SZ*14),*dep=mem,*x=dep+IMG_SZ,*y=x+3*IMG_SZ,*z=y+3*IMG_SZ,*out=z+3*IMG_SZ,*out1=out+IMG_SZ;
+    int32_t *idx=(int32_t *)(out1+IMG_SZ),*idx1=idx+IMG_SZ;
+    int n_bad=0,pass,i,j,u,v,du,dv;
+
+    if (mem==NULL || img_pool_init(&pool,sizeof(float)*IMG_SZ*6+(4u<<20),0))
+    {
+        free(mem);
+        return -1;
+    }
+    synth_frame(dep,0,rnd);
+    for (pass=0;pass<3;pass++)
+    {
+        if (pass==1)
+        {
+            cam.k1=-0.1f; cam.k2=0.05f; cam.p1=1e-3f; cam.p2=-5e-4f; cam.k3=0.01f;
+        }
+        if (img_deproj_init(&dp,&cam,&pool) || img_proj_init(&pj,&cam,&pool))
+        {
+            img_deproj_release(&dp);
+            n_bad++;
+            break;
+        }
+        img_deproj_f32(&dp,x,y,z,dep,par);
+        if (pass<2)
+        {
+            img_proj_run(&pj,out,idx,NULL,x,y,z,NULL,IMG_SZ,NULL,0,par);
+            for (i=0;i<IMG_SZ;i++)
+                n_bad+=(out[i]!=dep[i]) || (idx[i]!=(dep[i]>0 ? i : -1));
+        }
+        else
+        {
+            for (i=0;i<IMG_SZ;i++)
+            {
+                x[IMG_SZ+i]=x[2*IMG_SZ+i]=x[i];
+                y[IMG_SZ+i]=y[2*IMG_SZ+i]=y[i];
+                z[IMG_SZ+i]=z[2*IMG_SZ+i]=z[i];
+                x[i]*=1.1f; y[i]*=1.1f; z[i]*=1.1f;
+            }
+            img_proj_run(&pj,out,idx,NULL,x,y,z,NULL,3*IMG_SZ,NULL,0,par);
+            for (i=0;i<IMG_SZ;i++)
+                n_bad+=(out[i]!=dep[i]) || (idx[i]!=(dep[i]>0 ? IMG_SZ+i : -1));
+            img_proj_run(&pj,out,idx,NULL,x,y,z,NULL,3*IMG_SZ,NULL,1,par);
+            img_proj_run(&pj,out1,idx1,NULL,x,y,z,NULL,3*IMG_SZ,NULL,1,NULL);
+            for (v=0;v<IMG_HGT;v++)
+                for (u=0;u<IMG_WID;u++)
+                {
+                    int b=-1;
+
+                    for (dv=-1;dv<=1;dv++)
+                        for (du=-1;du<=1;du++)
+                        {
+                            if (u+du<0 || u+du>=IMG_WID || v+dv<0 || v+dv>=IMG_HGT)
+                                continue;
+                            j=(v+dv)*IMG_WID+u+du;
+                            if (dep[j]>0 && (b<0 || dep[j]<dep[b] || (dep[j]==dep[b] && j<b)))
+                                b=j;
+                        }
+                    i=v*IMG_WID+u;
+                    n_bad+=(out[i]!=(b<0 ? 0 : dep[b])) || (idx[i]!=(b<0 ? -1 : IMG_SZ+b));
+                }
+            n_bad+=memcmp(out,out1,sizeof(float)*IMG_SZ)!=0 || memcmp(idx,idx1,sizeof(int32_t)*IMG_SZ)!=0;
+        }
+        img_proj_release(&pj);
+        img_deproj_release(&dp);
+    }
+    img_pool_destroy(&pool);
+    free(mem);
+    printf("proj: %d mismatches (round trip, distorted round trip, z-buffer and splat)\n",n_bad);
+    return n_bad ? -1 : 0;
+}
+
+
+// 彩色相机投影，和img_reg.c相同的float运算（加0.5，取整即为四舍五入）
+static void reg_proj_ref(const struct img_cam_s *c, float qx, float qy, float qz, float *u, float *v)
+{
+    float iz=1/qz,xn=qx*iz,yn=qy*iz,r2=xn*xn+yn*yn;
+    float k=1+r2*(c->k1+r2*(c->k2+r2*c->k3));
+    float xd=xn*k+2*c->p1*xn*yn+c->p2*(r2+2*xn*xn);
+    float yd=yn*k+c->p1*(r2+2*yn*yn)+2*c->p2*xn*yn;
+
+    *u=c->fx*xd+c->skew*yd+c->cx+0.5f;
+    *v=c->fy*yd+c->cy+0.5f;
+}
+
+
+// 配准：同轴同内参时每个深度像素映射到同一序号的彩色像素，对齐到彩色图的深度等于原深度；
+// 有视差和彩色相机畸变时和逐像素计算的映射、z缓冲、3x3邻域遮挡判断、取色和对齐深度逐个比较，
+// 映射到的彩色像素和double计算的投影位置相差不超过半个像素；单线程和多线程结果相同
+static int check_reg(uint32_t *rnd, struct img_par_s *par)
+{
+    enum { CW=640, CH=480 };
+    struct img_cam_s cam={IMG_WID*0.7f,IMG_WID*0.7f,IMG_WID*0.5f,IMG_HGT*0.5f,0,0,0,0,0,0};
+    struct img_cam_s cam_c={525,527,319.5f,241.5f,0.3f,0.05f,-0.1f,2e-4f,-3e-4f,0.01f};
+    const float tol=0.02f;
+    struct img_reg_s reg;
+    struct img_pool_s pool;
+    float qt[7]={1,0.01f,-0.02f,0.015f,0,0,0},T[16],R[9],t[3]={0,0,0},e_uv=0;
+    float *mem=malloc(sizeof(float)*(IMG_SZ*2+CW*CH*3)),*dep=mem,*cz=dep+IMG_SZ,*dep_c=cz+IMG_SZ,*dep_c1=dep_c+CW*CH,*zr=dep_c1+CW*CH;
+    int32_t *idx=malloc(sizeof(int32_t)*IMG_SZ*3),*idx1=idx+IMG_SZ,*ci=idx1+IMG_SZ;
+    uint8_t *rgb=malloc(CW*CH*3+IMG_SZ*6),*rgb_out=rgb+CW*CH*3,*rgb_out1=rgb_out+IMG_SZ*3;
+    int n_bad=0,pass,cw,ch,i,k;
+
+    if (mem==NULL || idx==NULL || rgb==NULL || img_pool_init(&pool,sizeof(float)*(IMG_SZ*12+CW*(CH+2)+2)+(4u<<20),0))
+    {
+        free(mem); free(idx); free(rgb);
+        return -1;
+    }
+    synth_frame(dep,0,rnd);
+    for (i=0;i<CW*CH*3;i++)
+    {
+        *rnd=*rnd*1664525u+1013904223u;
+        rgb[i]=(uint8_t)(*rnd>>24);
+    }
+    img_rigid_from_qt(T,qt,1);
+    for (pass=0;pass<2;pass++)
+    {
+        const struct img_cam_s *c=pass ? &cam_c : &cam;
+
+        cw=pass ? CW : IMG_WID;
+        ch=pass ? CH : IMG_HGT;
+        for (i=0;i<9;i++)
+            R[i]=pass ? T[i/3*4+i%3] : (i%4==0);
+        if (pass)
+        {
+            t[0]=0.025f; t[1]=0.001f; t[2]=-0.002f;
+        }
+        if (img_reg_init(&reg,&cam,c,cw,ch,R,t,&pool))
+        {
+            n_bad++;
+            break;
+        }
+        img_reg_run(&reg,rgb_out,idx,dep_c,dep,rgb,tol,par);
+        img_reg_run(&reg,rgb_out1,idx1,dep_c1,dep,rgb,tol,NULL);
+        n_bad+=memcmp(idx,idx1,sizeof(int32_t)*IMG_SZ)!=0 || memcmp(rgb_out,rgb_out1,IMG_SZ*3)!=0
+               || memcmp(dep_c,dep_c1,sizeof(float)*cw*ch)!=0;
+
+        // 逐像素映射和z缓冲
+        for (i=0;i<cw*ch;i++)
+            zr[i]=INFINITY;
+        for (k=0;k<IMG_SZ;k++)
+        {
+            float rx=reg.dp.rx[k],ry=reg.dp.ry[k],z=dep[k],uf,vf;
+            float ax=R[0]*rx+R[1]*ry+R[2],ay=R[3]*rx+R[4]*ry+R[5],az=R[6]*rx+R[7]*ry+R[8],qz=z*az+t[2];
+
+            if (pass)
+                reg_proj_ref(c,z*ax+t[0],z*ay+t[1],qz,&uf,&vf);
+            else
+                reg_proj_ref(c,ax,ay,az,&uf,&vf);
+            cz[k]=qz;
+            ci[k]=(z>0 && qz>0 && uf>=0 && uf<cw && vf>=0 && vf<ch) ? (int)vf*cw+(int)uf : -1;
+            if (ci[k]<0)
+                continue;
+            zr[ci[k]]=(qz<zr[ci[k]]) ? qz : zr[ci[k]];
+            if (pass==0)
+                n_bad+=(ci[k]!=k);
+            else
+            {
+                // 和double计算的投影位置比较
+                double px=z*((double)R[0]*rx+R[1]*ry+R[2])+t[0],py=z*((double)R[3]*rx+R[4]*ry+R[5])+t[1];
+                double pz=z*((double)R[6]*rx+R[7]*ry+R[8])+t[2],xn=px/pz,yn=py/pz,r2=xn*xn+yn*yn;
+                double kd=1+r2*(c->k1+r2*(c->k2+r2*c->k3));
+                double xd=xn*kd+2*c->p1*xn*yn+c->p2*(r2+2*xn*xn),yd=yn*kd+c->p1*(r2+2*yn*yn)+2*c->p2*xn*yn;
+                float eu=(float)fabs(c->fx*xd+c->skew*yd+c->cx-ci[k]%cw),ev=(float)fabs(c->fy*yd+c->cy-ci[k]/cw);
+                e_uv=(eu>e_uv) ? eu : e_uv;
+                e_uv=(ev>e_uv) ? ev : e_uv;
+            }
+        }
+
+        // 遮挡：3x3邻域（按彩色像素序号相邻，同img_reg.c）的最小深度
+        for (k=0;k<IMG_SZ;k++)
+        {
+            float zmin=INFINITY;
+            int vis=0,dv,du;
+
+            if (ci[k]>=0)
+            {
+                for (dv=-1;dv<=1;dv++)
+                    for (du=-1;du<=1;du++)
+                    {
+                        i=ci[k]+dv*cw+du;
+                        if (i>=0 && i<cw*ch && zr[i]<zmin)
+                            zmin=zr[i];
+                    }
+                vis=(cz[k]<=zmin*(1+tol));
+            }
+            n_bad+=(idx[k]!=(vis ? ci[k] : -1));
+            for (i=0;i<3;i++)
+                n_bad+=(rgb_out[3*k+i]!=(vis ? rgb[3*ci[k]+i] : 0));
+        }
+        for (i=0;i<cw*ch;i++)
+            n_bad+=(dep_c[i]!=(isinf(zr[i]) ? 0 : zr[i]));
+        img_reg_release(&reg);
+    }
+    img_pool_destroy(&pool);
+    free(mem); free(idx); free(rgb);
+    printf("reg: %d mismatches (coaxial, parallax with color distortion), mapping %.2g px from the pixel centre\n",
+           n_bad,e_uv);
+    return (n_bad==0 && e_uv<0.5f+1e-3f) ? 0 : -1;
+}
+
+
+// KD树：k近邻和半径查询与暴力搜索比较（查询点一半是建树的点），
+// 再交换两组点建树，两个方向的半径查询找到的点对数应该相同
+static int check_kdt(uint32_t *rnd, struct img_par_s *par)
+{
+    enum { M=500, K=8, KR=64 };
+    const float r=0.15f,eps=1e-5f;
+    struct img_kdt_s ta,tb,te;
+    float *x=malloc(sizeof(float)*(CHECK_N+M)*3),*y=x+CHECK_N+M,*z=y+CHECK_N+M;
+    float *qx=x+CHECK_N,*qy=y+CHECK_N,*qz=z+CHECK_N;
+    float *d=malloc(sizeof(float)*(CHECK_N+M*KR)),*dist=d+CHECK_N;
+    int32_t *idx=malloc(sizeof(int32_t)*(CHECK_N*KR+M*3)),*cnt=idx+CHECK_N*KR,*n_lo=cnt+M,*n_hi=n_lo+M;
+    long n_ab=0,n_ba=0;
+    int n_bad=0,i,j,l;
+
+    memset(&ta,0,sizeof(ta));
+    memset(&tb,0,sizeof(tb));
+    memset(&te,0,sizeof(te));
+    if (x==NULL || d==NULL || idx==NULL)
+    {
+        free(x); free(d); free(idx);
+        return -1;
+    }
+    for (i=0;i<CHECK_N;i++)
+    {
+        x[i]=rnd_f(rnd); y[i]=rnd_f(rnd); z[i]=rnd_f(rnd);
+    }
+    for (i=0;i<M;i++)
+        if (i&1)
+        {
+            qx[i]=x[i*7]; qy[i]=y[i*7]; qz[i]=z[i*7];
+        }
+        else
+        {
+            qx[i]=rnd_f(rnd); qy[i]=rnd_f(rnd); qz[i]=rnd_f(rnd);
+        }
+    // 空树也可以建立
+    if (img_kdt_build(&ta,x,y,z,CHECK_N,16,par) || img_kdt_build(&tb,qx,qy,qz,M,4,par) || img_kdt_build(&te,x,y,z,0,16,par))
+    {
+        n_bad=1;
+        goto done;
+    }
+
+    // k近邻：序号和距离一致、按距离排序，建树的点最近的是自己，
+    // 比第k近距离近的点不超过k-1个、不远于第k近距离的点不少于k个
+    img_kdt_query(&ta,qx,qy,qz,M,K,0,idx,dist,NULL,par);
+    for (i=0;i<M;i++)
+    {
+        float dk=dist[i*K+K-1];
+        int c_lt=0,c_le=0;
+
+        for (j=0;j<CHECK_N;j++)
+        {
+            float ex=x[j]-qx[i],ey=y[j]-qy[i],ez=z[j]-qz[i];
+            d[j]=sqrtf(ex*ex+ey*ey+ez*ez);
+        }
+        for (l=0;l<K;l++)
+        {
+            int32_t id=idx[i*K+l];
+            if (id<0 || id>=CHECK_N || fabsf(d[id]-dist[i*K+l])>eps || (l>0 && dist[i*K+l]<dist[i*K+l-1]))
+                n_bad++;
+        }
+        n_bad+=(i&1) && dist[i*K]!=0;
+        n_lo[i]=n_hi[i]=0;
+        for (j=0;j<CHECK_N;j++)
+        {
+            c_lt+=(d[j]<dk-eps);
+            c_le+=(d[j]<=dk+eps);
+            n_lo[i]+=(d[j]<r-eps);                  // 距离在r附近的点两种结果都可以
+            n_hi[i]+=(d[j]<r+eps);
+        }
+        n_bad+=(c_lt>K-1) || (c_le<K);
+    }
+
+    // 半径查询：点数和暴力搜索相同，返回的点都在r以内
+    img_kdt_query(&ta,qx,qy,qz,M,KR,r,idx,dist,cnt,par);
+    for (i=0;i<M;i++)
+    {
+        n_bad+=(cnt[i]<n_lo[i] || cnt[i]>n_hi[i] || cnt[i]>=KR);
+        for (l=0;l<cnt[i];l++)
+            n_bad+=!(dist[i*KR+l]<r);
+        n_ab+=cnt[i];
+    }
+    img_kdt_query(&tb,x,y,z,CHECK_N,KR,r,idx,NULL,NULL,par);
+    for (i=0;i<CHECK_N;i++)
+        for (l=0;l<KR && idx[i*KR+l]>=0;l++)
+            n_ba++;
+    n_bad+=(n_ab!=n_ba);
+
+done:
+    img_kdt_release(&ta);
+    img_kdt_release(&tb);
+    img_kdt_release(&te);
+    free(x); free(d); free(idx);
+    printf("kdtree: %d mismatches, %ld/%ld pairs within r both ways\n",n_bad,n_ab,n_ba);
+    return n_bad ? -1 : 0;
+}
+
+
+// 窗口内第p个像素的有效邻点（不含自己）的距离平方，返回个数
+static int win_dist(float *d2, const float *x, const float *y, const float *z, int p, int w)
+{
+    int u=p%IMG_WID,v=p/IMG_WID,n=0,dx,dy;
+
+    for (dy=-w;dy<=w;dy++)
+        for (dx=-w;dx<=w;dx++)
+        {
+            int q=p+dy*IMG_WID+dx;
+            float ex,ey,ez;
+
+            if ((dx==0 && dy==0) || u+dx<0 || u+dx>=IMG_WID || v+dy<0 || v+dy>=IMG_HGT || !(z[q]>0))
+                continue;
+            ex=x[q]-x[p]; ey=y[q]-y[p]; ez=z[q]-z[p];
+            d2[n++]=ex*ex+ey*ey+ez*ez;
+        }
+    return n;
+}
+
+
+// 离群点去除：合成深度图像按针孔模型转成有序点云，ROR、SOR和逐像素搜索窗口的结果比较，
+// 距离或z分数落在门限附近（相对误差1e-4以内）的像素两种结果都可以
+static int check_outlier(uint32_t *rnd, struct img_par_s *par)
+{
+    const int w=2,k_ror=4,k_sor=6;
+    const float r=0.01f,z_max=1.0f,f=IMG_WID*0.7f;
+    float *x=malloc(sizeof(float)*IMG_SZ*4),*y=x+IMG_SZ,*z=y+IMG_SZ,*md=z+IMG_SZ;
+    float d2[(2*IMG_OUTLIER_W_MAX+1)*(2*IMG_OUTLIER_W_MAX+1)];
+    uint8_t *mask=malloc(IMG_SZ);
+    double s=0,ss=0,mean,lim;
+    int n_ror=0,n_sor=0,n_md=0,kept,i,j,l,n;
+
+    if (x==NULL || mask==NULL)
+    {
+        free(x); free(mask);
+        return -1;
+    }
+    synth_frame(z,0,rnd);
+    for (i=0;i<IMG_SZ;i++)
+    {
+        if (i%IMG_WID<32 && i/IMG_WID<32 && (i%IMG_WID%3 || i/IMG_WID%3))
+            z[i]=0;                                 // 左上角稀疏的点窗口内没有邻点，检查近邻不足的情况
+        x[i]=(i%IMG_WID-IMG_WID*0.5f)*z[i]/f;
+        y[i]=(i/IMG_WID-IMG_HGT*0.5f)*z[i]/f;
+    }
+
+    // ROR：半径内的邻点不少于k-1个时保留
+    kept=img_outlier_ror(mask,x,y,z,w,k_ror,r,par);
+    for (i=0,l=0;i<IMG_SZ;i++)
+    {
+        int n_lo=0,n_hi=0;
+
+        n=(z[i]>0) ? win_dist(d2,x,y,z,i,w) : 0;
+        for (j=0;j<n;j++)
+        {
+            n_lo+=(d2[j]<r*r*(1-1e-4f));
+            n_hi+=(d2[j]<r*r*(1+1e-4f));
+        }
+        n_ror+=(mask[i]>1) || (mask[i] && n_hi<k_ror-1) || (!mask[i] && z[i]>0 && n_lo>=k_ror-1);
+        l+=mask[i];
+    }
+    n_ror+=(kept!=l);
+
+    // SOR：k-1个最近邻点的距离之和除以k为平均距离，有效的平均距离求均值和标准差（ddof=1）
+    kept=img_outlier_sor(mask,md,x,y,z,w,k_sor,z_max,par);
+    for (i=0;i<IMG_SZ;i++)
+    {
+        float m=INFINITY;
+
+        n=(z[i]>0) ? win_dist(d2,x,y,z,i,w) : 0;
+        if (n>=k_sor-1)
+        {
+            for (j=0;j<k_sor-1;j++)                 // 选出k-1个最小的，从小到大相加
+                for (l=j+1;l<n;l++)
+                    if (d2[l]<d2[j])
+                    {
+                        float t=d2[j]; d2[j]=d2[l]; d2[l]=t;
+                    }
+            for (j=0,m=0;j<k_sor-1;j++)
+                m+=sqrtf(d2[j]);
+            m/=k_sor;
+            s+=m;
+            ss+=(double)m*m;
+            n_md++;
+        }
+        n_sor+=isinf(m) ? !isinf(md[i]) : !(fabsf(md[i]-m)<=1e-4f*m);
+        md[i]=m;
+    }
+    mean=s/n_md;
+    lim=z_max*sqrt((ss-s*s/n_md)/(n_md-1));
+    for (i=0,l=0;i<IMG_SZ;i++)
+    {
+        double e=fabs(md[i]-mean);
+        n_sor+=(mask[i]>1) || (mask[i] && !(e<lim*(1+1e-4))) || (!mask[i] && z[i]>0 && e<lim*(1-1e-4));
+        l+=mask[i];
+    }
+    n_sor+=(kept!=l);
+
+    free(x);
+    free(mask);
+    printf("outlier: ror %d mismatches, sor %d mismatches (%d of %d points kept)\n",n_ror,n_sor,kept,n_md);
+    return (n_ror || n_sor) ? -1 : 0;
+}
+
+
+// 点云第c列（x,y,z,nx,ny,nz,a,b）原第i个点的值，颜色为(i+k)&0xff
+static float pc_val(int c, int i) { return (float)i+0.125f*c; }
+
+
+// 点云的第i个点应为原来的第o[i]个点；o[i]<0时为拼接的第-o[i]-1个点，只有坐标和b列，其余各列为0。返回不同的点数
+static int pc_diff(const struct img_pc_s *pc, const int32_t *o, int n)
+{
+    const float *col[8]={ pc->x,pc->y,pc->z,pc->nx,pc->ny,pc->nz,pc->f[0],pc->f[1] };
+    int i,c,k,n_bad=(pc->n!=n);
+
+    for (i=0;i<n && i<pc->n;i++)
+    {
+        int s=o[i]<0 ? -o[i]-1 : o[i],bad=0;
+        for (c=0;c<8;c++)
+            bad|=col[c][i]!=(o[i]>=0 || c<3 || c==7 ? pc_val(c,s) : 0.0f);
+        for (k=0;k<3;k++)
+            bad|=pc->rgb[3*i+k]!=(o[i]>=0 ? ((s+k)&0xff) : 0);
+        n_bad+=bad;
+    }
+    return n_bad;
+}
+
+
+// 点云原地操作：随机序号（多数idx[i]<i，经过临时缓冲区）和递增序号的subset_idx、subset_mask，
+// 拼接没有法向量、颜色和a列的点云（容量够，缩小后尾部的旧数据要清0），再和自己拼接（重新分配内存）
+static int check_pc(uint32_t *rnd)
+{
+    enum { M=CHECK_N/2 };
+    struct img_pc_s pc,src;
+    int32_t *o=malloc(sizeof(int32_t)*(CHECK_N*2+M)),*idx=o+CHECK_N*2;
+    uint8_t *mask=malloc(CHECK_N);
+    int n_idx=0,n_mask=0,n_cat=0,i,m,n;
+
+    memset(&pc,0,sizeof(pc));
+    memset(&src,0,sizeof(src));
+    if (o==NULL || mask==NULL || img_pc_init(&pc,CHECK_N,IMG_PC_NRM|IMG_PC_RGB)
+        || img_pc_add_field(&pc,"a")!=0 || img_pc_add_field(&pc,"b")!=1
+        || img_pc_init(&src,M,0) || img_pc_add_field(&src,"c")!=0 || img_pc_add_field(&src,"b")!=1)
+    {
+        n_idx=1;
+        goto done;
+    }
+    for (i=0;i<CHECK_N;i++)
+    {
+        pc.x[i]=pc_val(0,i); pc.y[i]=pc_val(1,i); pc.z[i]=pc_val(2,i);
+        pc.nx[i]=pc_val(3,i); pc.ny[i]=pc_val(4,i); pc.nz[i]=pc_val(5,i);
+        pc.f[0][i]=pc_val(6,i); pc.f[1][i]=pc_val(7,i);
+        pc.rgb[3*i]=i&0xff; pc.rgb[3*i+1]=(i+1)&0xff; pc.rgb[3*i+2]=(i+2)&0xff;
+        o[i]=i;
+    }
+
+    // 序号越界时点云不变
+    for (i=0;i<M;i++)
+        idx[i]=(int32_t)((rnd_f(rnd)+1)*(CHECK_N/2));
+    idx[M-1]=CHECK_N;
+    n_idx+=img_pc_subset_idx(&pc,idx,M)!=-1 || pc_diff(&pc,o,CHECK_N);
+    idx[M-1]=0;
+    n_idx+=img_pc_subset_idx(&pc,idx,M)!=0;
+    for (i=0;i<M;i++)
+        o[CHECK_N+i]=o[idx[i]];
+    memcpy(o,o+CHECK_N,sizeof(int32_t)*M);
+    n_idx+=pc_diff(&pc,o,M);
+
+    for (m=i=0;i<M;i+=1+(rnd_f(rnd)>0))
+        idx[m++]=i;
+    n_idx+=img_pc_subset_idx(&pc,idx,m)!=0;
+    for (i=0;i<m;i++)
+        o[i]=o[idx[i]];
+    n_idx+=pc_diff(&pc,o,m);
+
+    for (i=n=0;i<m;i++)
+    {
+        mask[i]=rnd_f(rnd)>0;
+        if (mask[i])
+            o[n++]=o[i];
+    }
+    n_mask+=img_pc_subset_mask(&pc,mask)!=n;
+    n_mask+=pc_diff(&pc,o,n);
+
+    // src的c列忽略，b列按名字对应到pc的第2个标量列
+    for (i=0;i<M;i++)
+    {
+        src.x[i]=pc_val(0,CHECK_N+i); src.y[i]=pc_val(1,CHECK_N+i); src.z[i]=pc_val(2,CHECK_N+i);
+        src.f[0][i]=-1; src.f[1][i]=pc_val(7,CHECK_N+i);
+        o[n+i]=-(CHECK_N+i)-1;
+    }
+    n_cat+=img_pc_concat(&pc,&src)!=0;
+    n_cat+=pc_diff(&pc,o,n+M);
+    n+=M;
+    n_cat+=(n*2<=pc.cap);                           // 下面的拼接需要重新分配
+    n_cat+=img_pc_concat(&pc,&pc)!=0;
+    memcpy(o+n,o,sizeof(int32_t)*n);
+    n_cat+=pc_diff(&pc,o,n*2);
+
+done:
+    printf("pc: subset_idx %d, subset_mask %d, concat %d mismatches (%d points)\n",n_idx,n_mask,n_cat,pc.n);
+    img_pc_release(&pc);
+    img_pc_release(&src);
+    free(o);
+    free(mask);
+    return (n_idx || n_mask || n_cat) ? -1 : 0;
+}
+
+
+// 自检，返回出错的项数
+static int self_check(int n_thr)
+{
+    struct img_par_s *par=img_par_create(n_thr);
+    uint32_t rnd=12345;
+    int n_err=0;
+
+    n_err+=check_bat(&rnd,par)!=0;
+    n_err+=check_rigid(&rnd,par)!=0;
+    n_err+=check_deproj(&rnd,par)!=0;
+    n_err+=check_normal(&rnd,par)!=0;
+    n_err+=check_proj(&rnd,par)!=0;
+    n_err+=check_reg(&rnd,par)!=0;
+    n_err+=check_kdt(&rnd,par)!=0;
+    n_err+=check_outlier(&rnd,par)!=0;
+    n_err+=check_pc(&rnd)!=0;
+    img_par_destroy(par);
+    printf("self-check: %s\n",n_err ? "FAILED" : "passed");
+    return n_err;
+}
+
+
+static void usage(const char *prog)
+{
+    fprintf(stderr,
+        "usage: %s [options]\n"
+        "  -i file     use recorded depth frames instead of synthetic ones\n"
+        "  -t i16|f32  recorded depth type, default i16\n"
+        "  -s scale    recorded depth scale, default 0.001\n"
+        "  -S bytes    bytes to skip after each recorded frame\n"
+        "  -F name     only run kernels whose name contains the string\n"
+        "  -k frames   frames per batch for the bat variants, default 4\n"
+        "  -j threads  threads for the mt variants, default CPU count\n"
+        "  -r repeats  repeats per kernel, default 11\n"
+        "  -m seconds  minimum time per repeat, default 0.02\n"
+        "  -f fmt      txt, csv or json, default txt\n"
+        "  -o file     write results to file instead of stdout\n"
+        "  -b file     compare with a previous csv result\n"
+        "  -x tol      slowdown tolerance for -b, default 0.1\n"
+        "  -P          read hardware performance counters\n"
+        "  -C          check the batch and point cloud kernels and exit\n"
+        "frame size %dx%d\n",prog,IMG_WID,IMG_HGT);
+}
+
+
+int main(int argc, char *argv[])
+{
+    static struct bench_ctx_s ctx;
+    static struct bench_res_s res[BENCH_TAB_SZ];
+    struct bench_ctx_s *c=&ctx;
+    struct img_pool_s pool;
+    const char *fin=NULL,*fout=NULL,*fbase=NULL,*filt=NULL,*fmt="txt";
+    float *tmp[BENCH_K_MAX];
+    uint32_t rnd=12345;
+    double t_min=0.02,tol=0.1,gbs_copy[2]={0,0};
+    float scale=0.001f;
+    long skip=0;
+    int f32=0,n_rep=11,n_thr=0,n_res=0,perf=0,check=0,opt,i,j;
+    FILE *fp=stdout;
+
+    c->k=4;
+    while ((opt=getopt(argc,argv,"i:t:s:S:F:k:j:r:m:f:o:b:x:PCh"))!=-1)
+    {
+        switch (opt)
+        {
+        case 'i': fin  =optarg; break;
+        case 't': f32  =(strcmp(optarg,"f32")==0); break;
+        case 's': scale=strtof(optarg,NULL); break;
+        case 'S': skip =atol(optarg); break;
+        case 'F': filt =optarg; break;
+        case 'k': c->k =atoi(optarg); break;
+        case 'j': n_thr=atoi(optarg); break;
+        case 'r': n_rep=atoi(optarg); break;
+        case 'm': t_min=atof(optarg); break;
+        case 'f': fmt  =optarg; break;
+        case 'o': fout =optarg; break;
+        case 'b': fbase=optarg; break;
+        case 'x': tol  =atof(optarg); break;
+        case 'P': perf =1; break;
+        case 'C': check=1; break;
+        default : usage(argv[0]); return 1;
+        }
+    }
+    if (c->k<1) c->k=1;
+    if (c->k>BENCH_K_MAX) c->k=BENCH_K_MAX;
+    if (n_rep<1) n_rep=1;
+    if (n_rep>BENCH_REP_MAX) n_rep=BENCH_REP_MAX;
+    if (check)
+        return self_check(n_thr) ? 1 : 0;
+
+    // 输入图像2*BENCH_FRM_N*k帧（单帧和交织），输出、历史和状态图像各k帧
+    if (img_pool_init(&pool,sizeof(float)*IMG_SZ*((BENCH_FRM_N*(c->k+1))+c->k*11)+(4u<<20),IMG_POOL_HUGE|IMG_POOL_PREFAULT))
+    {
+        fprintf(stderr,"cannot allocate frame pool\n");
+        return 1;
+    }
+    for (i=0;i<BENCH_FRM_N;i++)
+    {
+        c->frm[i]    =img_pool_alloc_img(&pool,1);
+        c->frm_bat[i]=img_pool_alloc_img(&pool,c->k);
+    }
+    c->img_out =img_pool_alloc_img(&pool,c->k);
+    c->img_buf =img_pool_alloc_img(&pool,5*c->k);
+    c->img_st1 =img_pool_alloc_img(&pool,c->k);
+    c->img_st2 =img_pool_alloc_img(&pool,c->k);
+    c->img_st3 =img_pool_alloc_img(&pool,1);
+    c->img_w   =img_pool_alloc_img(&pool,1);
+    c->img_mask=(uint8_t *)img_pool_alloc(&pool,IMG_SZ);
+    c->rb_mem  =(float *)img_pool_alloc(&pool,sizeof(float)*3*IMG_WID);
+    if (c->rb_mem==NULL)
+    {
+        fprintf(stderr,"frame pool too small\n");
+        return 1;
+    }
+
+    if (fin)
+    {
+        if (load_frames(c,fin,f32,scale,skip))
+            return 1;
+    }
+    else
+        for (i=0;i<BENCH_FRM_N;i++)
+            synth_frame(c->frm[i],i,&rnd);
+
+    // 第i组交织图像由第i,i+1,...,i+k-1帧组成
+    for (i=0;i<BENCH_FRM_N;i++)
+    {
+        for (j=0;j<c->k;j++)
+            tmp[j]=c->frm[(i+j)%BENCH_FRM_N];
+        img_interleave(c->frm_bat[i],tmp,c->k);
+    }
+    for (i=0;i<5*c->k;i++)
+        img_copy(c->img_buf+i*IMG_SZ,c->frm[i%BENCH_FRM_N],IMG_SZ);
+    for (i=0;i<IMG_SZ;i++)
+        c->img_w[i]=c->frm[0][i]!=0;
+
+    c->par=img_par_create(n_thr);
+    memset(&c->perf,0,sizeof(c->perf));
+    if (perf && img_perf_open(&c->perf))
+    {
+        fprintf(stderr,"hardware performance counters not available\n");
+        perf=0;
+    }
+
+    for (i=0;i<BENCH_TAB_SZ;i++)
+    {
+        const struct bench_s *b=&bench_tab[i];
+        int is_copy=strcmp(b->name,"copy")==0;
+
+        if (filt && !is_copy && strstr(b->name,filt)==NULL)
+            continue;
+        bench_one(c,b,n_rep,t_min,&res[n_res]);
+
+        // copy的带宽作为内存带宽的参考值，单帧和批处理分别比较
+        if (is_copy)
+            gbs_copy[strcmp(b->var,"scalar")!=0]=res[n_res].gbs;
+        j=strcmp(b->var,"scalar")!=0 && strcmp(b->var,"mt")!=0;
+        res[n_res].bw_frac=gbs_copy[j]>0 ? res[n_res].gbs/gbs_copy[j] : 0;
+        n_res++;
+    }
+
+    if (fout && (fp=fopen(fout,"w"))==NULL)
+    {
+        perror(fout);
+        return 1;
+    }
+    print_res(fp,fmt,fin ? fin : "synthetic",res,n_res,perf);
+    if (fp!=stdout)
+        fclose(fp);
+
+    img_perf_close(&c->perf);
+    img_par_destroy(c->par);
+    img_pool_destroy(&pool);
+
+    if (fbase)
+    {
+        int n_slow=compare_base(fbase,res,n_res,tol);
+        if (n_slow<0)
+            return 1;
+        if (n_slow>0)
+            return 2;
+    }
+    return 0;
+}
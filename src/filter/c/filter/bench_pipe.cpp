@@ -0,0 +1,456 @@
+/**
+ * @file    bench_pipe.cpp
+ * @author  YRD
+ * @version 1.0
+ * @date    2026-10-18
+ * @brief   深度处理流水线端到端延迟测试
+ * @details 用data/images/IR_RGB_images中的红外强度图(intensityN.png)和彩色图(colorN.png)，加上合成深度图，
+ *          模拟传感器按KINECT_FPS帧率送入数据，每帧依次经过：
+ *              输入（PNG解码、深度转换为m）-> 滤波链(img_chain) -> 反投影为点云 -> 点云输出（距离过滤）
+ *          统计每帧从传感器送出到点云输出完成的延迟的p50/p99/p99.9/最大值、抖动（标准差和输出间隔偏差）、
+ *          丢帧数（处理不及时，传感器队列满）和超时帧数（延迟超过一个帧周期）。
+ *          合成深度图在红外强度很低的位置置0（无效深度），和真实ToF传感器一致。
+ *          反投影使用global_cfg.py中的K_ir内参（按图像宽度缩放）和射线表(img_deproj.h)，点云为x/y/z/强度4幅图像（SoA）；
+ *          -k时反投影和距离过滤合成一遍(img_deproj_crop_f32)，点云为紧凑的点列表
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <opencv2/opencv.hpp>
+#include "img_const.h"
+#include "img_algo.h"
+#include "img_pool.h"
+#include "img_par.h"
+#include "img_chain.h"
+#include "img_deproj.h"
+
+#define PIPE_IMG_MAX    64          // 最多图像组数
+#define PIPE_Q_MAX      16          // 传感器队列最大长度
+
+// 流水线各阶段
+enum { ST_INGEST, ST_FILTER, ST_DEPROJ, ST_OUTPUT, ST_N };
+static const char *st_name[ST_N]={ "ingest","filter","deproj","output" };
+
+// 一组输入图像（压缩数据，每帧解码）
+struct pipe_img_s
+{
+    std::vector<uchar> ir_png,rgb_png;
+    int16_t *dep;                   // 合成深度图（mm）
+};
+
+// 传感器队列，元素为帧序号
+struct pipe_q_s
+{
+    uint64_t        seq[PIPE_Q_MAX];
+    uint64_t        t_sched[PIPE_Q_MAX];
+    int             head,cnt,sz;
+    int             closed;
+    pthread_mutex_t mtx;
+    pthread_cond_t  cv;
+};
+
+struct pipe_s
+{
+    struct pipe_img_s img[PIPE_IMG_MAX];
+    int         n_img;
+    struct pipe_q_s q;
+    double      fps;
+    long        n_frm;              // 传感器送出的帧数
+
+    uint64_t    n_drop;             // 丢帧数
+    uint64_t    t_start;
+};
+
+
+static int load_file(const char *fname, std::vector<uchar> &buf)
+{
+    FILE *fp=fopen(fname,"rb");
+    long sz;
+
+    if (fp==NULL)
+        return -1;
+    fseek(fp,0,SEEK_END);
+    sz=ftell(fp);
+    fseek(fp,0,SEEK_SET);
+    buf.resize(sz);
+    if (fread(buf.data(),1,sz,fp)!=(size_t)sz)
+    {
+        fclose(fp);
+        return -1;
+    }
+    fclose(fp);
+    return 0;
+}
+
+
+// 合成深度图：倾斜平面和半球形物体，单位mm，落在global_cfg.py的dmin~dmax之间，红外强度低的位置无效
+static void synth_depth(int16_t *dep, const cv::Mat &ir, int seq)
+{
+    uint32_t rnd=seq*2654435761u+1;
+    int x,y;
+
+    for (y=0;y<IMG_HGT;y++)
+        for (x=0;x<IMG_WID;x++)
+        {
+            float z=900+200.0f*y/IMG_HGT;
+            float dx=x-IMG_WID*0.5f,dy=y-IMG_HGT*0.5f,r2=(dx*dx+dy*dy)/(IMG_HGT*IMG_HGT*0.09f);
+
+            if (r2<1)
+                z-=200*sqrtf(1-r2);
+            rnd=rnd*1664525u+1013904223u;
+            z+=((rnd>>8)&0xff)/25.6f-5;                 // ±5mm噪声
+            if (ir.at<uchar>(y,x)<8)
+                z=0;
+            dep[y*IMG_WID+x]=(int16_t)z;
+        }
+}
+
+
+static void *sensor_thread(void *arg)
+{
+    struct pipe_s *p=(struct pipe_s *)arg;
+    struct pipe_q_s *q=&p->q;
+    struct timespec ts;
+    uint64_t t;
+    long n;
+
+    for (n=0;n<p->n_frm;n++)
+    {
+        t=p->t_start+(uint64_t)(n*1e9/p->fps);
+        ts.tv_sec =t/1000000000u;
+        ts.tv_nsec=t%1000000000u;
+        clock_nanosleep(CLOCK_MONOTONIC,TIMER_ABSTIME,&ts,NULL);
+
+        pthread_mutex_lock(&q->mtx);
+        if (q->cnt==q->sz)
+            p->n_drop++;            // 处理不及时，新帧被丢弃
+        else
+        {
+            int i=(q->head+q->cnt)%q->sz;
+            q->seq[i]=n;
+            q->t_sched[i]=t;
+            q->cnt++;
+            pthread_cond_signal(&q->cv);
+        }
+        pthread_mutex_unlock(&q->mtx);
+    }
+
+    pthread_mutex_lock(&q->mtx);
+    q->closed=1;
+    pthread_cond_signal(&q->cv);
+    pthread_mutex_unlock(&q->mtx);
+    return NULL;
+}
+
+
+static int cmp_u64(const void *a, const void *b)
+{
+    uint64_t x=*(const uint64_t *)a,y=*(const uint64_t *)b;
+    return x<y ? -1 : x>y;
+}
+
+// 排序后的百分位数（us）
+static double pct(const uint64_t *v, long n, double p)
+{
+    long i=(long)(p*(n-1)+0.5);
+    return n ? v[i]/1e3 : 0.0;
+}
+
+
+static void usage(const char *prog)
+{
+    fprintf(stderr,
+        "usage: %s [options]\n"
+        "  -d dir      image directory, default data/images/IR_RGB_images\n"
+        "  -c chain    filter chain, default \"mid3_t,plane_mf_sqr3\"\n"
+        "  -r fps      sensor frame rate, default 60 (KINECT_FPS)\n"
+        "  -n frames   frames to replay, default 600 (CNT_SAV_MAX)\n"
+        "  -q length   sensor queue length, default 2\n"
+        "  -j threads  threads for the spatial filters and deprojection, default 1\n"
+        "  -o file     write organized point clouds, per frame x/y/z/intensity float32 planes\n"
+        "  -f fmt      txt or json, default txt\n"
+        "  -k          compact point list: fused deprojection and range crop, -o writes per frame\n"
+        "              int32 n, then n x, y, z, intensity float32 and n int32 pixel indices\n"
+        "frame size %dx%d\n",prog,IMG_WID,IMG_HGT);
+}
+
+
+int main(int argc, char *argv[])
+{
+    static struct pipe_s pipe;
+    struct pipe_s *p=&pipe;
+    struct img_pool_s pool;
+    struct img_par_s *par=NULL;
+    struct img_chain_s chain;
+    const char *dir="data/images/IR_RGB_images",*spec="mid3_t,plane_mf_sqr3",*fout=NULL,*fmt="txt";
+    struct img_cam_s cam={ 360.8538f,361.1244f,241.8416f,203.6490f,0,0,0,0,0,0 };
+    struct img_deproj_s dp;
+    float dmin=0.5f,dmax=1.2f;
+    float *img_in,*img_flt,*pc;
+    uint64_t *lat,*st[ST_N],*itv,t_prev=0,n_late=0;
+    double lat_avg=0,lat_std=0,itv_avg=0,itv_std=0,pts_avg=0;
+    int32_t *pix=NULL;
+    int n_thr=1,compact=0,opt,i,k;
+    long n,n_done=0;
+    pthread_t thr;
+    FILE *fp=NULL;
+
+    p->fps=60;
+    p->n_frm=600;
+    p->q.sz=2;
+    while ((opt=getopt(argc,argv,"d:c:r:n:q:j:o:f:kh"))!=-1)
+    {
+        switch (opt)
+        {
+        case 'd': dir   =optarg; break;
+        case 'c': spec  =optarg; break;
+        case 'r': p->fps=atof(optarg); break;
+        case 'n': p->n_frm=atol(optarg); break;
+        case 'q': p->q.sz=atoi(optarg); break;
+        case 'j': n_thr =atoi(optarg); break;
+        case 'o': fout  =optarg; break;
+        case 'f': fmt   =optarg; break;
+        case 'k': compact=1; break;
+        default : usage(argv[0]); return 1;
+        }
+    }
+    if (p->q.sz<1) p->q.sz=1;
+    if (p->q.sz>PIPE_Q_MAX) p->q.sz=PIPE_Q_MAX;
+    if (p->fps<=0 || p->n_frm<1)
+    {
+        usage(argv[0]);
+        return 1;
+    }
+
+    // 读入压缩图像，生成合成深度图
+    for (i=0;i<PIPE_IMG_MAX;i++)
+    {
+        struct pipe_img_s *m=&p->img[i];
+        char fname[1024];
+        cv::Mat ir;
+
+        snprintf(fname,sizeof(fname),"%s/intensity%d.png",dir,i);
+        if (load_file(fname,m->ir_png))
+            break;
+        snprintf(fname,sizeof(fname),"%s/color%d.png",dir,i);
+        if (load_file(fname,m->rgb_png))
+            break;
+
+        ir=cv::imdecode(m->ir_png,cv::IMREAD_GRAYSCALE);
+        if (ir.empty())
+        {
+            fprintf(stderr,"%s/intensity%d.png: cannot decode\n",dir,i);
+            return 1;
+        }
+        cv::resize(ir,ir,cv::Size(IMG_WID,IMG_HGT));
+        m->dep=(int16_t *)malloc(sizeof(int16_t)*IMG_SZ);
+        synth_depth(m->dep,ir,i);
+    }
+    p->n_img=i;
+    if (p->n_img==0)
+    {
+        fprintf(stderr,"%s: no intensity/color images\n",dir);
+        return 1;
+    }
+
+    if (img_pool_init(&pool,sizeof(float)*IMG_SZ*(7*IMG_CHAIN_MAX+8)+(1u<<20),IMG_POOL_HUGE|IMG_POOL_PREFAULT|IMG_POOL_LOCK))
+    {
+        fprintf(stderr,"cannot allocate frame pool\n");
+        return 1;
+    }
+    if (n_thr>1)
+        par=img_par_create(n_thr);
+    if (img_chain_init(&chain,spec,&pool,par))
+        return 1;
+    img_in =img_pool_alloc_img(&pool,1);
+    img_flt=img_pool_alloc_img(&pool,1);
+    pc     =img_pool_alloc_img(&pool,4);
+    pix    =(int32_t *)img_pool_alloc(&pool,sizeof(int32_t)*IMG_SZ);
+    if (pc==NULL || pix==NULL)
+    {
+        fprintf(stderr,"frame pool too small\n");
+        return 1;
+    }
+    img_cam_scale(&cam,IMG_WID/512.0f);
+    if (img_deproj_init(&dp,&cam,&pool))
+        return 1;
+
+    lat=(uint64_t *)malloc(sizeof(uint64_t)*p->n_frm);
+    itv=(uint64_t *)malloc(sizeof(uint64_t)*p->n_frm);
+    for (k=0;k<ST_N;k++)
+        st[k]=(uint64_t *)malloc(sizeof(uint64_t)*p->n_frm);
+
+    if (fout && (fp=fopen(fout,"wb"))==NULL)
+    {
+        perror(fout);
+        return 1;
+    }
+
+    pthread_mutex_init(&p->q.mtx,NULL);
+    pthread_cond_init(&p->q.cv,NULL);
+    p->t_start=img_time_ns()+100000000u;        // 100ms后开始
+    pthread_create(&thr,NULL,sensor_thread,p);
+
+    for (;;)
+    {
+        struct pipe_img_s *m;
+        uint64_t seq,t_sched,t[ST_N+1];
+        cv::Mat ir,rgb;
+        float *q;
+        int16_t *d;
+        int n_pts=0;
+
+        pthread_mutex_lock(&p->q.mtx);
+        while (p->q.cnt==0 && !p->q.closed)
+            pthread_cond_wait(&p->q.cv,&p->q.mtx);
+        if (p->q.cnt==0)
+        {
+            pthread_mutex_unlock(&p->q.mtx);
+            break;
+        }
+        seq    =p->q.seq[p->q.head];
+        t_sched=p->q.t_sched[p->q.head];
+        p->q.head=(p->q.head+1)%p->q.sz;
+        p->q.cnt--;
+        pthread_mutex_unlock(&p->q.mtx);
+
+        // 输入：解码红外和彩色图，深度转换为m
+        t[0]=img_time_ns();
+        m=&p->img[seq%p->n_img];
+        ir =cv::imdecode(m->ir_png ,cv::IMREAD_GRAYSCALE);
+        rgb=cv::imdecode(m->rgb_png,cv::IMREAD_COLOR);
+        if (ir.cols!=IMG_WID || ir.rows!=IMG_HGT)
+            cv::resize(ir,ir,cv::Size(IMG_WID,IMG_HGT));
+        for (d=m->dep,q=img_in;q<img_in+IMG_SZ;)
+            *q++=*d++*0.001f;
+
+        // 滤波
+        t[1]=img_time_ns();
+        img_chain_run(&chain,img_flt,img_in);
+
+        // 反投影，点云按像素组织，x/y/z/强度各一幅图像；紧凑模式同时做距离过滤，只取保留点的强度
+        t[2]=img_time_ns();
+        if (compact)
+        {
+            const uchar *s=ir.ptr<uchar>(0);
+            n_pts=img_deproj_crop_f32(&dp,pc,pc+IMG_SZ,pc+2*IMG_SZ,pix,img_flt,dmin,dmax,NULL,par);
+            for (i=0,q=pc+3*IMG_SZ;i<n_pts;i++)
+                *q++=s[pix[i]];
+        }
+        else
+        {
+            img_deproj_f32(&dp,pc,pc+IMG_SZ,pc+2*IMG_SZ,img_flt,par);
+            for (i=0,q=pc+3*IMG_SZ;i<IMG_HGT;i++)
+            {
+                const uchar *s=ir.ptr<uchar>(i);
+                int j;
+                for (j=0;j<IMG_WID;j++)
+                    *q++=s[j];
+            }
+        }
+
+        // 输出：距离过滤，去掉dmin~dmax之外的点（紧凑模式已过滤）
+        t[3]=img_time_ns();
+        if (compact)
+        {
+            if (fp)
+            {
+                fwrite(&n_pts,sizeof(n_pts),1,fp);
+                for (k=0;k<4;k++)
+                    fwrite(pc+k*IMG_SZ,sizeof(float),n_pts,fp);
+                fwrite(pix,sizeof(int32_t),n_pts,fp);
+            }
+        }
+        else
+        {
+            for (i=0;i<IMG_SZ;i++)
+            {
+                if (pc[2*IMG_SZ+i]<dmin || pc[2*IMG_SZ+i]>dmax)
+                    pc[i]=pc[IMG_SZ+i]=pc[2*IMG_SZ+i]=0;
+                else
+                    n_pts++;
+            }
+            if (fp)
+                fwrite(pc,sizeof(float)*4,IMG_SZ,fp);
+        }
+        t[4]=img_time_ns();
+
+        for (k=0;k<ST_N;k++)
+            st[k][n_done]=t[k+1]-t[k];
+        lat[n_done]=t[4]-t_sched;
+        if (lat[n_done]>1e9/p->fps)
+            n_late++;
+        if (n_done)
+            itv[n_done-1]=t[4]-t_prev;
+        t_prev=t[4];
+        pts_avg+=n_pts;
+        n_done++;
+    }
+    pthread_join(thr,NULL);
+    if (fp)
+        fclose(fp);
+
+    // 统计
+    for (n=0;n<n_done;n++)
+        lat_avg+=lat[n];
+    lat_avg/=n_done ? n_done : 1;
+    for (n=0;n<n_done;n++)
+        lat_std+=(lat[n]-lat_avg)*(lat[n]-lat_avg);
+    lat_std=sqrt(lat_std/(n_done ? n_done : 1));
+    for (n=0;n+1<n_done;n++)
+        itv_avg+=itv[n];
+    itv_avg/=n_done>1 ? n_done-1 : 1;
+    for (n=0;n+1<n_done;n++)
+        itv_std+=(itv[n]-1e9/p->fps)*(itv[n]-1e9/p->fps);
+    itv_std=sqrt(itv_std/(n_done>1 ? n_done-1 : 1));
+    pts_avg/=n_done ? n_done : 1;
+
+    qsort(lat,n_done,sizeof(uint64_t),cmp_u64);
+    for (k=0;k<ST_N;k++)
+        qsort(st[k],n_done,sizeof(uint64_t),cmp_u64);
+
+    if (strcmp(fmt,"json")==0)
+    {
+        printf("{\"res\":\"%dx%d\",\"chain\":\"%s\",\"fps\":%.2f,\"frames\":%ld,\"done\":%ld,\"dropped\":%llu,\"late\":%llu,\n",
+               IMG_WID,IMG_HGT,spec,p->fps,p->n_frm,n_done,(unsigned long long)p->n_drop,(unsigned long long)n_late);
+        printf(" \"latency_us\":{\"avg\":%.1f,\"p50\":%.1f,\"p99\":%.1f,\"p999\":%.1f,\"max\":%.1f,\"std\":%.1f},\n",
+               lat_avg/1e3,pct(lat,n_done,0.5),pct(lat,n_done,0.99),pct(lat,n_done,0.999),pct(lat,n_done,1),lat_std/1e3);
+        printf(" \"interval_us\":{\"avg\":%.1f,\"std\":%.1f},\"points\":%.0f,\n",itv_avg/1e3,itv_std/1e3,pts_avg);
+        printf(" \"stages\":{");
+        for (k=0;k<ST_N;k++)
+            printf("%s\"%s\":{\"p50\":%.1f,\"p99\":%.1f,\"max\":%.1f}",k ? "," : "",st_name[k],
+                   pct(st[k],n_done,0.5),pct(st[k],n_done,0.99),pct(st[k],n_done,1));
+        printf("}}\n");
+    }
+    else
+    {
+        printf("%dx%d, %s, %.1f fps, %ld frames (%d images)\n",IMG_WID,IMG_HGT,spec,p->fps,p->n_frm,p->n_img);
+        printf("done %ld, dropped %llu, late %llu, points/frame %.0f\n",
+               n_done,(unsigned long long)p->n_drop,(unsigned long long)n_late,pts_avg);
+        printf("latency(us)  avg %.1f  p50 %.1f  p99 %.1f  p99.9 %.1f  max %.1f  jitter(std) %.1f\n",
+               lat_avg/1e3,pct(lat,n_done,0.5),pct(lat,n_done,0.99),pct(lat,n_done,0.999),pct(lat,n_done,1),lat_std/1e3);
+        printf("interval(us) avg %.1f  std %.1f\n",itv_avg/1e3,itv_std/1e3);
+        printf("%-8s %10s %10s %10s\n","stage","p50(us)","p99(us)","max(us)");
+        for (k=0;k<ST_N;k++)
+            printf("%-8s %10.1f %10.1f %10.1f\n",st_name[k],
+                   pct(st[k],n_done,0.5),pct(st[k],n_done,0.99),pct(st[k],n_done,1));
+        img_chain_report(&chain,stdout);
+    }
+
+    for (i=0;i<p->n_img;i++)
+        free(p->img[i].dep);
+    for (k=0;k<ST_N;k++)
+        free(st[k]);
+    free(lat);
+    free(itv);
+    img_deproj_release(&dp);
+    img_chain_release(&chain);
+    img_par_destroy(par);
+    img_pool_destroy(&pool);
+    return 0;
+}
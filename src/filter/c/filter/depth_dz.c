@@ -0,0 +1,237 @@
+/**
+ * @file    depth_dz.c
+ * @author  YRD
+ * @version 1.0
+ * @date    2026-10-18
+ * @brief   深度数据文件压缩/解压
+ * @details 把录制的原始深度数据文件（格式同filter程序，见img_rec.h）压缩为.dz文件（img_dz.h），或者把.dz文件解压为
+ *          每帧IMG_WID*IMG_HGT个uint16的原始文件。int16深度值按位原样保存，解压后和原文件的深度平面完全相同。
+ *          结束时输出压缩比和每帧编解码时间，以及相对于传感器帧率(-r)的倍数，-c时解压每一帧并和原数据比较。
+ *          -G生成合成的int16深度数据文件，供depth_dz_test.sh测试压缩是否无损。
+ *          filter程序可以直接读取.dz文件
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "img_const.h"
+#include "img_par.h"
+#include "img_rec.h"
+#include "img_dz.h"
+
+
+// 合成深度数据：倾斜平面加圆形物体（mm），叠加噪声，随机的0（空洞）、-1（无效标记）和远处的大值，
+// 覆盖平滑区域和预测残差很大的像素
+static int gen_frames(const char *fname, long n)
+{
+    FILE *fp=fopen(fname,"wb");
+    int16_t *img=(int16_t *)malloc(sizeof(int16_t)*IMG_SZ);
+    uint32_t rnd=12345;
+    long i;
+    int x,y;
+
+    if (fp==NULL || img==NULL)
+    {
+        perror(fname);
+        if (fp) fclose(fp);
+        free(img);
+        return 1;
+    }
+    for (i=0;i<n;i++)
+    {
+        for (y=0;y<IMG_HGT;y++)
+            for (x=0;x<IMG_WID;x++)
+            {
+                int dx=x-IMG_WID/2-(int)(i*3),dy=y-IMG_HGT/2,z=1500+500*y/IMG_HGT;
+
+                if (dx*dx+dy*dy<IMG_HGT*IMG_HGT/16)
+                    z-=400;
+                rnd=rnd*1664525u+1013904223u;
+                z+=(int)(rnd>>28)-8;
+                if ((rnd&0xff)<8)
+                    z=0;
+                else if ((rnd&0xff)<10)
+                    z=-1;
+                else if ((rnd&0xff)<12)
+                    z=30000+(int)(rnd>>20&0x3ff);
+                img[y*IMG_WID+x]=(int16_t)z;
+            }
+        if (fwrite(img,sizeof(int16_t),IMG_SZ,fp)!=IMG_SZ)
+            break;
+    }
+    free(img);
+    if (fclose(fp) || i<n)
+    {
+        perror(fname);
+        return 1;
+    }
+    return 0;
+}
+
+
+static void usage(const char *prog)
+{
+    fprintf(stderr,
+        "usage: %s [options] input output\n"
+        "       %s -G frames output\n"
+        "  -d          decompress a .dz file to raw uint16 frames\n"
+        "  -G frames   write synthetic dep:i16 frames for tests\n"
+        "  -l layout   input frame layout, default \"dep:i16\" (see filter -l)\n"
+        "  -p plane    plane to compress, default dep\n"
+        "  -B bands    bands per frame, default %d\n"
+        "  -j threads  encode/decode threads, default 1\n"
+        "  -n frames   stop after the given number of frames\n"
+        "  -r fps      sensor frame rate for the realtime factor, default 60\n"
+        "  -c          decode every frame and compare with the input\n"
+        "frame size %dx%d\n",prog,prog,IMG_DZ_BAND_DEF,IMG_WID,IMG_HGT);
+}
+
+
+int main(int argc, char *argv[])
+{
+    const char *layout="dep:i16",*plane_name="dep";
+    struct img_rec_s rec;
+    struct img_dz_writer_s w;
+    struct img_par_s *par=NULL;
+    uint16_t *chk=NULL;
+    uint64_t t_enc=0,t_dec=0,t0,sz_out=0;
+    double fps=60,ms_enc,ms_dec;
+    long n_max=-1,n_gen=-1,n,i;
+    int dec=0,check=0,n_band=IMG_DZ_BAND_DEF,n_thr=1,plane,opt,ret=0;
+    FILE *fp=NULL;
+
+    while ((opt=getopt(argc,argv,"dG:l:p:B:j:n:r:ch"))!=-1)
+    {
+        switch (opt)
+        {
+        case 'd': dec   =1; break;
+        case 'G': n_gen =atol(optarg); break;
+        case 'l': layout=optarg; break;
+        case 'p': plane_name=optarg; break;
+        case 'B': n_band=atoi(optarg); break;
+        case 'j': n_thr =atoi(optarg); break;
+        case 'n': n_max =atol(optarg); break;
+        case 'r': fps   =atof(optarg); break;
+        case 'c': check =1; break;
+        default : usage(argv[0]); return 1;
+        }
+    }
+    if (n_gen>=0 && optind+1==argc)
+        return gen_frames(argv[optind],n_gen);
+    if (n_gen>=0 || optind+2!=argc)
+    {
+        usage(argv[0]);
+        return 1;
+    }
+
+    if (img_rec_open(&rec,argv[optind],layout))
+        return 1;
+    plane=img_rec_plane(&rec,dec ? "dep" : plane_name);
+    if (dec && rec.dz_idx==NULL)
+    {
+        fprintf(stderr,"%s: not a compressed file\n",argv[optind]);
+        img_rec_close(&rec);
+        return 1;
+    }
+    if (plane<0 || rec.plane[plane].cnt<IMG_SZ
+        || (rec.plane[plane].type!=IMG_REC_U16 && rec.plane[plane].type!=IMG_REC_I16))
+    {
+        fprintf(stderr,"%s: no u16/i16 plane '%s' of %d pixels\n",argv[optind],plane_name,IMG_SZ);
+        img_rec_close(&rec);
+        return 1;
+    }
+    n=(n_max>=0 && n_max<rec.n_frm) ? n_max : rec.n_frm;
+
+    if (n_thr>1)
+        rec.par=par=img_par_create(n_thr);
+    if (dec)
+        fp=fopen(argv[optind+1],"wb");
+    if ((dec && fp==NULL) || (!dec && img_dz_create(&w,argv[optind+1],n_band,par)))
+    {
+        perror(argv[optind+1]);
+        img_rec_close(&rec);
+        img_par_destroy(par);
+        return 1;
+    }
+    if (!dec && check)
+        chk=(uint16_t *)malloc(sizeof(uint16_t)*IMG_SZ);
+
+    for (i=0;i<n;i++)
+    {
+        const uint16_t *dep;
+
+        t0 =img_time_ns();
+        dep=(const uint16_t *)img_rec_frame(&rec,i,plane);
+        if (dec)
+        {
+            t_dec+=img_time_ns()-t0;
+            if (dep==NULL)
+            {
+                fprintf(stderr,"frame %ld: bad compressed data\n",i);
+                ret=1;
+                break;
+            }
+            if (fwrite(dep,sizeof(uint16_t),IMG_SZ,fp)!=IMG_SZ)
+            {
+                perror(argv[optind+1]);
+                ret=1;
+                break;
+            }
+            sz_out+=*(const uint32_t *)(rec.base+rec.dz_idx[i]);
+            continue;
+        }
+
+        t0=img_time_ns();
+        if (img_dz_write(&w,dep))
+        {
+            perror(argv[optind+1]);
+            ret=1;
+            break;
+        }
+        t_enc+=img_time_ns()-t0;
+        sz_out=w.off-IMG_DZ_HDR_SZ;
+
+        if (chk)
+        {
+            t0=img_time_ns();
+            if (img_dz_dec(chk,w.buf,(size_t)(w.off-w.idx[i]),par))
+                chk[0]=~dep[0];
+            t_dec+=img_time_ns()-t0;
+            if (memcmp(chk,dep,sizeof(uint16_t)*IMG_SZ))
+            {
+                fprintf(stderr,"frame %ld: decoded frame differs\n",i);
+                ret=1;
+                break;
+            }
+        }
+    }
+    n=i;
+
+    if (dec)
+        fclose(fp);
+    else if (img_dz_close(&w))
+    {
+        perror(argv[optind+1]);
+        ret=1;
+    }
+
+    if (n)
+    {
+        ms_enc=t_enc*1e-6/n;
+        ms_dec=t_dec*1e-6/n;
+        printf("%ld frames, %.1f MB raw, %.1f MB compressed, ratio %.2f, %.2f bits/pixel\n",n,
+               n*IMG_SZ*2.0/(1<<20),sz_out/(double)(1<<20),n*IMG_SZ*2.0/sz_out,sz_out*8.0/((double)n*IMG_SZ));
+        if (!dec)
+            printf("encode %.3f ms/frame, %.1f MB/s, %.1fx realtime at %.0f fps\n",
+                   ms_enc,IMG_SZ*2.0/(1<<20)/(ms_enc*1e-3),1000/(ms_enc*fps),fps);
+        if (dec || chk)
+            printf("decode %.3f ms/frame, %.1f MB/s, %.1fx realtime at %.0f fps%s\n",
+                   ms_dec,IMG_SZ*2.0/(1<<20)/(ms_dec*1e-3),1000/(ms_dec*fps),fps,chk && !ret ? ", lossless" : "");
+    }
+
+    free(chk);
+    img_rec_close(&rec);
+    img_par_destroy(par);
+    return ret;
+}
@@ -0,0 +1,22 @@
+#!/bin/sh
+# depth_dz无损压缩测试（ctest）：depth_dz_test.sh <depth_dz> [工作目录]
+# 合成深度数据压缩（-c逐帧校验），解压后和原文件逐字节比较；
+# 再截掉索引和最后一帧的一部分（模拟录制中断），解压时重建索引，应得到前面完整的帧
+set -e
+DZ=$1
+DIR=${2:-.}/depth_dz_test
+N=12
+
+mkdir -p "$DIR"
+"$DZ" -G $N "$DIR/syn.raw"
+"$DZ" -c -j 2 "$DIR/syn.raw" "$DIR/syn.dz"
+"$DZ" -d "$DIR/syn.dz" "$DIR/dec.raw"
+cmp "$DIR/syn.raw" "$DIR/dec.raw"
+
+FRM=$(($(wc -c <"$DIR/syn.raw")/N))
+DZ_SZ=$(wc -c <"$DIR/syn.dz")
+head -c $((DZ_SZ-8*N-16-100)) "$DIR/syn.dz" >"$DIR/cut.dz"
+"$DZ" -d "$DIR/cut.dz" "$DIR/cut.raw"
+test "$(wc -c <"$DIR/cut.raw")" -eq $(((N-1)*FRM))
+head -c $(((N-1)*FRM)) "$DIR/syn.raw" | cmp - "$DIR/cut.raw"
+echo "depth_dz: $N frames lossless, truncated file reindexed to $((N-1)) frames"
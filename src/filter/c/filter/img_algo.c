@@ -0,0 +1,64 @@
+/**
+ * @file    img_algo.c
+ * @author  YRD
+ * @version 1.0
+ * @date    2026-10-18
+ * @brief   图像滤波基础运算函数
+ * @details 环形缓冲器以及整幅图像的基本运算
+*/
+
+#include <string.h>
+#include "img_const.h"
+#include "img_algo.h"
+
+void ring_buf_f32_init(struct ring_buf_f32_s *rbuf, float *buf, int sz)
+{
+    rbuf->buf=buf;
+    rbuf->sz =sz;
+    rbuf->idx=0;
+    memset(buf,0,sizeof(float)*sz);
+}
+
+
+float *img_copy(float *img_out, float *img_in, int n)
+{
+    if (img_out!=img_in)
+        memcpy(img_out,img_in,sizeof(float)*n);
+    return img_out;
+}
+
+
+float *img_mul_f32(float *img_out, float *img_in, float c)
+{
+    float *p=img_in, *q=img_out, *q_end=img_out+IMG_SZ;
+    for (;q<q_end;p++,q++)
+        *q=(*p)*c;
+    return img_out;
+}
+
+
+float *img_prod_f32(float *img_inout, float c)
+{
+    float *q=img_inout, *q_end=img_inout+IMG_SZ;
+    for (;q<q_end;q++)
+        *q*=c;
+    return img_inout;
+}
+
+
+float *img_cum(float *img_inout, float *img_in)
+{
+    float *p=img_in, *q=img_inout, *q_end=img_inout+IMG_SZ;
+    for (;q<q_end;p++,q++)
+        *q+=*p;
+    return img_inout;
+}
+
+
+float *img_mac(float *img_inout, float *img_in, float c)
+{
+    float *p=img_in, *q=img_inout, *q_end=img_inout+IMG_SZ;
+    for (;q<q_end;p++,q++)
+        *q+=(*p)*c;
+    return img_inout;
+}
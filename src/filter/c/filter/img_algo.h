@@ -0,0 +1,277 @@
+/**
+ * @file    img_algo.h
+ * @author  YRD
+ * @version 1.0
+ * @date    2026-10-18
+ * @brief   图像滤波基础运算函数
+ * @details 包括排序选择（中值、最大最小值）、环形缓冲器以及整幅图像的基本运算，
+ *          供img_filter.c和其他滤波模块使用
+*/
+
+#ifndef __IMG_ALGO_H__
+#define __IMG_ALGO_H__
+
+#include <stdint.h>
+
+#ifdef _MSC_VER
+#define inline __inline
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// 两个/三个数的最大、最小和中值，使用比较选择实现，编译器可以将其转化为SIMD的min/max指令
+#define MIN2(a,b)       ((a)<(b)?(a):(b))
+#define MAX2(a,b)       ((a)>(b)?(a):(b))
+#define MIN3(a,b,c)     MIN2(MIN2(a,b),c)
+#define MAX3(a,b,c)     MAX2(MAX2(a,b),c)
+#define MID3(a,b,c)     MAX2(MIN2(a,b),MIN2(MAX2(a,b),c))
+
+/**
+ * @brief           环形缓冲器，用于原址（_sa）滤波时暂存滤波结果，长度通常为3行图像数据
+ */
+struct ring_buf_f32_s
+{
+    float *buf;     ///< 缓冲区
+    int    sz;      ///< 缓冲区长度
+    int    idx;     ///< 当前读写位置
+};
+
+/**
+ * @fn              void ring_buf_f32_init(struct ring_buf_f32_s *rbuf, float *buf, int sz)
+ * @brief           环形缓冲器初始化，缓冲区内容清零
+ * @param [inout]   struct ring_buf_f32_s *rbuf：环形缓冲器
+ * @param [in]      float *buf：指针，指向缓冲区，长度至少为sz
+ * @param [in]      int sz：缓冲区长度
+ */
+void ring_buf_f32_init(struct ring_buf_f32_s *rbuf, float *buf, int sz);
+
+/**
+ * @fn              float ring_buf_f32_io(struct ring_buf_f32_s *rbuf, float v)
+ * @brief           写入一个新数据，同时读出最老的数据（延迟sz个数据）
+ * @param [inout]   struct ring_buf_f32_s *rbuf：环形缓冲器
+ * @param [in]      float v：新数据
+ * @retval          float：最老的数据
+ */
+static inline float ring_buf_f32_io(struct ring_buf_f32_s *rbuf, float v)
+{
+    float r=rbuf->buf[rbuf->idx];
+    rbuf->buf[rbuf->idx]=v;
+    if (++rbuf->idx==rbuf->sz) rbuf->idx=0;
+    return r;
+}
+
+// 5个数的最大值、最小值
+static inline float max5(float a, float b, float c, float d, float e) { return MAX2(MAX3(a,b,c),MAX2(d,e)); }
+static inline float min5(float a, float b, float c, float d, float e) { return MIN2(MIN3(a,b,c),MIN2(d,e)); }
+
+// 8个数的最小值
+static inline float min8(float a, float b, float c, float d, float e, float f, float g, float h)
+{
+    return MIN2(MIN2(MIN2(a,b),MIN2(c,d)),MIN2(MIN2(e,f),MIN2(g,h)));
+}
+
+// 5个数的中值，使用7次比较交换的选择网络，没有分支
+static inline float mid5(float a, float b, float c, float d, float e)
+{
+    float t;
+    t=MIN2(a,b); b=MAX2(a,b); a=t;      // a<=b
+    t=MIN2(d,e); e=MAX2(d,e); d=t;      // d<=e
+    t=MAX2(a,d); e=MIN2(b,e); a=t;      // 去掉4个数中的最大值和最小值
+    // 此时中值为{a,e,c}的中值
+    return MID3(a,e,c);
+}
+
+// 7个数的中值，使用插入排序
+static inline float mid7(float a, float b, float c, float d, float e, float f, float g)
+{
+    float v[7];
+    float t;
+    int i,j;
+
+    v[0]=a; v[1]=b; v[2]=c; v[3]=d; v[4]=e; v[5]=f; v[6]=g;
+    for (i=1;i<7;i++)
+    {
+        t=v[i];
+        for (j=i;j>0 && v[j-1]>t;j--)
+            v[j]=v[j-1];
+        v[j]=t;
+    }
+    return v[3];
+}
+
+// 5个数去掉最大值和最小值后的平均值
+static inline float minmax_avg5(float a, float b, float c, float d, float e)
+{
+    return (a+b+c+d+e-max5(a,b,c,d,e)-min5(a,b,c,d,e))*(1.0f/3);
+}
+
+static inline float sqr_f32(float x) { return x*x; }
+
+/**
+ * @fn              float plane_mf_pix_ext(float z0, float z1, float z2, float z3, float z4, float z5, float z6, float z7, float z8,
+ *                                     float *gx, float *gy, float *res)
+ * @brief           平面匹配滤波器（单像素），同时输出最优平面的斜率和拟合残差
+ * @details         输入：3x3=9个像素点深度，
+ *                      z0 z1 z2
+ *                      z3 z4 z5
+ *                      z6 z7 z8
+ *                  计算原理：
+ *                  从9个点中，找出6个点，计算拟合的平面离那6个点的距离误差，找出最匹配的6个点，作为匹配结果，修正中间点(z4)的深度
+ *                  注意：最优方案使用比较选择而不是分支得到，以便编译器对多帧批处理循环做向量化
+ *                  8种方案都是6点最小二乘平面 z=zc+gx*du+gy*dv，斜率和zc一样是6个点的固定线性组合，
+ *                  和zc用同一组比较选出，几乎不增加计算量
+ * @param [out]     float *gx,*gy：最优平面沿x（列）、y（行）方向的斜率，单位为深度/像素
+ * @param [out]     float *res：最优平面的拟合残差（6个点的均方误差，深度单位的平方），越小越可信
+ * @retval          float：中心点深度修正结果
+ */
+static inline float plane_mf_pix_ext(float z0, float z1, float z2, float z3, float z4, float z5, float z6, float z7, float z8,
+                                     float *gx, float *gy, float *res)
+{
+    float e0,e1,e2,e3,e4,e5,e6,e7;
+    float minv,zc,sx,sy;
+
+    e0= (sqr_f32(-5*z0+4*z1+  z2+3*z3     -3*z5)+   //  z0 z1 z2    // 用上方6个点拟合平面，计算拟合误差e0
+         sqr_f32( 4*z0-8*z1+4*z2               )+   //  z3 z4 z5
+         sqr_f32(   z0+4*z1-5*z2-3*z3     +3*z5)+   //  *  *  *
+         sqr_f32( 3*z0     -3*z2-5*z3+4*z4+  z5)+
+         sqr_f32(                4*z3-8*z4+4*z5)+
+         sqr_f32(-3*z0     +3*z2+  z3+4*z4-5*z5))/144;
+
+    e1= (sqr_f32(-3*z0+3*z1-  z2+3*z4-  z5-  z8)+   //  z0 z1 z2    // 用右上方6个点拟合平面，计算拟合误差e1
+         sqr_f32( 3*z0-7*z1+3*z2+  z4+  z5-  z8)+   //  *  z4 z5
+         sqr_f32(  -z0+3*z1-3*z2-  z4+3*z5-  z8)+   //  *  *  z8
+         sqr_f32( 3*z0+  z1-  z2-7*z4+  z5+3*z8)+
+         sqr_f32(  -z0+  z1+3*z2+  z4-7*z5+3*z8)+
+         sqr_f32(  -z0-  z1-  z2+3*z4+3*z5-3*z8))/100;
+
+    e2= (sqr_f32(-5*z1+3*z2+4*z4     +  z7-3*z8)+   //  *  z1 z2    // 用右方6个点拟合平面，计算拟合误差e2
+         sqr_f32( 3*z1-5*z2     +4*z5-3*z7+  z8)+   //  *  z4 z5
+         sqr_f32( 4*z1     -8*z4     +4*z7     )+   //  *  z7 z8
+         sqr_f32(      4*z2     -8*z5     +4*z8)+
+         sqr_f32(   z1-3*z2+4*z4     -5*z7+3*z8)+
+         sqr_f32(-3*z1+  z2     +4*z5+3*z7-5*z8))/144;
+
+    e3= (sqr_f32(-3*z2+3*z4+3*z5-  z6-  z7-  z8)+   //  *  *  z2    // 用右下方6个点拟合平面，计算拟合误差e3
+         sqr_f32( 3*z2-7*z4+  z5+3*z6+  z7-  z8)+   //  *  z4 z5
+         sqr_f32( 3*z2+  z4-7*z5-  z6+  z7+3*z8)+   //  z6 z7 z8
+         sqr_f32(  -z2+3*z4-  z5-3*z6+3*z7-  z8)+
+         sqr_f32(  -z2+  z4+  z5+3*z6-7*z7+3*z8)+
+         sqr_f32(  -z2-  z4+3*z5-  z6+3*z7-3*z8))/100;
+
+    e4= (sqr_f32(-5*z3+4*z4+  z5+3*z6     -3*z8)+   //  *  *  *     // 用下方6个点拟合平面，计算拟合误差e4
+         sqr_f32( 4*z3-8*z4+4*z5               )+   //  z3 z4 z5
+         sqr_f32(   z3+4*z4-5*z5-3*z6     +3*z8)+   //  z6 z7 z8
+         sqr_f32( 3*z3     -3*z5-5*z6+4*z7+  z8)+
+         sqr_f32(                4*z6-8*z7+4*z8)+
+         sqr_f32(-3*z3     +3*z5+  z6+4*z7-5*z8))/144;
+
+    e5= (sqr_f32(-3*z0+3*z3+3*z4-  z6-  z7-  z8)+   //  z0 *  *     // 用左下方6个点拟合平面，计算拟合误差e5
+         sqr_f32( 3*z0-7*z3+  z4+3*z6+  z7-  z8)+   //  z3 z4 *
+         sqr_f32( 3*z0+  z3-7*z4-  z6+  z7+3*z8)+   //  z6 z7 z8
+         sqr_f32(  -z0+3*z3-  z4-3*z6+3*z7-  z8)+
+         sqr_f32(  -z0+  z3+  z4+3*z6-7*z7+3*z8)+
+         sqr_f32(  -z0-  z3+3*z4-  z6+3*z7-3*z8))/100;
+
+    e6= (sqr_f32(-5*z0+3*z1+4*z3     +  z6-3*z7)+   //  z0 z1 *     // 用左方6个点拟合平面，计算拟合误差e6
+         sqr_f32( 3*z0-5*z1     +4*z4-3*z6+  z7)+   //  z3 z4 *
+         sqr_f32( 4*z0     -8*z3     +4*z6     )+   //  z6 z7 *
+         sqr_f32(      4*z1     -8*z4     +4*z7)+
+         sqr_f32(   z0-3*z1+4*z3     -5*z6+3*z7)+
+         sqr_f32(-3*z0+  z1     +4*z4+3*z6-5*z7))/144;
+
+    e7= (sqr_f32(-3*z0+3*z1-  z2+3*z3-  z4-  z6)+   //  z0 z1 z2    // 用左上6个点拟合平面，计算拟合误差e7
+         sqr_f32( 3*z0-7*z1+3*z2+  z3+  z4-  z6)+   //  z3 z4 *
+         sqr_f32(-  z0+3*z1-3*z2-  z3+3*z4-  z6)+   //  z6 *  *
+         sqr_f32( 3*z0+  z1-  z2-7*z3+  z4+3*z6)+
+         sqr_f32(  -z0+  z1+3*z2+  z3-7*z4+3*z6)+
+         sqr_f32(  -z0-  z1-  z2+3*z3+3*z4-3*z6))/100;
+
+    // 根据e0~e7，找到最优拟合方案，同时选出对应的中心点深度修正结果和平面斜率
+    // 方案0和4、方案2和6的修正结果相同，斜率不同
+    minv=e0; zc=(z3+z4+z5)/3;
+    sx=(  -z0     +  z2-  z3     +  z5               )/4;
+    sy=(  -z0-  z1-  z2+  z3+  z4+  z5               )/3;
+    sx=(e1<minv)?(-2*z0     +2*z2       -z4+  z5               )/5:sx;
+    sy=(e1<minv)?(     -  z1-2*z2       +z4               +2*z8)/5:sy;
+    zc=(e1<minv)?( 3*z0+  z1-  z2+3*z4+  z5+3*z8)/10:zc; minv=MIN2(e1,minv);
+    sx=(e2<minv)?(     -  z1+  z2     -  z4+  z5     -  z7+  z8)/3:sx;
+    sy=(e2<minv)?(     -  z1-  z2                    +  z7+  z8)/4:sy;
+    zc=(e2<minv)?(   z1     +  z4     +  z7     )/3 :zc; minv=MIN2(e2,minv);
+    sx=(e3<minv)?(                     -  z4+  z5-2*z6     +2*z8)/5:sx;
+    sy=(e3<minv)?(          -2*z2     -  z4          +  z7+2*z8)/5:sy;
+    zc=(e3<minv)?( 3*z2+3*z4+  z5+3*z6+  z7  -z8)/10:zc; minv=MIN2(e3,minv);
+    sx=(e4<minv)?(                -  z3     +  z5-  z6     +  z8)/4:sx;
+    sy=(e4<minv)?(                -  z3-  z4-  z5+  z6+  z7+  z8)/3:sy;
+    zc=(e4<minv)?(   z3+  z4+  z5               )/3 :zc; minv=MIN2(e4,minv);
+    sx=(e5<minv)?(                -  z3+  z4     -2*z6     +2*z8)/5:sx;
+    sy=(e5<minv)?(-2*z0               -  z4     +2*z6+  z7     )/5:sy;
+    zc=(e5<minv)?( 3*z0+  z3+3*z4  -z6+  z7+3*z8)/10:zc; minv=MIN2(e5,minv);
+    sx=(e6<minv)?(  -z0+  z1     -  z3+  z4     -  z6+  z7     )/3:sx;
+    sy=(e6<minv)?(  -z0-  z1                    +  z6+  z7     )/4:sy;
+    zc=(e6<minv)?(        z1     +  z4     +  z7)/3 :zc; minv=MIN2(e6,minv);
+    sx=(e7<minv)?(-2*z0     +2*z2-  z3+  z4                    )/5:sx;
+    sy=(e7<minv)?(-2*z0-  z1          +  z4     +2*z6          )/5:sy;
+    zc=(e7<minv)?(  -z0+  z1+3*z2+  z3+3*z4+3*z6)/10:zc; minv=MIN2(e7,minv);
+
+    *gx=sx;
+    *gy=sy;
+    *res=minv/6;
+    return zc;
+}
+
+/**
+ * @fn              float plane_mf_pix(float z0, float z1, float z2, float z3, float z4, float z5, float z6, float z7, float z8)
+ * @brief           平面匹配滤波器（单像素），img_plane_mf_pix的内联实现，供单帧和多帧批处理滤波器共享
+ * @details         只要中心点深度时，内联后斜率和残差的计算被编译器删除，结果和plane_mf_pix_ext相同
+ * @retval          float：中心点深度修正结果
+ */
+static inline float plane_mf_pix(float z0, float z1, float z2, float z3, float z4, float z5, float z6, float z7, float z8)
+{
+    float gx,gy,res;
+    return plane_mf_pix_ext(z0,z1,z2,z3,z4,z5,z6,z7,z8,&gx,&gy,&res);
+}
+
+/**
+ * @fn              float *img_copy(float *img_out, float *img_in, int n)
+ * @brief           图像数据复制
+ * @param [in]      float *img_in：指针，指向源图像
+ * @param [in]      int n：数据个数
+ * @param [out]     float *img_out：指针，指向目的图像
+ * @retval          float *：和img_out相同
+ */
+float *img_copy(float *img_out, float *img_in, int n);
+
+/**
+ * @fn              float *img_mul_f32(float *img_out, float *img_in, float c)
+ * @brief           图像乘以常数：img_out[:]=img_in[:]*c
+ * @retval          float *：和img_out相同
+ */
+float *img_mul_f32(float *img_out, float *img_in, float c);
+
+/**
+ * @fn              float *img_prod_f32(float *img_inout, float c)
+ * @brief           图像乘以常数（原址运算）：img_inout[:]*=c
+ * @retval          float *：和img_inout相同
+ */
+float *img_prod_f32(float *img_inout, float c);
+
+/**
+ * @fn              float *img_cum(float *img_inout, float *img_in)
+ * @brief           图像累加：img_inout[:]+=img_in[:]
+ * @retval          float *：和img_inout相同
+ */
+float *img_cum(float *img_inout, float *img_in);
+
+/**
+ * @fn              float *img_mac(float *img_inout, float *img_in, float c)
+ * @brief           图像乘累加：img_inout[:]+=img_in[:]*c
+ * @retval          float *：和img_inout相同
+ */
+float *img_mac(float *img_inout, float *img_in, float c);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
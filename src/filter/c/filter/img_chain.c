@@ -0,0 +1,640 @@
+/**
+ * @file    img_chain.c
+ * @author  YRD
+ * @version 1.0
+ * @date    2026-10-18
+ * @brief   滤波链
+ * @details 滤波级描述表stage_tab列出了所有可以串联的滤波器，新增滤波器时在表中增加一项即可
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "img_const.h"
+#include "img_algo.h"
+#include "img_filter.h"
+#include "img_filter_bat.h"
+#include "img_trace.h"
+#include "img_chain.h"
+
+
+// 空间滤波器
+static float *run_fir_cross    (struct img_stage_s *s, float *o, float *i) { return img_fir_cross(o,i,s->coff); }
+static float *run_fir_sqr3     (struct img_stage_s *s, float *o, float *i) { return img_fir_sqr3_bat_mt(o,i,s->coff,1,s->par); }
+static float *run_mid_cross    (struct img_stage_s *s, float *o, float *i) { (void)s; return img_mid_cross(o,i); }
+static float *run_plane_mf_sqr3(struct img_stage_s *s, float *o, float *i) { return img_plane_mf_sqr3_bat_mt(o,i,1,s->par); }
+static float *run_nnf_sqr3     (struct img_stage_s *s, float *o, float *i) { return img_nnf_sqr3(o,i,s->coff[0]); }
+static float *run_nnd_sqr3     (struct img_stage_s *s, float *o, float *i) { (void)s; return img_nnd_sqr3(o,i); }
+
+static float *run_hole_fill(struct img_stage_s *s, float *o, float *i)
+{
+    int n;
+    for (n=0;n<IMG_SZ;n++)
+        s->img_mask[n]=(i[n]!=0);
+    return img_hole_fill(o,i,s->img_mask);
+}
+
+// 时间滤波器
+static float *run_iir_t(struct img_stage_s *s, float *o, float *i)
+{
+    (void)o;
+    if (s->n==0)
+        img_copy(s->img_st1,i,IMG_SZ);
+    return img_iir_t(s->img_st1,i,s->coff[0]);
+}
+
+static float *run_iir_sos      (struct img_stage_s *s, float *o, float *i) { return img_iir_sos(o,i,s->img_st1,s->img_st2,s->coff); }
+static float *run_fir3_t       (struct img_stage_s *s, float *o, float *i) { return img_fir3_t(o,s->img_buf,i,s->coff,&s->state); }
+static float *run_mid3_t       (struct img_stage_s *s, float *o, float *i) { return img_mid3_t(o,s->img_buf,i,&s->state); }
+static float *run_max3_t       (struct img_stage_s *s, float *o, float *i) { return img_max3_t(o,s->img_buf,i,&s->state); }
+static float *run_mid5_t       (struct img_stage_s *s, float *o, float *i) { return img_mid5_t(o,s->img_buf,i,&s->state); }
+static float *run_minmax_avg5_t(struct img_stage_s *s, float *o, float *i) { return img_minmax_avg5_t(o,s->img_buf,i,&s->state); }
+static float *run_max5_t       (struct img_stage_s *s, float *o, float *i) { return img_max5_t(o,s->img_buf,i,&s->state); }
+static float *run_min5_t       (struct img_stage_s *s, float *o, float *i) { return img_min5_t(o,s->img_buf,i,&s->state); }
+static float *run_fb_mid3_t    (struct img_stage_s *s, float *o, float *i) { return img_fb_mid3_t(o,s->img_buf,i,s->coff[0],&s->state); }
+static float *run_nnf_sqr3_mid5(struct img_stage_s *s, float *o, float *i) { return img_nnf_sqr3_mid5(o,s->img_buf,i,&s->state,s->coff[0]); }
+static float *run_mid7_st      (struct img_stage_s *s, float *o, float *i) { return img_mid7_st(o,s->img_buf,i,&s->state); }
+
+// 时间滤波器，历史图像由调用者提供（h[0]最老），不拷贝
+static float *hist_fir3_t       (struct img_stage_s *s, float *o, float **h) { return img_fir3_t_raw(o,h[0],h[1],h[2],s->coff); }
+static float *hist_mid3_t       (struct img_stage_s *s, float *o, float **h) { (void)s; return img_mid3_t_raw(o,h[0],h[1],h[2]); }
+static float *hist_max3_t       (struct img_stage_s *s, float *o, float **h) { (void)s; return img_max3_t_raw(o,h[0],h[1],h[2]); }
+static float *hist_mid5_t       (struct img_stage_s *s, float *o, float **h) { (void)s; return img_mid5_t_raw(o,h[0],h[1],h[2],h[3],h[4]); }
+static float *hist_minmax_avg5_t(struct img_stage_s *s, float *o, float **h) { (void)s; return img_minmax_avg5_t_raw(o,h[0],h[1],h[2],h[3],h[4]); }
+static float *hist_max5_t       (struct img_stage_s *s, float *o, float **h) { (void)s; return img_max5_t_raw(o,h[0],h[1],h[2],h[3],h[4]); }
+static float *hist_min5_t       (struct img_stage_s *s, float *o, float **h) { (void)s; return img_min5_t_raw(o,h[0],h[1],h[2],h[3],h[4]); }
+static float *hist_fb_mid3_t    (struct img_stage_s *s, float *o, float **h) { return img_fb_mid3_t_raw(o,h[0],h[1],h[2],h[3],h[4],s->coff[0]); }
+static float *hist_nnf_sqr3_mid5(struct img_stage_s *s, float *o, float **h) { return img_nnf_sqr3_mid5_raw(o,h[0],h[1],h[2],h[3],h[4],s->coff[0]); }
+static float *hist_mid7_st      (struct img_stage_s *s, float *o, float **h) { (void)s; return img_mid7_st_raw(o,h[0],h[1],h[2]); }
+
+// 可选实现：单帧滤波器、k=1的批处理滤波器（循环可向量化），结果和默认实现相同
+static float *run_fir_sqr3_1         (struct img_stage_s *s, float *o, float *i) { return img_fir_sqr3(o,i,s->coff); }
+static float *run_fir_sqr3_bat       (struct img_stage_s *s, float *o, float *i) { return img_fir_sqr3_bat(o,i,s->coff,1); }
+static float *run_plane_mf_sqr3_1    (struct img_stage_s *s, float *o, float *i) { (void)s; return img_plane_mf_sqr3(o,i); }
+static float *run_plane_mf_sqr3_bat  (struct img_stage_s *s, float *o, float *i) { (void)s; return img_plane_mf_sqr3_bat(o,i,1); }
+static float *run_fir3_t_bat         (struct img_stage_s *s, float *o, float *i) { return img_fir3_t_bat(o,s->img_buf,i,s->coff,1,&s->state); }
+static float *run_mid3_t_bat         (struct img_stage_s *s, float *o, float *i) { return img_mid3_t_bat(o,s->img_buf,i,1,&s->state); }
+static float *run_max3_t_bat         (struct img_stage_s *s, float *o, float *i) { return img_max3_t_bat(o,s->img_buf,i,1,&s->state); }
+static float *run_mid5_t_bat         (struct img_stage_s *s, float *o, float *i) { return img_mid5_t_bat(o,s->img_buf,i,1,&s->state); }
+static float *run_minmax_avg5_t_bat  (struct img_stage_s *s, float *o, float *i) { return img_minmax_avg5_t_bat(o,s->img_buf,i,1,&s->state); }
+static float *run_max5_t_bat         (struct img_stage_s *s, float *o, float *i) { return img_max5_t_bat(o,s->img_buf,i,1,&s->state); }
+static float *run_min5_t_bat         (struct img_stage_s *s, float *o, float *i) { return img_min5_t_bat(o,s->img_buf,i,1,&s->state); }
+static float *hist_fir3_t_bat        (struct img_stage_s *s, float *o, float **h) { return img_fir3_t_bat_raw(o,h[0],h[1],h[2],s->coff,1); }
+static float *hist_mid3_t_bat        (struct img_stage_s *s, float *o, float **h) { (void)s; return img_mid3_t_bat_raw(o,h[0],h[1],h[2],1); }
+static float *hist_max3_t_bat        (struct img_stage_s *s, float *o, float **h) { (void)s; return img_max3_t_bat_raw(o,h[0],h[1],h[2],1); }
+static float *hist_mid5_t_bat        (struct img_stage_s *s, float *o, float **h) { (void)s; return img_mid5_t_bat_raw(o,h[0],h[1],h[2],h[3],h[4],1); }
+static float *hist_minmax_avg5_t_bat (struct img_stage_s *s, float *o, float **h) { (void)s; return img_minmax_avg5_t_bat_raw(o,h[0],h[1],h[2],h[3],h[4],1); }
+static float *hist_max5_t_bat        (struct img_stage_s *s, float *o, float **h) { (void)s; return img_max5_t_bat_raw(o,h[0],h[1],h[2],h[3],h[4],1); }
+static float *hist_min5_t_bat        (struct img_stage_s *s, float *o, float **h) { (void)s; return img_min5_t_bat_raw(o,h[0],h[1],h[2],h[3],h[4],1); }
+
+static float *run_iir_t_bat(struct img_stage_s *s, float *o, float *i)
+{
+    (void)o;
+    if (s->n==0)
+        img_copy(s->img_st1,i,IMG_SZ);
+    return img_iir_t_bat(s->img_st1,i,s->coff[0],1);
+}
+
+// 降级：跳过本级，直接输出输入图像
+static float *deg_skip(struct img_stage_s *s, float *o, float *i, float **h) { (void)s; (void)o; (void)h; return i; }
+
+// 2帧历史的时间滤波器跳过本级，仍更新历史图像（和img_mid3_t等的状态约定相同）
+static float *deg_skip2_t(struct img_stage_s *s, float *o, float *i, float **h)
+{
+    (void)o;
+    if (h==NULL)
+    {
+        img_copy(s->img_buf+(s->state ? IMG_SZ : 0),i,IMG_SZ);
+        s->state=!s->state;
+    }
+    return i;
+}
+
+// 4帧历史的第k帧，k=0最老，k=3最新（和img_mid5_t等的状态约定相同）
+static float *hist4(struct img_stage_s *s, float **h, int k)
+{
+    return h ? h[k] : s->img_buf+IMG_SZ*((s->state+k)%4);
+}
+
+// 4帧历史更新为当前图像
+static void hist4_push(struct img_stage_s *s, float **h, float *i)
+{
+    if (h==NULL)
+    {
+        img_copy(s->img_buf+IMG_SZ*s->state,i,IMG_SZ);
+        s->state=(s->state+1)%4;
+    }
+}
+
+// 5帧时间滤波器降级为最近3帧的中值/最大值
+static float *deg_mid3_5t(struct img_stage_s *s, float *o, float *i, float **h)
+{
+    img_mid3_t_raw(o,hist4(s,h,2),hist4(s,h,3),i);
+    hist4_push(s,h,i);
+    return o;
+}
+
+static float *deg_max3_5t(struct img_stage_s *s, float *o, float *i, float **h)
+{
+    img_max3_t_raw(o,hist4(s,h,2),hist4(s,h,3),i);
+    hist4_push(s,h,i);
+    return o;
+}
+
+static float *deg_skip5_t(struct img_stage_s *s, float *o, float *i, float **h)
+{
+    (void)o;
+    hist4_push(s,h,i);
+    return i;
+}
+
+// nnf_sqr3_mid5降级为只用当前帧的nnf_sqr3
+static float *deg_nnf_sqr3_mid5(struct img_stage_s *s, float *o, float *i, float **h)
+{
+    img_nnf_sqr3(o,i,s->coff[0]);
+    hist4_push(s,h,i);
+    return o;
+}
+
+// mid7_st降级为使用相同3帧的时间中值
+static float *deg_mid7_st(struct img_stage_s *s, float *o, float *i, float **h)
+{
+    return h ? img_mid3_t_raw(o,h[0],h[1],h[2]) : img_mid3_t(o,s->img_buf,i,&s->state);
+}
+
+// 降级模式：名称，质量损失，估计运行时间(us)，执行函数
+static const struct img_stage_deg_s deg_skip_sp  ={ "skip",     2, 0,    deg_skip          };
+static const struct img_stage_deg_s deg_skip_pmf ={ "skip",     4, 0,    deg_skip          };
+static const struct img_stage_deg_s deg_skip_hole={ "skip",     3, 0,    deg_skip          };
+static const struct img_stage_deg_s deg_skip_t2  ={ "skip",     2, 100,  deg_skip2_t       };
+static const struct img_stage_deg_s deg_skip_t5  ={ "skip",     2, 100,  deg_skip5_t       };
+static const struct img_stage_deg_s deg_mid3_t5  ={ "mid3_t",   1, 360,  deg_mid3_5t       };
+static const struct img_stage_deg_s deg_mid3_fb  ={ "mid3_t",   2, 360,  deg_mid3_5t       };
+static const struct img_stage_deg_s deg_max3_t5  ={ "max3_t",   1, 300,  deg_max3_5t       };
+static const struct img_stage_deg_s deg_nnf_mid5 ={ "nnf_sqr3", 1, 1200, deg_nnf_sqr3_mid5 };
+static const struct img_stage_deg_s deg_mid7     ={ "mid3_t",   1, 360,  deg_mid7_st       };
+
+#define C9 (1.0f/9)
+
+// 滤波级描述表：级名，参数个数，默认参数，历史图像帧数，状态图像数，执行函数，共享历史的执行函数，
+//               估计运行时间(us)，降级模式
+static const struct img_stage_desc_s stage_tab[]=
+{
+    { "fir_cross",      5, {0.2f,0.2f,0.2f,0.2f,0.2f},      0, 0, run_fir_cross,     NULL,               470,   &deg_skip_sp   },
+    { "fir_sqr3",       9, {C9,C9,C9,C9,C9,C9,C9,C9,C9},    0, 0, run_fir_sqr3,      NULL,               740,   &deg_skip_sp   },
+    { "mid_cross",      0, {0},                             0, 0, run_mid_cross,     NULL,               550,   &deg_skip_sp   },
+    { "plane_mf_sqr3",  0, {0},                             0, 0, run_plane_mf_sqr3, NULL,               18000, &deg_skip_pmf  },
+    { "nnf_sqr3",       1, {0.05f},                         0, 0, run_nnf_sqr3,      NULL,               1100,  &deg_skip_sp   },
+    { "nnd_sqr3",       0, {0},                             0, 0, run_nnd_sqr3,      NULL,               1000,  &deg_skip_sp   },
+    { "hole_fill",      0, {0},                             0, 0, run_hole_fill,     NULL,               510,   &deg_skip_hole },
+    { "iir_t",          1, {0.5f},                          0, 1, run_iir_t,         NULL,               250,   NULL           },
+    { "iir_sos",        6, {1,0,0,0,0,1},                   0, 2, run_iir_sos,       NULL,               1200,  NULL           },
+    { "fir3_t",         3, {1.0f/3,1.0f/3,1.0f/3},          2, 0, run_fir3_t,        hist_fir3_t,        250,   &deg_skip_t2   },
+    { "mid3_t",         0, {0},                             2, 0, run_mid3_t,        hist_mid3_t,        260,   &deg_skip_t2   },
+    { "max3_t",         0, {0},                             2, 0, run_max3_t,        hist_max3_t,        200,   &deg_skip_t2   },
+    { "mid5_t",         0, {0},                             4, 0, run_mid5_t,        hist_mid5_t,        530,   &deg_mid3_t5   },
+    { "minmax_avg5_t",  0, {0},                             4, 0, run_minmax_avg5_t, hist_minmax_avg5_t, 570,   &deg_mid3_t5   },
+    { "max5_t",         0, {0},                             4, 0, run_max5_t,        hist_max5_t,        390,   &deg_max3_t5   },
+    { "min5_t",         0, {0},                             4, 0, run_min5_t,        hist_min5_t,        400,   &deg_skip_t5   },
+    { "fb_mid3_t",      1, {0.05f},                         4, 0, run_fb_mid3_t,     hist_fb_mid3_t,     860,   &deg_mid3_fb   },
+    { "nnf_sqr3_mid5",  1, {0.05f},                         4, 0, run_nnf_sqr3_mid5, hist_nnf_sqr3_mid5, 850,   &deg_nnf_mid5  },
+    { "mid7_st",        0, {0},                             2, 0, run_mid7_st,       hist_mid7_st,       13000, &deg_mid7      },
+};
+
+#define STAGE_TAB_SZ    ((int)(sizeof(stage_tab)/sizeof(stage_tab[0])))
+
+// 实现表：级名，实现名，执行函数，共享历史的执行函数；每级的第一项为默认实现
+static const struct img_stage_var_s var_tab[]=
+{
+    { "fir_sqr3",       "bat_mt",   run_fir_sqr3,           NULL                   },
+    { "fir_sqr3",       "bat",      run_fir_sqr3_bat,       NULL                   },
+    { "fir_sqr3",       "scalar",   run_fir_sqr3_1,         NULL                   },
+    { "plane_mf_sqr3",  "bat_mt",   run_plane_mf_sqr3,      NULL                   },
+    { "plane_mf_sqr3",  "bat",      run_plane_mf_sqr3_bat,  NULL                   },
+    { "plane_mf_sqr3",  "scalar",   run_plane_mf_sqr3_1,    NULL                   },
+    { "iir_t",          "scalar",   run_iir_t,              NULL                   },
+    { "iir_t",          "bat",      run_iir_t_bat,          NULL                   },
+    { "fir3_t",         "scalar",   run_fir3_t,             NULL                   },
+    { "fir3_t",         "bat",      run_fir3_t_bat,         hist_fir3_t_bat        },
+    { "mid3_t",         "scalar",   run_mid3_t,             NULL                   },
+    { "mid3_t",         "bat",      run_mid3_t_bat,         hist_mid3_t_bat        },
+    { "max3_t",         "scalar",   run_max3_t,             NULL                   },
+    { "max3_t",         "bat",      run_max3_t_bat,         hist_max3_t_bat        },
+    { "mid5_t",         "scalar",   run_mid5_t,             NULL                   },
+    { "mid5_t",         "bat",      run_mid5_t_bat,         hist_mid5_t_bat        },
+    { "minmax_avg5_t",  "scalar",   run_minmax_avg5_t,      NULL                   },
+    { "minmax_avg5_t",  "bat",      run_minmax_avg5_t_bat,  hist_minmax_avg5_t_bat },
+    { "max5_t",         "scalar",   run_max5_t,             NULL                   },
+    { "max5_t",         "bat",      run_max5_t_bat,         hist_max5_t_bat        },
+    { "min5_t",         "scalar",   run_min5_t,             NULL                   },
+    { "min5_t",         "bat",      run_min5_t_bat,         hist_min5_t_bat        },
+};
+
+#define VAR_TAB_SZ      ((int)(sizeof(var_tab)/sizeof(var_tab[0])))
+
+static const struct img_stage_var_s *var_sel[STAGE_TAB_SZ];    // 各级选择的实现，NULL为默认
+
+
+const struct img_stage_desc_s *img_stage_find(const char *name)
+{
+    int i;
+    for (i=0;i<STAGE_TAB_SZ;i++)
+        if (strcmp(stage_tab[i].name,name)==0)
+            return &stage_tab[i];
+    return NULL;
+}
+
+
+const struct img_stage_desc_s *img_stage_get(int i)
+{
+    return i>=0 && i<STAGE_TAB_SZ ? &stage_tab[i] : NULL;
+}
+
+
+const struct img_stage_var_s *img_stage_var(const char *stage, int i)
+{
+    int j;
+    for (j=0;j<VAR_TAB_SZ;j++)
+        if (strcmp(var_tab[j].stage,stage)==0 && i--==0)
+            return &var_tab[j];
+    return NULL;
+}
+
+
+int img_stage_select(const char *stage, const char *var)
+{
+    const struct img_stage_desc_s *d=img_stage_find(stage);
+    const struct img_stage_var_s *v;
+    int i;
+
+    if (d==NULL)
+        return -1;
+    if (var==NULL)
+    {
+        var_sel[d-stage_tab]=NULL;
+        return 0;
+    }
+    for (i=0;(v=img_stage_var(stage,i))!=NULL;i++)
+        if (strcmp(v->name,var)==0)
+        {
+            var_sel[d-stage_tab]=v;
+            return 0;
+        }
+    return -1;
+}
+
+
+const struct img_stage_var_s *img_stage_selected(const char *stage)
+{
+    const struct img_stage_desc_s *d=img_stage_find(stage);
+    if (d==NULL)
+        return NULL;
+    return var_sel[d-stage_tab] ? var_sel[d-stage_tab] : img_stage_var(stage,0);
+}
+
+
+void img_chain_list(FILE *fp)
+{
+    int i,j;
+    for (i=0;i<STAGE_TAB_SZ;i++)
+    {
+        fprintf(fp,"  %-16s",stage_tab[i].name);
+        for (j=0;j<stage_tab[i].n_par;j++)
+            fprintf(fp,"%c%g",j ? '/' : ':',stage_tab[i].par_def[j]);
+        fprintf(fp,"\n");
+    }
+}
+
+
+// 为滤波级分配图像
+static int stage_alloc(struct img_stage_s *s, struct img_pool_s *pool)
+{
+    const struct img_stage_desc_s *d=s->desc;
+
+    s->img_out=img_pool_alloc_img(pool,1);
+    if (s->img_out==NULL) return -1;
+    memset(s->img_out,0,sizeof(float)*IMG_SZ);
+
+    if (d->n_hist)
+    {
+        s->img_buf=img_pool_alloc_img(pool,d->n_hist);
+        if (s->img_buf==NULL) return -1;
+    }
+    if (d->n_st>0)
+    {
+        s->img_st1=img_pool_alloc_img(pool,1);
+        if (s->img_st1==NULL) return -1;
+        memset(s->img_st1,0,sizeof(float)*IMG_SZ);
+    }
+    if (d->n_st>1)
+    {
+        s->img_st2=img_pool_alloc_img(pool,1);
+        if (s->img_st2==NULL) return -1;
+        memset(s->img_st2,0,sizeof(float)*IMG_SZ);
+    }
+    if (d->run==run_hole_fill)
+    {
+        s->img_mask=(uint8_t *)img_pool_alloc(pool,IMG_SZ);
+        if (s->img_mask==NULL) return -1;
+    }
+    return 0;
+}
+
+
+int img_chain_init(struct img_chain_s *chain, const char *spec, struct img_pool_s *pool, struct img_par_s *par)
+{
+    char buf[1024];
+    char *tok,*save=NULL;
+
+    memset(chain,0,sizeof(*chain));
+    chain->pool=pool;
+    chain->par =par;
+    chain->trace_id=img_trace_id("chain");
+
+    if (strlen(spec)>=sizeof(buf))
+    {
+        fprintf(stderr,"img_chain: spec too long\n");
+        return -1;
+    }
+    strcpy(buf,spec);
+
+    for (tok=strtok_r(buf,",",&save);tok;tok=strtok_r(NULL,",",&save))
+    {
+        struct img_stage_s *s;
+        char *arg=strchr(tok,':');
+        int j;
+
+        if (*tok==0)
+            continue;
+        if (chain->n>=IMG_CHAIN_MAX)
+        {
+            fprintf(stderr,"img_chain: more than %d stages\n",IMG_CHAIN_MAX);
+            goto err;
+        }
+        if (arg)
+            *arg++=0;
+
+        s=&chain->stg[chain->n];
+        s->desc=img_stage_find(tok);
+        if (s->desc==NULL)
+        {
+            fprintf(stderr,"img_chain: unknown stage '%s'\n",tok);
+            goto err;
+        }
+        s->par=par;
+        s->var=img_stage_selected(s->desc->name);
+        s->run=s->var ? s->var->run : s->desc->run;
+        s->run_hist=s->var && s->var->run_hist ? s->var->run_hist : s->desc->run_hist;
+        s->trace_id=img_trace_id(s->desc->name);
+        s->t_est=s->desc->cost*1e3f*IMG_SZ/(512*424);
+        s->t_deg_est=s->desc->deg ? s->desc->deg->cost*1e3f*IMG_SZ/(512*424) : s->t_est;
+        memcpy(s->coff,s->desc->par_def,sizeof(s->coff));
+
+        for (j=0;arg && *arg;j++)
+        {
+            char *end;
+            if (j>=s->desc->n_par)
+            {
+                fprintf(stderr,"img_chain: stage '%s' takes %d parameter(s)\n",tok,s->desc->n_par);
+                goto err;
+            }
+            s->coff[j]=strtof(arg,&end);
+            if (end==arg || (*end && *end!='/'))
+            {
+                fprintf(stderr,"img_chain: bad parameter '%s' for stage '%s'\n",arg,tok);
+                goto err;
+            }
+            arg=*end ? end+1 : end;
+        }
+
+        chain->n++;
+        if (stage_alloc(s,pool))
+        {
+            fprintf(stderr,"img_chain: out of pool memory for stage '%s'\n",tok);
+            goto err;
+        }
+    }
+    return 0;
+
+err:
+    img_chain_release(chain);
+    return -1;
+}
+
+
+void img_chain_release(struct img_chain_s *chain)
+{
+    int i;
+    for (i=0;i<chain->n;i++)
+    {
+        struct img_stage_s *s=&chain->stg[i];
+        img_pool_release(chain->pool,s->img_out);
+        img_pool_release(chain->pool,s->img_buf);
+        img_pool_release(chain->pool,s->img_st1);
+        img_pool_release(chain->pool,s->img_st2);
+        img_pool_release(chain->pool,s->img_mask);
+        memset(s,0,sizeof(*s));
+    }
+    chain->n=0;
+    img_hist_clear(&chain->hist);
+    chain->hist_shared=0;
+}
+
+
+// 按剩余时间选择降级的级：预测时间超出时，每次选"节省时间/质量损失"最大的级降级
+static void chain_plan(struct img_chain_s *chain, int64_t left)
+{
+    float full=0,pred;
+    int i,k;
+
+    for (i=0;i<chain->n;i++)
+    {
+        chain->stg[i].deg=0;
+        full+=chain->stg[i].t_est;
+    }
+    for (pred=full;pred>(float)left;)
+    {
+        float best=0;
+        k=-1;
+        for (i=0;i<chain->n;i++)
+        {
+            struct img_stage_s *s=&chain->stg[i];
+            float save=s->t_est-s->t_deg_est;
+            if (!s->deg && s->desc->deg && s->n-s->n_deg>=2 && s->deg_run<IMG_QOS_PROBE
+                && save>0 && save/s->desc->deg->loss>best)
+            {
+                best=save/s->desc->deg->loss;
+                k=i;
+            }
+        }
+        if (k<0)
+            break;
+        chain->stg[k].deg=1;
+        pred-=chain->stg[k].t_est-chain->stg[k].t_deg_est;
+    }
+
+    if (pred<full)
+        chain->n_deg_frm++;
+    if (chain->qos_log && (pred<full || chain->qos_last))
+    {
+        fprintf(chain->qos_log,"qos %llu: left %.2f ms, full %.2f ms, plan %.2f ms,",
+                (unsigned long long)chain->n_frm,left/1e6,full/1e6,pred/1e6);
+        for (i=0;i<chain->n;i++)
+            if (chain->stg[i].deg)
+                fprintf(chain->qos_log," %s:%s",chain->stg[i].desc->name,chain->stg[i].desc->deg->name);
+        fprintf(chain->qos_log,pred<full ? "\n" : " full\n");
+    }
+    chain->qos_last=(pred<full);
+}
+
+
+// 依次执行各级，hist不为NULL时第一级使用hist中的历史图像，t_dead为截止时间（0表示不降级）
+static float *chain_run(struct img_chain_s *chain, float *img_out, float *img_in, float **hist, uint64_t t_dead)
+{
+    float *p=img_in;
+    uint64_t t0,t1,ts;
+    int i,j;
+
+    ts=t0=img_time_ns();
+    if (t_dead)
+        chain_plan(chain,(int64_t)(t_dead-ts));
+    for (i=0;i<chain->n;i++)
+    {
+        struct img_stage_s *s=&chain->stg[i];
+
+        // 第一帧时用当前图像填充历史图像，避免输出开始的几帧被初始的0值拉低
+        if (s->n==0 && s->img_buf)
+            for (j=0;j<s->desc->n_hist;j++)
+                img_copy(s->img_buf+j*IMG_SZ,p,IMG_SZ);
+
+        if (chain->perf)
+            img_perf_start(chain->perf);
+        if (s->deg)
+            p=s->desc->deg->run(s,s->img_out,p,i==0 ? hist : NULL);
+        else if (i==0 && hist)
+            p=s->run_hist(s,s->img_out,hist);
+        else
+            p=s->run(s,s->img_out,p);
+        if (chain->perf)
+            img_perf_stop(chain->perf,&s->perf_cnt);
+
+        t1=img_time_ns();
+        s->t_last=t1-t0;
+        if (s->deg)
+        {
+            s->t_deg_est+=((float)s->t_last-s->t_deg_est)/8;
+            s->n_deg++;
+            s->deg_run++;
+        }
+        else
+        {
+            if (s->n==1)                                    // 第一帧含历史图像填充，第二帧的实测值直接作为估计
+                s->t_est=(float)s->t_last;
+            else if (s->n)
+                s->t_est+=((float)s->t_last-s->t_est)/8;
+            s->deg_run=0;
+        }
+        s->t_sum+=s->t_last;
+        if (s->t_last>s->t_max) s->t_max=s->t_last;
+        img_trace_rec(s->trace_id,t0,t1,(uint32_t)chain->n_frm);
+        s->n++;
+        t0=t1;
+    }
+    img_copy(img_out,p,IMG_SZ);
+
+    t1=img_time_ns();
+    if (t_dead && t1>t_dead)
+        chain->n_late++;
+    img_trace_rec(chain->trace_id,ts,t1,(uint32_t)chain->n_frm);
+    t1-=ts;
+    chain->t_sum+=t1;
+    if (t1>chain->t_max) chain->t_max=t1;
+    chain->n_frm++;
+
+    return img_out;
+}
+
+
+float *img_chain_run(struct img_chain_s *chain, float *img_out, float *img_in)
+{
+    return chain_run(chain,img_out,img_in,NULL,chain->qos_budget ? img_time_ns()+chain->qos_budget : 0);
+}
+
+
+int img_chain_share_hist(struct img_chain_s *chain)
+{
+    struct img_stage_s *s=&chain->stg[0];
+
+    if (chain->n==0 || s->run_hist==NULL || s->desc->n_hist>=IMG_HIST_MAX)
+        return -1;
+    if (!chain->hist_shared)
+    {
+        img_pool_release(chain->pool,s->img_buf);
+        s->img_buf=NULL;
+        chain->hist.n=s->desc->n_hist+1;
+        chain->hist_shared=1;
+    }
+    return s->desc->n_hist;
+}
+
+
+float *img_chain_run_frm(struct img_chain_s *chain, float *img_out, struct img_frm_s *frm)
+{
+    struct img_hist_s *h=&chain->hist;
+    uint64_t t_dead=chain->qos_budget ? frm->t_in+chain->qos_budget : 0;
+    float *img[IMG_HIST_MAX];
+    int j;
+
+    if (!chain->hist_shared)
+        return chain_run(chain,img_out,frm->img,NULL,t_dead);
+
+    // 历史不足时用最老的帧补齐，和img_chain_run第一帧的处理相同
+    img_hist_push(h,frm);
+    for (j=0;j<h->n;j++)
+        img[h->n-1-j]=h->frm[j<h->cnt ? j : h->cnt-1]->img;
+    return chain_run(chain,img_out,frm->img,img,t_dead);
+}
+
+
+void img_chain_qos(struct img_chain_s *chain, uint64_t budget_ns, FILE *log)
+{
+    chain->qos_budget=budget_ns;
+    chain->qos_log=log;
+    chain->qos_last=0;
+}
+
+
+void img_chain_report(struct img_chain_s *chain, FILE *fp)
+{
+    int perf=chain->perf && chain->perf->n;
+    int qos=chain->qos_budget!=0;
+    int i;
+
+    fprintf(fp,"%-16s %10s %10s","stage","avg(us)","max(us)");
+    if (qos)
+        fprintf(fp," %8s","deg");
+    if (perf)
+        fprintf(fp," %6s %8s %8s %8s %8s","ipc","l1d/pix","llc/pix","brm/pix","B/pix");
+    fprintf(fp,"\n");
+    for (i=0;i<chain->n;i++)
+    {
+        struct img_stage_s *s=&chain->stg[i];
+        fprintf(fp,"%-16s %10.1f %10.1f",s->desc->name,
+                s->n ? s->t_sum/1e3/s->n : 0.0,s->t_max/1e3);
+        if (qos)
+            fprintf(fp," %8llu",(unsigned long long)s->n_deg);
+        if (perf)
+        {
+            double ipc,l1d,llc,brm,bpp;
+            img_perf_derive(&s->perf_cnt,(double)s->perf_cnt.n*IMG_SZ,&ipc,&l1d,&llc,&brm,&bpp);
+            fprintf(fp," %6.2f %8.4f %8.4f %8.4f %8.2f",ipc,l1d,llc,brm,bpp);
+        }
+        fprintf(fp,"\n");
+    }
+    fprintf(fp,"%-16s %10.1f %10.1f","total",
+            chain->n_frm ? chain->t_sum/1e3/chain->n_frm : 0.0,chain->t_max/1e3);
+    if (qos)
+        fprintf(fp," %8llu  (%llu frames over %.1f ms budget)",(unsigned long long)chain->n_deg_frm,
+                (unsigned long long)chain->n_late,chain->qos_budget/1e6);
+    fprintf(fp,"\n");
+}
@@ -0,0 +1,239 @@
+/**
+ * @file    img_chain.h
+ * @author  YRD
+ * @version 1.0
+ * @date    2026-10-18
+ * @brief   滤波链
+ * @details 把img_filter.h中的滤波器按配置串联为滤波链，逐帧执行，并统计每一级的运行时间。
+ *          配置字符串格式为：级名[:参数1/参数2/...],级名[:参数...],...
+ *          例如 "mid5_t,nnf_sqr3:0.05,plane_mf_sqr3,fir_sqr3:0.0625/0.125/0.0625/0.125/0.25/0.125/0.0625/0.125/0.0625"
+ *          级名为img_filter.h中的滤波函数名去掉前缀img_，省略参数时使用默认值，可用的级名见img_chain_list。
+ *          各级的历史图像、状态和输出图像都从内存池(img_pool)分配。
+ *          每一级和整条滤波链的运行时间同时记录到img_trace（级名和"chain"），打开跟踪后可以得到延迟分布和时间线。
+ *          输入帧是引用计数帧（img_frm.h）时，第一级的时间滤波器可以直接引用最近几个输入帧作为历史图像，
+ *          不再每帧拷贝一次，见img_chain_share_hist和img_chain_run_frm。
+ *          设置每帧的时间预算后（img_chain_qos），每帧运行前按各级实测时间预测总时间，超出剩余时间时
+ *          按"节省时间/质量损失"从大到小依次把可降级的级换成降级模式（跳过、较便宜的中值滤波等），
+ *          直到预测时间不超过剩余时间；过载时每帧都降级输出而不是丢帧，每次降级决定都写入日志。
+ *          各级完整运行两次（得到实测时间）之前不降级，连续降级IMG_QOS_PROBE帧后完整运行一次以更新实测时间。
+ *          部分滤波级有多个实现（单帧、批处理、多线程），结果相同，速度因CPU而异，
+ *          用img_stage_select选择（通常由img_tune.h在启动时测速选择），之后建立的滤波链使用所选实现
+*/
+
+#ifndef __IMG_CHAIN_H__
+#define __IMG_CHAIN_H__
+
+#include <stdio.h>
+#include <stdint.h>
+#include "img_pool.h"
+#include "img_par.h"
+#include "img_perf.h"
+#include "img_frm.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define IMG_CHAIN_MAX       16      ///< 滤波链最多级数
+#define IMG_STAGE_PAR_MAX   9       ///< 每级最多参数个数
+#define IMG_QOS_PROBE       256     ///< 连续降级这么多帧后完整运行一次，重新测量完整运行时间
+
+struct img_stage_s;
+
+/**
+ * @brief           降级模式
+ */
+struct img_stage_deg_s
+{
+    const char *name;                       ///< 降级模式名（日志中使用）
+    float       loss;                       ///< 质量损失，选择降级顺序时使用
+    float       cost;                       ///< 估计运行时间（us，512x424单线程）
+    /// 降级执行，hist和run_hist相同，NULL时使用img_buf；时间滤波器需照常更新历史图像和状态
+    float    *(*run)(struct img_stage_s *stg, float *img_out, float *img_in, float **hist);
+};
+
+/**
+ * @brief           滤波级的一种实现
+ */
+struct img_stage_var_s
+{
+    const char *stage;                      ///< 级名
+    const char *name;                       ///< 实现名
+    float    *(*run)(struct img_stage_s *stg, float *img_out, float *img_in);
+    float    *(*run_hist)(struct img_stage_s *stg, float *img_out, float **img_in);    ///< NULL时和描述中的相同
+};
+
+/**
+ * @brief           滤波级描述
+ */
+struct img_stage_desc_s
+{
+    const char *name;                       ///< 级名
+    int         n_par;                      ///< 参数个数
+    float       par_def[IMG_STAGE_PAR_MAX]; ///< 默认参数
+    int         n_hist;                     ///< 历史图像帧数（img_buf）
+    int         n_st;                       ///< 状态图像数（IIR滤波器）
+    /// 执行一帧滤波，返回输出图像（通常为img_out，原址滤波器返回其状态图像）
+    float    *(*run)(struct img_stage_s *stg, float *img_out, float *img_in);
+    /// 使用外部历史图像执行一帧滤波，img_in[0]最老，img_in[n_hist]为当前图像，NULL表示只能用img_buf
+    float    *(*run_hist)(struct img_stage_s *stg, float *img_out, float **img_in);
+    float       cost;                       ///< 估计运行时间（us，512x424单线程），实测前用于调度
+    const struct img_stage_deg_s *deg;      ///< 降级模式，NULL表示不能降级
+};
+
+/**
+ * @brief           滤波级
+ */
+struct img_stage_s
+{
+    const struct img_stage_desc_s *desc;
+    const struct img_stage_var_s  *var;     ///< 所用的实现，NULL为描述中的执行函数
+    float    *(*run)(struct img_stage_s *stg, float *img_out, float *img_in);          ///< 所用实现的执行函数
+    float    *(*run_hist)(struct img_stage_s *stg, float *img_out, float **img_in);
+    float       coff[IMG_STAGE_PAR_MAX];    ///< 参数（滤波系数、门限等）
+    float      *img_buf;                    ///< 历史图像
+    float      *img_st1,*img_st2;           ///< 状态图像
+    uint8_t    *img_mask;                   ///< 空洞指示
+    int         state;                      ///< 滤波状态变量
+    float      *img_out;                    ///< 输出图像
+    struct img_par_s *par;                  ///< 线程池，支持多线程的滤波器使用
+
+    uint64_t    n;                          ///< 运行帧数
+    uint64_t    t_sum,t_max,t_last;         ///< 运行时间统计（ns）
+    int         trace_id;                   ///< 跟踪编号（img_trace.h）
+    struct img_perf_cnt_s perf_cnt;         ///< 硬件性能计数累计值
+
+    float       t_est,t_deg_est;            ///< 完整、降级运行时间的估计值（ns，实测值的滑动平均）
+    int         deg;                        ///< 本帧降级运行
+    int         deg_run;                    ///< 连续降级帧数
+    uint64_t    n_deg;                      ///< 降级运行帧数
+};
+
+/**
+ * @brief           滤波链
+ */
+struct img_chain_s
+{
+    struct img_stage_s stg[IMG_CHAIN_MAX];
+    int         n;                          ///< 级数
+    struct img_pool_s *pool;
+    struct img_par_s  *par;
+    struct img_perf_s *perf;                ///< 硬件性能计数器，NULL时不统计，需在运行滤波链的线程中打开
+
+    uint64_t    n_frm;                      ///< 运行帧数
+    uint64_t    t_sum,t_max;                ///< 整条滤波链运行时间统计（ns）
+    int         trace_id;                   ///< 跟踪编号（img_trace.h）
+    struct img_hist_s hist;                 ///< 第一级共享的输入帧历史
+    int         hist_shared;                ///< 第一级使用hist代替img_buf
+
+    uint64_t    qos_budget;                 ///< 每帧时间预算（ns），0表示不降级
+    FILE       *qos_log;                    ///< 降级决定日志，NULL时不记录
+    int         qos_last;                   ///< 上一帧有降级
+    uint64_t    n_deg_frm;                  ///< 降级帧数
+    uint64_t    n_late;                     ///< 降级后仍超过截止时间的帧数
+};
+
+/**
+ * @fn              int img_chain_init(struct img_chain_s *chain, const char *spec, struct img_pool_s *pool, struct img_par_s *par)
+ * @brief           根据配置字符串建立滤波链
+ * @param [out]     struct img_chain_s *chain：滤波链
+ * @param [in]      const char *spec：配置字符串，格式见文件说明
+ * @param [in]      struct img_pool_s *pool：内存池
+ * @param [in]      struct img_par_s *par：线程池，可以为NULL
+ * @retval          int：0成功，-1配置错误或内存不足（错误信息输出到stderr）
+ */
+int img_chain_init(struct img_chain_s *chain, const char *spec, struct img_pool_s *pool, struct img_par_s *par);
+
+/**
+ * @fn              void img_chain_release(struct img_chain_s *chain)
+ * @brief           释放滤波链占用的图像（归还内存池）
+ */
+void img_chain_release(struct img_chain_s *chain);
+
+/**
+ * @fn              float *img_chain_run(struct img_chain_s *chain, float *img_out, float *img_in)
+ * @brief           对一帧图像依次执行滤波链的各级
+ * @param [inout]   struct img_chain_s *chain：滤波链
+ * @param [in]      float *img_in：指针，指向待滤波图像，内容不被修改
+ * @param [out]     float *img_out：指针，指向的空间存放滤波结果
+ * @retval          float *：和img_out相同
+ */
+float *img_chain_run(struct img_chain_s *chain, float *img_out, float *img_in);
+
+/**
+ * @fn              int img_chain_share_hist(struct img_chain_s *chain)
+ * @brief           第一级改为引用输入帧作为历史图像，释放其img_buf，之后只能用img_chain_run_frm运行
+ * @details         滤波链会持有最近n_hist个输入帧的引用，输入帧池需要相应增加n_hist帧
+ * @retval          int：第一级的历史帧数（>0），-1第一级不是时间滤波器（滤波链不变，img_chain_run_frm拷贝历史）
+ */
+int img_chain_share_hist(struct img_chain_s *chain);
+
+/**
+ * @fn              float *img_chain_run_frm(struct img_chain_s *chain, float *img_out, struct img_frm_s *frm)
+ * @brief           和img_chain_run相同，输入为引用计数帧，共享历史时滤波链增加frm的引用
+ */
+float *img_chain_run_frm(struct img_chain_s *chain, float *img_out, struct img_frm_s *frm);
+
+/**
+ * @fn              void img_chain_qos(struct img_chain_s *chain, uint64_t budget_ns, FILE *log)
+ * @brief           设置每帧时间预算，打开按截止时间降级
+ * @details         截止时间为帧的采集时间（img_chain_run_frm的frm->t_in）或开始运行时间（img_chain_run）加上预算，
+ *                  每个降级帧和恢复完整运行的帧在log中记一行：帧号、剩余时间、预测时间和降级的级
+ * @param [in]      uint64_t budget_ns：每帧时间预算（ns），例如60fps时16.6ms，0关闭
+ * @param [in]      FILE *log：降级决定日志，可以为NULL
+ */
+void img_chain_qos(struct img_chain_s *chain, uint64_t budget_ns, FILE *log);
+
+/**
+ * @fn              void img_chain_report(struct img_chain_s *chain, FILE *fp)
+ * @brief           输出各级的平均和最大运行时间，设置了perf时还输出IPC、每像素缓存缺失和分支预测失败、内存流量，
+ *                  打开降级时还输出各级的降级帧数
+ */
+void img_chain_report(struct img_chain_s *chain, FILE *fp);
+
+/**
+ * @fn              const struct img_stage_desc_s *img_stage_find(const char *name)
+ * @brief           按级名查找滤波级描述
+ * @retval          const struct img_stage_desc_s *：没有找到时返回NULL
+ */
+const struct img_stage_desc_s *img_stage_find(const char *name);
+
+/**
+ * @fn              const struct img_stage_desc_s *img_stage_get(int i)
+ * @brief           取第i个滤波级描述，用于列出全部滤波级
+ * @retval          const struct img_stage_desc_s *：i超出范围时返回NULL
+ */
+const struct img_stage_desc_s *img_stage_get(int i);
+
+/**
+ * @fn              const struct img_stage_var_s *img_stage_var(const char *stage, int i)
+ * @brief           取滤波级的第i个实现，第0个为默认实现（和描述中的执行函数相同）
+ * @retval          const struct img_stage_var_s *：i超出范围或该级只有一个实现时返回NULL
+ */
+const struct img_stage_var_s *img_stage_var(const char *stage, int i);
+
+/**
+ * @fn              int img_stage_select(const char *stage, const char *var)
+ * @brief           选择滤波级的实现，对之后建立的滤波链有效，应在启动时（建立滤波链之前）调用
+ * @param [in]      const char *var：实现名，NULL恢复默认实现
+ * @retval          int：0成功，-1级名或实现名不存在
+ */
+int img_stage_select(const char *stage, const char *var);
+
+/**
+ * @fn              const struct img_stage_var_s *img_stage_selected(const char *stage)
+ * @brief           滤波级当前选择的实现
+ * @retval          const struct img_stage_var_s *：该级只有一个实现时返回NULL
+ */
+const struct img_stage_var_s *img_stage_selected(const char *stage);
+
+/**
+ * @fn              void img_chain_list(FILE *fp)
+ * @brief           输出可用的级名、参数个数和默认参数
+ */
+void img_chain_list(FILE *fp);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -0,0 +1,24 @@
+/**
+ * @file    img_const.h
+ * @author  YRD
+ * @version 1.0
+ * @date    2026-10-18
+ * @brief   图像滤波运算常数
+ * @details 图像尺寸在编译时确定，可以通过编译选项-DIMG_WID=xxx -DIMG_HGT=xxx修改，
+ *          KINECT深度图为512x424，NEW_TOF深度图为320x240（参见global_cfg.py）
+*/
+
+#ifndef __IMG_CONST_H__
+#define __IMG_CONST_H__
+
+#ifndef IMG_WID
+#define IMG_WID 640
+#endif
+
+#ifndef IMG_HGT
+#define IMG_HGT 480
+#endif
+
+#define IMG_SZ  (IMG_WID*IMG_HGT)
+
+#endif
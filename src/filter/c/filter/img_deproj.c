@@ -0,0 +1,306 @@
+/**
+ * @file    img_deproj.c
+ * @author  YRD
+ * @version 1.0
+ * @date    2026-10-18
+ * @brief   深度图反投影为点云
+ * @details 射线表用double计算，去畸变迭代20次（和OpenCV相同）；
+ *          每帧的反投影按行块执行（内部函数deproj_xxx_rows），单线程时只有一个行块；
+ *          紧缩输出时每个行块先紧缩到自己的像素范围开头，全部完成后再依次移到一起
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include "img_const.h"
+#include "img_deproj.h"
+
+#define UNDIST_ITER     20          // 去畸变迭代次数
+
+
+void img_cam_scale(struct img_cam_s *cam, float s)
+{
+    cam->fx*=s;
+    cam->fy*=s;
+    cam->cx*=s;
+    cam->cy*=s;
+    cam->skew*=s;
+}
+
+
+int img_deproj_init(struct img_deproj_s *dp, const struct img_cam_s *cam, struct img_pool_s *pool)
+{
+    const struct img_cam_s *c=cam;
+    int dist=(c->k1!=0 || c->k2!=0 || c->p1!=0 || c->p2!=0 || c->k3!=0);
+    int u,v,k;
+
+    memset(dp,0,sizeof(*dp));
+    if (!(c->fx>0) || !(c->fy>0))
+    {
+        fprintf(stderr,"img_deproj: bad focal length %g/%g\n",c->fx,c->fy);
+        return -1;
+    }
+    dp->cam=*cam;
+    dp->pool=pool;
+    dp->rx=img_pool_alloc_img(pool,1);
+    dp->ry=img_pool_alloc_img(pool,1);
+    if (dp->rx==NULL || dp->ry==NULL)
+    {
+        fprintf(stderr,"img_deproj: frame pool too small\n");
+        img_deproj_release(dp);
+        return -1;
+    }
+
+    for (v=0;v<IMG_HGT;v++)
+        for (u=0;u<IMG_WID;u++)
+        {
+            // 逆K：y0=(v-cy)/fy，x0=(u-cx-skew*y0)/fx
+            double y0=(v-c->cy)/(double)c->fy;
+            double x0=(u-c->cx-c->skew*y0)/(double)c->fx;
+            double x=x0,y=y0;
+
+            // 去畸变：迭代求解 x0=x*(1+k1*r2+k2*r4+k3*r6)+dx(x,y)
+            for (k=0;dist && k<UNDIST_ITER;k++)
+            {
+                double r2=x*x+y*y;
+                double icdist=1.0/(1+((c->k3*r2+c->k2)*r2+c->k1)*r2);
+                double dx=2*c->p1*x*y+c->p2*(r2+2*x*x);
+                double dy=c->p1*(r2+2*y*y)+2*c->p2*x*y;
+                x=(x0-dx)*icdist;
+                y=(y0-dy)*icdist;
+            }
+            dp->rx[v*IMG_WID+u]=(float)x;
+            dp->ry[v*IMG_WID+u]=(float)y;
+        }
+    return 0;
+}
+
+
+void img_deproj_release(struct img_deproj_s *dp)
+{
+    if (dp->pool)
+    {
+        img_pool_release(dp->pool,dp->rx);
+        img_pool_release(dp->pool,dp->ry);
+    }
+    dp->rx=dp->ry=NULL;
+}
+
+
+// 反投影n个像素，x=d*rx，y=d*ry，z=d
+static void deproj_f32_rows(float *x, float *y, float *z, const float *dep, const float *rx, const float *ry, int n)
+{
+    int i;
+
+    for (i=0;i<n;i++)
+    {
+        x[i]=dep[i]*rx[i];
+        y[i]=dep[i]*ry[i];
+    }
+    if (z)
+        for (i=0;i<n;i++)
+            z[i]=dep[i];
+}
+
+
+static void deproj_u16_rows(float *x, float *y, float *z, const uint16_t *dep, float scale, const float *rx, const float *ry, int n)
+{
+    int i;
+
+    if (z)
+    {
+        for (i=0;i<n;i++)
+        {
+            float d=dep[i]*scale;
+            x[i]=d*rx[i];
+            y[i]=d*ry[i];
+            z[i]=d;
+        }
+    }
+    else
+    {
+        for (i=0;i<n;i++)
+        {
+            float d=dep[i]*scale;
+            x[i]=d*rx[i];
+            y[i]=d*ry[i];
+        }
+    }
+}
+
+
+// 多线程行块任务参数
+struct deproj_arg_s
+{
+    const struct img_deproj_s *dp;
+    float       *x,*y,*z;
+    const void  *dep;
+    float        scale;
+    int          u16;
+};
+
+
+static void deproj_task(void *arg, int i, int n)
+{
+    struct deproj_arg_s *a=(struct deproj_arg_s *)arg;
+    int y0,y1,o,m;
+
+    img_par_band(0,IMG_HGT,i,n,&y0,&y1);
+    o=y0*IMG_WID;
+    m=(y1-y0)*IMG_WID;
+    if (a->u16)
+        deproj_u16_rows(a->x+o,a->y+o,a->z ? a->z+o : NULL,(const uint16_t *)a->dep+o,a->scale,a->dp->rx+o,a->dp->ry+o,m);
+    else
+        deproj_f32_rows(a->x+o,a->y+o,a->z ? a->z+o : NULL,(const float *)a->dep+o,a->dp->rx+o,a->dp->ry+o,m);
+}
+
+
+void img_deproj_f32(const struct img_deproj_s *dp, float *x, float *y, float *z, const float *dep, struct img_par_s *par)
+{
+    struct deproj_arg_s a;
+    a.dp=dp; a.x=x; a.y=y; a.z=(z==dep) ? NULL : z; a.dep=dep; a.scale=1; a.u16=0;
+    img_par_run(par,deproj_task,&a,img_par_threads(par));
+}
+
+
+void img_deproj_u16(const struct img_deproj_s *dp, float *x, float *y, float *z, const uint16_t *dep, float scale, struct img_par_s *par)
+{
+    struct deproj_arg_s a;
+    a.dp=dp; a.x=x; a.y=y; a.z=z; a.dep=dep; a.scale=scale; a.u16=1;
+    img_par_run(par,deproj_task,&a,img_par_threads(par));
+}
+
+
+/*------------------------ 反投影、距离过滤、变换和紧缩 ------------------------*/
+
+#define CROP_BLK        256         // 紧缩块像素数，块内的坐标和保留标志放在栈上
+
+// 多线程行块任务参数，每个行块紧缩写入自己的像素范围，完成后再依次移到一起
+struct crop_arg_s
+{
+    const struct img_deproj_s *dp;
+    float       *x,*y,*z;
+    int32_t     *idx;
+    const void  *dep;
+    float        scale;
+    int          u16;
+    float        dmin,dmax;
+    float        T[12];             // 变换矩阵前3行
+    int          off[IMG_PAR_THR_MAX],cnt[IMG_PAR_THR_MAX];
+};
+
+
+// 像素[i0,i1)反投影、过滤、变换，紧缩写入x/y/z/idx[i0...]，返回保留点数
+static int crop_rows(const struct crop_arg_s *a, int i0, int i1)
+{
+    float bx[CROP_BLK],by[CROP_BLK],bz[CROP_BLK];
+    int keep[CROP_BLK];
+    const float *T=a->T;
+    float *x=a->x+i0,*y=a->y+i0,*z=a->z+i0;
+    int32_t *idx=a->idx ? a->idx+i0 : NULL;
+    int b,i,m,n=0;
+
+    for (b=i0;b<i1;b+=CROP_BLK)
+    {
+        const float *rx=a->dp->rx+b,*ry=a->dp->ry+b;
+        m=(i1-b<CROP_BLK) ? i1-b : CROP_BLK;
+
+        // 块内计算，无分支，可向量化
+        if (a->u16)
+        {
+            const uint16_t *d=(const uint16_t *)a->dep+b;
+            for (i=0;i<m;i++)
+            {
+                float zc=d[i]*a->scale,xc=zc*rx[i],yc=zc*ry[i];
+                bx[i]=T[0]*xc+T[1]*yc+T[ 2]*zc+T[ 3];
+                by[i]=T[4]*xc+T[5]*yc+T[ 6]*zc+T[ 7];
+                bz[i]=T[8]*xc+T[9]*yc+T[10]*zc+T[11];
+                keep[i]=(zc>=a->dmin) & (zc<=a->dmax) & (zc>0);
+            }
+        }
+        else
+        {
+            const float *d=(const float *)a->dep+b;
+            for (i=0;i<m;i++)
+            {
+                float zc=d[i],xc=zc*rx[i],yc=zc*ry[i];
+                bx[i]=T[0]*xc+T[1]*yc+T[ 2]*zc+T[ 3];
+                by[i]=T[4]*xc+T[5]*yc+T[ 6]*zc+T[ 7];
+                bz[i]=T[8]*xc+T[9]*yc+T[10]*zc+T[11];
+                keep[i]=(zc>=a->dmin) & (zc<=a->dmax) & (zc>0);
+            }
+        }
+
+        // 紧缩：每个点都写到位置n，保留时n加1，没有难以预测的分支；
+        // 写入位置不超过当前像素，不会越过本行块
+        if (idx)
+        {
+            for (i=0;i<m;i++)
+            {
+                x[n]=bx[i]; y[n]=by[i]; z[n]=bz[i]; idx[n]=b+i;
+                n+=keep[i];
+            }
+        }
+        else
+        {
+            for (i=0;i<m;i++)
+            {
+                x[n]=bx[i]; y[n]=by[i]; z[n]=bz[i];
+                n+=keep[i];
+            }
+        }
+    }
+    return n;
+}
+
+
+static void crop_task(void *arg, int i, int n)
+{
+    struct crop_arg_s *a=(struct crop_arg_s *)arg;
+    int y0,y1;
+
+    img_par_band(0,IMG_HGT,i,n,&y0,&y1);
+    a->off[i]=y0*IMG_WID;
+    a->cnt[i]=crop_rows(a,y0*IMG_WID,y1*IMG_WID);
+}
+
+
+static int crop_run(struct crop_arg_s *a, const float *T, struct img_par_s *par)
+{
+    static const float T_eye[12]={ 1,0,0,0, 0,1,0,0, 0,0,1,0 };
+    int n_thr=img_par_threads(par),i,n;
+
+    memcpy(a->T,T ? T : T_eye,sizeof(a->T));
+    img_par_run(par,crop_task,a,n_thr);
+
+    // 各行块的点移到一起，第0块已在最前面
+    for (i=1,n=a->cnt[0];i<n_thr;i++)
+    {
+        size_t sz=sizeof(float)*a->cnt[i];
+        memmove(a->x+n,a->x+a->off[i],sz);
+        memmove(a->y+n,a->y+a->off[i],sz);
+        memmove(a->z+n,a->z+a->off[i],sz);
+        if (a->idx)
+            memmove(a->idx+n,a->idx+a->off[i],sizeof(int32_t)*a->cnt[i]);
+        n+=a->cnt[i];
+    }
+    return n;
+}
+
+
+int img_deproj_crop_f32(const struct img_deproj_s *dp, float *x, float *y, float *z, int32_t *idx,
+                        const float *dep, float dmin, float dmax, const float *T, struct img_par_s *par)
+{
+    struct crop_arg_s a;
+    a.dp=dp; a.x=x; a.y=y; a.z=z; a.idx=idx; a.dep=dep; a.scale=1; a.u16=0; a.dmin=dmin; a.dmax=dmax;
+    return crop_run(&a,T,par);
+}
+
+
+int img_deproj_crop_u16(const struct img_deproj_s *dp, float *x, float *y, float *z, int32_t *idx,
+                        const uint16_t *dep, float scale, float dmin, float dmax, const float *T, struct img_par_s *par)
+{
+    struct crop_arg_s a;
+    a.dp=dp; a.x=x; a.y=y; a.z=z; a.idx=idx; a.dep=dep; a.scale=scale; a.u16=1; a.dmin=dmin; a.dmax=dmax;
+    return crop_run(&a,T,par);
+}
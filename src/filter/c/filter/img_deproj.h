@@ -0,0 +1,115 @@
+/**
+ * @file    img_deproj.h
+ * @author  YRD
+ * @version 1.0
+ * @date    2026-10-18
+ * @brief   深度图反投影为点云
+ * @details 每个像素(u,v)的反投影方向只和内参有关：x=z*rx(u,v)，y=z*ry(u,v)。
+ *          初始化时按内参（含skew和Brown-Conrady畸变k1/k2/p1/p2/k3）为每个像素计算一次射线表rx/ry，
+ *          畸变用迭代法去除（同OpenCV的undistortPoints）；之后每帧每个像素只需2次乘法，
+ *          输出为分开存放的x/y/z三幅图像（SoA），循环可以被编译器向量化，多线程时按行分块并行。
+ *          输入可以是滤波链输出的float深度(m)，也可以是传感器原始的uint16深度(mm，乘以scale)。
+ *          深度为0的像素输出(0,0,0)，和PointCloud.remove_zero_points的约定一致。
+ *          内参是IMG_WID*IMG_HGT图像上的像素值，其他分辨率标定的内参需先按宽度缩放（见img_cam_scale）。
+ *          img_deproj_crop_xxx把反投影、距离过滤（global_cfg.py的dmin/dmax，同时去掉0深度点）和4x4变换（global_cfg.py的T）
+ *          合成一遍：按块计算变换后的坐标和保留标志（可向量化），再无分支地紧缩写入点列表，
+ *          输出为紧凑的x/y/z列表和每个点的像素序号，不再生成整幅点云图像和中间数组
+*/
+
+#ifndef __IMG_DEPROJ_H__
+#define __IMG_DEPROJ_H__
+
+#include <stdint.h>
+#include "img_pool.h"
+#include "img_par.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief           相机内参和畸变系数
+ */
+struct img_cam_s
+{
+    float       fx,fy;                      ///< 焦距（像素）
+    float       cx,cy;                      ///< 光心（像素）
+    float       skew;                       ///< 倾斜
+    float       k1,k2,p1,p2,k3;             ///< 畸变系数，全0表示无畸变
+};
+
+/**
+ * @brief           反投影射线表
+ */
+struct img_deproj_s
+{
+    struct img_cam_s  cam;                  ///< 建表使用的内参
+    float            *rx,*ry;               ///< 每个像素的x/z、y/z，各IMG_SZ个float
+    struct img_pool_s *pool;
+};
+
+/**
+ * @fn              void img_cam_scale(struct img_cam_s *cam, float s)
+ * @brief           按图像缩放比例s调整内参（畸变系数不变），例如640x480标定的内参用于320x240图像时s=0.5
+ */
+void img_cam_scale(struct img_cam_s *cam, float s);
+
+/**
+ * @fn              int img_deproj_init(struct img_deproj_s *dp, const struct img_cam_s *cam, struct img_pool_s *pool)
+ * @brief           按内参建立射线表，表从内存池分配
+ * @param [out]     struct img_deproj_s *dp：射线表
+ * @param [in]      const struct img_cam_s *cam：内参
+ * @param [in]      struct img_pool_s *pool：内存池
+ * @retval          int：0成功，-1内参无效或内存不足（错误信息输出到stderr）
+ */
+int img_deproj_init(struct img_deproj_s *dp, const struct img_cam_s *cam, struct img_pool_s *pool);
+
+/**
+ * @fn              void img_deproj_release(struct img_deproj_s *dp)
+ * @brief           释放射线表（归还内存池）
+ */
+void img_deproj_release(struct img_deproj_s *dp);
+
+/**
+ * @fn              void img_deproj_f32(const struct img_deproj_s *dp, float *x, float *y, float *z, const float *dep, struct img_par_s *par)
+ * @brief           float深度图反投影
+ * @param [in]      const float *dep：深度图（m），IMG_SZ个float
+ * @param [out]     float *x,*y,*z：各IMG_SZ个float，存放点云坐标，z为NULL或和dep相同时不写z
+ * @param [in]      struct img_par_s *par：线程池，可以为NULL
+ */
+void img_deproj_f32(const struct img_deproj_s *dp, float *x, float *y, float *z, const float *dep, struct img_par_s *par);
+
+/**
+ * @fn              void img_deproj_u16(const struct img_deproj_s *dp, float *x, float *y, float *z, const uint16_t *dep, float scale, struct img_par_s *par)
+ * @brief           uint16深度图反投影，深度乘以scale转换为m（Kinect的mm深度scale=0.001）
+ * @param [out]     float *x,*y,*z：各IMG_SZ个float，z为NULL时不写z
+ */
+void img_deproj_u16(const struct img_deproj_s *dp, float *x, float *y, float *z, const uint16_t *dep, float scale, struct img_par_s *par);
+
+/**
+ * @fn              int img_deproj_crop_f32(const struct img_deproj_s *dp, float *x, float *y, float *z, int32_t *idx,
+ *                                          const float *dep, float dmin, float dmax, const float *T, struct img_par_s *par)
+ * @brief           float深度图反投影、距离过滤和变换，输出紧凑的点列表
+ * @param [in]      const float *dep：深度图（m），IMG_SZ个float
+ * @param [in]      float dmin,dmax：保留深度在[dmin,dmax]之间的像素（相机坐标系的z，变换前），深度为0的像素总是去掉
+ * @param [in]      const float *T：4x4变换矩阵（行优先，16个float），p'=T*[x y z 1]，NULL为单位矩阵
+ * @param [out]     float *x,*y,*z：各IMG_SZ个float，前n个为保留点变换后的坐标，按像素顺序
+ * @param [out]     int32_t *idx：IMG_SZ个int32，前n个为保留点的像素序号（v*IMG_WID+u），可以为NULL
+ * @param [in]      struct img_par_s *par：线程池，可以为NULL
+ * @retval          int：保留的点数n
+ */
+int img_deproj_crop_f32(const struct img_deproj_s *dp, float *x, float *y, float *z, int32_t *idx,
+                        const float *dep, float dmin, float dmax, const float *T, struct img_par_s *par);
+
+/**
+ * @fn              int img_deproj_crop_u16(const struct img_deproj_s *dp, float *x, float *y, float *z, int32_t *idx,
+ *                                          const uint16_t *dep, float scale, float dmin, float dmax, const float *T, struct img_par_s *par)
+ * @brief           uint16深度图反投影、距离过滤和变换，深度乘以scale转换为m，其他同img_deproj_crop_f32
+ */
+int img_deproj_crop_u16(const struct img_deproj_s *dp, float *x, float *y, float *z, int32_t *idx,
+                        const uint16_t *dep, float scale, float dmin, float dmax, const float *T, struct img_par_s *par);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
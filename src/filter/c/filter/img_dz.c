@@ -0,0 +1,426 @@
+/**
+ * @file    img_dz.c
+ * @author  YRD
+ * @version 1.0
+ * @date    2026-10-18
+ * @brief   深度图像无损压缩
+ * @details 压缩时各行带先写到输出缓冲区中按最大长度预留的位置，全部完成后再依次移到一起，
+ *          这样多线程压缩不需要额外的缓冲区。文件中的整数按本机字节序（小端）存放
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "img_const.h"
+#include "img_dz.h"
+
+#define DZ_BLK          16                              // 每组残差数
+#define DZ_BLK_MAX      (1+2*17)                        // 每组最大长度，残差最多17位
+#define DZ_FRM_HDR(n)   (12+4*(n))                      // 帧头长度
+
+static const char dz_magic[8]={ 'I','M','G','D','Z',0,0,1 };
+static const char dz_idx_magic[8]={ 'I','M','G','D','Z','I','D','X' };
+
+// 第b个行带的起止行
+#define BAND_Y0(b,n)    ((b)*IMG_HGT/(n))
+#define BAND_Y1(b,n)    (((b)+1)*IMG_HGT/(n))
+
+#define DZ_ROW          ((IMG_WID+DZ_BLK-1)/DZ_BLK*DZ_BLK)  // 每行残差数，补齐到整组
+
+// 行带最大压缩长度
+static size_t band_bound(int n_band)
+{
+    return (size_t)(IMG_HGT/n_band+1)*(DZ_ROW/DZ_BLK)*DZ_BLK_MAX;
+}
+
+
+size_t img_dz_bound(int n_band)
+{
+    if (n_band<1) n_band=1;
+    if (n_band>IMG_DZ_BAND_MAX) n_band=IMG_DZ_BAND_MAX;
+    return DZ_FRM_HDR(n_band)+n_band*band_bound(n_band)+3;
+}
+
+
+// LOCO-I中值预测，a左，b上，c左上，等于a、b、a+b-c的中值，写成min/max没有分支
+static inline int med_pred(int a, int b, int c)
+{
+    int mx=a>b ? a : b,mn=a>b ? b : a,g=a+b-c;
+    g=g>mn ? g : mn;
+    return g<mx ? g : mx;
+}
+
+#define ZZ_ENC(d)       (((uint32_t)(d)<<1)^(uint32_t)((d)>>31))
+#define ZZ_DEC(z)       ((int)(((z)>>1)^(0u-((z)&1))))
+
+// 写一组残差，数据按32位写出，组长度2*w字节
+static inline uint8_t *blk_put(uint8_t *q, const uint32_t *r)
+{
+    uint32_t m=0;
+    uint64_t acc=0;
+    int w=0,nb=0,i;
+
+    for (i=0;i<DZ_BLK;i++)
+        m|=r[i];
+#if defined(__GNUC__)
+    w=m ? 32-__builtin_clz(m) : 0;
+#else
+    while (m>>w)
+        w++;
+#endif
+    *q++=(uint8_t)w;
+
+    for (i=0;i<DZ_BLK;i++)
+    {
+        acc|=(uint64_t)r[i]<<nb;
+        nb+=w;
+        if (nb>=32)
+        {
+            memcpy(q,&acc,4);
+            q+=4;
+            acc>>=32;
+            nb-=32;
+        }
+    }
+    if (nb)                                                 // 16*w位，剩下的一定是16位
+    {
+        memcpy(q,&acc,2);
+        q+=2;
+    }
+    return q;
+}
+
+// 读一组残差，数据按16位读入，返回NULL表示数据越界
+static inline const uint8_t *blk_get(const uint8_t *q, const uint8_t *q_end, uint32_t *r)
+{
+    uint64_t acc=0;
+    uint32_t mask;
+    int w,nb=0,i;
+
+    if (q>=q_end)
+        return NULL;
+    w=*q++;
+    if (w>17 || q+2*w>q_end)
+        return NULL;
+    mask=(1u<<w)-1;
+
+    for (i=0;i<DZ_BLK;i++)
+    {
+        while (nb<w)
+        {
+            acc|=(uint64_t)(q[0]|q[1]<<8)<<nb;
+            q+=2;
+            nb+=16;
+        }
+        r[i]=(uint32_t)acc&mask;
+        acc>>=w;
+        nb-=w;
+    }
+    return q;
+}
+
+
+// 压缩第y0~y1-1行，返回长度
+static size_t band_enc(uint8_t *out, const uint16_t *in, int y0, int y1)
+{
+    uint32_t r[DZ_ROW];
+    uint8_t *q=out;
+    int x,y;
+
+    memset(r,0,sizeof(r));
+    for (y=y0;y<y1;y++)
+    {
+        const uint16_t *p=in+y*IMG_WID,*u=p-IMG_WID;
+        if (y==y0)
+        {
+            r[0]=ZZ_ENC((int)p[0]);
+            for (x=1;x<IMG_WID;x++)
+                r[x]=ZZ_ENC(p[x]-p[x-1]);
+        }
+        else
+        {
+            r[0]=ZZ_ENC(p[0]-u[0]);
+            for (x=1;x<IMG_WID;x++)
+                r[x]=ZZ_ENC(p[x]-med_pred(p[x-1],u[x],u[x-1]));
+        }
+        for (x=0;x<DZ_ROW;x+=DZ_BLK)
+            q=blk_put(q,r+x);
+    }
+    return q-out;
+}
+
+// 解压第y0~y1-1行，返回0成功
+static int band_dec(uint16_t *out, const uint8_t *in, const uint8_t *in_end, int y0, int y1)
+{
+    uint32_t r[DZ_ROW];
+    int x,y;
+
+    for (y=y0;y<y1;y++)
+    {
+        uint16_t *p=out+y*IMG_WID,*u=p-IMG_WID;
+        for (x=0;x<DZ_ROW;x+=DZ_BLK)
+            if ((in=blk_get(in,in_end,r+x))==NULL)
+                return -1;
+        if (y==y0)
+        {
+            p[0]=(uint16_t)ZZ_DEC(r[0]);
+            for (x=1;x<IMG_WID;x++)
+                p[x]=(uint16_t)(p[x-1]+ZZ_DEC(r[x]));
+        }
+        else
+        {
+            p[0]=(uint16_t)(u[0]+ZZ_DEC(r[0]));
+            for (x=1;x<IMG_WID;x++)
+                p[x]=(uint16_t)(med_pred(p[x-1],u[x],u[x-1])+ZZ_DEC(r[x]));
+        }
+    }
+    return 0;
+}
+
+
+struct dz_arg_s
+{
+    uint8_t        *frm;
+    const uint8_t  *frm_end;
+    uint16_t       *img;
+    int             n_band;
+    size_t          band_sz[IMG_DZ_BAND_MAX];
+    int             err;
+};
+
+static void dz_enc_task(void *arg, int i, int n)
+{
+    struct dz_arg_s *a=(struct dz_arg_s *)arg;
+    uint8_t *q=a->frm+DZ_FRM_HDR(n)+i*band_bound(n);
+    a->band_sz[i]=band_enc(q,a->img,BAND_Y0(i,n),BAND_Y1(i,n));
+}
+
+static void dz_dec_task(void *arg, int i, int n)
+{
+    struct dz_arg_s *a=(struct dz_arg_s *)arg;
+    const uint32_t *off=(const uint32_t *)(a->frm+12);
+    const uint8_t *end=i+1<n ? a->frm+off[i+1] : a->frm_end;
+    if (band_dec(a->img,a->frm+off[i],end,BAND_Y0(i,n),BAND_Y1(i,n)))
+        a->err=1;
+}
+
+
+size_t img_dz_enc(uint8_t *out, const uint16_t *in, int n_band, struct img_par_s *par)
+{
+    struct dz_arg_s a;
+    uint32_t *off=(uint32_t *)(out+12);
+    uint32_t pos;
+    uint16_t *h=(uint16_t *)(out+4);
+    int i;
+
+    if (n_band<1 || n_band>IMG_DZ_BAND_MAX || n_band>IMG_HGT)
+        return 0;
+
+    a.frm   =out;
+    a.img   =(uint16_t *)in;
+    a.n_band=n_band;
+    img_par_run(par,dz_enc_task,&a,n_band);
+
+    // 把各行带移到一起
+    pos=DZ_FRM_HDR(n_band);
+    for (i=0;i<n_band;i++)
+    {
+        uint8_t *src=out+DZ_FRM_HDR(n_band)+i*band_bound(n_band);
+        if (out+pos!=src)
+            memmove(out+pos,src,a.band_sz[i]);
+        off[i]=pos;
+        pos+=(uint32_t)a.band_sz[i];
+    }
+    while (pos&3)                                           // 帧长度补齐到4字节，文件中的帧头都是对齐的
+        out[pos++]=0;
+
+    *(uint32_t *)out=pos;
+    h[0]=IMG_WID;
+    h[1]=IMG_HGT;
+    h[2]=(uint16_t)n_band;
+    h[3]=0;
+    return pos;
+}
+
+
+int img_dz_dec(uint16_t *out, const uint8_t *in, size_t sz, struct img_par_s *par)
+{
+    struct dz_arg_s a;
+    const uint16_t *h=(const uint16_t *)(in+4);
+    const uint32_t *off=(const uint32_t *)(in+12);
+    size_t hdr;
+    int n_band,i;
+
+    if (sz<12 || *(const uint32_t *)in!=sz || h[0]!=IMG_WID || h[1]!=IMG_HGT)
+        return -1;
+    n_band=h[2];
+    if (n_band<1 || n_band>IMG_DZ_BAND_MAX)
+        return -1;
+    hdr=(size_t)DZ_FRM_HDR(n_band);
+    if (sz<hdr)
+        return -1;
+    for (i=0;i<n_band;i++)
+        if (off[i]<hdr || off[i]>sz || (i && off[i]<off[i-1]))
+            return -1;
+
+    a.frm    =(uint8_t *)in;
+    a.frm_end=in+sz;
+    a.img    =out;
+    a.n_band =n_band;
+    a.err    =0;
+    img_par_run(par,dz_dec_task,&a,n_band);
+    return a.err ? -1 : 0;
+}
+
+
+void img_dz_hdr(uint8_t *out, int n_band)
+{
+    uint32_t *h=(uint32_t *)(out+8);
+
+    memcpy(out,dz_magic,8);
+    h[0]=IMG_WID;
+    h[1]=IMG_HGT;
+    h[2]=n_band;
+    h[3]=0;
+}
+
+
+void img_dz_tail(uint8_t *out, uint64_t n_frm)
+{
+    memcpy(out,&n_frm,8);
+    memcpy(out+8,dz_idx_magic,8);
+}
+
+
+int img_dz_create(struct img_dz_writer_s *w, const char *fname, int n_band, struct img_par_s *par)
+{
+    uint8_t hdr[IMG_DZ_HDR_SZ];
+
+    memset(w,0,sizeof(*w));
+    if (n_band<1 || n_band>IMG_DZ_BAND_MAX || n_band>IMG_HGT)
+    {
+        fprintf(stderr,"img_dz: %d bands out of range\n",n_band);
+        return -1;
+    }
+    w->n_band=n_band;
+    w->par   =par;
+    w->buf   =(uint8_t *)malloc(img_dz_bound(n_band));
+    w->fp    =fopen(fname,"wb");
+    img_dz_hdr(hdr,n_band);
+    if (w->buf==NULL || w->fp==NULL || fwrite(hdr,1,IMG_DZ_HDR_SZ,w->fp)!=IMG_DZ_HDR_SZ)
+    {
+        perror(fname);
+        if (w->fp) fclose(w->fp);
+        free(w->buf);
+        memset(w,0,sizeof(*w));
+        return -1;
+    }
+    w->off=IMG_DZ_HDR_SZ;
+    return 0;
+}
+
+
+int img_dz_write_enc(struct img_dz_writer_s *w, const uint8_t *buf, size_t sz)
+{
+    if (w->n_frm==w->cap)
+    {
+        long cap=w->cap ? w->cap*2 : 1024;
+        uint64_t *idx=(uint64_t *)realloc(w->idx,sizeof(uint64_t)*cap);
+        if (idx==NULL)
+            return -1;
+        w->idx=idx;
+        w->cap=cap;
+    }
+    if (fwrite(buf,1,sz,w->fp)!=sz)
+        return -1;
+    w->idx[w->n_frm++]=w->off;
+    w->off+=sz;
+    return 0;
+}
+
+
+int img_dz_write(struct img_dz_writer_s *w, const uint16_t *dep)
+{
+    size_t sz=img_dz_enc(w->buf,dep,w->n_band,w->par);
+    return sz ? img_dz_write_enc(w,w->buf,sz) : -1;
+}
+
+
+int img_dz_close(struct img_dz_writer_s *w)
+{
+    uint64_t n=w->n_frm;
+    uint8_t tail[IMG_DZ_TAIL_SZ];
+    int ret=0;
+
+    if (w->fp==NULL)
+        return -1;
+    img_dz_tail(tail,n);
+    if ((n && fwrite(w->idx,sizeof(uint64_t),n,w->fp)!=n) || fwrite(tail,1,IMG_DZ_TAIL_SZ,w->fp)!=IMG_DZ_TAIL_SZ)
+        ret=-1;
+    if (fclose(w->fp))
+        ret=-1;
+    free(w->idx);
+    free(w->buf);
+    memset(w,0,sizeof(*w));
+    return ret;
+}
+
+
+int img_dz_is_dz(const uint8_t *data, size_t size)
+{
+    return size>=IMG_DZ_HDR_SZ && memcmp(data,dz_magic,8)==0;
+}
+
+
+long img_dz_index(const uint8_t *data, size_t size, uint64_t **idx)
+{
+    const uint32_t *hdr=(const uint32_t *)(data+8);
+    uint64_t n,off,*p;
+    long cap=0,i;
+
+    *idx=NULL;
+    if (!img_dz_is_dz(data,size) || hdr[0]!=IMG_WID || hdr[1]!=IMG_HGT)
+        return -1;
+
+    // 文件末尾的索引
+    if (size>=IMG_DZ_HDR_SZ+16 && memcmp(data+size-8,dz_idx_magic,8)==0)
+    {
+        n=*(const uint64_t *)(data+size-16);
+        if (n<=(size-IMG_DZ_HDR_SZ-16)/8)
+        {
+            const uint64_t *s=(const uint64_t *)(data+size-16-8*n);
+            for (i=0;i<(long)n;i++)
+                if (s[i]<IMG_DZ_HDR_SZ || s[i]+12>size-16-8*n)
+                    break;
+            if (i==(long)n && (*idx=(uint64_t *)malloc(sizeof(uint64_t)*(n ? n : 1)))!=NULL)
+            {
+                memcpy(*idx,s,sizeof(uint64_t)*n);
+                return (long)n;
+            }
+        }
+    }
+
+    // 没有索引，逐帧扫描
+    n=0;
+    for (off=IMG_DZ_HDR_SZ;off+12<=size;)
+    {
+        uint32_t fsz=*(const uint32_t *)(data+off);
+        if (fsz<12 || off+fsz>size)
+            break;
+        if ((long)n==cap)
+        {
+            cap=cap ? cap*2 : 1024;
+            p=(uint64_t *)realloc(*idx,sizeof(uint64_t)*cap);
+            if (p==NULL)
+            {
+                free(*idx);
+                *idx=NULL;
+                return -1;
+            }
+            *idx=p;
+        }
+        (*idx)[n++]=off;
+        off+=fsz;
+    }
+    return (long)n;
+}
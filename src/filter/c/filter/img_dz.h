@@ -0,0 +1,136 @@
+/**
+ * @file    img_dz.h
+ * @author  YRD
+ * @version 1.0
+ * @date    2026-10-18
+ * @brief   深度图像无损压缩
+ * @details 针对uint16深度图（单位mm）的无损压缩，每帧分为若干行带(band)，各行带独立编码，可以多线程编解码：
+ *          1. 预测：LOCO-I中值预测(MED)，用左、上、左上3个像素预测当前像素，行带第一行用左边像素，第一列用上边像素；
+ *          2. 残差zigzag映射为无符号数；
+ *          3. 每行每16个残差一组（行末不足16个时补0），按组内最大值的位数w紧凑存放（1字节w，加2*w字节数据）。
+ *          压缩文件格式（.dz）：
+ *              文件头：8字节标志"IMGDZ\0\0\1"，uint32宽、高、行带数、保留
+ *              各帧：  uint32帧长度（字节，包括帧头，补齐到4字节），uint16宽、高、行带数、保留，uint32各行带偏移，行带数据
+ *              索引：  uint64各帧在文件中的偏移，uint64帧数，8字节标志"IMGDZIDX"
+ *          索引在关闭时写入文件末尾，用于快速定位任意帧；没有索引（录制中断）时读取方逐帧扫描帧长度重建索引
+*/
+
+#ifndef __IMG_DZ_H__
+#define __IMG_DZ_H__
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "img_par.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define IMG_DZ_BAND_MAX     64          ///< 每帧最多行带数
+#define IMG_DZ_BAND_DEF     8           ///< 默认行带数
+#define IMG_DZ_HDR_SZ       24          ///< 文件头长度
+#define IMG_DZ_TAIL_SZ      16          ///< 索引后面的帧数和标志长度
+
+/**
+ * @fn              size_t img_dz_bound(int n_band)
+ * @brief           一帧压缩数据的最大长度（字节）
+ */
+size_t img_dz_bound(int n_band);
+
+/**
+ * @fn              size_t img_dz_enc(uint8_t *out, const uint16_t *in, int n_band, struct img_par_s *par)
+ * @brief           压缩一帧IMG_WID*IMG_HGT深度图
+ * @param [out]     uint8_t *out：压缩数据，长度至少为img_dz_bound(n_band)
+ * @param [in]      const uint16_t *in：深度图
+ * @param [in]      int n_band：行带数，1~IMG_DZ_BAND_MAX
+ * @param [in]      struct img_par_s *par：线程池，NULL时单线程
+ * @retval          size_t：压缩数据长度，0表示参数错误
+ */
+size_t img_dz_enc(uint8_t *out, const uint16_t *in, int n_band, struct img_par_s *par);
+
+/**
+ * @fn              int img_dz_dec(uint16_t *out, const uint8_t *in, size_t sz, struct img_par_s *par)
+ * @brief           解压一帧
+ * @param [out]     uint16_t *out：深度图，IMG_SZ个像素
+ * @param [in]      const uint8_t *in：压缩数据
+ * @param [in]      size_t sz：压缩数据长度
+ * @param [in]      struct img_par_s *par：线程池，NULL时单线程
+ * @retval          int：0成功，-1数据错误或尺寸和IMG_WID/IMG_HGT不符
+ */
+int img_dz_dec(uint16_t *out, const uint8_t *in, size_t sz, struct img_par_s *par);
+
+/**
+ * @fn              void img_dz_hdr(uint8_t *out, int n_band)
+ * @brief           生成文件头，IMG_DZ_HDR_SZ字节（不用img_dz_writer_s自己写文件时使用）
+ */
+void img_dz_hdr(uint8_t *out, int n_band);
+
+/**
+ * @fn              void img_dz_tail(uint8_t *out, uint64_t n_frm)
+ * @brief           生成索引末尾的帧数和标志，IMG_DZ_TAIL_SZ字节，写在n_frm个uint64帧偏移之后
+ */
+void img_dz_tail(uint8_t *out, uint64_t n_frm);
+
+/**
+ * @brief           压缩文件写入
+ */
+struct img_dz_writer_s
+{
+    FILE       *fp;
+    uint64_t   *idx;                ///< 各帧偏移
+    long        n_frm,cap;
+    uint64_t    off;                ///< 当前文件长度
+    uint8_t    *buf;                ///< 压缩缓冲区
+    int         n_band;
+    struct img_par_s *par;
+};
+
+/**
+ * @fn              int img_dz_create(struct img_dz_writer_s *w, const char *fname, int n_band, struct img_par_s *par)
+ * @brief           创建压缩文件
+ * @retval          int：0成功，-1失败
+ */
+int img_dz_create(struct img_dz_writer_s *w, const char *fname, int n_band, struct img_par_s *par);
+
+/**
+ * @fn              int img_dz_write(struct img_dz_writer_s *w, const uint16_t *dep)
+ * @brief           压缩并写入一帧
+ * @retval          int：0成功，-1写文件失败
+ */
+int img_dz_write(struct img_dz_writer_s *w, const uint16_t *dep);
+
+/**
+ * @fn              int img_dz_write_enc(struct img_dz_writer_s *w, const uint8_t *buf, size_t sz)
+ * @brief           写入已压缩的一帧（由其他线程调用img_dz_enc压缩）
+ * @retval          int：0成功，-1写文件失败
+ */
+int img_dz_write_enc(struct img_dz_writer_s *w, const uint8_t *buf, size_t sz);
+
+/**
+ * @fn              int img_dz_close(struct img_dz_writer_s *w)
+ * @brief           写入帧索引并关闭文件
+ * @retval          int：0成功，-1写文件失败
+ */
+int img_dz_close(struct img_dz_writer_s *w);
+
+/**
+ * @fn              int img_dz_is_dz(const uint8_t *data, size_t size)
+ * @brief           判断数据是否为压缩文件（检查文件头标志）
+ */
+int img_dz_is_dz(const uint8_t *data, size_t size);
+
+/**
+ * @fn              long img_dz_index(const uint8_t *data, size_t size, uint64_t **idx)
+ * @brief           取得映射到内存的压缩文件的帧索引，没有索引时扫描各帧重建
+ * @param [in]      const uint8_t *data：文件内容
+ * @param [in]      size_t size：文件长度
+ * @param [out]     uint64_t **idx：帧偏移数组（malloc分配，由调用者释放）
+ * @retval          long：帧数，-1文件错误
+ */
+long img_dz_index(const uint8_t *data, size_t size, uint64_t **idx);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
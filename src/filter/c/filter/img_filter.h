@@ -13,6 +13,8 @@
 
 #include <stdint.h>
 
+struct ring_buf_f32_s;     // 环形缓冲器，定义见img_algo.h
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -330,7 +332,7 @@ float *img_mid7_st_raw(float *img_out, float *img_in0, float *img_in1, float *im
 float *img_mid7_st(float *img_out, float *img_buf, float *img_in, int *state);
 
 float img_plane_mf_pix(float z0, float z1, float z2, float z3, float z4, float z5, float z6, float z7, float z8);
-//float *img_plane_mf_sqr3_sa(float *img_inout, struct ring_buf_f32_s *rbuf);
+float *img_plane_mf_sqr3_sa(float *img_inout, struct ring_buf_f32_s *rbuf);
 float *img_plane_mf_sqr3(float *img_out, float *img_in);
 
 /** 
@@ -0,0 +1,438 @@
+/**
+ * @file    img_filter_bat.c
+ * @author  YRD
+ * @version 1.0
+ * @date    2026-10-18
+ * @brief   多相机批处理图像滤波函数
+ * @details 交织格式说明见img_filter_bat.h。
+ *          空间滤波器按输出图像行[y0,y1)计算（内部函数xxx_rows），多线程版本(_mt)把图像按行分块并行计算
+*/
+
+#include <string.h>
+#include "img_const.h"
+#include "img_algo.h"
+#include "img_filter.h"
+#include "img_filter_bat.h"
+
+
+float *img_interleave(float *img_out, float **img_in, int k)
+{
+    int i,j;
+    float *q=img_out;
+
+    if (k==1)
+        return img_copy(img_out,img_in[0],IMG_SZ);
+
+    for (i=0;i<IMG_SZ;i++)
+        for (j=0;j<k;j++)
+            *q++=img_in[j][i];
+    return img_out;
+}
+
+
+float **img_deinterleave(float **img_out, float *img_in, int k)
+{
+    int i,j;
+    float *p=img_in;
+
+    if (k==1)
+    {
+        img_copy(img_out[0],img_in,IMG_SZ);
+        return img_out;
+    }
+
+    for (i=0;i<IMG_SZ;i++)
+        for (j=0;j<k;j++)
+            img_out[j][i]=*p++;
+    return img_out;
+}
+
+
+// 3x3空间滤波的有效输出范围（以像素为单位），和单帧滤波器相同：从第1行第1列到第H-2行第W-2列
+static void sqr3_range(int y0, int y1, int *i0, int *i1)
+{
+    *i0=y0*IMG_WID;
+    *i1=y1*IMG_WID;
+    if (*i0<IMG_WID+1)             *i0=IMG_WID+1;
+    if (*i1>IMG_WID*(IMG_HGT-1)-1) *i1=IMG_WID*(IMG_HGT-1)-1;
+}
+
+
+// 3x3滤波，只计算输出图像的第y0~y1-1行
+static void fir_sqr3_rows(float *img_out, float *img_in, float *coff, int k, int y0, int y1)
+{
+    int i0,i1;
+    int w=IMG_WID*k;        // 交织格式下一行的数据个数
+
+    sqr3_range(y0,y1,&i0,&i1);
+    if (i0>=i1) return;
+
+    {
+        float *p0=img_in+(i0-IMG_WID-1)*k, *p1=p0+k, *p2=p0+2*k;
+        float *p3=p0+w                   , *p4=p3+k, *p5=p3+2*k;
+        float *p6=p0+2*w                 , *p7=p6+k, *p8=p6+2*k;
+        float *q=img_out+i0*k, *q_end=img_out+i1*k;
+
+        float c0=*(coff  ), c1=*(coff+1), c2=*(coff+2);
+        float c3=*(coff+3), c4=*(coff+4), c5=*(coff+5);
+        float c6=*(coff+6), c7=*(coff+7), c8=*(coff+8);
+
+        float s;
+        for (;q<q_end;q++,p0++,p1++,p2++,p3++,p4++,p5++,p6++,p7++,p8++)
+        {
+            s =(*p0) * c0;
+            s+=(*p1) * c1;
+            s+=(*p2) * c2;
+            s+=(*p3) * c3;
+            s+=(*p4) * c4;
+            s+=(*p5) * c5;
+            s+=(*p6) * c6;
+            s+=(*p7) * c7;
+            s+=(*p8) * c8;
+
+            *q=s;
+        }
+    }
+}
+
+
+float *img_fir_sqr3_bat(float *img_out, float *img_in, float *coff, int k)
+{
+    fir_sqr3_rows(img_out,img_in,coff,k,1,IMG_HGT-1);
+    return img_out;
+}
+
+
+// 平面匹配滤波，只计算输出图像的第y0~y1-1行
+static void plane_mf_sqr3_rows(float *img_out, float *img_in, int k, int y0, int y1)
+{
+    int i0,i1;
+    int w=IMG_WID*k;
+
+    sqr3_range(y0,y1,&i0,&i1);
+    if (i0>=i1) return;
+
+    {
+        float *p0=img_in+(i0-IMG_WID-1)*k, *p1=p0+k, *p2=p0+2*k;
+        float *p3=p0+w                   , *p4=p3+k, *p5=p3+2*k;
+        float *p6=p0+2*w                 , *p7=p6+k, *p8=p6+2*k;
+        float *q=img_out+i0*k, *q_end=img_out+i1*k;
+
+        for (;q<q_end;q++,p0++,p1++,p2++,p3++,p4++,p5++,p6++,p7++,p8++)
+            *q=plane_mf_pix(*p0,*p1,*p2,*p3,*p4,*p5,*p6,*p7,*p8);
+    }
+}
+
+
+float *img_plane_mf_sqr3_bat(float *img_out, float *img_in, int k)
+{
+    plane_mf_sqr3_rows(img_out,img_in,k,1,IMG_HGT-1);
+    return img_out;
+}
+
+
+// 平面匹配滤波，同时输出斜率和残差，只计算输出图像的第y0~y1-1行
+static void plane_mf_sqr3_ext_rows(float *img_out, float *img_gx, float *img_gy, float *img_res, float *img_in, int k, int y0, int y1)
+{
+    int i0,i1;
+    int w=IMG_WID*k;
+
+    sqr3_range(y0,y1,&i0,&i1);
+    if (i0>=i1) return;
+
+    {
+        float *p0=img_in+(i0-IMG_WID-1)*k, *p1=p0+k, *p2=p0+2*k;
+        float *p3=p0+w                   , *p4=p3+k, *p5=p3+2*k;
+        float *p6=p0+2*w                 , *p7=p6+k, *p8=p6+2*k;
+        float *q=img_out+i0*k, *q_end=img_out+i1*k;
+        float *gx=img_gx+i0*k, *gy=img_gy+i0*k, *r=img_res+i0*k;
+
+        for (;q<q_end;q++,gx++,gy++,r++,p0++,p1++,p2++,p3++,p4++,p5++,p6++,p7++,p8++)
+            *q=plane_mf_pix_ext(*p0,*p1,*p2,*p3,*p4,*p5,*p6,*p7,*p8,gx,gy,r);
+    }
+}
+
+
+// 多线程行块任务参数
+struct sqr3_mt_arg_s
+{
+    float *img_out;
+    float *img_in;
+    float *coff;
+    float *img_gx,*img_gy,*img_res;
+    int    k;
+};
+
+
+static void fir_sqr3_task(void *arg, int i, int n)
+{
+    struct sqr3_mt_arg_s *a=(struct sqr3_mt_arg_s *)arg;
+    int y0,y1;
+    img_par_band(1,IMG_HGT-1,i,n,&y0,&y1);
+    fir_sqr3_rows(a->img_out,a->img_in,a->coff,a->k,y0,y1);
+}
+
+
+static void plane_mf_sqr3_task(void *arg, int i, int n)
+{
+    struct sqr3_mt_arg_s *a=(struct sqr3_mt_arg_s *)arg;
+    int y0,y1;
+    img_par_band(1,IMG_HGT-1,i,n,&y0,&y1);
+    plane_mf_sqr3_rows(a->img_out,a->img_in,a->k,y0,y1);
+}
+
+
+static void plane_mf_sqr3_ext_task(void *arg, int i, int n)
+{
+    struct sqr3_mt_arg_s *a=(struct sqr3_mt_arg_s *)arg;
+    int y0,y1;
+    img_par_band(1,IMG_HGT-1,i,n,&y0,&y1);
+    plane_mf_sqr3_ext_rows(a->img_out,a->img_gx,a->img_gy,a->img_res,a->img_in,a->k,y0,y1);
+}
+
+
+float *img_fir_sqr3_bat_mt(float *img_out, float *img_in, float *coff, int k, struct img_par_s *par)
+{
+    struct sqr3_mt_arg_s a;
+    a.img_out=img_out; a.img_in=img_in; a.coff=coff; a.k=k;
+    img_par_run(par,fir_sqr3_task,&a,img_par_threads(par));
+    return img_out;
+}
+
+
+float *img_plane_mf_sqr3_bat_mt(float *img_out, float *img_in, int k, struct img_par_s *par)
+{
+    struct sqr3_mt_arg_s a;
+    a.img_out=img_out; a.img_in=img_in; a.coff=NULL; a.k=k;
+    img_par_run(par,plane_mf_sqr3_task,&a,img_par_threads(par));
+    return img_out;
+}
+
+
+float *img_plane_mf_sqr3_ext_bat_mt(float *img_out, float *img_gx, float *img_gy, float *img_res, float *img_in, int k, struct img_par_s *par)
+{
+    struct sqr3_mt_arg_s a;
+    a.img_out=img_out; a.img_in=img_in; a.coff=NULL; a.k=k;
+    a.img_gx=img_gx; a.img_gy=img_gy; a.img_res=img_res;
+    img_par_run(par,plane_mf_sqr3_ext_task,&a,img_par_threads(par));
+    return img_out;
+}
+
+
+float *img_iir_t_bat(float *img_inout, float *img_in, float alpha, int k)
+{
+    float *p=img_in, *p_end=img_in+IMG_SZ*k;
+    float *q=img_inout;
+    float a=(float)alpha, b=(float)(1.0-alpha);
+
+    for (;p<p_end;p++,q++)
+        (*q)=(*q)*a+b*(*p);
+    return img_inout;
+}
+
+
+float *img_fir3_t_bat_raw(float *img_out, float *img_in0, float *img_in1, float *img_in2, float *coff, int k)
+{
+    float *p0=img_in0, *p1=img_in1, *p2=img_in2;
+    float *q=img_out,*q_end=img_out+IMG_SZ*k;
+    float c0=*(coff),c1=*(coff+1),c2=*(coff+2);
+
+    for (;q<q_end;p0++,p1++,p2++,q++)
+        *q=(*p0)*c0+(*p1)*c1+(*p2)*c2;
+    return img_out;
+}
+
+
+float *img_mid3_t_bat_raw(float *img_out, float *img_in0, float *img_in1, float *img_in2, int k)
+{
+    float *p0=img_in0, *p1=img_in1, *p2=img_in2;
+    float *q=img_out,*q_end=img_out+IMG_SZ*k;
+
+    for (;q<q_end;p0++,p1++,p2++,q++)
+        *q=MID3(*p0,*p1,*p2);
+    return img_out;
+}
+
+
+float *img_max3_t_bat_raw(float *img_out, float *img_in0, float *img_in1, float *img_in2, int k)
+{
+    float *p0=img_in0, *p1=img_in1, *p2=img_in2;
+    float *q=img_out,*q_end=img_out+IMG_SZ*k;
+
+    for (;q<q_end;p0++,p1++,p2++,q++)
+        *q=MAX3(*p0,*p1,*p2);
+    return img_out;
+}
+
+
+float *img_mid5_t_bat_raw(float *img_out, float *img_in0, float *img_in1, float *img_in2, float *img_in3, float *img_in4, int k)
+{
+    float *p0=img_in0, *p1=img_in1, *p2=img_in2, *p3=img_in3, *p4=img_in4;
+    float *q=img_out,*q_end=img_out+IMG_SZ*k;
+
+    for (;q<q_end;p0++,p1++,p2++,p3++,p4++,q++)
+        *q=mid5(*p0,*p1,*p2,*p3,*p4);
+    return img_out;
+}
+
+
+float *img_minmax_avg5_t_bat_raw(float *img_out, float *img_in0, float *img_in1, float *img_in2, float *img_in3, float *img_in4, int k)
+{
+    float *p0=img_in0, *p1=img_in1, *p2=img_in2, *p3=img_in3, *p4=img_in4;
+    float *q=img_out,*q_end=img_out+IMG_SZ*k;
+
+    for (;q<q_end;p0++,p1++,p2++,p3++,p4++,q++)
+        *q=minmax_avg5(*p0,*p1,*p2,*p3,*p4);
+    return img_out;
+}
+
+
+float *img_max5_t_bat_raw(float *img_out, float *img_in0, float *img_in1, float *img_in2, float *img_in3, float *img_in4, int k)
+{
+    float *p0=img_in0, *p1=img_in1, *p2=img_in2, *p3=img_in3, *p4=img_in4;
+    float *q=img_out,*q_end=img_out+IMG_SZ*k;
+
+    for (;q<q_end;p0++,p1++,p2++,p3++,p4++,q++)
+        *q=max5(*p0,*p1,*p2,*p3,*p4);
+    return img_out;
+}
+
+
+float *img_min5_t_bat_raw(float *img_out, float *img_in0, float *img_in1, float *img_in2, float *img_in3, float *img_in4, int k)
+{
+    float *p0=img_in0, *p1=img_in1, *p2=img_in2, *p3=img_in3, *p4=img_in4;
+    float *q=img_out,*q_end=img_out+IMG_SZ*k;
+
+    for (;q<q_end;p0++,p1++,p2++,p3++,p4++,q++)
+        *q=min5(*p0,*p1,*p2,*p3,*p4);
+    return img_out;
+}
+
+
+// 以下为带历史数据管理的时间滤波器，历史数据的存放方式和单帧滤波器相同，只是每帧的大小为k*IMG_SZ
+
+float *img_fir3_t_bat(float *img_out, float *img_buf, float *img_in, float *coff, int k, int *state)
+{
+    int n=IMG_SZ*k;
+    float *img_buf1=img_buf+n;
+
+    if (*state)
+    {
+        img_fir3_t_bat_raw(img_out,img_buf1,img_buf,img_in,coff,k);
+        img_copy(img_buf1,img_in,n);
+        *state=0;
+    }
+    else
+    {
+        img_fir3_t_bat_raw(img_out,img_buf,img_buf1,img_in,coff,k);
+        img_copy(img_buf,img_in,n);
+        *state=1;
+    }
+    return img_out;
+}
+
+
+float *img_mid3_t_bat(float *img_out, float *img_buf, float *img_in, int k, int *state)
+{
+    int n=IMG_SZ*k;
+    float *img_buf1=img_buf+n;
+
+    if (*state)
+    {
+        img_mid3_t_bat_raw(img_out,img_buf1,img_buf,img_in,k);
+        img_copy(img_buf1,img_in,n);
+        *state=0;
+    }
+    else
+    {
+        img_mid3_t_bat_raw(img_out,img_buf,img_buf1,img_in,k);
+        img_copy(img_buf,img_in,n);
+        *state=1;
+    }
+    return img_out;
+}
+
+
+float *img_max3_t_bat(float *img_out, float *img_buf, float *img_in, int k, int *state)
+{
+    int n=IMG_SZ*k;
+    float *img_buf1=img_buf+n;
+
+    if (*state)
+    {
+        img_max3_t_bat_raw(img_out,img_buf1,img_buf,img_in,k);
+        img_copy(img_buf1,img_in,n);
+        *state=0;
+    }
+    else
+    {
+        img_max3_t_bat_raw(img_out,img_buf,img_buf1,img_in,k);
+        img_copy(img_buf,img_in,n);
+        *state=1;
+    }
+    return img_out;
+}
+
+
+float *img_mid5_t_bat(float *img_out, float *img_buf, float *img_in, int k, int *state)
+{
+    int n=IMG_SZ*k;
+    float *img_buf0=img_buf+n*  (*state);
+    float *img_buf1=img_buf+n*(((*state)+1)%4);
+    float *img_buf2=img_buf+n*(((*state)+2)%4);
+    float *img_buf3=img_buf+n*(((*state)+3)%4);
+
+    img_mid5_t_bat_raw(img_out,img_buf0,img_buf1,img_buf2,img_buf3,img_in,k);
+    img_copy(img_buf0,img_in,n);
+    *state=((*state)+1)%4;
+
+    return img_out;
+}
+
+
+float *img_minmax_avg5_t_bat(float *img_out, float *img_buf, float *img_in, int k, int *state)
+{
+    int n=IMG_SZ*k;
+    float *img_buf0=img_buf+n*  (*state);
+    float *img_buf1=img_buf+n*(((*state)+1)%4);
+    float *img_buf2=img_buf+n*(((*state)+2)%4);
+    float *img_buf3=img_buf+n*(((*state)+3)%4);
+
+    img_minmax_avg5_t_bat_raw(img_out,img_buf0,img_buf1,img_buf2,img_buf3,img_in,k);
+    img_copy(img_buf0,img_in,n);
+    *state=((*state)+1)%4;
+
+    return img_out;
+}
+
+
+float *img_max5_t_bat(float *img_out, float *img_buf, float *img_in, int k, int *state)
+{
+    int n=IMG_SZ*k;
+    float *img_buf0=img_buf+n*  (*state);
+    float *img_buf1=img_buf+n*(((*state)+1)%4);
+    float *img_buf2=img_buf+n*(((*state)+2)%4);
+    float *img_buf3=img_buf+n*(((*state)+3)%4);
+
+    img_max5_t_bat_raw(img_out,img_buf0,img_buf1,img_buf2,img_buf3,img_in,k);
+    img_copy(img_buf0,img_in,n);
+    *state=((*state)+1)%4;
+
+    return img_out;
+}
+
+
+float *img_min5_t_bat(float *img_out, float *img_buf, float *img_in, int k, int *state)
+{
+    int n=IMG_SZ*k;
+    float *img_buf0=img_buf+n*  (*state);
+    float *img_buf1=img_buf+n*(((*state)+1)%4);
+    float *img_buf2=img_buf+n*(((*state)+2)%4);
+    float *img_buf3=img_buf+n*(((*state)+3)%4);
+
+    img_min5_t_bat_raw(img_out,img_buf0,img_buf1,img_buf2,img_buf3,img_in,k);
+    img_copy(img_buf0,img_in,n);
+    *state=((*state)+1)%4;
+
+    return img_out;
+}
@@ -0,0 +1,232 @@
+/**
+ * @file    img_filter_bat.h
+ * @author  YRD
+ * @version 1.0
+ * @date    2026-10-18
+ * @brief   多相机批处理图像滤波函数
+ * @details 同一时刻多个传感器（k个）的图像交织存放，作为一批数据滤波：
+ *          交织格式为像素优先，第i个像素第j帧的数据位于img[i*k+j]，一批数据共k*IMG_SZ个float。
+ *          在交织格式下，3x3模板中各点的偏移量都是k的整数倍，滤波循环变成一个长度为k倍的连续数据循环，
+ *          滤波系数只加载一次，函数调用和行首尾的开销被k帧分摊，并且循环可以被编译器向量化。
+ *          k=1时与img_filter.h中的单帧滤波器结果相同。
+*/
+
+#ifndef __IMG_FILTER_BAT_H__
+#define __IMG_FILTER_BAT_H__
+
+#include <stdint.h>
+#include "img_par.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @fn              float *img_interleave(float *img_out, float **img_in, int k)
+ * @brief           把k帧图像交织为批处理格式
+ * @param [in]      float **img_in：指针数组，指向k帧待交织图像
+ * @param [in]      int k：帧数
+ * @param [out]     float *img_out：指针，指向的空间（k*IMG_SZ个float）存放交织后的图像
+ * @retval          float *：和img_out相同
+ */
+float *img_interleave(float *img_out, float **img_in, int k);
+
+/**
+ * @fn              float **img_deinterleave(float **img_out, float *img_in, int k)
+ * @brief           把批处理格式的图像拆分为k帧图像
+ * @param [in]      float *img_in：指针，指向交织格式图像
+ * @param [in]      int k：帧数
+ * @param [out]     float **img_out：指针数组，指向k帧图像的存放空间
+ * @retval          float **：和img_out相同
+ */
+float **img_deinterleave(float **img_out, float *img_in, int k);
+
+/**
+ * @fn              float *img_fir_sqr3_bat(float *img_out, float *img_in, float *coff, int k)
+ * @brief           使用3x3滤波模板的图像滤波（k帧批处理），功能同img_fir_sqr3
+ *                  注意：滤波输出图像的最外圈边沿（1层像素）是无效数据
+ * @param [in]      float *img_in：指针，指向交织格式的待滤波图像
+ * @param [in]      float *coff：指针，指向9个滤波系数，k帧共用
+ * @param [in]      int k：帧数
+ * @param [out]     float *img_out：指针，指向的空间存放交织格式的图像运算结果
+ * @retval          float *：和img_out相同
+ */
+float *img_fir_sqr3_bat(float *img_out, float *img_in, float *coff, int k);
+
+/**
+ * @fn              float *img_plane_mf_sqr3_bat(float *img_out, float *img_in, int k)
+ * @brief           3x3平面匹配滤波（k帧批处理），功能同img_plane_mf_sqr3
+ *                  注意：滤波输出图像的最外圈边沿（1层像素）是无效数据
+ * @param [in]      float *img_in：指针，指向交织格式的待滤波图像
+ * @param [in]      int k：帧数
+ * @param [out]     float *img_out：指针，指向的空间存放交织格式的图像运算结果
+ * @retval          float *：和img_out相同
+ */
+float *img_plane_mf_sqr3_bat(float *img_out, float *img_in, int k);
+
+/**
+ * @fn              float *img_fir_sqr3_bat_mt(float *img_out, float *img_in, float *coff, int k, struct img_par_s *par)
+ * @brief           使用3x3滤波模板的图像滤波（k帧批处理，多线程），图像按行分块，由线程池par中的各线程并行计算
+ *                  k=1时即为单帧图像的多线程滤波，结果和img_fir_sqr3相同
+ * @param [in]      struct img_par_s *par：线程池，为NULL时单线程计算
+ * @retval          float *：和img_out相同
+ */
+float *img_fir_sqr3_bat_mt(float *img_out, float *img_in, float *coff, int k, struct img_par_s *par);
+
+/**
+ * @fn              float *img_plane_mf_sqr3_bat_mt(float *img_out, float *img_in, int k, struct img_par_s *par)
+ * @brief           3x3平面匹配滤波（k帧批处理，多线程），图像按行分块，由线程池par中的各线程并行计算
+ *                  k=1时即为单帧图像的多线程滤波，结果和img_plane_mf_sqr3相同
+ * @param [in]      struct img_par_s *par：线程池，为NULL时单线程计算
+ * @retval          float *：和img_out相同
+ */
+float *img_plane_mf_sqr3_bat_mt(float *img_out, float *img_in, int k, struct img_par_s *par);
+
+/**
+ * @fn              float *img_plane_mf_sqr3_ext_bat_mt(float *img_out, float *img_gx, float *img_gy, float *img_res, float *img_in, int k, struct img_par_s *par)
+ * @brief           3x3平面匹配滤波（k帧批处理，多线程），同时输出每个像素最优平面的斜率和拟合残差（见img_algo.h中的plane_mf_pix_ext），
+ *                  img_out和img_plane_mf_sqr3_bat_mt的结果相同；斜率可以用img_normal_grad转换为法向量图，残差可以作为深度的置信度
+ *                  注意：输出图像的最外圈边沿（1层像素）是无效数据
+ * @param [in]      float *img_in：指针，指向交织格式的待滤波图像
+ * @param [out]     float *img_gx,*img_gy：指针，指向的空间（k*IMG_SZ个float）存放交织格式的x（列）、y（行）方向斜率，单位为深度/像素
+ * @param [out]     float *img_res：指针，指向的空间（k*IMG_SZ个float）存放交织格式的拟合残差（均方误差，深度单位的平方）
+ * @param [in]      struct img_par_s *par：线程池，为NULL时单线程计算
+ * @retval          float *：和img_out相同
+ */
+float *img_plane_mf_sqr3_ext_bat_mt(float *img_out, float *img_gx, float *img_gy, float *img_res, float *img_in, int k, struct img_par_s *par);
+
+/**
+ * @fn              float *img_iir_t_bat(float *img_inout, float *img_in, float alpha, int k)
+ * @brief           1阶IIR图像序列的时间滤波（k帧批处理），功能同img_iir_t
+ * @param [in]      float *img_in：指针，指向交织格式的待滤波图像
+ * @param [in]      float alpha：滤波系数（遗忘因子）0~1，越接近1，滤波器带宽越小
+ * @param [in]      int k：帧数
+ * @param [inout]   float *img_inout：指针，指向空间存放先前滤波结果和新的滤波结果
+ * @retval          float *：和img_inout相同
+ */
+float *img_iir_t_bat(float *img_inout, float *img_in, float alpha, int k);
+
+/**
+ * @fn              float *img_fir3_t_bat_raw(float *img_out, float *img_in0, float *img_in1, float *img_in2, float *coff, int k)
+ * @brief           图像序列的FIR时间滤波（k帧批处理），功能同img_fir3_t_raw
+ * @param [in]      float *img_in0，img_in1，img_in2为交织格式的历史图像帧(指针)，img_in0对应最老图像，img_in2对应最新图像
+ * @param [in]      float *coff：指针，指向3个滤波加权系数
+ * @param [in]      int k：帧数
+ * @param [out]     float *img_out：指针，指向空间存放滤波结果
+ * @retval          float *：和img_out相同
+ */
+float *img_fir3_t_bat_raw(float *img_out, float *img_in0, float *img_in1, float *img_in2, float *coff, int k);
+
+/**
+ * @fn              float *img_fir3_t_bat(float *img_out, float *img_buf, float *img_in, float *coff, int k, int *state)
+ * @brief           图像序列的FIR时间滤波（k帧批处理），功能同img_fir3_t
+ * @param [in]      float *img_buf：历史图像帧(指针)，连续存放最近2批交织格式图像（2*k*IMG_SZ个float）
+ * @param [in]      float *img_in：指针，指向最新输入的交织格式图像
+ * @param [in]      float *coff：指针，指向3个滤波加权系数
+ * @param [in]      int k：帧数
+ * @param [out]     float *img_out：指针，指向的空间存放滤波结果
+ * @param [inout]   int *state：指针，指向滤波状态变量，初始值需设为0，指向的内容在运行后被修改
+ * @retval          float *：和img_out相同
+ */
+float *img_fir3_t_bat(float *img_out, float *img_buf, float *img_in, float *coff, int k, int *state);
+
+/**
+ * @fn              float *img_mid3_t_bat_raw(float *img_out, float *img_in0, float *img_in1, float *img_in2, int k)
+ * @brief           图像序列的中值滤波（k帧批处理），功能同img_mid3_t_raw
+ * @retval          float *：和img_out相同
+ */
+float *img_mid3_t_bat_raw(float *img_out, float *img_in0, float *img_in1, float *img_in2, int k);
+
+/**
+ * @fn              float *img_mid3_t_bat(float *img_out, float *img_buf, float *img_in, int k, int *state)
+ * @brief           图像序列的中值滤波（k帧批处理），功能同img_mid3_t
+ * @param [in]      float *img_buf：历史图像帧(指针)，连续存放最近2批交织格式图像（2*k*IMG_SZ个float）
+ * @param [inout]   int *state：指针，指向滤波状态变量，初始值需设为0，指向的内容在运行后被修改
+ * @retval          float *：和img_out相同
+ */
+float *img_mid3_t_bat(float *img_out, float *img_buf, float *img_in, int k, int *state);
+
+/**
+ * @fn              float *img_max3_t_bat_raw(float *img_out, float *img_in0, float *img_in1, float *img_in2, int k)
+ * @brief           3帧图像序列的像素最大值（k帧批处理），功能同img_max3_t_raw
+ * @retval          float *：和img_out相同
+ */
+float *img_max3_t_bat_raw(float *img_out, float *img_in0, float *img_in1, float *img_in2, int k);
+
+/**
+ * @fn              float *img_max3_t_bat(float *img_out, float *img_buf, float *img_in, int k, int *state)
+ * @brief           3帧图像序列的像素最大值（k帧批处理），功能同img_max3_t
+ * @param [in]      float *img_buf：历史图像帧(指针)，连续存放最近2批交织格式图像（2*k*IMG_SZ个float）
+ * @param [inout]   int *state：指针，指向滤波状态变量，初始值需设为0，指向的内容在运行后被修改
+ * @retval          float *：和img_out相同
+ */
+float *img_max3_t_bat(float *img_out, float *img_buf, float *img_in, int k, int *state);
+
+/**
+ * @fn              float *img_mid5_t_bat_raw(float *img_out, float *img_in0, float *img_in1, float *img_in2, float *img_in3, float *img_in4, int k)
+ * @brief           图像序列的中值滤波（k帧批处理），功能同img_mid5_t_raw
+ * @retval          float *：和img_out相同
+ */
+float *img_mid5_t_bat_raw(float *img_out, float *img_in0, float *img_in1, float *img_in2, float *img_in3, float *img_in4, int k);
+
+/**
+ * @fn              float *img_mid5_t_bat(float *img_out, float *img_buf, float *img_in, int k, int *state)
+ * @brief           图像序列的中值滤波（k帧批处理），功能同img_mid5_t
+ * @param [in]      float *img_buf：历史图像帧(指针)，连续存放最近4批交织格式图像（4*k*IMG_SZ个float）
+ * @param [inout]   int *state：指针，指向滤波状态变量(最老的图像帧在img_buf中的位置），初始值需设为0，指向的内容在运行后被修改
+ * @retval          float *：和img_out相同
+ */
+float *img_mid5_t_bat(float *img_out, float *img_buf, float *img_in, int k, int *state);
+
+/**
+ * @fn              float *img_minmax_avg5_t_bat_raw(float *img_out, float *img_in0, float *img_in1, float *img_in2, float *img_in3, float *img_in4, int k)
+ * @brief           图像序列的平均中值滤波（k帧批处理），功能同img_minmax_avg5_t_raw
+ * @retval          float *：和img_out相同
+ */
+float *img_minmax_avg5_t_bat_raw(float *img_out, float *img_in0, float *img_in1, float *img_in2, float *img_in3, float *img_in4, int k);
+
+/**
+ * @fn              float *img_minmax_avg5_t_bat(float *img_out, float *img_buf, float *img_in, int k, int *state)
+ * @brief           图像序列的平均中值滤波（k帧批处理），功能同img_minmax_avg5_t
+ * @param [in]      float *img_buf：历史图像帧(指针)，连续存放最近4批交织格式图像（4*k*IMG_SZ个float）
+ * @param [inout]   int *state：指针，指向滤波状态变量(最老的图像帧在img_buf中的位置），初始值需设为0，指向的内容在运行后被修改
+ * @retval          float *：和img_out相同
+ */
+float *img_minmax_avg5_t_bat(float *img_out, float *img_buf, float *img_in, int k, int *state);
+
+/**
+ * @fn              float *img_max5_t_bat_raw(float *img_out, float *img_in0, float *img_in1, float *img_in2, float *img_in3, float *img_in4, int k)
+ * @brief           5帧图像序列的像素最大值（k帧批处理），功能同img_max5_t_raw
+ * @retval          float *：和img_out相同
+ */
+float *img_max5_t_bat_raw(float *img_out, float *img_in0, float *img_in1, float *img_in2, float *img_in3, float *img_in4, int k);
+
+/**
+ * @fn              float *img_max5_t_bat(float *img_out, float *img_buf, float *img_in, int k, int *state)
+ * @brief           5帧图像序列的像素最大值（k帧批处理），功能同img_max5_t
+ * @param [in]      float *img_buf：历史图像帧(指针)，连续存放最近4批交织格式图像（4*k*IMG_SZ个float）
+ * @param [inout]   int *state：指针，指向滤波状态变量(最老的图像帧在img_buf中的位置），初始值需设为0，指向的内容在运行后被修改
+ * @retval          float *：和img_out相同
+ */
+float *img_max5_t_bat(float *img_out, float *img_buf, float *img_in, int k, int *state);
+
+/**
+ * @fn              float *img_min5_t_bat_raw(float *img_out, float *img_in0, float *img_in1, float *img_in2, float *img_in3, float *img_in4, int k)
+ * @brief           5帧图像序列的像素最小值（k帧批处理），功能同img_min5_t_raw
+ * @retval          float *：和img_out相同
+ */
+float *img_min5_t_bat_raw(float *img_out, float *img_in0, float *img_in1, float *img_in2, float *img_in3, float *img_in4, int k);
+
+/**
+ * @fn              float *img_min5_t_bat(float *img_out, float *img_buf, float *img_in, int k, int *state)
+ * @brief           5帧图像序列的像素最小值（k帧批处理），功能同img_min5_t
+ * @param [in]      float *img_buf：历史图像帧(指针)，连续存放最近4批交织格式图像（4*k*IMG_SZ个float）
+ * @param [inout]   int *state：指针，指向滤波状态变量(最老的图像帧在img_buf中的位置），初始值需设为0，指向的内容在运行后被修改
+ * @retval          float *：和img_out相同
+ */
+float *img_min5_t_bat(float *img_out, float *img_buf, float *img_in, int k, int *state);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
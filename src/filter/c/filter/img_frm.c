@@ -0,0 +1,214 @@
+/**
+ * @file    img_frm.c
+ * @author  YRD
+ * @version 1.0
+ * @date    2026-10-18
+ * @brief   引用计数帧
+ * @details 引用计数用原子操作，只有帧回到帧池、信箱放入和取走时加锁
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include "img_const.h"
+#include "img_frm.h"
+
+
+int img_arena_init(struct img_arena_s *arena, struct img_pool_s *pool, int n)
+{
+    int i;
+
+    memset(arena,0,sizeof(*arena));
+    if (n<1 || n>IMG_ARENA_MAX)
+        return -1;
+    arena->pool=pool;
+    for (i=0;i<n;i++)
+    {
+        struct img_frm_s *f=&arena->frm[i];
+        if ((f->img=img_pool_alloc_img(pool,1))==NULL)
+        {
+            img_arena_destroy(arena);
+            return -1;
+        }
+        f->arena=arena;
+        f->next=arena->free;
+        arena->free=f;
+        arena->n++;
+    }
+    arena->n_free=arena->n_free_min=n;
+    pthread_mutex_init(&arena->mtx,NULL);
+    pthread_cond_init(&arena->cv,NULL);
+    return 0;
+}
+
+
+void img_arena_destroy(struct img_arena_s *arena)
+{
+    int i;
+
+    if (arena->n_free!=arena->n)
+        fprintf(stderr,"img_arena: %d frame(s) still referenced\n",arena->n-arena->n_free);
+    for (i=0;i<arena->n;i++)
+        img_pool_release(arena->pool,arena->frm[i].img);
+    if (arena->n)
+    {
+        pthread_mutex_destroy(&arena->mtx);
+        pthread_cond_destroy(&arena->cv);
+    }
+    memset(arena,0,sizeof(*arena));
+}
+
+
+void img_arena_close(struct img_arena_s *arena)
+{
+    pthread_mutex_lock(&arena->mtx);
+    arena->closed=1;
+    pthread_cond_broadcast(&arena->cv);
+    pthread_mutex_unlock(&arena->mtx);
+}
+
+
+struct img_frm_s *img_frm_alloc(struct img_arena_s *arena, int wait)
+{
+    struct img_frm_s *f;
+
+    pthread_mutex_lock(&arena->mtx);
+    while (arena->free==NULL && wait && !arena->closed)
+        pthread_cond_wait(&arena->cv,&arena->mtx);
+    f=arena->closed ? NULL : arena->free;
+    if (f)
+    {
+        arena->free=f->next;
+        arena->n_free--;
+        if (arena->n_free<arena->n_free_min)
+            arena->n_free_min=arena->n_free;
+        f->next=NULL;
+        f->ref=1;
+    }
+    pthread_mutex_unlock(&arena->mtx);
+    return f;
+}
+
+
+void img_frm_release(struct img_frm_s *f)
+{
+    struct img_arena_s *arena;
+    int ref;
+
+    if (f==NULL)
+        return;
+#ifdef _MSC_VER
+    ref=_InterlockedDecrement((volatile long *)&f->ref);
+#else
+    ref=__sync_sub_and_fetch(&f->ref,1);
+#endif
+    // 释放次数多于引用次数：再放回空闲链表会让同一帧出现两次，链表被破坏
+    assert(ref>=0 && "img_frm_release: frame released more often than retained");
+    if (ref!=0)
+        return;
+    arena=f->arena;
+    pthread_mutex_lock(&arena->mtx);
+    f->next=arena->free;
+    arena->free=f;
+    arena->n_free++;
+    pthread_cond_signal(&arena->cv);
+    pthread_mutex_unlock(&arena->mtx);
+}
+
+
+void img_mbox_init(struct img_mbox_s *mb)
+{
+    memset(mb,0,sizeof(*mb));
+    pthread_mutex_init(&mb->mtx,NULL);
+    pthread_cond_init(&mb->cv,NULL);
+}
+
+
+void img_mbox_put(struct img_mbox_s *mb, struct img_frm_s *f)
+{
+    struct img_frm_s *old;
+
+    img_frm_retain(f);
+    pthread_mutex_lock(&mb->mtx);
+    if (mb->closed)
+    {
+        pthread_mutex_unlock(&mb->mtx);
+        img_frm_release(f);
+        return;
+    }
+    old=mb->frm;
+    mb->frm=f;
+    mb->n_put++;
+    if (old)
+        mb->n_drop++;
+    pthread_cond_signal(&mb->cv);
+    pthread_mutex_unlock(&mb->mtx);
+    img_frm_release(old);                                   // 在锁外释放，回到帧池时要加帧池的锁
+}
+
+
+struct img_frm_s *img_mbox_get(struct img_mbox_s *mb, int wait)
+{
+    struct img_frm_s *f;
+
+    pthread_mutex_lock(&mb->mtx);
+    while (mb->frm==NULL && wait && !mb->closed)
+        pthread_cond_wait(&mb->cv,&mb->mtx);
+    f=mb->frm;
+    mb->frm=NULL;
+    pthread_mutex_unlock(&mb->mtx);
+    return f;
+}
+
+
+void img_mbox_close(struct img_mbox_s *mb)
+{
+    struct img_frm_s *f;
+
+    pthread_mutex_lock(&mb->mtx);
+    mb->closed=1;
+    f=mb->frm;
+    mb->frm=NULL;
+    if (f)
+        mb->n_drop++;
+    pthread_cond_broadcast(&mb->cv);
+    pthread_mutex_unlock(&mb->mtx);
+    img_frm_release(f);
+}
+
+
+int img_bcast_sub(struct img_bcast_s *b, struct img_mbox_s *mb)
+{
+    if (b->n>=IMG_BCAST_MAX)
+        return -1;
+    b->sub[b->n++]=mb;
+    return 0;
+}
+
+
+void img_bcast_pub(struct img_bcast_s *b, struct img_frm_s *f)
+{
+    int i;
+    for (i=0;i<b->n;i++)
+        img_mbox_put(b->sub[i],f);
+}
+
+
+void img_hist_push(struct img_hist_s *h, struct img_frm_s *f)
+{
+    int i;
+
+    if (h->cnt==h->n)
+        img_frm_release(h->frm[--h->cnt]);
+    for (i=h->cnt;i>0;i--)
+        h->frm[i]=h->frm[i-1];
+    h->frm[0]=img_frm_retain(f);
+    h->cnt++;
+}
+
+
+void img_hist_clear(struct img_hist_s *h)
+{
+    while (h->cnt)
+        img_frm_release(h->frm[--h->cnt]);
+}
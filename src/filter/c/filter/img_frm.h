@@ -0,0 +1,200 @@
+/**
+ * @file    img_frm.h
+ * @author  YRD
+ * @version 1.0
+ * @date    2026-10-18
+ * @brief   引用计数帧
+ * @details 一帧图像发布后不再修改，多个使用者（写文件、反投影、显示、检测、时间滤波器的历史图像）共享同一块内存，不拷贝：
+ *          1. 帧在启动时从内存池一次分配到帧池(img_arena_s)，img_frm_alloc取出时引用计数为1，
+ *             每个使用者img_frm_retain增加引用，用完img_frm_release减少，减到0时自动回到帧池；
+ *          2. 信箱(img_mbox_s)只保存最新的一帧，放入新帧时释放还没有被取走的旧帧（latest-wins），
+ *             慢的使用者只会跳帧，不会阻塞发布者；广播(img_bcast_s)把一帧放入所有订阅者的信箱；
+ *          3. 历史(img_hist_s)保存最近几帧的引用，时间滤波器直接使用历史帧（img_chain_run_frm），
+ *             不再把每帧拷贝到自己的历史图像中。
+ *          帧池中帧的个数要覆盖同时被持有的最多帧数（队列长度+历史帧数+各使用者正在处理的帧）
+*/
+
+#ifndef __IMG_FRM_H__
+#define __IMG_FRM_H__
+
+#include <stdint.h>
+#include <pthread.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#include "img_pool.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define IMG_ARENA_MAX       64          ///< 帧池最多帧数
+#define IMG_BCAST_MAX       8           ///< 广播最多订阅者数
+#define IMG_HIST_MAX        8           ///< 历史最多帧数
+
+struct img_arena_s;
+
+/**
+ * @brief           帧
+ */
+struct img_frm_s
+{
+    float      *img;                    ///< IMG_SZ个float
+    uint64_t    seq;                    ///< 帧序号
+    uint64_t    t_in;                   ///< 采集时间（ns）
+    volatile int ref;                   ///< 引用计数
+    struct img_arena_s *arena;
+    struct img_frm_s   *next;           ///< 空闲链表
+};
+
+/**
+ * @brief           帧池
+ */
+struct img_arena_s
+{
+    struct img_frm_s  frm[IMG_ARENA_MAX];
+    int               n;                ///< 帧数
+    struct img_frm_s *free;             ///< 空闲帧
+    int               n_free;
+    int               n_free_min;       ///< 空闲帧数的最小值
+    int               closed;
+    struct img_pool_s *pool;
+    pthread_mutex_t   mtx;
+    pthread_cond_t    cv;
+};
+
+/**
+ * @fn              int img_arena_init(struct img_arena_s *arena, struct img_pool_s *pool, int n)
+ * @brief           从内存池分配n帧
+ * @retval          int：0成功，-1内存池不足或n超出范围
+ */
+int img_arena_init(struct img_arena_s *arena, struct img_pool_s *pool, int n);
+
+/**
+ * @fn              void img_arena_destroy(struct img_arena_s *arena)
+ * @brief           把全部帧还给内存池，调用前所有帧都应已释放
+ */
+void img_arena_destroy(struct img_arena_s *arena);
+
+/**
+ * @fn              void img_arena_close(struct img_arena_s *arena)
+ * @brief           唤醒在img_frm_alloc中等待的线程并使其返回NULL，用于停止流水线
+ */
+void img_arena_close(struct img_arena_s *arena);
+
+/**
+ * @fn              struct img_frm_s *img_frm_alloc(struct img_arena_s *arena, int wait)
+ * @brief           取一个空闲帧，引用计数为1
+ * @param [in]      int wait：没有空闲帧时等待（反压），0时立即返回NULL
+ * @retval          struct img_frm_s *：NULL表示没有空闲帧或帧池已关闭
+ */
+struct img_frm_s *img_frm_alloc(struct img_arena_s *arena, int wait);
+
+/**
+ * @fn              struct img_frm_s *img_frm_retain(struct img_frm_s *f)
+ * @brief           增加引用
+ * @retval          struct img_frm_s *：和f相同
+ */
+static inline struct img_frm_s *img_frm_retain(struct img_frm_s *f)
+{
+#ifdef _MSC_VER
+    _InterlockedIncrement((volatile long *)&f->ref);
+#else
+    __sync_fetch_and_add(&f->ref,1);
+#endif
+    return f;
+}
+
+/**
+ * @fn              void img_frm_release(struct img_frm_s *f)
+ * @brief           减少引用，减到0时回到帧池，f可以为NULL；重复释放（引用计数小于0）时assert失败
+ */
+void img_frm_release(struct img_frm_s *f);
+
+/**
+ * @brief           信箱，只保存最新一帧
+ */
+struct img_mbox_s
+{
+    struct img_frm_s *frm;              ///< 未取走的帧，持有一个引用
+    int               closed;
+    uint64_t          n_put;            ///< 放入帧数
+    uint64_t          n_drop;           ///< 被新帧替换、没有取走的帧数
+    pthread_mutex_t   mtx;
+    pthread_cond_t    cv;
+};
+
+/**
+ * @fn              void img_mbox_init(struct img_mbox_s *mb)
+ * @brief           信箱初始化
+ */
+void img_mbox_init(struct img_mbox_s *mb);
+
+/**
+ * @fn              void img_mbox_put(struct img_mbox_s *mb, struct img_frm_s *f)
+ * @brief           放入一帧（增加引用），替换未取走的旧帧，从不阻塞
+ */
+void img_mbox_put(struct img_mbox_s *mb, struct img_frm_s *f);
+
+/**
+ * @fn              struct img_frm_s *img_mbox_get(struct img_mbox_s *mb, int wait)
+ * @brief           取走最新一帧，调用者用完后img_frm_release
+ * @param [in]      int wait：信箱空时等待
+ * @retval          struct img_frm_s *：NULL表示信箱空（wait为0时）或已关闭
+ */
+struct img_frm_s *img_mbox_get(struct img_mbox_s *mb, int wait);
+
+/**
+ * @fn              void img_mbox_close(struct img_mbox_s *mb)
+ * @brief           关闭信箱，释放未取走的帧（计入n_drop），唤醒等待的使用者
+ */
+void img_mbox_close(struct img_mbox_s *mb);
+
+/**
+ * @brief           广播
+ */
+struct img_bcast_s
+{
+    struct img_mbox_s *sub[IMG_BCAST_MAX];
+    int                n;
+};
+
+/**
+ * @fn              int img_bcast_sub(struct img_bcast_s *b, struct img_mbox_s *mb)
+ * @brief           增加订阅者，在发布之前调用
+ * @retval          int：0成功，-1订阅者过多
+ */
+int img_bcast_sub(struct img_bcast_s *b, struct img_mbox_s *mb);
+
+/**
+ * @fn              void img_bcast_pub(struct img_bcast_s *b, struct img_frm_s *f)
+ * @brief           把一帧放入全部订阅者的信箱，发布者仍持有自己的引用
+ */
+void img_bcast_pub(struct img_bcast_s *b, struct img_frm_s *f);
+
+/**
+ * @brief           历史，保存最近n帧的引用
+ */
+struct img_hist_s
+{
+    struct img_frm_s *frm[IMG_HIST_MAX];    ///< frm[0]最新
+    int               n;                    ///< 保存帧数
+    int               cnt;                  ///< 已保存帧数
+};
+
+/**
+ * @fn              void img_hist_push(struct img_hist_s *h, struct img_frm_s *f)
+ * @brief           加入一帧（增加引用），超过n帧时释放最老的一帧
+ */
+void img_hist_push(struct img_hist_s *h, struct img_frm_s *f);
+
+/**
+ * @fn              void img_hist_clear(struct img_hist_s *h)
+ * @brief           释放全部历史帧
+ */
+void img_hist_clear(struct img_hist_s *h);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
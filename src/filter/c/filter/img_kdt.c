@@ -0,0 +1,360 @@
+/**
+ * @file    img_kdt.c
+ * @author  YRD
+ * @version 1.0
+ * @date    2026-10-18
+ * @brief   KD树（批量k近邻和半径查询）
+ * @details 建树：每个结点在包围盒最长的维上用快速选择找中位数，x/y/z/序号四列一起交换；
+ *          查询：显式栈深度优先，每层最多压入一个远侧子树，近邻用大小为k的大顶堆，结束时堆排序输出
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "img_kdt.h"
+
+#define DEPTH_MAX       28          // 内部结点最多层数，点数小于2^31时叶子不超过8个点
+#define PAR_LV_MAX      10          // 多线程建树时单线程划分的最多层数
+
+
+void img_kdt_release(struct img_kdt_s *kt)
+{
+    free(kt->px);
+    free(kt->pid);
+    free(kt->split);
+    free(kt->dim);
+    free(kt->lb);
+    memset(kt,0,sizeof(*kt));
+}
+
+
+// 交换重排后的第i、j个点
+static inline void pt_swap(struct img_kdt_s *kt, int i, int j)
+{
+    float t;
+    int32_t p;
+
+    t=kt->px[i]; kt->px[i]=kt->px[j]; kt->px[j]=t;
+    t=kt->py[i]; kt->py[i]=kt->py[j]; kt->py[j]=t;
+    t=kt->pz[i]; kt->pz[i]=kt->pz[j]; kt->pz[j]=t;
+    p=kt->pid[i]; kt->pid[i]=kt->pid[j]; kt->pid[j]=p;
+}
+
+
+// 快速选择：点[lo,hi)按第c列重排，使第k个点之前的点都不大于它，之后的点都不小于它
+static void pt_select(struct img_kdt_s *kt, const float *c, int lo, int hi, int k)
+{
+    while (hi-lo>2)
+    {
+        // 三点取中作为主元，有序输入（深度图按行展开的点）不会退化
+        float a=c[lo],b=c[lo+(hi-lo)/2],d=c[hi-1];
+        float p=(a<b) ? ((b<d) ? b : (a<d) ? d : a) : ((a<d) ? a : (b<d) ? d : b);
+        int i=lo,j=hi-1;
+
+        while (i<=j)
+        {
+            while (c[i]<p)
+                i++;
+            while (c[j]>p)
+                j--;
+            if (i<=j)
+                pt_swap(kt,i++,j--);
+        }
+        if (k<=j)
+            hi=j+1;
+        else if (k>=i)
+            lo=i;
+        else
+            return;
+    }
+    if (hi-lo==2 && c[lo]>c[lo+1])
+        pt_swap(kt,lo,lo+1);
+}
+
+
+// 建立以v（第lv层）为根、点[lo,hi)的子树，到第stop层为止，第stop层各结点的点起点记入out
+static void build_node(struct img_kdt_s *kt, int v, int lo, int hi, int lv, int stop, int32_t *out)
+{
+    const float *c[3]={ kt->px,kt->py,kt->pz };
+    float mn[3]={ INFINITY,INFINITY,INFINITY },mx[3]={ -INFINITY,-INFINITY,-INFINITY };
+    int i,d,m;
+
+    if (lv==stop)
+    {
+        out[v-((1<<stop)-1)]=lo;
+        return;
+    }
+    for (i=lo;i<hi;i++)
+        for (d=0;d<3;d++)
+        {
+            mn[d]=(c[d][i]<mn[d]) ? c[d][i] : mn[d];
+            mx[d]=(c[d][i]>mx[d]) ? c[d][i] : mx[d];
+        }
+    d=(mx[1]-mn[1]>mx[0]-mn[0]) ? 1 : 0;
+    d=(mx[2]-mn[2]>mx[d]-mn[d]) ? 2 : d;
+
+    m=lo+(hi-lo)/2;
+    pt_select(kt,c[d],lo,hi,m);
+    kt->dim[v]=(uint8_t)d;
+    kt->split[v]=(m<hi) ? c[d][m] : 0;
+    build_node(kt,2*v+1,lo,m,lv+1,stop,out);
+    build_node(kt,2*v+2,m,hi,lv+1,stop,out);
+}
+
+
+// 多线程建树任务参数
+struct kdt_bld_arg_s
+{
+    struct img_kdt_s *kt;
+    int          lv;                // 子树根所在层
+    const int32_t *bnd;             // 子树的点范围，2^lv+1个
+};
+
+static void build_task(void *arg, int i, int n)
+{
+    struct kdt_bld_arg_s *a=(struct kdt_bld_arg_s *)arg;
+    int s0,s1,s;
+
+    img_par_band(0,1<<a->lv,i,n,&s0,&s1);
+    for (s=s0;s<s1;s++)
+        build_node(a->kt,(1<<a->lv)-1+s,a->bnd[s],a->bnd[s+1],a->lv,a->kt->depth,a->kt->lb);
+}
+
+
+int img_kdt_build(struct img_kdt_s *kt, const float *x, const float *y, const float *z, int n,
+                  int leaf, struct img_par_s *par)
+{
+    struct kdt_bld_arg_s a;
+    int32_t bnd[(1<<PAR_LV_MAX)+1];
+    int n_thr=img_par_threads(par),depth=0,n_node,lv,i;
+
+    if (n<0 || leaf<1 || leaf>IMG_KDT_LEAF_MAX)
+    {
+        fprintf(stderr,"img_kdt: bad point count %d or leaf size %d\n",n,leaf);
+        img_kdt_release(kt);
+        return -1;
+    }
+    while (depth<DEPTH_MAX && (int)(((int64_t)n+(1<<depth)-1)>>depth)>leaf)
+        depth++;
+    n_node=(1<<depth)-1;
+
+    // 容量不够时重新申请，点数变小时沿用原来的内存
+    if (kt->px==NULL || n>kt->cap || (int64_t)(n ? n : 1)*3<kt->cap)
+    {
+        int cap=n ? n : 1;
+        free(kt->px);
+        free(kt->pid);
+        kt->px=(float *)malloc(3*sizeof(float)*(size_t)cap);
+        kt->pid=(int32_t *)malloc(sizeof(int32_t)*(size_t)cap);
+        kt->cap=cap;
+    }
+    if (n_node>kt->n_node || kt->lb==NULL)
+    {
+        free(kt->split);
+        free(kt->dim);
+        free(kt->lb);
+        kt->split=(float *)malloc(sizeof(float)*(size_t)(n_node ? n_node : 1));
+        kt->dim=(uint8_t *)malloc((size_t)(n_node ? n_node : 1));
+        kt->lb=(int32_t *)malloc(sizeof(int32_t)*((size_t)n_node+2));
+        kt->n_node=n_node;
+    }
+    if (kt->px==NULL || kt->pid==NULL || kt->split==NULL || kt->dim==NULL || kt->lb==NULL)
+    {
+        fprintf(stderr,"img_kdt: out of memory for %d points\n",n);
+        img_kdt_release(kt);
+        return -1;
+    }
+    kt->n=n;
+    kt->depth=depth;
+    kt->py=kt->px+kt->cap;
+    kt->pz=kt->px+2*(size_t)kt->cap;
+    memcpy(kt->px,x,sizeof(float)*(size_t)n);
+    memcpy(kt->py,y,sizeof(float)*(size_t)n);
+    memcpy(kt->pz,z,sizeof(float)*(size_t)n);
+    for (i=0;i<n;i++)
+        kt->pid[i]=i;
+
+    // 单线程划分上面lv层，得到每个线程至少4棵子树，再多线程各自建立
+    for (lv=0;lv<depth && lv<PAR_LV_MAX && (1<<lv)<4*n_thr && n_thr>1;lv++)
+        ;
+    if (lv==0)
+        build_node(kt,0,0,n,0,depth,kt->lb);
+    else
+    {
+        build_node(kt,0,0,n,0,lv,bnd);
+        bnd[1<<lv]=n;
+        a.kt=kt; a.lv=lv; a.bnd=bnd;
+        img_par_run(par,build_task,&a,n_thr);
+    }
+    kt->lb[1<<depth]=n;
+    return 0;
+}
+
+
+int img_kdt_build_pc(struct img_kdt_s *kt, const struct img_pc_s *pc, int leaf, struct img_par_s *par)
+{
+    return img_kdt_build(kt,pc->x,pc->y,pc->z,pc->n,leaf,par);
+}
+
+
+// 大顶堆（距离平方hd，重排后的点序号hi）：从第i个结点向下调整，堆大小为n
+static inline void heap_down(float *hd, int32_t *hi, int n, int i)
+{
+    float d=hd[i];
+    int32_t p=hi[i];
+
+    for (;;)
+    {
+        int c=2*i+1;
+        if (c>=n)
+            break;
+        if (c+1<n && hd[c+1]>hd[c])
+            c++;
+        if (!(hd[c]>d))
+            break;
+        hd[i]=hd[c]; hi[i]=hi[c];
+        i=c;
+    }
+    hd[i]=d; hi[i]=p;
+}
+
+static inline void heap_push(float *hd, int32_t *hi, int n, float d, int32_t p)
+{
+    int i=n;
+
+    while (i>0 && hd[(i-1)/2]<d)
+    {
+        hd[i]=hd[(i-1)/2]; hi[i]=hi[(i-1)/2];
+        i=(i-1)/2;
+    }
+    hd[i]=d; hi[i]=p;
+}
+
+
+// 一个查询点的k近邻（距离平方小于r2），结果留在堆中，返回个数
+static int query_one(const struct img_kdt_s *kt, const float *q, int k, float r2, float *hd, int32_t *hi)
+{
+    struct { int v; float d2; } stk[DEPTH_MAX+1];
+    float bd[IMG_KDT_LEAF_MAX];
+    int n_in=(1<<kt->depth)-1,v=0,sp=0,cnt=0,j;
+    float worst=r2,qx=q[0],qy=q[1],qz=q[2];
+
+    for (;;)
+    {
+        // 下行到叶子，沿途把远侧子树和它到分割面的距离平方压栈
+        while (v<n_in)
+        {
+            float d=q[kt->dim[v]]-kt->split[v];
+            int near=2*v+1+(d>=0);
+            stk[sp].v=4*v+3-near;
+            stk[sp].d2=d*d;
+            sp++;
+            v=near;
+        }
+
+        // 叶子扫描：先无分支算出全部距离平方，再插入堆
+        {
+            int j0=kt->lb[v-n_in],m=kt->lb[v-n_in+1]-j0;
+            const float *x=kt->px+j0,*y=kt->py+j0,*z=kt->pz+j0;
+
+            for (j=0;j<m;j++)
+            {
+                float dx=x[j]-qx,dy=y[j]-qy,dz=z[j]-qz;
+                bd[j]=dx*dx+dy*dy+dz*dz;
+            }
+            for (j=0;j<m;j++)
+                if (bd[j]<worst)
+                {
+                    if (cnt<k)
+                        heap_push(hd,hi,cnt++,bd[j],j0+j);
+                    else
+                    {
+                        hd[0]=bd[j]; hi[0]=j0+j;
+                        heap_down(hd,hi,k,0);
+                    }
+                    if (cnt==k)
+                        worst=hd[0];
+                }
+        }
+
+        // 弹出下一个可能有更近点的远侧子树
+        do
+        {
+            if (sp==0)
+                return cnt;
+            sp--;
+        } while (!(stk[sp].d2<worst));
+        v=stk[sp].v;
+    }
+}
+
+
+// 多线程查询任务参数
+struct kdt_q_arg_s
+{
+    const struct img_kdt_s *kt;
+    const float *qx,*qy,*qz;
+    int          m,k;
+    float        r2;
+    int32_t     *idx;
+    float       *dist;
+    int32_t     *cnt;
+};
+
+static void query_task(void *arg, int i, int n)
+{
+    struct kdt_q_arg_s *a=(struct kdt_q_arg_s *)arg;
+    const struct img_kdt_s *kt=a->kt;
+    float hd[IMG_KDT_K_MAX];
+    int32_t hi[IMG_KDT_K_MAX];
+    int k=a->k,i0,i1,c,j;
+
+    // 点数可能超过img_par_band的int乘法范围，用64位计算分段
+    i0=(int)((int64_t)a->m*i/n);
+    i1=(int)((int64_t)a->m*(i+1)/n);
+    for (;i0<i1;i0++)
+    {
+        float q[3]={ a->qx[i0],a->qy[i0],a->qz[i0] };
+        int32_t *idx=a->idx+(size_t)i0*k;
+        float *dist=a->dist ? a->dist+(size_t)i0*k : NULL;
+        int cnt=query_one(kt,q,k,a->r2,hd,hi);
+
+        // 堆排序，从小到大
+        for (c=cnt-1;c>0;c--)
+        {
+            float d=hd[0];
+            int32_t p=hi[0];
+            hd[0]=hd[c]; hi[0]=hi[c];
+            hd[c]=d; hi[c]=p;
+            heap_down(hd,hi,c,0);
+        }
+        for (j=0;j<cnt;j++)
+            idx[j]=kt->pid[hi[j]];
+        for (;j<k;j++)
+            idx[j]=-1;
+        if (dist)
+        {
+            for (j=0;j<cnt;j++)
+                dist[j]=sqrtf(hd[j]);
+            for (;j<k;j++)
+                dist[j]=INFINITY;
+        }
+        if (a->cnt)
+            a->cnt[i0]=cnt;
+    }
+}
+
+
+void img_kdt_query(const struct img_kdt_s *kt, const float *qx, const float *qy, const float *qz, int m,
+                   int k, float r, int32_t *idx, float *dist, int32_t *cnt, struct img_par_s *par)
+{
+    struct kdt_q_arg_s a;
+
+    if (m<=0 || k<1 || k>IMG_KDT_K_MAX)
+        return;
+    a.kt=kt; a.qx=qx; a.qy=qy; a.qz=qz; a.m=m; a.k=k;
+    a.r2=(r>0) ? r*r : INFINITY;
+    a.idx=idx; a.dist=dist; a.cnt=cnt;
+    img_par_run(par,query_task,&a,img_par_threads(par));
+}
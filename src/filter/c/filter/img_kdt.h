@@ -0,0 +1,90 @@
+/**
+ * @file    img_kdt.h
+ * @author  YRD
+ * @version 1.0
+ * @date    2026-10-18
+ * @brief   KD树（批量k近邻和半径查询）
+ * @details 代替src/ref/structures/kdtree.py封装的scipy cKDTree，点来自img_pc.h的列存储点云或任意x/y/z列：
+ *              树是完全二叉树，按层序隐式存放（结点v的子结点为2v+1、2v+2），每个内部结点只存分割值和分割维，
+ *              叶子数为2的幂，每次按中位数把点分成数量相差不超过1的两半，所以叶子大小均匀，不需要存子结点指针；
+ *              建树时点按叶子顺序重排复制成x/y/z三列，叶子内的点连续存放，
+ *              叶子扫描先无分支地算出全部距离平方（可向量化），再把小于当前第k近距离的点插入大顶堆。
+ *          查询从近侧子树开始深度优先，远侧子树到分割面的距离不小于当前第k近距离时剪枝；
+ *          半径查询就是距离上限为r的k近邻查询，结果按距离排序，每个查询点最多返回k个。
+ *          批量查询按查询点分段多线程，结果写入调用者预先分配的序号和距离缓冲区。
+ *          建树时上面几层单线程划分，下面的子树多线程各自建立；重建时点数不超过已分配的容量不重新申请内存
+*/
+
+#ifndef __IMG_KDT_H__
+#define __IMG_KDT_H__
+
+#include <stdint.h>
+#include "img_par.h"
+#include "img_pc.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define IMG_KDT_LEAF_MAX    64      ///< 叶子最大点数
+#define IMG_KDT_K_MAX       1024    ///< 每个查询点最多返回的近邻数
+
+/**
+ * @brief           KD树，使用前清0
+ */
+struct img_kdt_s
+{
+    int         n;                  ///< 点数
+    int         cap;                ///< 已分配的点数
+    int         depth;              ///< 内部结点层数，叶子数为2^depth
+    float      *split;              ///< 内部结点的分割值，2^depth-1个
+    uint8_t    *dim;                ///< 内部结点的分割维（0/1/2），2^depth-1个
+    int32_t    *lb;                 ///< 叶子在重排后的点中的起点，2^depth+1个
+    int         n_node;             ///< 已分配的内部结点数
+    float      *px,*py,*pz;         ///< 按叶子顺序重排的点坐标，py=px+cap，pz=px+2*cap
+    int32_t    *pid;                ///< 重排后的点在原来点云中的序号
+};
+
+/**
+ * @fn              int img_kdt_build(struct img_kdt_s *kt, const float *x, const float *y, const float *z, int n,
+ *                                    int leaf, struct img_par_s *par)
+ * @brief           建树，点被复制到树中，建树后原来的点可以修改
+ * @param [in]      const float *x,*y,*z：点坐标，各n个float
+ * @param [in]      int leaf：叶子最大点数，1~IMG_KDT_LEAF_MAX
+ * @param [in]      struct img_par_s *par：线程池，可以为NULL
+ * @retval          int：0成功，-1参数无效或内存不足（树为空）
+ */
+int img_kdt_build(struct img_kdt_s *kt, const float *x, const float *y, const float *z, int n,
+                  int leaf, struct img_par_s *par);
+
+/**
+ * @fn              int img_kdt_build_pc(struct img_kdt_s *kt, const struct img_pc_s *pc, int leaf, struct img_par_s *par)
+ * @brief           用点云的坐标建树
+ */
+int img_kdt_build_pc(struct img_kdt_s *kt, const struct img_pc_s *pc, int leaf, struct img_par_s *par);
+
+/**
+ * @fn              void img_kdt_release(struct img_kdt_s *kt)
+ * @brief           释放树的内存
+ */
+void img_kdt_release(struct img_kdt_s *kt);
+
+/**
+ * @fn              void img_kdt_query(const struct img_kdt_s *kt, const float *qx, const float *qy, const float *qz, int m,
+ *                                     int k, float r, int32_t *idx, float *dist, int32_t *cnt, struct img_par_s *par)
+ * @brief           m个查询点各自的k个最近点（r>0时只找距离小于r的点），按距离从小到大排列
+ * @param [in]      const float *qx,*qy,*qz：查询点，各m个float，可以就是建树的点（结果包括查询点自己）
+ * @param [in]      int k：每个查询点的近邻数，1~IMG_KDT_K_MAX
+ * @param [in]      float r：距离上限，<=0时不限
+ * @param [out]     int32_t *idx：m*k个int32，近邻在建树的点中的序号，不足k个时后面为-1
+ * @param [out]     float *dist：m*k个float，近邻的距离，不足k个时后面为INFINITY，可以为NULL
+ * @param [out]     int32_t *cnt：m个int32，每个查询点找到的近邻数，可以为NULL
+ * @param [in]      struct img_par_s *par：线程池，可以为NULL
+ */
+void img_kdt_query(const struct img_kdt_s *kt, const float *qx, const float *qy, const float *qz, int m,
+                   int k, float r, int32_t *idx, float *dist, int32_t *cnt, struct img_par_s *par);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -0,0 +1,355 @@
+/**
+ * @file    img_normal.c
+ * @author  YRD
+ * @version 1.0
+ * @date    2026-10-18
+ * @brief   有序点云的法向量估计
+ * @details COV模式分三步，每步一次img_par_run：积分图逐行前缀和（按行分块）、逐列累加（按列分块）、
+ *          每个像素先算差分叉积法向量再用窗口协方差替换（按行分块）。
+ *          协方差矩阵最小特征值的特征向量用反迭代求解（从叉积法向量开始，乘伴随矩阵），不需要三角函数和开方以外的运算
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include "img_const.h"
+#include "img_normal.h"
+
+#define II_ROW          ((IMG_WID+1)*IMG_NORMAL_II)     // 积分图每行double数
+
+
+int img_normal_init(struct img_normal_s *ne, int mode, int r, float max_dz, struct img_pool_s *pool)
+{
+    memset(ne,0,sizeof(*ne));
+    if ((mode!=IMG_NORMAL_CROSS && mode!=IMG_NORMAL_COV) || r<1 || 2*r>=IMG_HGT)
+    {
+        fprintf(stderr,"img_normal: bad mode %d or radius %d\n",mode,r);
+        return -1;
+    }
+    ne->mode=mode;
+    ne->r=r;
+    ne->max_dz=max_dz;
+    ne->pool=pool;
+    if (mode==IMG_NORMAL_COV)
+    {
+        if ((ne->ii=(double *)img_pool_alloc(pool,sizeof(double)*II_ROW*(IMG_HGT+1)))==NULL)
+        {
+            fprintf(stderr,"img_normal: frame pool too small\n");
+            return -1;
+        }
+        memset(ne->ii,0,sizeof(double)*II_ROW);             // 第0行全为0
+    }
+    return 0;
+}
+
+
+void img_normal_release(struct img_normal_s *ne)
+{
+    if (ne->pool)
+        img_pool_release(ne->pool,ne->ii);
+    ne->ii=NULL;
+}
+
+
+// 多线程任务参数
+struct normal_arg_s
+{
+    struct img_normal_s *ne;
+    float       *nx,*ny,*nz,*curv;
+    const float *x,*y,*z;
+};
+
+
+// 差分叉积法向量，行[y0,y1)，差分距离r；邻点有效且和中心深度差不超过门限时权重为1，否则为0，
+// 两侧权重都为1时为中心差分，只有一侧为1时为单侧差分。
+// 每行先算到栈上的行缓存再拷贝到输出，输出和输入不会重叠，循环不需要别名检查就能向量化
+static void cross_rows(const struct normal_arg_s *a, int r, int y0, int y1)
+{
+    float bx[IMG_WID],by[IMG_WID],bz[IMG_WID];
+    float t=a->ne->max_dz>0 ? a->ne->max_dz : 1e30f;
+    int u,v,w=r*IMG_WID;
+
+    memset(bx,0,sizeof(bx));
+    memset(by,0,sizeof(by));
+    memset(bz,0,sizeof(bz));
+    for (v=y0;v<y1;v++)
+    {
+        const float *x=a->x+v*IMG_WID,*y=a->y+v*IMG_WID,*z=a->z+v*IMG_WID;
+
+        if (v<r || v>=IMG_HGT-r)
+        {
+            memset(a->nx+v*IMG_WID,0,sizeof(float)*IMG_WID);
+            memset(a->ny+v*IMG_WID,0,sizeof(float)*IMG_WID);
+            memset(a->nz+v*IMG_WID,0,sizeof(float)*IMG_WID);
+            continue;
+        }
+        for (u=r;u<IMG_WID-r;u++)                               // 左右r个像素保持为0
+        {
+            float zc=z[u],lim=t*zc;
+            float wl=(float)((z[u-r]>0) & (fabsf(z[u-r]-zc)<=lim));
+            float wr=(float)((z[u+r]>0) & (fabsf(z[u+r]-zc)<=lim));
+            float wu=(float)((z[u-w]>0) & (fabsf(z[u-w]-zc)<=lim));
+            float wd=(float)((z[u+w]>0) & (fabsf(z[u+w]-zc)<=lim));
+            float hx=wr*(x[u+r]-x[u])+wl*(x[u]-x[u-r]);
+            float hy=wr*(y[u+r]-y[u])+wl*(y[u]-y[u-r]);
+            float hz=wr*(z[u+r]-z[u])+wl*(z[u]-z[u-r]);
+            float gx=wd*(x[u+w]-x[u])+wu*(x[u]-x[u-w]);
+            float gy=wd*(y[u+w]-y[u])+wu*(y[u]-y[u-w]);
+            float gz=wd*(z[u+w]-z[u])+wu*(z[u]-z[u-w]);
+            float cx=hy*gz-hz*gy,cy=hz*gx-hx*gz,cz=hx*gy-hy*gx;
+            float len2=cx*cx+cy*cy+cz*cz;
+            float ok=(float)((zc>0) & (len2>0));
+            float sg=(cx*x[u]+cy*y[u]+cz*zc>0) ? -ok : ok;      // 朝向相机，无效时为0
+            float s=sg/sqrtf(len2*ok+(1-ok));                   // 无效时除以1，避免除0
+
+            bx[u]=cx*s;
+            by[u]=cy*s;
+            bz[u]=cz*s;
+        }
+        memcpy(a->nx+v*IMG_WID,bx,sizeof(bx));
+        memcpy(a->ny+v*IMG_WID,by,sizeof(by));
+        memcpy(a->nz+v*IMG_WID,bz,sizeof(bz));
+    }
+}
+
+
+// 积分图逐行前缀和：ii[v+1][u+1]=sum(第v行0~u像素)
+static void ii_row_task(void *arg, int i, int n)
+{
+    struct normal_arg_s *a=(struct normal_arg_s *)arg;
+    const float *x=a->x,*y=a->y,*z=a->z;
+    float t=a->ne->max_dz>0 ? a->ne->max_dz : 1e30f;
+    int y0,y1,u,v,k;
+
+    img_par_band(0,IMG_HGT,i,n,&y0,&y1);
+    for (v=y0;v<y1;v++)
+    {
+        double *R=a->ne->ii+(size_t)(v+1)*II_ROW,s[IMG_NORMAL_II];
+
+        memset(s,0,sizeof(s));
+        memset(R,0,sizeof(double)*IMG_NORMAL_II);
+        for (u=v*IMG_WID;u<(v+1)*IMG_WID;u++)
+        {
+            double px=x[u],py=y[u],pz=z[u];
+            int edge=0;
+
+            R+=IMG_NORMAL_II;
+            if (pz>0)
+            {
+                // 和右边、下边有效邻点的深度差超过门限时，该像素记为不连续
+                if (u%IMG_WID<IMG_WID-1 && z[u+1]>0 && fabsf(z[u+1]-z[u])>t*z[u])
+                    edge=1;
+                if (u<IMG_SZ-IMG_WID && z[u+IMG_WID]>0 && fabsf(z[u+IMG_WID]-z[u])>t*z[u])
+                    edge=1;
+                s[0]+=1;
+                s[1]+=px;    s[2]+=py;    s[3]+=pz;
+                s[4]+=px*px; s[5]+=px*py; s[6]+=px*pz;
+                s[7]+=py*py; s[8]+=py*pz; s[9]+=pz*pz;
+                s[10]+=edge;
+            }
+            for (k=0;k<IMG_NORMAL_II;k++)
+                R[k]=s[k];
+        }
+    }
+}
+
+
+// 积分图逐列累加：ii[v][u]+=ii[v-1][u]，按列分块
+static void ii_col_task(void *arg, int i, int n)
+{
+    struct normal_arg_s *a=(struct normal_arg_s *)arg;
+    int c0,c1,v,k;
+
+    img_par_band(0,II_ROW,i,n,&c0,&c1);
+    for (v=2;v<=IMG_HGT;v++)
+    {
+        double *R=a->ne->ii+(size_t)v*II_ROW,*P=R-II_ROW;
+        for (k=c0;k<c1;k++)
+            R[k]+=P[k];
+    }
+}
+
+
+// 对称矩阵c（xx,xy,xz,yy,yz,zz）最小特征值的单位特征向量和曲率，返回0成功，-1退化。
+// 从初始方向nv（叉积法向量）开始反迭代：v=adj(C)*v，相当于乘C的逆，每次误差缩小λ0/λ1倍，
+// 平面附近λ0远小于λ1，迭代IMG_NORMAL_ITER次就足够；最小特征值用瑞利商n'Cn
+static int eig_min(const double *c, double *nv, double *curv)
+{
+    double a00=c[3]*c[5]-c[4]*c[4],a01=c[2]*c[4]-c[1]*c[5],a02=c[1]*c[4]-c[2]*c[3];
+    double a11=c[0]*c[5]-c[2]*c[2],a12=c[1]*c[2]-c[0]*c[4],a22=c[0]*c[3]-c[1]*c[1];
+    double x=nv[0],y=nv[1],z=nv[2],d,l,tr=c[0]+c[3]+c[5];
+    int k;
+
+    // 伴随矩阵的元素约为λ1*λ2，迭代几次不会下溢，最后再归一化
+    for (k=0;k<IMG_NORMAL_ITER;k++)
+    {
+        double ux=a00*x+a01*y+a02*z,uy=a01*x+a11*y+a12*z,uz=a02*x+a12*y+a22*z;
+        x=ux; y=uy; z=uz;
+    }
+    d=x*x+y*y+z*z;
+    if (!(d>1e-300))
+        return -1;
+    d=1/sqrt(d);
+    x*=d; y*=d; z*=d;
+    l=x*(c[0]*x+c[1]*y+c[2]*z)+y*(c[1]*x+c[3]*y+c[4]*z)+z*(c[2]*x+c[4]*y+c[5]*z);
+    nv[0]=x; nv[1]=y; nv[2]=z;
+    *curv=(l>0 && tr>0) ? l/tr : 0;
+    return 0;
+}
+
+
+// 窗口协方差法向量，窗口内有不连续或有效点少于3个时保留叉积结果
+static void cov_rows(const struct normal_arg_s *a, int y0, int y1)
+{
+    const double *ii=a->ne->ii;
+    int r=a->ne->r,u,v,k;
+
+    for (v=y0;v<y1;v++)
+    {
+        int v0=v-r<0 ? 0 : v-r,v1=v+r+1>IMG_HGT ? IMG_HGT : v+r+1;
+        const double *T=ii+(size_t)v0*II_ROW,*B=ii+(size_t)v1*II_ROW;
+
+        for (u=0;u<IMG_WID;u++)
+        {
+            int i=v*IMG_WID+u,u0=u-r<0 ? 0 : u-r,u1=u+r+1>IMG_WID ? IMG_WID : u+r+1;
+            double s[IMG_NORMAL_II],c[6],nv[3],cv,w;
+
+            if (a->curv)
+                a->curv[i]=0;
+            if (!(a->z[i]>0))
+                continue;
+            for (k=0;k<IMG_NORMAL_II;k++)
+                s[k]=B[u1*IMG_NORMAL_II+k]-B[u0*IMG_NORMAL_II+k]-T[u1*IMG_NORMAL_II+k]+T[u0*IMG_NORMAL_II+k];
+            if (s[10]>0.5 || s[0]<2.5)
+                continue;
+            w=1/s[0];
+            s[1]*=w; s[2]*=w; s[3]*=w;
+            c[0]=s[4]*w-s[1]*s[1]; c[1]=s[5]*w-s[1]*s[2]; c[2]=s[6]*w-s[1]*s[3];
+            c[3]=s[7]*w-s[2]*s[2]; c[4]=s[8]*w-s[2]*s[3]; c[5]=s[9]*w-s[3]*s[3];
+            // 初始方向：叉积法向量，无效时用视线方向
+            nv[0]=a->nx[i]; nv[1]=a->ny[i]; nv[2]=a->nz[i];
+            if (nv[0]==0 && nv[1]==0 && nv[2]==0)
+            {
+                nv[0]=a->x[i]; nv[1]=a->y[i]; nv[2]=a->z[i];
+            }
+            if (eig_min(c,nv,&cv))
+                continue;
+            if (nv[0]*a->x[i]+nv[1]*a->y[i]+nv[2]*a->z[i]>0)
+            {
+                nv[0]=-nv[0]; nv[1]=-nv[1]; nv[2]=-nv[2];
+            }
+            a->nx[i]=(float)nv[0];
+            a->ny[i]=(float)nv[1];
+            a->nz[i]=(float)nv[2];
+            if (a->curv)
+                a->curv[i]=(float)cv;
+        }
+    }
+}
+
+
+static void normal_task(void *arg, int i, int n)
+{
+    struct normal_arg_s *a=(struct normal_arg_s *)arg;
+    int y0,y1;
+
+    img_par_band(0,IMG_HGT,i,n,&y0,&y1);
+    if (a->ne->mode==IMG_NORMAL_COV)
+    {
+        cross_rows(a,1,y0,y1);
+        cov_rows(a,y0,y1);
+    }
+    else
+    {
+        cross_rows(a,a->ne->r,y0,y1);
+        if (a->curv)
+            memset(a->curv+y0*IMG_WID,0,sizeof(float)*(y1-y0)*IMG_WID);
+    }
+}
+
+
+void img_normal_run(struct img_normal_s *ne, float *nx, float *ny, float *nz, float *curv,
+                    const float *x, const float *y, const float *z, struct img_par_s *par)
+{
+    struct normal_arg_s a;
+    int n_thr=img_par_threads(par);
+
+    a.ne=ne; a.nx=nx; a.ny=ny; a.nz=nz; a.curv=curv; a.x=x; a.y=y; a.z=z;
+    if (ne->mode==IMG_NORMAL_COV)
+    {
+        img_par_run(par,ii_row_task,&a,n_thr);
+        img_par_run(par,ii_col_task,&a,n_thr);
+    }
+    img_par_run(par,normal_task,&a,n_thr);
+}
+
+
+/*------------------------ 平面匹配滤波斜率转换为法向量 ------------------------*/
+
+// 多线程任务参数
+struct grad_arg_s
+{
+    const struct img_deproj_s *dp;
+    float       *nx,*ny,*nz;
+    const float *z,*gx,*gy;
+};
+
+
+// 点p(u,v)=z*r(u,v)，r=(rx,ry,1)；切向量dp/du=gx*r+z*dr/du，dp/dv=gy*r+z*dr/dv，
+// 射线的导数用射线表的中心差分（含畸变）；叉积为法向量。每行先算到栈上的行缓存再拷贝到输出
+static void grad_task(void *arg, int i, int n)
+{
+    struct grad_arg_s *a=(struct grad_arg_s *)arg;
+    float bx[IMG_WID],by[IMG_WID],bz[IMG_WID];
+    int y0,y1,u,v;
+
+    img_par_band(0,IMG_HGT,i,n,&y0,&y1);
+    memset(bx,0,sizeof(bx));
+    memset(by,0,sizeof(by));
+    memset(bz,0,sizeof(bz));
+    for (v=y0;v<y1;v++)
+    {
+        const float *rx=a->dp->rx+v*IMG_WID,*ry=a->dp->ry+v*IMG_WID;
+        const float *z=a->z+v*IMG_WID,*gx=a->gx+v*IMG_WID,*gy=a->gy+v*IMG_WID;
+
+        if (v<1 || v>=IMG_HGT-1)
+        {
+            memset(a->nx+v*IMG_WID,0,sizeof(float)*IMG_WID);
+            memset(a->ny+v*IMG_WID,0,sizeof(float)*IMG_WID);
+            memset(a->nz+v*IMG_WID,0,sizeof(float)*IMG_WID);
+            continue;
+        }
+        for (u=1;u<IMG_WID-1;u++)                               // 左右1个像素保持为0
+        {
+            float zc=z[u],h=0.5f*zc;
+            float hx=gx[u]*rx[u]+h*(rx[u+1]-rx[u-1]);
+            float hy=gx[u]*ry[u]+h*(ry[u+1]-ry[u-1]);
+            float hz=gx[u];
+            float tx=gy[u]*rx[u]+h*(rx[u+IMG_WID]-rx[u-IMG_WID]);
+            float ty=gy[u]*ry[u]+h*(ry[u+IMG_WID]-ry[u-IMG_WID]);
+            float tz=gy[u];
+            float cx=hy*tz-hz*ty,cy=hz*tx-hx*tz,cz=hx*ty-hy*tx;
+            float len2=cx*cx+cy*cy+cz*cz;
+            float ok=(float)((zc>0) & (len2>0));
+            float sg=(cx*rx[u]+cy*ry[u]+cz>0) ? -ok : ok;       // 朝向相机，无效时为0
+            float s=sg/sqrtf(len2*ok+(1-ok));                   // 无效时除以1，避免除0
+
+            bx[u]=cx*s;
+            by[u]=cy*s;
+            bz[u]=cz*s;
+        }
+        memcpy(a->nx+v*IMG_WID,bx,sizeof(bx));
+        memcpy(a->ny+v*IMG_WID,by,sizeof(by));
+        memcpy(a->nz+v*IMG_WID,bz,sizeof(bz));
+    }
+}
+
+
+void img_normal_grad(const struct img_deproj_s *dp, float *nx, float *ny, float *nz,
+                     const float *z, const float *gx, const float *gy, struct img_par_s *par)
+{
+    struct grad_arg_s a;
+
+    a.dp=dp; a.nx=nx; a.ny=ny; a.nz=nz; a.z=z; a.gx=gx; a.gy=gy;
+    img_par_run(par,grad_task,&a,img_par_threads(par));
+}
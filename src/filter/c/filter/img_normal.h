@@ -0,0 +1,93 @@
+/**
+ * @file    img_normal.h
+ * @author  YRD
+ * @version 1.0
+ * @date    2026-10-18
+ * @brief   有序点云（深度图反投影）的法向量估计
+ * @details 传感器点云按像素组织（img_deproj.h输出的x/y/z图像），像素邻域就是空间邻域，不需要KD树搜索近邻：
+ *          IMG_NORMAL_CROSS：左右、上下相距r的像素差分得到两个切向量，叉积为法向量；
+ *                            邻点深度和中心相差超过max_dz*z（深度不连续，物体边沿）时改用单侧差分，两侧都不连续时无效。
+ *                            循环无分支，可以被编译器向量化。
+ *          IMG_NORMAL_COV：  (2r+1)x(2r+1)窗口内有效点的协方差矩阵，最小特征值的特征向量为法向量，
+ *                            同时输出曲率λ0/(λ0+λ1+λ2)；窗口求和用积分图（double），每个像素的代价和窗口大小无关。
+ *                            窗口内有深度不连续时该像素退回CROSS模式的结果（曲率为0），避免跨越物体边沿平滑。
+ *          法向量为单位向量，方向朝向相机（n·p<0）；无效像素（深度为0、边沿r个像素内、邻点不足）输出(0,0,0)。
+ *          多线程时按行分块并行（积分图的列方向累加按列分块并行）。
+ *          img_normal_grad直接用平面匹配滤波（img_plane_mf_sqr3_ext_bat_mt）选出的平面斜率计算法向量，
+ *          不需要先反投影，也不需要邻域差分，每个像素只有一次叉积和开方
+*/
+
+#ifndef __IMG_NORMAL_H__
+#define __IMG_NORMAL_H__
+
+#include "img_pool.h"
+#include "img_par.h"
+#include "img_deproj.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define IMG_NORMAL_CROSS    0       ///< 差分叉积
+#define IMG_NORMAL_COV      1       ///< 积分图协方差
+#define IMG_NORMAL_II       11      ///< 积分图每个像素的累加量个数：点数、x/y/z、6个二阶矩、不连续像素数
+#define IMG_NORMAL_ITER     3       ///< COV模式求最小特征向量的反迭代次数
+
+/**
+ * @brief           法向量估计器
+ */
+struct img_normal_s
+{
+    int         mode;                       ///< IMG_NORMAL_CROSS或IMG_NORMAL_COV
+    int         r;                          ///< CROSS为差分距离，COV为窗口半径
+    float       max_dz;                     ///< 深度不连续门限（相对深度，例如0.05为深度的5%）
+    double     *ii;                         ///< 积分图，(IMG_HGT+1)*(IMG_WID+1)*IMG_NORMAL_II，只有COV模式使用
+    struct img_pool_s *pool;
+};
+
+/**
+ * @fn              int img_normal_init(struct img_normal_s *ne, int mode, int r, float max_dz, struct img_pool_s *pool)
+ * @brief           建立法向量估计器，COV模式的积分图从内存池分配（约IMG_SZ*88字节）
+ * @param [in]      int mode：IMG_NORMAL_CROSS或IMG_NORMAL_COV
+ * @param [in]      int r：CROSS为差分距离（通常1~2），COV为窗口半径（通常2~5）
+ * @param [in]      float max_dz：深度不连续门限（相对深度），<=0时不检查
+ * @retval          int：0成功，-1参数错误或内存不足（错误信息输出到stderr）
+ */
+int img_normal_init(struct img_normal_s *ne, int mode, int r, float max_dz, struct img_pool_s *pool);
+
+/**
+ * @fn              void img_normal_release(struct img_normal_s *ne)
+ * @brief           释放积分图（归还内存池）
+ */
+void img_normal_release(struct img_normal_s *ne);
+
+/**
+ * @fn              void img_normal_run(struct img_normal_s *ne, float *nx, float *ny, float *nz, float *curv,
+ *                                      const float *x, const float *y, const float *z, struct img_par_s *par)
+ * @brief           估计每个像素的法向量
+ * @param [in]      const float *x,*y,*z：有序点云，各IMG_SZ个float，z为0的像素无效
+ * @param [out]     float *nx,*ny,*nz：各IMG_SZ个float，存放单位法向量，无效像素为0
+ * @param [out]     float *curv：IMG_SZ个float，存放曲率（COV模式），可以为NULL
+ * @param [in]      struct img_par_s *par：线程池，可以为NULL
+ */
+void img_normal_run(struct img_normal_s *ne, float *nx, float *ny, float *nz, float *curv,
+                    const float *x, const float *y, const float *z, struct img_par_s *par);
+
+/**
+ * @fn              void img_normal_grad(const struct img_deproj_s *dp, float *nx, float *ny, float *nz,
+ *                                       const float *z, const float *gx, const float *gy, struct img_par_s *par)
+ * @brief           深度图和每个像素的深度斜率（平面匹配滤波的输出）转换为法向量图
+ * @param [in]      const struct img_deproj_s *dp：射线表（相机内参）
+ * @param [in]      const float *z：深度图（m），IMG_SZ个float，z为0的像素无效
+ * @param [in]      const float *gx,*gy：深度沿x（列）、y（行）方向的斜率（m/像素），各IMG_SZ个float
+ * @param [out]     float *nx,*ny,*nz：各IMG_SZ个float，存放单位法向量（朝向相机），无效像素和边沿1个像素为0；
+ *                  nx、ny可以和gx、gy相同（逐行计算完再写出）
+ * @param [in]      struct img_par_s *par：线程池，可以为NULL
+ */
+void img_normal_grad(const struct img_deproj_s *dp, float *nx, float *ny, float *nz,
+                     const float *z, const float *gx, const float *gy, struct img_par_s *par);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
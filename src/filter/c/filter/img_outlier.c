@@ -0,0 +1,232 @@
+/**
+ * @file    img_outlier.c
+ * @author  YRD
+ * @version 1.0
+ * @date    2026-10-18
+ * @brief   有序点云的离群点去除
+ * @details ROR一次img_par_run：每个像素数窗口内距离小于r的有效点。
+ *          SOR两次img_par_run：第一次算每个像素的平均近邻距离，同时按线程累加均值和平方和（double），
+ *          合并后求均值和标准差，第二次按z分数生成mask。
+ *          块内每个像素的k-1个最小距离平方按近邻序号分行存放在栈上（kb[j][i]），插入时逐行做一次min/max，
+ *          整块像素同时插入，没有数据相关的分支
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include "img_const.h"
+#include "img_outlier.h"
+
+#define BLK             IMG_OUTLIER_BLK
+#define FAR             1e30f           // 无效邻点的距离平方（用乘法代替条件赋值，循环可以向量化）
+
+
+// 多线程任务参数
+struct outlier_arg_s
+{
+    uint8_t     *mask;
+    float       *md;
+    const float *x,*y,*z;
+    int          w,k;
+    float        r2;                            // ROR半径的平方
+    float        mean,lim;                      // SOR平均距离的均值和允许的偏差
+    int          kept[IMG_PAR_THR_MAX];         // 各任务保留的点数
+    int          n_md[IMG_PAR_THR_MAX];         // 各任务平均距离有效的点数
+    double       s_md[IMG_PAR_THR_MAX][2];      // 各任务平均距离的和、平方和
+};
+
+
+static int check_arg(int w, int k, int k_min)
+{
+    if (w<1 || w>IMG_OUTLIER_W_MAX || 2*w>=IMG_HGT || k<k_min || k>IMG_OUTLIER_K_MAX || k>(2*w+1)*(2*w+1))
+    {
+        fprintf(stderr,"img_outlier: bad window radius %d or neighbour count %d\n",w,k);
+        return -1;
+    }
+    return 0;
+}
+
+
+// 第v行[u0,u0+nb)像素到偏移(dy,dx)后像素的距离平方，偏移后的像素无效时不小于FAR，
+// 偏移后超出左右边界的像素不计算，有邻点的块内范围为[*i0,*i1)；调用者保证第v+dy行在图像内
+static void blk_dist(const struct outlier_arg_s *a, float *d2, int v, int u0, int nb, int dy, int dx, int *i0, int *i1)
+{
+    const float *x=a->x+v*IMG_WID+u0,*y=a->y+v*IMG_WID+u0,*z=a->z+v*IMG_WID+u0;
+    int o=dy*IMG_WID+dx,b0=(u0+dx<0) ? -(u0+dx) : 0,b1=(u0+nb+dx>IMG_WID) ? IMG_WID-dx-u0 : nb,i;
+
+    for (i=b0;i<b1;i++)
+    {
+        float ex=x[i+o]-x[i],ey=y[i+o]-y[i],ez=z[i+o]-z[i],d=ex*ex+ey*ey+ez*ez;
+        d2[i]=d+FAR*(float)(z[i+o]<=0);
+    }
+    *i0=b0;
+    *i1=b1;
+}
+
+
+static void ror_task(void *arg, int t, int n)
+{
+    struct outlier_arg_s *a=(struct outlier_arg_s *)arg;
+    float d2[BLK],r2=a->r2;
+    int cnt[BLK],w=a->w,y0,y1,u0,v,dy,dx,i,i0,i1,kept=0;
+
+    img_par_band(0,IMG_HGT,t,n,&y0,&y1);
+    for (v=y0;v<y1;v++)
+        for (u0=0;u0<IMG_WID;u0+=BLK)
+        {
+            int nb=(IMG_WID-u0<BLK) ? IMG_WID-u0 : BLK,p=v*IMG_WID+u0;
+
+            memset(cnt,0,sizeof(cnt));
+            for (dy=-w;dy<=w;dy++)
+            {
+                if (v+dy<0 || v+dy>=IMG_HGT)
+                    continue;
+                for (dx=-w;dx<=w;dx++)
+                {
+                    if (dy==0 && dx==0)
+                        continue;
+                    blk_dist(a,d2,v,u0,nb,dy,dx,&i0,&i1);
+                    for (i=i0;i<i1;i++)
+                        cnt[i]+=(d2[i]<r2);
+                }
+            }
+            for (i=0;i<nb;i++)
+            {
+                int m=(a->z[p+i]>0) & (cnt[i]>=a->k-1);
+                a->mask[p+i]=(uint8_t)m;
+                kept+=m;
+            }
+        }
+    a->kept[t]=kept;
+}
+
+
+int img_outlier_ror(uint8_t *mask, const float *x, const float *y, const float *z,
+                    int w, int k, float r, struct img_par_s *par)
+{
+    struct outlier_arg_s a;
+    int n_thr=img_par_threads(par),i,kept=0;
+
+    if (check_arg(w,k,1))
+        return -1;
+    if (!(r>0))
+    {
+        fprintf(stderr,"img_outlier: bad radius %g\n",r);
+        return -1;
+    }
+    a.mask=mask; a.x=x; a.y=y; a.z=z; a.w=w; a.k=k; a.r2=r*r;
+    img_par_run(par,ror_task,&a,n_thr);
+    for (i=0;i<n_thr;i++)
+        kept+=a.kept[i];
+    return kept;
+}
+
+
+// 平均近邻距离：块内每个像素的k-1个最小距离平方升序存放在kb[j*BLK+i]，
+// 新的距离逐行和kb比较，小的留下、大的继续向后比较（插入排序展开为min/max）
+static void md_task(void *arg, int t, int n)
+{
+    struct outlier_arg_s *a=(struct outlier_arg_s *)arg;
+    float d2[BLK],acc[BLK],kb[(IMG_OUTLIER_K_MAX-1)*BLK],rk=1.0f/a->k;
+    int w=a->w,km=a->k-1,y0,y1,u0,v,dy,dx,i,j,i0,i1,n_md=0;
+    double s=0,ss=0;
+
+    img_par_band(0,IMG_HGT,t,n,&y0,&y1);
+    for (v=y0;v<y1;v++)
+        for (u0=0;u0<IMG_WID;u0+=BLK)
+        {
+            int nb=(IMG_WID-u0<BLK) ? IMG_WID-u0 : BLK,p=v*IMG_WID+u0;
+
+            for (i=0;i<km*BLK;i++)
+                kb[i]=FAR;
+            for (dy=-w;dy<=w;dy++)
+            {
+                if (v+dy<0 || v+dy>=IMG_HGT)
+                    continue;
+                for (dx=-w;dx<=w;dx++)
+                {
+                    if (dy==0 && dx==0)
+                        continue;
+                    blk_dist(a,d2,v,u0,nb,dy,dx,&i0,&i1);
+                    for (j=0;j<km;j++)
+                    {
+                        float *b=kb+j*BLK;
+                        for (i=i0;i<i1;i++)
+                        {
+                            float c=b[i],e=d2[i],lo=(c<e) ? c : e,hi=(c<e) ? e : c;
+                            b[i]=lo;                // 先算出两个结果再写，条件赋值才能向量化
+                            d2[i]=hi;
+                        }
+                    }
+                }
+            }
+            // 点自己的距离为0，只计入除数；第k-1个最小距离不小于FAR时窗口内近邻不足
+            memset(acc,0,sizeof(acc));
+            for (j=0;j<km;j++)
+                for (i=0;i<nb;i++)
+                    acc[i]+=sqrtf(kb[j*BLK+i]);
+            for (i=0;i<nb;i++)
+            {
+                // 无效像素和近邻不足的像素都没有平均距离，为INFINITY
+                int ok=(a->z[p+i]>0) && (kb[(km-1)*BLK+i]<FAR);
+                float m=ok ? acc[i]*rk : INFINITY;
+
+                a->md[p+i]=m;
+                if (ok)
+                {
+                    s+=m;
+                    ss+=(double)m*m;
+                    n_md++;
+                }
+            }
+        }
+    a->n_md[t]=n_md;
+    a->s_md[t][0]=s;
+    a->s_md[t][1]=ss;
+}
+
+
+static void sor_mask_task(void *arg, int t, int n)
+{
+    struct outlier_arg_s *a=(struct outlier_arg_s *)arg;
+    const float *z=a->z,*md=a->md;
+    float mean=a->mean,lim=a->lim;
+    int y0,y1,p,kept=0;
+
+    img_par_band(0,IMG_HGT,t,n,&y0,&y1);
+    for (p=y0*IMG_WID;p<y1*IMG_WID;p++)
+    {
+        int m=(z[p]>0) & (fabsf(md[p]-mean)<lim);
+        a->mask[p]=(uint8_t)m;
+        kept+=m;
+    }
+    a->kept[t]=kept;
+}
+
+
+int img_outlier_sor(uint8_t *mask, float *md, const float *x, const float *y, const float *z,
+                    int w, int k, float z_max, struct img_par_s *par)
+{
+    struct outlier_arg_s a;
+    int n_thr=img_par_threads(par),i,n_md=0,kept=0;
+    double s=0,ss=0,sd;
+
+    if (check_arg(w,k,2))
+        return -1;
+    a.mask=mask; a.md=md; a.x=x; a.y=y; a.z=z; a.w=w; a.k=k;
+    img_par_run(par,md_task,&a,n_thr);
+    for (i=0;i<n_thr;i++)
+    {
+        n_md+=a.n_md[i];
+        s+=a.s_md[i][0];
+        ss+=a.s_md[i][1];
+    }
+    // 和scipy.stats.zscore(ddof=1)一样，少于2个点或标准差为0时z分数无效，全部去除
+    sd=(n_md>1) ? sqrt(fmax(ss-s*s/n_md,0)/(n_md-1)) : 0;
+    a.mean=(n_md>0) ? (float)(s/n_md) : 0;
+    a.lim=(sd>0) ? (float)(z_max*sd) : -1.0f;
+    img_par_run(par,sor_mask_task,&a,n_thr);
+    for (i=0;i<n_thr;i++)
+        kept+=a.kept[i];
+    return kept;
+}
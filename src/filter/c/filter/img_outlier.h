@@ -0,0 +1,68 @@
+/**
+ * @file    img_outlier.h
+ * @author  YRD
+ * @version 1.0
+ * @date    2026-10-18
+ * @brief   有序点云的离群点去除（半径滤波ROR、统计滤波SOR）
+ * @details 代替src/ref/filters/kdtree.py的RadiusOutlierRemovalFilter和StatisticalOutlierRemovalFilter每帧建KD树、查询k近邻的做法：
+ *          传感器点云按像素组织（img_deproj.h输出的x/y/z图像），空间近邻在像素邻域内，
+ *          每个像素只在(2w+1)x(2w+1)窗口内找近邻，距离仍是三维欧氏距离，不需要建树。
+ *          近邻数k和KD树版本的含义相同，包括点自己（距离0），即窗口内再找k-1个最近的有效点：
+ *              ROR：k个近邻的距离都小于r时保留，等价于窗口内距离小于r的有效点不少于k-1个；
+ *              SOR：k个近邻的平均距离md，所有有效点的md求均值和标准差（ddof=1），|md-均值|<z_max*标准差时保留。
+ *          窗口内有效点不足k-1个的点视为离群点（SOR的md为INFINITY，不参加统计）；
+ *          k个近邻都在窗口内时结果和KD树版本相同，窗口半径应使邻域覆盖足够的点（通常w=2~3，k<=8）。
+ *          每行按IMG_OUTLIER_BLK个像素分块，对窗口内的每个偏移一次算出整块像素到偏移后像素的距离平方，
+ *          再用无分支的min/max插入每个像素各自有序的k-1个最小距离（按偏移、按近邻序号存放，沿像素方向连续），
+ *          循环都可以被编译器向量化；多线程时按行分块并行
+*/
+
+#ifndef __IMG_OUTLIER_H__
+#define __IMG_OUTLIER_H__
+
+#include <stdint.h>
+#include "img_par.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define IMG_OUTLIER_W_MAX   7       ///< 窗口半径上限
+#define IMG_OUTLIER_K_MAX   32      ///< 近邻数上限（含点自己）
+#define IMG_OUTLIER_BLK     64      ///< 每块像素数
+
+/**
+ * @fn              int img_outlier_ror(uint8_t *mask, const float *x, const float *y, const float *z,
+ *                                      int w, int k, float r, struct img_par_s *par)
+ * @brief           半径滤波：k个近邻（含点自己）都在半径r以内的点保留
+ * @param [out]     uint8_t *mask：IMG_SZ个uint8，保留为1，去除和无效像素为0
+ * @param [in]      const float *x,*y,*z：有序点云，各IMG_SZ个float，z为0的像素无效
+ * @param [in]      int w：窗口半径，1~IMG_OUTLIER_W_MAX
+ * @param [in]      int k：近邻数，1~IMG_OUTLIER_K_MAX，且不超过窗口像素数
+ * @param [in]      float r：半径（m）
+ * @param [in]      struct img_par_s *par：线程池，可以为NULL
+ * @retval          int：保留的点数，-1参数错误（错误信息输出到stderr）
+ */
+int img_outlier_ror(uint8_t *mask, const float *x, const float *y, const float *z,
+                    int w, int k, float r, struct img_par_s *par);
+
+/**
+ * @fn              int img_outlier_sor(uint8_t *mask, float *md, const float *x, const float *y, const float *z,
+ *                                      int w, int k, float z_max, struct img_par_s *par)
+ * @brief           统计滤波：k个近邻（含点自己）平均距离的z分数绝对值小于z_max的点保留
+ * @param [out]     uint8_t *mask：IMG_SZ个uint8，保留为1，去除和无效像素为0
+ * @param [out]     float *md：IMG_SZ个float，存放k个近邻的平均距离，无效像素和窗口内近邻不足的像素为INFINITY
+ * @param [in]      const float *x,*y,*z：有序点云，各IMG_SZ个float，z为0的像素无效
+ * @param [in]      int w：窗口半径，1~IMG_OUTLIER_W_MAX
+ * @param [in]      int k：近邻数，2~IMG_OUTLIER_K_MAX，且不超过窗口像素数
+ * @param [in]      float z_max：z分数上限
+ * @param [in]      struct img_par_s *par：线程池，可以为NULL
+ * @retval          int：保留的点数，-1参数错误（错误信息输出到stderr）
+ */
+int img_outlier_sor(uint8_t *mask, float *md, const float *x, const float *y, const float *z,
+                    int w, int k, float z_max, struct img_par_s *par);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
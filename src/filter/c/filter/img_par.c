@@ -0,0 +1,170 @@
+/**
+ * @file    img_par.c
+ * @author  YRD
+ * @version 1.0
+ * @date    2026-10-18
+ * @brief   图像处理并行执行（线程池）
+ * @details 使用pthread实现，每次img_par_run增加一次批次号(gen)唤醒工作线程
+*/
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "img_par.h"
+
+struct img_par_s
+{
+    int             n_thr;          // 线程总数（包括调用线程）
+    pthread_t       thr[IMG_PAR_THR_MAX];
+    pthread_mutex_t mtx;
+    pthread_cond_t  cv_start;
+    pthread_cond_t  cv_done;
+    unsigned        gen;            // 批次号
+    int             n_busy;         // 本批次尚未完成的工作线程数
+    int             quit;
+
+    img_par_fn_t    fn;             // 本批次的任务
+    void           *arg;
+    int             n;
+};
+
+struct img_par_thr_arg_s
+{
+    struct img_par_s *par;
+    int t;
+};
+
+
+static void par_exec(struct img_par_s *par, int t)
+{
+    int i;
+    for (i=t;i<par->n;i+=par->n_thr)
+        par->fn(par->arg,i,par->n);
+}
+
+
+static void *par_worker(void *p)
+{
+    struct img_par_thr_arg_s a=*(struct img_par_thr_arg_s *)p;
+    struct img_par_s *par=a.par;
+    unsigned gen=0;
+
+    free(p);
+    for (;;)
+    {
+        pthread_mutex_lock(&par->mtx);
+        while (par->gen==gen && !par->quit)
+            pthread_cond_wait(&par->cv_start,&par->mtx);
+        if (par->quit)
+        {
+            pthread_mutex_unlock(&par->mtx);
+            break;
+        }
+        gen=par->gen;
+        pthread_mutex_unlock(&par->mtx);
+
+        par_exec(par,a.t);
+
+        pthread_mutex_lock(&par->mtx);
+        if (--par->n_busy==0)
+            pthread_cond_signal(&par->cv_done);
+        pthread_mutex_unlock(&par->mtx);
+    }
+    return NULL;
+}
+
+
+struct img_par_s *img_par_create(int n_thr)
+{
+    struct img_par_s *par;
+    int t;
+
+    if (n_thr<=0)
+        n_thr=(int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (n_thr<1) n_thr=1;
+    if (n_thr>IMG_PAR_THR_MAX) n_thr=IMG_PAR_THR_MAX;
+
+    par=(struct img_par_s *)calloc(1,sizeof(*par));
+    if (par==NULL)
+        return NULL;
+    pthread_mutex_init(&par->mtx,NULL);
+    pthread_cond_init(&par->cv_start,NULL);
+    pthread_cond_init(&par->cv_done,NULL);
+
+    par->n_thr=1;
+    for (t=1;t<n_thr;t++)
+    {
+        struct img_par_thr_arg_s *a=(struct img_par_thr_arg_s *)malloc(sizeof(*a));
+        if (a==NULL)
+            break;
+        a->par=par;
+        a->t=t;
+        if (pthread_create(&par->thr[t],NULL,par_worker,a))
+        {
+            free(a);
+            break;
+        }
+        par->n_thr++;
+    }
+    return par;
+}
+
+
+void img_par_destroy(struct img_par_s *par)
+{
+    int t;
+
+    if (par==NULL)
+        return;
+    pthread_mutex_lock(&par->mtx);
+    par->quit=1;
+    pthread_cond_broadcast(&par->cv_start);
+    pthread_mutex_unlock(&par->mtx);
+    for (t=1;t<par->n_thr;t++)
+        pthread_join(par->thr[t],NULL);
+
+    pthread_mutex_destroy(&par->mtx);
+    pthread_cond_destroy(&par->cv_start);
+    pthread_cond_destroy(&par->cv_done);
+    free(par);
+}
+
+
+int img_par_threads(struct img_par_s *par)
+{
+    return par ? par->n_thr : 1;
+}
+
+
+void img_par_run(struct img_par_s *par, img_par_fn_t fn, void *arg, int n)
+{
+    int i;
+
+    if (par==NULL || par->n_thr==1 || n<=1)
+    {
+        for (i=0;i<n;i++)
+            fn(arg,i,n);
+        return;
+    }
+
+    pthread_mutex_lock(&par->mtx);
+    par->fn=fn;
+    par->arg=arg;
+    par->n=n;
+    par->n_busy=par->n_thr-1;
+    par->gen++;
+    pthread_cond_broadcast(&par->cv_start);
+    pthread_mutex_unlock(&par->mtx);
+
+    par_exec(par,0);
+
+    pthread_mutex_lock(&par->mtx);
+    while (par->n_busy)
+        pthread_cond_wait(&par->cv_done,&par->mtx);
+    pthread_mutex_unlock(&par->mtx);
+}
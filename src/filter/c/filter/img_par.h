@@ -0,0 +1,85 @@
+/**
+ * @file    img_par.h
+ * @author  YRD
+ * @version 1.0
+ * @date    2026-10-18
+ * @brief   图像处理并行执行（线程池）
+ * @details 线程池在启动时创建，工作线程常驻，每次调用img_par_run把n个任务（通常是图像的n个行块）
+ *          分配给各线程执行，调用线程也参与计算，全部任务完成后返回。
+ *          par为NULL时在调用线程中顺序执行，便于同一份代码兼顾单线程和多线程
+*/
+
+#ifndef __IMG_PAR_H__
+#define __IMG_PAR_H__
+
+#include <stdint.h>
+#include <time.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define IMG_PAR_THR_MAX     64      ///< 最多线程数
+
+/**
+ * @brief           任务函数，i为任务序号（0~n-1），n为任务总数
+ */
+typedef void (*img_par_fn_t)(void *arg, int i, int n);
+
+struct img_par_s;
+
+/**
+ * @fn              struct img_par_s *img_par_create(int n_thr)
+ * @brief           创建线程池
+ * @param [in]      int n_thr：线程总数（包括调用线程），<=0时使用CPU核数
+ * @retval          struct img_par_s *：线程池，失败时返回NULL
+ */
+struct img_par_s *img_par_create(int n_thr);
+
+/**
+ * @fn              void img_par_destroy(struct img_par_s *par)
+ * @brief           停止工作线程并释放线程池
+ */
+void img_par_destroy(struct img_par_s *par);
+
+/**
+ * @fn              int img_par_threads(struct img_par_s *par)
+ * @brief           线程池的线程总数，par为NULL时为1
+ */
+int img_par_threads(struct img_par_s *par);
+
+/**
+ * @fn              void img_par_run(struct img_par_s *par, img_par_fn_t fn, void *arg, int n)
+ * @brief           并行执行n个任务，第t个线程执行任务t, t+n_thr, t+2*n_thr...，全部完成后返回
+ * @param [in]      struct img_par_s *par：线程池，为NULL时顺序执行
+ * @param [in]      img_par_fn_t fn：任务函数
+ * @param [in]      void *arg：任务参数
+ * @param [in]      int n：任务总数
+ */
+void img_par_run(struct img_par_s *par, img_par_fn_t fn, void *arg, int n);
+
+/**
+ * @fn              void img_par_band(int y0, int y1, int i, int n, int *b0, int *b1)
+ * @brief           把行范围[y0,y1)均分为n块，计算第i块的行范围[*b0,*b1)
+ */
+static inline void img_par_band(int y0, int y1, int i, int n, int *b0, int *b1)
+{
+    *b0=y0+(y1-y0)*i/n;
+    *b1=y0+(y1-y0)*(i+1)/n;
+}
+
+/**
+ * @fn              uint64_t img_time_ns(void)
+ * @brief           单调时钟，单位ns
+ */
+static inline uint64_t img_time_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC,&ts);
+    return (uint64_t)ts.tv_sec*1000000000u+(uint64_t)ts.tv_nsec;
+}
+
+#ifdef __cplusplus
+}
+#endif
+#endif
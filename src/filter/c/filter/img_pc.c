@@ -0,0 +1,362 @@
+/**
+ * @file    img_pc.c
+ * @author  YRD
+ * @version 1.0
+ * @date    2026-10-18
+ * @brief   点云容器（列存储）
+ * @details 坐标和法向量各3列分配在一块内存中，列间距为cap；标量列和颜色列各自单独分配。
+ *          各操作逐列进行，每列一个简单循环；取子集用无分支的原地压缩（每个点都写，写位置按mask前进）
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "img_pc.h"
+#include "img_rigid.h"
+
+#ifdef WIN32
+#include <malloc.h>
+#endif
+
+#define COL_MAX         (6+IMG_PC_FIELD_MAX)                // float列最多列数
+#define CAP_ALIGN       (IMG_PC_ALIGN/(int)sizeof(float))   // 容量取整点数
+#define CAP_UP(n)       (((n)+CAP_ALIGN-1)/CAP_ALIGN*CAP_ALIGN)
+
+
+static void *col_alloc(size_t sz)
+{
+#ifdef WIN32
+    return _aligned_malloc(sz ? sz : IMG_PC_ALIGN,IMG_PC_ALIGN);
+#else
+    void *p;
+    return posix_memalign(&p,IMG_PC_ALIGN,sz ? sz : IMG_PC_ALIGN) ? NULL : p;
+#endif
+}
+
+static void col_free(void *p)
+{
+#ifdef WIN32
+    _aligned_free(p);
+#else
+    free(p);
+#endif
+}
+
+
+// 全部float列指针的地址（按cols和n_f，不看指针是否为NULL），返回列数
+static int float_cols(struct img_pc_s *pc, float **c[COL_MAX])
+{
+    int k=0,i;
+
+    c[k++]=&pc->x; c[k++]=&pc->y; c[k++]=&pc->z;
+    if (pc->cols&IMG_PC_NRM)
+    {
+        c[k++]=&pc->nx; c[k++]=&pc->ny; c[k++]=&pc->nz;
+    }
+    for (i=0;i<pc->n_f;i++)
+        c[k++]=&pc->f[i];
+    return k;
+}
+
+
+// 3列一组的前n个数移到新的内存块p（列间距cap），释放原来的块（块首地址为*c0）
+static void grp3_move(float *p, int cap, float **c0, float **c1, float **c2, int n)
+{
+    if (n)
+    {
+        memcpy(p,*c0,sizeof(float)*(size_t)n);
+        memcpy(p+cap,*c1,sizeof(float)*(size_t)n);
+        memcpy(p+2*(size_t)cap,*c2,sizeof(float)*(size_t)n);
+    }
+    col_free(*c0);
+    *c0=p;
+    *c1=p+cap;
+    *c2=p+2*(size_t)cap;
+}
+
+
+int img_pc_init(struct img_pc_s *pc, int n, int cols)
+{
+    memset(pc,0,sizeof(*pc));
+    pc->cols=cols&(IMG_PC_NRM|IMG_PC_RGB);
+    if (n<0 || img_pc_reserve(pc,n ? n : CAP_ALIGN) || img_pc_resize(pc,n))
+    {
+        img_pc_release(pc);
+        return -1;
+    }
+    return 0;
+}
+
+
+void img_pc_release(struct img_pc_s *pc)
+{
+    int i;
+
+    col_free(pc->x);
+    col_free(pc->nx);
+    col_free(pc->rgb);
+    for (i=0;i<pc->n_f;i++)
+        col_free(pc->f[i]);
+    pc->x=pc->y=pc->z=pc->nx=pc->ny=pc->nz=NULL;
+    pc->rgb=NULL;
+    pc->n=pc->cap=pc->n_f=0;
+}
+
+
+int img_pc_reserve(struct img_pc_s *pc, int cap)
+{
+    float *xyz,*nrm=NULL,*f[IMG_PC_FIELD_MAX];
+    uint8_t *rgb=NULL;
+    int n=pc->n,i,ok;
+
+    if (cap<=pc->cap)
+        return 0;
+    if (cap>INT32_MAX/3-CAP_ALIGN)
+        return -1;
+    cap=CAP_UP(cap);
+
+    // 先申请全部新块，失败时点云不变
+    ok=((xyz=(float *)col_alloc(3*sizeof(float)*(size_t)cap))!=NULL);
+    if (pc->cols&IMG_PC_NRM)
+        ok&=((nrm=(float *)col_alloc(3*sizeof(float)*(size_t)cap))!=NULL);
+    if (pc->cols&IMG_PC_RGB)
+        ok&=((rgb=(uint8_t *)col_alloc(3*(size_t)cap))!=NULL);
+    for (i=0;i<pc->n_f;i++)
+        ok&=((f[i]=(float *)col_alloc(sizeof(float)*(size_t)cap))!=NULL);
+    if (!ok)
+    {
+        col_free(xyz);
+        col_free(nrm);
+        col_free(rgb);
+        for (i=0;i<pc->n_f;i++)
+            col_free(f[i]);
+        return -1;
+    }
+
+    grp3_move(xyz,cap,&pc->x,&pc->y,&pc->z,n);
+    if (nrm)
+        grp3_move(nrm,cap,&pc->nx,&pc->ny,&pc->nz,n);
+    if (rgb)
+    {
+        if (n)
+            memcpy(rgb,pc->rgb,3*(size_t)n);
+        col_free(pc->rgb);
+        pc->rgb=rgb;
+    }
+    for (i=0;i<pc->n_f;i++)
+    {
+        if (n)
+            memcpy(f[i],pc->f[i],sizeof(float)*(size_t)n);
+        col_free(pc->f[i]);
+        pc->f[i]=f[i];
+    }
+    pc->cap=cap;
+    return 0;
+}
+
+
+int img_pc_resize(struct img_pc_s *pc, int n)
+{
+    float **c[COL_MAX];
+    int k,i;
+
+    if (n<0)
+        return -1;
+    // 逐步增大时按1.5倍扩容，避免每次都重新分配
+    if (n>pc->cap && img_pc_reserve(pc,(n-pc->cap<pc->cap/2 && pc->cap<INT32_MAX/2) ? pc->cap+pc->cap/2 : n))
+        return -1;
+    if (n>pc->n)
+    {
+        k=float_cols(pc,c);
+        for (i=0;i<k;i++)
+            memset(*c[i]+pc->n,0,sizeof(float)*(size_t)(n-pc->n));
+        if (pc->rgb)
+            memset(pc->rgb+3*(size_t)pc->n,0,3*(size_t)(n-pc->n));
+    }
+    pc->n=n;
+    return 0;
+}
+
+
+int img_pc_add_cols(struct img_pc_s *pc, int cols)
+{
+    float *nrm=NULL;
+    uint8_t *rgb=NULL;
+
+    cols&=(IMG_PC_NRM|IMG_PC_RGB)&~pc->cols;
+    if ((cols&IMG_PC_NRM) && (nrm=(float *)col_alloc(3*sizeof(float)*(size_t)pc->cap))==NULL)
+        return -1;
+    if ((cols&IMG_PC_RGB) && (rgb=(uint8_t *)col_alloc(3*(size_t)pc->cap))==NULL)
+    {
+        col_free(nrm);
+        return -1;
+    }
+
+    if (nrm)
+    {
+        pc->nx=nrm;
+        pc->ny=nrm+pc->cap;
+        pc->nz=nrm+2*(size_t)pc->cap;
+        memset(pc->nx,0,sizeof(float)*(size_t)pc->n);
+        memset(pc->ny,0,sizeof(float)*(size_t)pc->n);
+        memset(pc->nz,0,sizeof(float)*(size_t)pc->n);
+    }
+    if (rgb)
+    {
+        memset(rgb,0,3*(size_t)pc->n);
+        pc->rgb=rgb;
+    }
+    pc->cols|=cols;
+    return 0;
+}
+
+
+int img_pc_field(const struct img_pc_s *pc, const char *name)
+{
+    int i;
+
+    for (i=0;i<pc->n_f;i++)
+        if (strcmp(pc->f_name[i],name)==0)
+            return i;
+    return -1;
+}
+
+
+int img_pc_add_field(struct img_pc_s *pc, const char *name)
+{
+    size_t len=strlen(name);
+    int i=img_pc_field(pc,name);
+
+    if (i>=0)
+        return i;
+    if (len==0 || len>=IMG_PC_NAME_MAX)
+    {
+        fprintf(stderr,"img_pc: bad field name '%s'\n",name);
+        return -1;
+    }
+    if (pc->n_f>=IMG_PC_FIELD_MAX)
+    {
+        fprintf(stderr,"img_pc: more than %d fields\n",IMG_PC_FIELD_MAX);
+        return -1;
+    }
+    i=pc->n_f;
+    if ((pc->f[i]=(float *)col_alloc(sizeof(float)*(size_t)pc->cap))==NULL)
+        return -1;
+    memset(pc->f[i],0,sizeof(float)*(size_t)pc->n);
+    memcpy(pc->f_name[i],name,len+1);
+    pc->n_f++;
+    return i;
+}
+
+
+void img_pc_transform(struct img_pc_s *pc, const float *T)
+{
+    img_rigid_apply_pc(pc,T,NULL);
+}
+
+
+int img_pc_subset_mask(struct img_pc_s *pc, const uint8_t *mask)
+{
+    float **c[COL_MAX];
+    int k=float_cols(pc,c),n=pc->n,i,j=0,m;
+
+    // 写位置j不超过读位置i，原地压缩安全
+    for (m=0;m<k;m++)
+    {
+        float *p=*c[m];
+        for (i=j=0;i<n;i++)
+        {
+            p[j]=p[i];
+            j+=(mask[i]!=0);
+        }
+    }
+    if (pc->rgb)
+    {
+        uint8_t *p=pc->rgb;
+        for (i=j=0;i<n;i++)
+        {
+            p[3*j]=p[3*i]; p[3*j+1]=p[3*i+1]; p[3*j+2]=p[3*i+2];
+            j+=(mask[i]!=0);
+        }
+    }
+    pc->n=j;
+    return j;
+}
+
+
+int img_pc_subset_idx(struct img_pc_s *pc, const int32_t *idx, int m)
+{
+    float **c[COL_MAX],*tmp=NULL;
+    uint8_t *tmp_c=NULL;
+    int k=float_cols(pc,c),fwd=1,i,j;
+
+    if (m<0 || m>pc->n)
+        return -1;
+    for (i=0;i<m;i++)
+    {
+        if ((uint32_t)idx[i]>=(uint32_t)pc->n)
+            return -1;
+        fwd&=(idx[i]>=i);
+    }
+
+    // idx[i]>=i时第idx[i]个点在第i步之前没有被覆盖，可以原地前移；否则先取到临时缓冲区再拷回
+    if (!fwd && ((tmp=(float *)malloc(sizeof(float)*(size_t)(m ? m : 1)))==NULL
+                 || (pc->rgb && (tmp_c=(uint8_t *)malloc(3*(size_t)(m ? m : 1)))==NULL)))
+    {
+        free(tmp);
+        return -1;
+    }
+    for (j=0;j<k;j++)
+    {
+        float *p=*c[j],*d=fwd ? p : tmp;
+        for (i=0;i<m;i++)
+            d[i]=p[idx[i]];
+        if (!fwd)
+            memcpy(p,tmp,sizeof(float)*(size_t)m);
+    }
+    if (pc->rgb)
+    {
+        uint8_t *p=pc->rgb,*d=fwd ? p : tmp_c;
+        for (i=0;i<m;i++)
+        {
+            const uint8_t *s=p+3*(size_t)idx[i];
+            d[3*i]=s[0]; d[3*i+1]=s[1]; d[3*i+2]=s[2];
+        }
+        if (!fwd)
+            memcpy(p,tmp_c,3*(size_t)m);
+    }
+    free(tmp);
+    free(tmp_c);
+    pc->n=m;
+    return 0;
+}
+
+
+int img_pc_concat(struct img_pc_s *pc, const struct img_pc_s *src)
+{
+    int n0=pc->n,m=src->n,i;
+
+    // src就是pc时resize会更新src的列指针，拼接的点数在resize之前取出
+    if ((int64_t)n0+m>INT32_MAX || img_pc_resize(pc,n0+m))
+        return -1;
+
+    memcpy(pc->x+n0,src->x,sizeof(float)*(size_t)m);
+    memcpy(pc->y+n0,src->y,sizeof(float)*(size_t)m);
+    memcpy(pc->z+n0,src->z,sizeof(float)*(size_t)m);
+    if (pc->nx && src->nx)
+    {
+        memcpy(pc->nx+n0,src->nx,sizeof(float)*(size_t)m);
+        memcpy(pc->ny+n0,src->ny,sizeof(float)*(size_t)m);
+        memcpy(pc->nz+n0,src->nz,sizeof(float)*(size_t)m);
+    }
+    if (pc->rgb && src->rgb)
+        memcpy(pc->rgb+3*(size_t)n0,src->rgb,3*(size_t)m);
+    for (i=0;i<pc->n_f;i++)
+    {
+        int j=img_pc_field(src,pc->f_name[i]);
+        if (j>=0)
+            memcpy(pc->f[i]+n0,src->f[j],sizeof(float)*(size_t)m);
+    }
+    // 其余的列由resize填0
+    return 0;
+}
@@ -0,0 +1,135 @@
+/**
+ * @file    img_pc.h
+ * @author  YRD
+ * @version 1.0
+ * @date    2026-10-18
+ * @brief   点云容器（列存储）
+ * @details 各原生几何模块共用的点云数据布局，代替src/ref/points.py中每次运算都新建3xN数组的BagOfPoints/PointCloud：
+ *              坐标x/y/z、法向量nx/ny/nz和任意个命名的标量列（曲率、强度、残差等）各自是一段连续的float；
+ *              颜色是一列n*3个uint8（RGB交织，和img_proj.h/img_reg.h的颜色格式、彩色图像素格式相同）。
+ *          坐标3列、法向量3列各分配在一块内存中，列间距为容量cap（y=x+cap，z=x+2*cap），可以直接作为(3,n)的跨步数组使用，
+ *          n等于cap时就是img_proj.h等模块使用的连续x/y/z平面。
+ *          各块按IMG_PC_ALIGN字节对齐，容量按IMG_PC_ALIGN/sizeof(float)个点取整，每列的起点都对齐，
+ *          逐列循环可以直接向量化，尾部不需要单独处理对齐。
+ *          变换、取子集、拼接都在原地完成：取子集和变换不重新分配内存，列指针不变；
+ *          只有容量不够（reserve、resize、concat）时才重新分配，已有的列指针随之失效；增加列不影响已有的列。
+ *          点云大小不固定，列内存直接向系统申请（不经过img_pool.h的帧内存池）
+*/
+
+#ifndef __IMG_PC_H__
+#define __IMG_PC_H__
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define IMG_PC_ALIGN        64      ///< 列对齐字节数
+#define IMG_PC_FIELD_MAX    16      ///< 最多标量列数
+#define IMG_PC_NAME_MAX     16      ///< 标量列名最大长度（含结尾0）
+
+#define IMG_PC_NRM          0x01    ///< 有法向量列
+#define IMG_PC_RGB          0x02    ///< 有颜色列
+
+/**
+ * @brief           点云
+ */
+struct img_pc_s
+{
+    int         n;                                  ///< 点数
+    int         cap;                                ///< 容量（点数）
+    int         cols;                               ///< IMG_PC_NRM/IMG_PC_RGB的组合
+    float      *x,*y,*z;                            ///< 坐标（m），y=x+cap，z=x+2*cap
+    float      *nx,*ny,*nz;                         ///< 法向量，ny=nx+cap，nz=nx+2*cap，没有法向量列时为NULL
+    uint8_t    *rgb;                                ///< 颜色，n*3个uint8，没有颜色列时为NULL
+    int         n_f;                                ///< 标量列数
+    float      *f[IMG_PC_FIELD_MAX];                ///< 标量列
+    char        f_name[IMG_PC_FIELD_MAX][IMG_PC_NAME_MAX];  ///< 标量列名
+};
+
+/**
+ * @fn              int img_pc_init(struct img_pc_s *pc, int n, int cols)
+ * @brief           建立n个点的点云，各列清0
+ * @param [in]      int n：点数，可以为0
+ * @param [in]      int cols：IMG_PC_NRM/IMG_PC_RGB的组合，坐标列总是存在
+ * @retval          int：0成功，-1内存不足
+ */
+int img_pc_init(struct img_pc_s *pc, int n, int cols);
+
+/**
+ * @fn              void img_pc_release(struct img_pc_s *pc)
+ * @brief           释放全部列
+ */
+void img_pc_release(struct img_pc_s *pc);
+
+/**
+ * @fn              int img_pc_reserve(struct img_pc_s *pc, int cap)
+ * @brief           容量扩大到至少cap个点，已有的点不变；容量足够时什么也不做
+ * @retval          int：0成功，-1内存不足（点云不变）
+ */
+int img_pc_reserve(struct img_pc_s *pc, int cap);
+
+/**
+ * @fn              int img_pc_resize(struct img_pc_s *pc, int n)
+ * @brief           点数改为n，新增的点各列为0
+ * @retval          int：0成功，-1内存不足（点云不变）
+ */
+int img_pc_resize(struct img_pc_s *pc, int n);
+
+/**
+ * @fn              int img_pc_add_cols(struct img_pc_s *pc, int cols)
+ * @brief           增加法向量列或颜色列，新增的列为0，已有的列不变
+ * @retval          int：0成功，-1内存不足
+ */
+int img_pc_add_cols(struct img_pc_s *pc, int cols);
+
+/**
+ * @fn              int img_pc_field(const struct img_pc_s *pc, const char *name)
+ * @brief           按名字查找标量列
+ * @retval          int：列序号，-1没有该列
+ */
+int img_pc_field(const struct img_pc_s *pc, const char *name);
+
+/**
+ * @fn              int img_pc_add_field(struct img_pc_s *pc, const char *name)
+ * @brief           增加标量列，新增的列为0；已有同名的列时直接返回该列
+ * @retval          int：列序号，-1列名无效、列数超过IMG_PC_FIELD_MAX或内存不足
+ */
+int img_pc_add_field(struct img_pc_s *pc, const char *name);
+
+/**
+ * @fn              void img_pc_transform(struct img_pc_s *pc, const float *T)
+ * @brief           原地刚体变换：坐标p=R*p+t，法向量n=R*n（单线程，多线程见img_rigid.h的img_rigid_apply_pc）
+ * @param [in]      const float *T：4x4变换矩阵（行优先，16个float），只使用前3行
+ */
+void img_pc_transform(struct img_pc_s *pc, const float *T);
+
+/**
+ * @fn              int img_pc_subset_mask(struct img_pc_s *pc, const uint8_t *mask)
+ * @brief           原地保留mask不为0的点，顺序不变
+ * @param [in]      const uint8_t *mask：n个uint8
+ * @retval          int：保留的点数
+ */
+int img_pc_subset_mask(struct img_pc_s *pc, const uint8_t *mask);
+
+/**
+ * @fn              int img_pc_subset_idx(struct img_pc_s *pc, const int32_t *idx, int m)
+ * @brief           原地取子集，第i个点为原来的第idx[i]个点；idx[i]>=i（例如idx递增）时逐列前移，否则经过临时缓冲区
+ * @param [in]      const int32_t *idx：m个序号，范围[0,n)，可以重复
+ * @retval          int：0成功，-1序号超出范围或m大于n（点云不变）
+ */
+int img_pc_subset_idx(struct img_pc_s *pc, const int32_t *idx, int m);
+
+/**
+ * @fn              int img_pc_concat(struct img_pc_s *pc, const struct img_pc_s *src)
+ * @brief           src的点拼接到pc后面，pc的列不变：src没有的列填0，src多出的列忽略，标量列按名字对应
+ * @param [in]      const struct img_pc_s *src：可以就是pc
+ * @retval          int：0成功，-1内存不足（点云不变）
+ */
+int img_pc_concat(struct img_pc_s *pc, const struct img_pc_s *src);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -0,0 +1,129 @@
+/**
+ * @file    img_perf.c
+ * @author  YRD
+ * @version 1.0
+ * @date    2026-10-18
+ * @brief   硬件性能计数器
+ * @details 计数器以时钟周期为组长，一次read读出整组，开始和结束各一次系统调用
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include "img_perf.h"
+
+#ifdef __linux__
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+static int perf_open(uint32_t type, uint64_t config, int group)
+{
+    struct perf_event_attr attr;
+
+    memset(&attr,0,sizeof(attr));
+    attr.size          =sizeof(attr);
+    attr.type          =type;
+    attr.config        =config;
+    attr.disabled      =(group==-1);
+    attr.exclude_kernel=1;
+    attr.exclude_hv    =1;
+    attr.read_format   =PERF_FORMAT_GROUP;
+    return (int)syscall(__NR_perf_event_open,&attr,0,-1,group,0);
+}
+
+#define CACHE_CFG(c,op,res) ((c)|((op)<<8)|((res)<<16))
+#endif
+
+
+int img_perf_open(struct img_perf_s *pf)
+{
+    int i;
+
+    memset(pf,0,sizeof(*pf));
+    for (i=0;i<IMG_PERF_N;i++)
+        pf->fd[i]=-1;
+
+#ifdef __linux__
+    pf->fd[IMG_PERF_CYC]=perf_open(PERF_TYPE_HARDWARE,PERF_COUNT_HW_CPU_CYCLES,-1);
+    if (pf->fd[IMG_PERF_CYC]<0)
+        return -1;
+    pf->idx[IMG_PERF_CYC]=pf->n++;
+
+    pf->fd[IMG_PERF_INS]=perf_open(PERF_TYPE_HARDWARE,PERF_COUNT_HW_INSTRUCTIONS,pf->fd[0]);
+    pf->fd[IMG_PERF_L1D]=perf_open(PERF_TYPE_HW_CACHE,
+                                   CACHE_CFG(PERF_COUNT_HW_CACHE_L1D,PERF_COUNT_HW_CACHE_OP_READ,PERF_COUNT_HW_CACHE_RESULT_MISS),pf->fd[0]);
+    pf->fd[IMG_PERF_LLC]=perf_open(PERF_TYPE_HARDWARE,PERF_COUNT_HW_CACHE_MISSES,pf->fd[0]);
+    pf->fd[IMG_PERF_BRM]=perf_open(PERF_TYPE_HARDWARE,PERF_COUNT_HW_BRANCH_MISSES,pf->fd[0]);
+    for (i=1;i<IMG_PERF_N;i++)
+        if (pf->fd[i]>=0)
+            pf->idx[i]=pf->n++;
+
+    ioctl(pf->fd[0],PERF_EVENT_IOC_RESET ,PERF_IOC_FLAG_GROUP);
+    ioctl(pf->fd[0],PERF_EVENT_IOC_ENABLE,PERF_IOC_FLAG_GROUP);
+    return 0;
+#else
+    return -1;
+#endif
+}
+
+
+void img_perf_close(struct img_perf_s *pf)
+{
+#ifdef __linux__
+    int i;
+    for (i=IMG_PERF_N-1;i>=0 && pf->n;i--)
+        if (pf->fd[i]>=0)
+            close(pf->fd[i]);
+#endif
+    memset(pf,0,sizeof(*pf));
+}
+
+
+// 读出整组计数值，格式为{n, v[0], ..., v[n-1]}
+static int perf_read(struct img_perf_s *pf, uint64_t *v)
+{
+#ifdef __linux__
+    uint64_t buf[1+IMG_PERF_N];
+    int i;
+
+    if (pf->n==0 || read(pf->fd[0],buf,sizeof(buf))<(ssize_t)(sizeof(uint64_t)*(1+pf->n)))
+        return -1;
+    for (i=0;i<IMG_PERF_N;i++)
+        v[i]=pf->fd[i]>=0 ? buf[1+pf->idx[i]] : 0;
+    return 0;
+#else
+    (void)pf; (void)v;
+    return -1;
+#endif
+}
+
+
+void img_perf_start(struct img_perf_s *pf)
+{
+    perf_read(pf,pf->v0);
+}
+
+
+void img_perf_stop(struct img_perf_s *pf, struct img_perf_cnt_s *cnt)
+{
+    uint64_t v[IMG_PERF_N];
+    int i;
+
+    if (perf_read(pf,v))
+        return;
+    for (i=0;i<IMG_PERF_N;i++)
+        cnt->v[i]+=v[i]-pf->v0[i];
+    cnt->n++;
+}
+
+
+void img_perf_derive(struct img_perf_cnt_s *cnt, double n_pix, double *ipc, double *l1d, double *llc, double *brm, double *bpp)
+{
+    if (n_pix<=0) n_pix=1;
+    *ipc=cnt->v[IMG_PERF_CYC] ? (double)cnt->v[IMG_PERF_INS]/cnt->v[IMG_PERF_CYC] : 0;
+    *l1d=cnt->v[IMG_PERF_L1D]/n_pix;
+    *llc=cnt->v[IMG_PERF_LLC]/n_pix;
+    *brm=cnt->v[IMG_PERF_BRM]/n_pix;
+    *bpp=*llc*64;
+}
@@ -0,0 +1,95 @@
+/**
+ * @file    img_perf.h
+ * @author  YRD
+ * @version 1.0
+ * @date    2026-10-18
+ * @brief   硬件性能计数器
+ * @details 用Linux perf_event_open打开一组计数器（时钟周期、指令、L1D读缺失、LLC缺失、分支预测失败），
+ *          在被测代码前后各读一次，累计差值，用于判断滤波器是受计算、缓存还是分支预测限制：
+ *              IPC=指令/周期，每像素LLC缺失*64近似为每像素的内存流量(bytes/pixel)。
+ *          计数器只统计调用线程（线程池中其他线程的计算不计入）。
+ *          打开失败（非Linux、perf_event_paranoid限制、虚拟机不支持）时img_perf_open返回-1，其余函数不做任何事，
+ *          单个计数器不支持时该项为0
+*/
+
+#ifndef __IMG_PERF_H__
+#define __IMG_PERF_H__
+
+#include <stdio.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/// 计数器
+enum
+{
+    IMG_PERF_CYC,                   ///< 时钟周期
+    IMG_PERF_INS,                   ///< 指令
+    IMG_PERF_L1D,                   ///< L1数据缓存读缺失
+    IMG_PERF_LLC,                   ///< 最后一级缓存缺失
+    IMG_PERF_BRM,                   ///< 分支预测失败
+    IMG_PERF_N
+};
+
+/**
+ * @brief           计数器组
+ */
+struct img_perf_s
+{
+    int         fd[IMG_PERF_N];     ///< 文件描述符，-1表示不支持
+    int         idx[IMG_PERF_N];    ///< 在组读取结果中的位置
+    int         n;                  ///< 打开的计数器数，0表示未打开
+    uint64_t    v0[IMG_PERF_N];     ///< 开始时的计数值
+};
+
+/**
+ * @brief           累计的计数值
+ */
+struct img_perf_cnt_s
+{
+    uint64_t    v[IMG_PERF_N];
+    uint64_t    n;                  ///< 累计次数
+};
+
+/**
+ * @fn              int img_perf_open(struct img_perf_s *pf)
+ * @brief           为调用线程打开计数器组
+ * @retval          int：0成功，-1不支持（pf仍可传给其他函数）
+ */
+int img_perf_open(struct img_perf_s *pf);
+
+/**
+ * @fn              void img_perf_close(struct img_perf_s *pf)
+ * @brief           关闭计数器组，未打开（n为0）时不做任何事
+ */
+void img_perf_close(struct img_perf_s *pf);
+
+/**
+ * @fn              void img_perf_start(struct img_perf_s *pf)
+ * @brief           记录开始时的计数值
+ */
+void img_perf_start(struct img_perf_s *pf);
+
+/**
+ * @fn              void img_perf_stop(struct img_perf_s *pf, struct img_perf_cnt_s *cnt)
+ * @brief           把从img_perf_start开始的计数增量累加到cnt
+ */
+void img_perf_stop(struct img_perf_s *pf, struct img_perf_cnt_s *cnt);
+
+/**
+ * @fn              void img_perf_derive(struct img_perf_cnt_s *cnt, double n_pix, double *ipc, double *l1d, double *llc, double *brm, double *bpp)
+ * @brief           计算派生指标
+ * @param [in]      struct img_perf_cnt_s *cnt：累计计数值
+ * @param [in]      double n_pix：累计期间处理的像素数
+ * @param [out]     double *ipc：每周期指令数
+ * @param [out]     double *l1d,*llc,*brm：每像素L1D缺失、LLC缺失、分支预测失败次数
+ * @param [out]     double *bpp：每像素内存流量（LLC缺失*64字节）
+ */
+void img_perf_derive(struct img_perf_cnt_s *cnt, double n_pix, double *ipc, double *l1d, double *llc, double *brm, double *bpp);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -0,0 +1,272 @@
+/**
+ * @file    img_pool.c
+ * @author  YRD
+ * @version 1.0
+ * @date    2026-10-18
+ * @brief   图像帧内存池
+ * @details 每个数据块前面有一个IMG_POOL_ALIGN字节的块头，记录所属尺寸类，
+ *          这样数据块本身仍然是对齐的，释放时不需要传入大小
+*/
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "img_const.h"
+#include "img_pool.h"
+
+#ifdef WIN32
+#include <malloc.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#else
+#include <unistd.h>
+#include <sys/mman.h>
+#endif
+
+#define IMG_POOL_MAGIC      0x504f4f4cu     // "POOL"
+#define IMG_POOL_HUGE_SZ    (2u<<20)        // 大页大小
+
+// 块头
+struct img_pool_blk_s
+{
+    uint32_t magic;
+    int32_t  cls;               // 尺寸类序号
+    void    *next;              // 空闲时指向下一个空闲块（数据块地址）
+};
+
+#define BLK_HDR(p)          ((struct img_pool_blk_s *)((uint8_t *)(p)-IMG_POOL_ALIGN))
+#define ALIGN_UP(x,a)       (((x)+(a)-1)/(a)*(a))
+
+
+// MSVC没有GCC的__sync原子操作，用Interlocked函数（MinGW两种都有，仍用__sync）
+#ifdef _MSC_VER
+static void pool_lock(struct img_pool_s *pool)
+{
+    while (_InterlockedExchange((volatile long *)&pool->lock,1))
+        while (pool->lock)
+            ;
+}
+
+static void pool_unlock(struct img_pool_s *pool)
+{
+    _InterlockedExchange((volatile long *)&pool->lock,0);
+}
+#else
+static void pool_lock(struct img_pool_s *pool)
+{
+    while (__sync_lock_test_and_set(&pool->lock,1))
+        while (pool->lock)
+            ;
+}
+
+static void pool_unlock(struct img_pool_s *pool)
+{
+    __sync_lock_release(&pool->lock);
+}
+#endif
+
+
+int img_pool_init(struct img_pool_s *pool, size_t size, int flags)
+{
+    memset(pool,0,sizeof(*pool));
+    pool->flags=flags;
+    size=ALIGN_UP(size,IMG_POOL_ALIGN);
+
+#ifdef WIN32
+    pool->base=(uint8_t *)_aligned_malloc(size,IMG_POOL_ALIGN);
+    if (pool->base==NULL)
+        return -1;
+#else
+    {
+        void *p=MAP_FAILED;
+        int mflags=MAP_PRIVATE|MAP_ANONYMOUS;
+
+#ifdef MAP_POPULATE
+        if (flags&IMG_POOL_PREFAULT)
+            mflags|=MAP_POPULATE;
+#endif
+#ifdef MAP_HUGETLB
+        if (flags&IMG_POOL_HUGE)
+        {
+            size_t hsz=ALIGN_UP(size,IMG_POOL_HUGE_SZ);
+            p=mmap(NULL,hsz,PROT_READ|PROT_WRITE,mflags|MAP_HUGETLB,-1,0);
+            if (p!=MAP_FAILED)
+            {
+                size=hsz;
+                pool->huge=1;
+            }
+        }
+#endif
+        if (p==MAP_FAILED)
+        {
+            p=mmap(NULL,size,PROT_READ|PROT_WRITE,mflags,-1,0);
+            if (p==MAP_FAILED)
+                return -1;
+#ifdef MADV_HUGEPAGE
+            // 没有预留大页时，建议内核使用透明大页
+            if (flags&IMG_POOL_HUGE)
+                madvise(p,size,MADV_HUGEPAGE);
+#endif
+        }
+        pool->base=(uint8_t *)p;
+    }
+#endif
+    pool->size=size;
+
+    // MAP_POPULATE不保证写时复制的页已经分配，逐页写一次确保没有缺页
+    if (flags&IMG_POOL_PREFAULT)
+    {
+        size_t i;
+        for (i=0;i<size;i+=4096)
+            pool->base[i]=0;
+    }
+
+#ifndef WIN32
+    if (flags&IMG_POOL_LOCK)
+        pool->locked=(mlock(pool->base,size)==0);
+#endif
+
+    return 0;
+}
+
+
+void img_pool_destroy(struct img_pool_s *pool)
+{
+    if (pool->base==NULL)
+        return;
+#ifdef WIN32
+    _aligned_free(pool->base);
+#else
+    if (pool->locked)
+        munlock(pool->base,pool->size);
+    munmap(pool->base,pool->size);
+#endif
+    memset(pool,0,sizeof(*pool));
+}
+
+
+// 查找（或新建）尺寸类，需在锁内调用
+static int pool_class(struct img_pool_s *pool, size_t sz)
+{
+    int i;
+    for (i=0;i<pool->n_cls;i++)
+        if (pool->cls[i].sz==sz)
+            return i;
+    if (pool->n_cls>=IMG_POOL_CLASS_MAX)
+        return -1;
+    pool->cls[i].sz=sz;
+    pool->n_cls++;
+    return i;
+}
+
+
+// 从剩余空间划分一个数据块，需在锁内调用
+static void *pool_carve(struct img_pool_s *pool, int c)
+{
+    size_t need=IMG_POOL_ALIGN+pool->cls[c].sz;
+    struct img_pool_blk_s *h;
+
+    if (pool->used+need>pool->size)
+        return NULL;
+
+    h=(struct img_pool_blk_s *)(pool->base+pool->used);
+    h->magic=IMG_POOL_MAGIC;
+    h->cls=c;
+    h->next=NULL;
+    pool->used+=need;
+    return (uint8_t *)h+IMG_POOL_ALIGN;
+}
+
+
+int img_pool_reserve(struct img_pool_s *pool, size_t sz, int n)
+{
+    int c,i=0;
+    void *p;
+
+    sz=ALIGN_UP(sz,IMG_POOL_ALIGN);
+
+    pool_lock(pool);
+    c=pool_class(pool,sz);
+    if (c>=0)
+    {
+        for (;i<n;i++)
+        {
+            p=pool_carve(pool,c);
+            if (p==NULL)
+                break;
+            BLK_HDR(p)->next=pool->cls[c].free;
+            pool->cls[c].free=p;
+            pool->cls[c].n_free++;
+        }
+    }
+    pool_unlock(pool);
+
+    return i;
+}
+
+
+void *img_pool_alloc(struct img_pool_s *pool, size_t sz)
+{
+    int c;
+    void *p=NULL;
+
+    sz=ALIGN_UP(sz,IMG_POOL_ALIGN);
+
+    pool_lock(pool);
+    pool->n_alloc++;
+    c=pool_class(pool,sz);
+    if (c>=0)
+    {
+        p=pool->cls[c].free;
+        if (p)
+        {
+            pool->cls[c].free=BLK_HDR(p)->next;
+            pool->cls[c].n_free--;
+            pool->n_reuse++;
+        }
+        else
+            p=pool_carve(pool,c);
+
+        if (p)
+            pool->cls[c].n_used++;
+    }
+    if (p==NULL)
+        pool->n_fail++;
+    pool_unlock(pool);
+
+    return p;
+}
+
+
+void img_pool_release(struct img_pool_s *pool, void *p)
+{
+    struct img_pool_blk_s *h;
+
+    if (p==NULL)
+        return;
+
+    h=BLK_HDR(p);
+    if (h->magic!=IMG_POOL_MAGIC || h->cls<0 || h->cls>=pool->n_cls)
+    {
+        fprintf(stderr,"img_pool_release: invalid block %p\n",p);
+        return;
+    }
+
+    pool_lock(pool);
+    h->next=pool->cls[h->cls].free;
+    pool->cls[h->cls].free=p;
+    pool->cls[h->cls].n_free++;
+    pool->cls[h->cls].n_used--;
+    pool_unlock(pool);
+}
+
+
+float *img_pool_alloc_img(struct img_pool_s *pool, int n)
+{
+    return (float *)img_pool_alloc(pool,sizeof(float)*IMG_SZ*n);
+}
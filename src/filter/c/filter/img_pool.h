@@ -0,0 +1,122 @@
+/**
+ * @file    img_pool.h
+ * @author  YRD
+ * @version 1.0
+ * @date    2026-10-18
+ * @brief   图像帧内存池
+ * @details 滤波器使用的历史图像(img_buf)、IIR状态和中间结果都从内存池分配：
+ *          1). 启动时一次性申请整块内存（可选大页），预先触发缺页并用mlock锁定，避免运行中的缺页中断；
+ *          2). 所有数据块按64字节对齐，满足SIMD加载和cache line对齐要求；
+ *          3). 相同大小的数据块归为同一尺寸类，释放后进入该类的空闲链表，被后续各处理环节重复使用。
+ *          稳态运行时不再调用malloc，也不产生缺页。
+*/
+
+#ifndef __IMG_POOL_H__
+#define __IMG_POOL_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define IMG_POOL_ALIGN      64      ///< 数据块对齐字节数
+#define IMG_POOL_CLASS_MAX  16      ///< 最多尺寸类数
+
+#define IMG_POOL_HUGE       0x01    ///< 使用大页（失败时退回普通页并建议内核使用透明大页）
+#define IMG_POOL_PREFAULT   0x02    ///< 初始化时预先触发缺页
+#define IMG_POOL_LOCK       0x04    ///< 初始化时用mlock锁定内存，防止被换出
+
+/**
+ * @brief           尺寸类，同一类的数据块大小相同
+ */
+struct img_pool_class_s
+{
+    size_t  sz;         ///< 数据块大小（字节，不含块头，已按IMG_POOL_ALIGN取整）
+    void   *free;       ///< 空闲链表
+    int     n_used;     ///< 正在使用的块数
+    int     n_free;     ///< 空闲块数
+};
+
+/**
+ * @brief           内存池
+ */
+struct img_pool_s
+{
+    uint8_t *base;      ///< 内存池起始地址
+    size_t   size;      ///< 内存池大小（字节）
+    size_t   used;      ///< 已经划分出去的大小（字节）
+    int      flags;     ///< 初始化标志，IMG_POOL_xxx
+    int      huge;      ///< 实际使用了大页
+    int      locked;    ///< 实际锁定了内存
+
+    struct img_pool_class_s cls[IMG_POOL_CLASS_MAX];
+    int      n_cls;     ///< 尺寸类数
+
+    uint64_t n_alloc;   ///< 分配次数
+    uint64_t n_reuse;   ///< 从空闲链表分配的次数
+    uint64_t n_fail;    ///< 分配失败次数
+
+    volatile int lock;  ///< 自旋锁（内部使用），分配和释放只在锁内修改链表，持锁时间很短
+};
+
+/**
+ * @fn              int img_pool_init(struct img_pool_s *pool, size_t size, int flags)
+ * @brief           内存池初始化，申请size字节内存
+ * @param [inout]   struct img_pool_s *pool：内存池
+ * @param [in]      size_t size：内存池大小（字节）
+ * @param [in]      int flags：IMG_POOL_HUGE/IMG_POOL_PREFAULT/IMG_POOL_LOCK的组合
+ *                  大页或mlock失败时不影响初始化结果，可通过pool->huge和pool->locked检查
+ * @retval          int：0成功，-1失败
+ */
+int img_pool_init(struct img_pool_s *pool, size_t size, int flags);
+
+/**
+ * @fn              void img_pool_destroy(struct img_pool_s *pool)
+ * @brief           释放内存池的全部内存
+ * @param [inout]   struct img_pool_s *pool：内存池
+ */
+void img_pool_destroy(struct img_pool_s *pool);
+
+/**
+ * @fn              int img_pool_reserve(struct img_pool_s *pool, size_t sz, int n)
+ * @brief           预先划分n个大小为sz的数据块放入空闲链表，启动时调用，保证稳态运行时的分配都能重用
+ * @param [inout]   struct img_pool_s *pool：内存池
+ * @param [in]      size_t sz：数据块大小（字节）
+ * @param [in]      int n：数据块个数
+ * @retval          int：实际划分的块数
+ */
+int img_pool_reserve(struct img_pool_s *pool, size_t sz, int n);
+
+/**
+ * @fn              void *img_pool_alloc(struct img_pool_s *pool, size_t sz)
+ * @brief           从内存池分配一个数据块，起始地址按IMG_POOL_ALIGN对齐
+ *                  优先使用同一尺寸类的空闲块，没有空闲块时从内存池剩余空间划分
+ * @param [inout]   struct img_pool_s *pool：内存池
+ * @param [in]      size_t sz：数据块大小（字节）
+ * @retval          void *：数据块地址，内存池空间不足或尺寸类已满时返回NULL
+ */
+void *img_pool_alloc(struct img_pool_s *pool, size_t sz);
+
+/**
+ * @fn              void img_pool_release(struct img_pool_s *pool, void *p)
+ * @brief           释放数据块，放回其尺寸类的空闲链表
+ * @param [inout]   struct img_pool_s *pool：内存池
+ * @param [in]      void *p：img_pool_alloc返回的数据块地址，可以为NULL
+ */
+void img_pool_release(struct img_pool_s *pool, void *p);
+
+/**
+ * @fn              float *img_pool_alloc_img(struct img_pool_s *pool, int n)
+ * @brief           分配n帧连续存放的图像（n*IMG_SZ个float），例如img_mid5_t的历史图像n=4
+ * @param [inout]   struct img_pool_s *pool：内存池
+ * @param [in]      int n：帧数
+ * @retval          float *：图像地址，失败时返回NULL
+ */
+float *img_pool_alloc_img(struct img_pool_s *pool, int n);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -0,0 +1,222 @@
+/**
+ * @file    img_proj.c
+ * @author  YRD
+ * @version 1.0
+ * @date    2026-10-18
+ * @brief   点云投影为深度图（z缓冲）
+ * @details 每帧三次img_par_run：清z缓冲（按行分块）、投影写入z缓冲（按点分段）、
+ *          z缓冲转换为深度/序号/颜色图（按行分块）
+*/
+
+#include <stdio.h>
+#include <string.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#include <math.h>
+#include "img_const.h"
+#include "img_proj.h"
+
+#define PROJ_BLK        256         // 投影块点数，块内的像素坐标和z缓冲字放在栈上
+#define ZBUF_EMPTY      (~(uint64_t)0)
+
+
+int img_proj_init(struct img_proj_s *pj, const struct img_cam_s *cam, struct img_pool_s *pool)
+{
+    memset(pj,0,sizeof(*pj));
+    if (!(cam->fx>0) || !(cam->fy>0))
+    {
+        fprintf(stderr,"img_proj: bad focal length %g/%g\n",cam->fx,cam->fy);
+        return -1;
+    }
+    pj->cam=*cam;
+    pj->pool=pool;
+    if ((pj->zbuf=(uint64_t *)img_pool_alloc(pool,sizeof(uint64_t)*IMG_SZ))==NULL)
+    {
+        fprintf(stderr,"img_proj: frame pool too small\n");
+        return -1;
+    }
+    return 0;
+}
+
+
+void img_proj_release(struct img_proj_s *pj)
+{
+    if (pj->pool)
+        img_pool_release(pj->pool,pj->zbuf);
+    pj->zbuf=NULL;
+}
+
+
+// 多线程任务参数
+struct proj_arg_s
+{
+    struct img_proj_s *pj;
+    float       *dep;
+    int32_t     *idx;
+    uint8_t     *rgb_out;
+    const float *x,*y,*z;
+    const uint8_t *rgb;
+    int          n,r;
+    float        T[12];             // 变换矩阵前3行
+};
+
+
+static void clear_task(void *arg, int i, int n)
+{
+    struct proj_arg_s *a=(struct proj_arg_s *)arg;
+    int y0,y1;
+
+    img_par_band(0,IMG_HGT,i,n,&y0,&y1);
+    memset(a->pj->zbuf+y0*IMG_WID,0xff,sizeof(uint64_t)*(y1-y0)*IMG_WID);
+}
+
+
+// z缓冲取最小值：先读一次，比当前值近时才做原子比较交换，被其他线程抢先改写时重新比较；
+// MSVC没有GCC的__sync原子操作，用Interlocked函数
+static inline void zbuf_min(uint64_t *p, uint64_t k)
+{
+    uint64_t c=*(volatile uint64_t *)p,o;
+
+    while (k<c)
+    {
+#ifdef _MSC_VER
+        o=(uint64_t)_InterlockedCompareExchange64((volatile __int64 *)p,(__int64)k,(__int64)c);
+#else
+        o=__sync_val_compare_and_swap(p,c,k);
+#endif
+        if (o==c)
+            break;
+        c=o;
+    }
+}
+
+
+// 投影点[i0,i1)并写入z缓冲
+static void proj_pts(const struct proj_arg_s *a, int i0, int i1)
+{
+    int bu[PROJ_BLK],bv[PROJ_BLK];
+    uint32_t bz[PROJ_BLK];
+    const struct img_cam_s *c=&a->pj->cam;
+    const float *T=a->T;
+    uint64_t *zbuf=a->pj->zbuf;
+    int b,i,m,du,dv,r=a->r;
+
+    for (b=i0;b<i1;b+=PROJ_BLK)
+    {
+        const float *x=a->x+b,*y=a->y+b,*z=a->z+b;
+        m=(i1-b<PROJ_BLK) ? i1-b : PROJ_BLK;
+
+        // 块内计算，无分支，可向量化；畸变系数为0时畸变项为0，针孔相机不需要单独的循环
+        for (i=0;i<m;i++)
+        {
+            float xc=T[0]*x[i]+T[1]*y[i]+T[ 2]*z[i]+T[ 3];
+            float yc=T[4]*x[i]+T[5]*y[i]+T[ 6]*z[i]+T[ 7];
+            float zc=T[8]*x[i]+T[9]*y[i]+T[10]*z[i]+T[11];
+            float iz=1/zc;                                      // zc<=0时结果无效（ok为0），不做条件运算以免妨碍向量化
+            float xn=xc*iz,yn=yc*iz,r2=xn*xn+yn*yn;
+            float k=1+r2*(c->k1+r2*(c->k2+r2*c->k3));
+            float xd=xn*k+2*c->p1*xn*yn+c->p2*(r2+2*xn*xn);
+            float yd=yn*k+c->p1*(r2+2*yn*yn)+2*c->p2*xn*yn;
+            float uf=c->fx*xd+c->skew*yd+c->cx+0.5f;            // 加0.5后取整为四舍五入
+            float vf=c->fy*yd+c->cy+0.5f;
+            int ok=(zc>0) & (uf>=0) & (uf<IMG_WID) & (vf>=0) & (vf<IMG_HGT);
+            uint32_t zb;
+
+            memcpy(&zb,&zc,sizeof(zb));
+            bu[i]=(int)(ok ? uf : -1.0f);                       // 先选择再转换，超出int范围的值不参与转换
+            bv[i]=(int)(ok ? vf : 0.0f);
+            bz[i]=zb;
+        }
+
+        if (r==0)
+        {
+            for (i=0;i<m;i++)
+                if (bu[i]>=0)
+                    zbuf_min(zbuf+bv[i]*IMG_WID+bu[i],(uint64_t)bz[i]<<32 | (uint32_t)(b+i));
+        }
+        else
+        {
+            for (i=0;i<m;i++)
+            {
+                uint64_t key=(uint64_t)bz[i]<<32 | (uint32_t)(b+i);
+                int u0=bu[i]-r,u1=bu[i]+r,v0=bv[i]-r,v1=bv[i]+r;
+
+                if (bu[i]<0)
+                    continue;
+                if (u0<0) u0=0;
+                if (v0<0) v0=0;
+                if (u1>IMG_WID-1) u1=IMG_WID-1;
+                if (v1>IMG_HGT-1) v1=IMG_HGT-1;
+                for (dv=v0;dv<=v1;dv++)
+                    for (du=u0;du<=u1;du++)
+                        zbuf_min(zbuf+dv*IMG_WID+du,key);
+            }
+        }
+    }
+}
+
+
+static void proj_task(void *arg, int i, int n)
+{
+    struct proj_arg_s *a=(struct proj_arg_s *)arg;
+
+    // 点数可能超过img_par_band的int乘法范围，用64位计算分段
+    proj_pts(a,(int)((int64_t)a->n*i/n),(int)((int64_t)a->n*(i+1)/n));
+}
+
+
+// z缓冲转换为深度、序号和颜色
+static void resolve_task(void *arg, int i, int n)
+{
+    struct proj_arg_s *a=(struct proj_arg_s *)arg;
+    const uint64_t *zbuf=a->pj->zbuf;
+    int y0,y1,k,k0,k1;
+
+    img_par_band(0,IMG_HGT,i,n,&y0,&y1);
+    k0=y0*IMG_WID;
+    k1=y1*IMG_WID;
+    if (a->dep)
+        for (k=k0;k<k1;k++)
+        {
+            uint32_t zb=(uint32_t)(zbuf[k]>>32);
+            float d;
+            memcpy(&d,&zb,sizeof(d));
+            a->dep[k]=(zbuf[k]==ZBUF_EMPTY) ? 0 : d;
+        }
+    if (a->idx)
+        for (k=k0;k<k1;k++)
+            a->idx[k]=(zbuf[k]==ZBUF_EMPTY) ? -1 : (int32_t)(uint32_t)zbuf[k];
+    if (a->rgb_out)
+        for (k=k0;k<k1;k++)
+        {
+            uint8_t *q=a->rgb_out+3*k;
+            if (zbuf[k]==ZBUF_EMPTY)
+                q[0]=q[1]=q[2]=0;
+            else
+            {
+                const uint8_t *p=a->rgb+3*(size_t)(uint32_t)zbuf[k];
+                q[0]=p[0]; q[1]=p[1]; q[2]=p[2];
+            }
+        }
+}
+
+
+void img_proj_run(struct img_proj_s *pj, float *dep, int32_t *idx, uint8_t *rgb_out,
+                  const float *x, const float *y, const float *z, const uint8_t *rgb, int n,
+                  const float *T, int r, struct img_par_s *par)
+{
+    static const float T_eye[12]={ 1,0,0,0, 0,1,0,0, 0,0,1,0 };
+    struct proj_arg_s a;
+    int n_thr=img_par_threads(par);
+
+    a.pj=pj; a.dep=dep; a.idx=idx; a.rgb_out=rgb ? rgb_out : NULL;
+    a.x=x; a.y=y; a.z=z; a.rgb=rgb; a.n=n;
+    a.r=(r<0) ? 0 : (r>IMG_PROJ_R_MAX) ? IMG_PROJ_R_MAX : r;
+    memcpy(a.T,T ? T : T_eye,sizeof(a.T));
+
+    img_par_run(par,clear_task,&a,n_thr);
+    if (n>0)
+        img_par_run(par,proj_task,&a,n_thr);
+    img_par_run(par,resolve_task,&a,n_thr);
+}
@@ -0,0 +1,77 @@
+/**
+ * @file    img_proj.h
+ * @author  YRD
+ * @version 1.0
+ * @date    2026-10-18
+ * @brief   点云投影为深度图（z缓冲）
+ * @details img_deproj.h的反向运算：把任意点云（融合后的点云、变换到虚拟视点的点云）按内参投影为IMG_WID*IMG_HGT的深度图，
+ *          同一像素有多个点时保留最近的点（z最小），可以同时输出每个像素对应的点序号和点的颜色。
+ *          z缓冲的每个像素是一个64位字：高32位为深度（正float的位模式和数值大小顺序相同），低32位为点序号，
+ *          多线程时各线程投影自己的一段点，用原子比较交换取最小值，不需要每个线程一份深度图再合并；
+ *          深度相同时序号小的点优先，结果和线程数无关。
+ *          投影按块计算（变换、透视除法、畸变、取整，无分支，可向量化），再逐点写入z缓冲，
+ *          写入前先读一次，不比当前值近的点不做原子操作。
+ *          splat半径r>0时每个点写入以投影像素为中心的(2r+1)x(2r+1)个像素，用于稀疏点云填孔
+*/
+
+#ifndef __IMG_PROJ_H__
+#define __IMG_PROJ_H__
+
+#include <stdint.h>
+#include "img_pool.h"
+#include "img_par.h"
+#include "img_deproj.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define IMG_PROJ_R_MAX      8       ///< 最大splat半径
+
+/**
+ * @brief           投影器
+ */
+struct img_proj_s
+{
+    struct img_cam_s  cam;                  ///< 目标相机内参和畸变系数
+    uint64_t         *zbuf;                 ///< z缓冲，IMG_SZ个64位字
+    struct img_pool_s *pool;
+};
+
+/**
+ * @fn              int img_proj_init(struct img_proj_s *pj, const struct img_cam_s *cam, struct img_pool_s *pool)
+ * @brief           建立投影器，z缓冲从内存池分配（IMG_SZ*8字节）
+ * @param [in]      const struct img_cam_s *cam：目标相机内参（IMG_WID*IMG_HGT图像上的像素值），畸变系数全0为针孔相机
+ * @retval          int：0成功，-1内参无效或内存不足（错误信息输出到stderr）
+ */
+int img_proj_init(struct img_proj_s *pj, const struct img_cam_s *cam, struct img_pool_s *pool);
+
+/**
+ * @fn              void img_proj_release(struct img_proj_s *pj)
+ * @brief           释放z缓冲（归还内存池）
+ */
+void img_proj_release(struct img_proj_s *pj);
+
+/**
+ * @fn              void img_proj_run(struct img_proj_s *pj, float *dep, int32_t *idx, uint8_t *rgb_out,
+ *                                    const float *x, const float *y, const float *z, const uint8_t *rgb, int n,
+ *                                    const float *T, int r, struct img_par_s *par)
+ * @brief           n个点投影为深度图
+ * @param [in]      const float *x,*y,*z：点坐标（m），各n个float
+ * @param [in]      const uint8_t *rgb：每个点的颜色，n*3个uint8（RGB交织），只在rgb_out不为NULL时使用
+ * @param [in]      int n：点数
+ * @param [in]      const float *T：4x4变换矩阵（行优先，16个float），先变换到相机坐标系再投影，NULL为单位矩阵
+ * @param [in]      int r：splat半径，0为每个点只写一个像素，最大IMG_PROJ_R_MAX
+ * @param [out]     float *dep：IMG_SZ个float，每个像素最近点的深度（相机坐标系的z），没有点的像素为0，可以为NULL
+ * @param [out]     int32_t *idx：IMG_SZ个int32，每个像素最近点的序号，没有点的像素为-1，可以为NULL
+ * @param [out]     uint8_t *rgb_out：IMG_SZ*3个uint8，每个像素最近点的颜色，没有点的像素为0，可以为NULL
+ * @param [in]      struct img_par_s *par：线程池，可以为NULL
+ */
+void img_proj_run(struct img_proj_s *pj, float *dep, int32_t *idx, uint8_t *rgb_out,
+                  const float *x, const float *y, const float *z, const uint8_t *rgb, int n,
+                  const float *T, int r, struct img_par_s *par);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -0,0 +1,2608 @@
+/**
+ * @file    img_py.c
+ * @author  YRD
+ * @version 1.0
+ * @date    2026-10-18
+ * @brief   Python扩展模块_img_filter
+ * @details 在Python中直接调用滤波链(img_chain.h)和异步录制(img_sav.h)，图像通过缓冲区协议传递，不拷贝数据，
+ *          numpy数组、bytearray、memoryview等都可以直接作为输入输出：
+ *              import numpy as np, _img_filter
+ *              f=_img_filter.Chain("mid3_t,plane_mf_sqr3",threads=2)      # 每个数据流一个Chain
+ *              out=np.empty((_img_filter.HGT,_img_filter.WID),np.float32)
+ *              f.run(depth_f32,out)
+ *          输入输出必须是C连续的IMG_WID*IMG_HGT个float32，out省略时新建并返回memoryview（np.asarray不拷贝）。
+ *          滤波时释放GIL，多个Chain可以在多个Python线程中同时运行，同一个Chain同时只能在一个线程中使用。
+ *          图像尺寸在编译时确定（CMake的TOF_TYPE），模块属性WID/HGT给出尺寸。Python端的封装见src/filter/native.py。
+ *          ShmReader读取filter程序(-S)发布到共享内存的帧(img_shm.h)，返回指向共享内存的只读memoryview，
+ *          等待新帧时释放GIL。
+ *          tune()在建立Chain之前测速选择各滤波级最快的实现(img_tune.h)，结果保存在缓存文件中。
+ *          Deproj按内参建立射线表(img_deproj.h)，把滤波输出或原始uint16深度反投影为x/y/z三幅图像，
+ *          或者一遍完成反投影、距离过滤和变换，输出紧凑的点列表(crop)，或者平面匹配滤波的同时输出法向量和拟合残差(plane_mf)；Normals用像素邻域估计有序点云的法向量(img_normal.h)；
+ *          Proj是反向运算，把点云用z缓冲投影为深度图，可同时输出点序号和颜色(img_proj.h)；
+ *          Reg把深度图和彩色图配准，输出对齐到深度图的彩色图和对齐到彩色图的深度图(img_reg.h)；
+ *          Cloud是列存储的点云容器(img_pc.h)，坐标、法向量、颜色和标量列以memoryview导出，不拷贝，
+ *          导出的视图存在时不能扩大容量（和bytearray一样）；
+ *          Rigid原地变换Cloud或(3,n)数组，批量复合、求逆、转换位姿(img_rigid.h)；
+ *          KDTree在Cloud或(3,n)数组上建树，批量k近邻和半径查询写入调用者给出的缓冲区(img_kdt.h)；
+ *          Outlier在像素窗口内找近邻，对有序点云做半径滤波和统计滤波，输出mask(img_outlier.h)
+*/
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+#include <string.h>
+#include "img_const.h"
+#include "img_pool.h"
+#include "img_par.h"
+#include "img_chain.h"
+#include "img_filter_bat.h"
+#include "img_rec.h"
+#include "img_sav.h"
+#include "img_shm.h"
+#include "img_tune.h"
+#include "img_deproj.h"
+#include "img_normal.h"
+#include "img_proj.h"
+#include "img_reg.h"
+#include "img_pc.h"
+#include "img_rigid.h"
+#include "img_kdt.h"
+#include "img_outlier.h"
+
+
+// 取得缓冲区，检查类型和长度；fmt为允许的格式字符，n为元素个数（0时不检查）
+static int get_buf(PyObject *o, Py_buffer *b, int writable, const char *fmt, Py_ssize_t n, const char *name)
+{
+    const char *f;
+
+    if (PyObject_GetBuffer(o,b,PyBUF_C_CONTIGUOUS|PyBUF_FORMAT|(writable ? PyBUF_WRITABLE : 0)))
+        return -1;
+    f=b->format ? b->format : "B";
+    if (*f=='@' || *f=='=' || *f=='<')
+        f++;
+    if (f[0]==0 || f[1]!=0 || strchr(fmt,f[0])==NULL)
+    {
+        PyErr_Format(PyExc_TypeError,"%s: unsupported buffer format '%s'",name,b->format ? b->format : "B");
+        PyBuffer_Release(b);
+        return -1;
+    }
+    if (n && b->len!=n*b->itemsize)
+    {
+        PyErr_Format(PyExc_ValueError,"%s: %zd elements, expected %zd (%dx%d)",
+                     name,b->len/b->itemsize,n,IMG_WID,IMG_HGT);
+        PyBuffer_Release(b);
+        return -1;
+    }
+    return 0;
+}
+
+// 新建n个float32的图像，返回IMG_HGT*IMG_WID（n>1时为n*IMG_HGT*IMG_WID）的memoryview
+static PyObject *new_img(Py_buffer *b, int n)
+{
+    PyObject *ba,*mv,*img;
+
+    if ((ba=PyByteArray_FromStringAndSize(NULL,sizeof(float)*IMG_SZ*n))==NULL)
+        return NULL;
+    mv=PyMemoryView_FromObject(ba);
+    Py_DECREF(ba);
+    if (mv==NULL)
+        return NULL;
+    if (n>1)
+        img=PyObject_CallMethod(mv,"cast","s(iii)","f",n,IMG_HGT,IMG_WID);
+    else
+        img=PyObject_CallMethod(mv,"cast","s(ii)","f",IMG_HGT,IMG_WID);
+    Py_DECREF(mv);
+    if (img && PyObject_GetBuffer(img,b,PyBUF_C_CONTIGUOUS|PyBUF_WRITABLE))
+        Py_CLEAR(img);
+    return img;
+}
+
+
+/*-------------------------------- Chain --------------------------------*/
+
+typedef struct
+{
+    PyObject_HEAD
+    struct img_pool_s  pool;
+    struct img_par_s  *par;
+    struct img_chain_s chain;
+    int                ok;          // 滤波链已建立
+    int                busy;        // 正在滤波（GIL已释放）
+} chain_obj;
+
+
+static int chain_init(chain_obj *self, PyObject *args, PyObject *kw)
+{
+    static char *kwlist[]={ "spec", "threads", NULL };
+    const char *spec,*c;
+    int n_thr=1,n_stg=1;
+
+    if (!PyArg_ParseTupleAndKeywords(args,kw,"s|i",kwlist,&spec,&n_thr))
+        return -1;
+    if (self->ok)
+    {
+        PyErr_SetString(PyExc_RuntimeError,"Chain already initialized");
+        return -1;
+    }
+    for (c=spec;*c;c++)
+        n_stg+=(*c==',');
+    if (n_stg>IMG_CHAIN_MAX)
+    {
+        PyErr_Format(PyExc_ValueError,"more than %d stages",IMG_CHAIN_MAX);
+        return -1;
+    }
+
+    // 每级最多1+4+2帧图像
+    if (img_pool_init(&self->pool,sizeof(float)*IMG_SZ*(7*n_stg+1)+(1u<<20),IMG_POOL_PREFAULT))
+    {
+        PyErr_NoMemory();
+        return -1;
+    }
+    if (n_thr>1)
+        self->par=img_par_create(n_thr);
+    if (img_chain_init(&self->chain,spec,&self->pool,self->par))
+    {
+        img_par_destroy(self->par);
+        self->par=NULL;
+        img_pool_destroy(&self->pool);
+        PyErr_Format(PyExc_ValueError,"bad filter chain '%s'",spec);
+        return -1;
+    }
+    self->ok=1;
+    return 0;
+}
+
+static void chain_dealloc(chain_obj *self)
+{
+    if (self->ok)
+    {
+        img_chain_release(&self->chain);
+        img_par_destroy(self->par);
+        img_pool_destroy(&self->pool);
+    }
+    Py_TYPE(self)->tp_free((PyObject *)self);
+}
+
+static PyObject *chain_run(chain_obj *self, PyObject *args, PyObject *kw)
+{
+    static char *kwlist[]={ "src", "out", NULL };
+    PyObject *src,*out=Py_None,*ret;
+    Py_buffer bi,bo;
+
+    if (!PyArg_ParseTupleAndKeywords(args,kw,"O|O",kwlist,&src,&out))
+        return NULL;
+    if (!self->ok || self->busy)
+    {
+        PyErr_SetString(PyExc_RuntimeError,self->ok ? "Chain is running in another thread" : "Chain not initialized");
+        return NULL;
+    }
+    if (get_buf(src,&bi,0,"f",IMG_SZ,"src"))
+        return NULL;
+    if (out==Py_None)
+        ret=new_img(&bo,1);
+    else if (get_buf(out,&bo,1,"f",IMG_SZ,"out")==0)
+    {
+        ret=out;
+        Py_INCREF(ret);
+    }
+    else
+        ret=NULL;
+    if (ret==NULL)
+    {
+        PyBuffer_Release(&bi);
+        return NULL;
+    }
+    if (bo.buf==bi.buf)
+    {
+        PyBuffer_Release(&bi);
+        PyBuffer_Release(&bo);
+        Py_DECREF(ret);
+        PyErr_SetString(PyExc_ValueError,"src and out must not be the same buffer");
+        return NULL;
+    }
+
+    self->busy=1;
+    Py_BEGIN_ALLOW_THREADS
+    img_chain_run(&self->chain,(float *)bo.buf,(float *)bi.buf);
+    Py_END_ALLOW_THREADS
+    self->busy=0;
+
+    PyBuffer_Release(&bi);
+    PyBuffer_Release(&bo);
+    return ret;
+}
+
+static PyObject *chain_stats(chain_obj *self, PyObject *unused)
+{
+    PyObject *stg,*d;
+    int i;
+
+    (void)unused;
+    if (!self->ok)
+    {
+        PyErr_SetString(PyExc_RuntimeError,"Chain not initialized");
+        return NULL;
+    }
+    if ((stg=PyList_New(self->chain.n))==NULL)
+        return NULL;
+    for (i=0;i<self->chain.n;i++)
+    {
+        struct img_stage_s *s=&self->chain.stg[i];
+        PyObject *e=Py_BuildValue("{s:s,s:K,s:d,s:d}","name",s->desc->name,"frames",(unsigned long long)s->n,
+                                  "avg_us",s->n ? s->t_sum/1e3/s->n : 0.0,"max_us",s->t_max/1e3);
+        if (e==NULL)
+        {
+            Py_DECREF(stg);
+            return NULL;
+        }
+        PyList_SET_ITEM(stg,i,e);
+    }
+    d=Py_BuildValue("{s:K,s:d,s:d,s:N}","frames",(unsigned long long)self->chain.n_frm,
+                    "avg_us",self->chain.n_frm ? self->chain.t_sum/1e3/self->chain.n_frm : 0.0,
+                    "max_us",self->chain.t_max/1e3,"stages",stg);
+    return d;
+}
+
+static PyMethodDef chain_methods[]=
+{
+    { "run",   (PyCFunction)(void (*)(void))chain_run, METH_VARARGS|METH_KEYWORDS,
+      "run(src, out=None) -> out\nFilter one float32 frame; out is created when omitted." },
+    { "stats", (PyCFunction)chain_stats, METH_NOARGS,
+      "stats() -> dict\nFrames and average/maximum time of the chain and of each stage." },
+    { NULL }
+};
+
+static PyTypeObject chain_type=
+{
+    PyVarObject_HEAD_INIT(NULL,0)
+    .tp_name     ="_img_filter.Chain",
+    .tp_basicsize=sizeof(chain_obj),
+    .tp_dealloc  =(destructor)chain_dealloc,
+    .tp_flags    =Py_TPFLAGS_DEFAULT,
+    .tp_doc      ="Chain(spec, threads=1)\nFilter chain for one depth stream, spec as in img_chain.h.",
+    .tp_methods  =chain_methods,
+    .tp_init     =(initproc)chain_init,
+    .tp_new      =PyType_GenericNew,
+};
+
+
+/*------------------------------- Recorder -------------------------------*/
+
+typedef struct
+{
+    PyObject_HEAD
+    struct img_sav_s sav;
+    int              ok;            // 文件已打开
+    int              busy;          // 正在提交（GIL已释放），img_sav只允许一个采集线程
+} rec_obj;
+
+
+static int rec_init(rec_obj *self, PyObject *args, PyObject *kw)
+{
+    static char *kwlist[]={ "fname", "frame_bytes", "buffers", "wait_ms", "dz", NULL };
+    const char *fname;
+    Py_ssize_t frm_sz;
+    int n_buf=IMG_SAV_BUF_DEF,wait_ms=0,dz=0,ret;
+
+    if (!PyArg_ParseTupleAndKeywords(args,kw,"sn|iip",kwlist,&fname,&frm_sz,&n_buf,&wait_ms,&dz))
+        return -1;
+    if (self->ok)
+    {
+        PyErr_SetString(PyExc_RuntimeError,"Recorder already open");
+        return -1;
+    }
+    Py_BEGIN_ALLOW_THREADS
+    ret=img_sav_open(&self->sav,fname,(size_t)frm_sz,n_buf,dz ? IMG_SAV_DZ : IMG_SAV_RAW,wait_ms);
+    Py_END_ALLOW_THREADS
+    if (ret)
+    {
+        PyErr_Format(PyExc_OSError,"cannot record to '%s'",fname);
+        return -1;
+    }
+    self->ok=1;
+    return 0;
+}
+
+static PyObject *rec_close(rec_obj *self, PyObject *unused)
+{
+    int ret;
+
+    (void)unused;
+    if (!self->ok)
+        Py_RETURN_NONE;
+    if (self->busy)
+    {
+        PyErr_SetString(PyExc_RuntimeError,"Recorder is used in another thread");
+        return NULL;
+    }
+    self->ok=0;
+    Py_BEGIN_ALLOW_THREADS
+    ret=img_sav_close(&self->sav);
+    Py_END_ALLOW_THREADS
+    if (ret)
+    {
+        PyErr_SetString(PyExc_OSError,"write error while recording");
+        return NULL;
+    }
+    Py_RETURN_NONE;
+}
+
+static void rec_dealloc(rec_obj *self)
+{
+    if (self->ok)
+        img_sav_close(&self->sav);
+    Py_TYPE(self)->tp_free((PyObject *)self);
+}
+
+static PyObject *rec_put(rec_obj *self, PyObject *frm)
+{
+    Py_buffer b;
+    int drop;
+
+    if (!self->ok || self->busy)
+    {
+        PyErr_SetString(self->ok ? PyExc_RuntimeError : PyExc_ValueError,
+                        self->ok ? "Recorder is used in another thread" : "Recorder is closed");
+        return NULL;
+    }
+    if (PyObject_GetBuffer(frm,&b,PyBUF_C_CONTIGUOUS))
+        return NULL;
+    if ((size_t)b.len!=self->sav.frm_sz)
+    {
+        PyErr_Format(PyExc_ValueError,"frame has %zd bytes, expected %zu",b.len,self->sav.frm_sz);
+        PyBuffer_Release(&b);
+        return NULL;
+    }
+    self->busy=1;
+    Py_BEGIN_ALLOW_THREADS
+    drop=img_sav_frame(&self->sav,b.buf);
+    Py_END_ALLOW_THREADS
+    self->busy=0;
+    PyBuffer_Release(&b);
+    return PyBool_FromLong(!drop);
+}
+
+static PyObject *rec_stats(rec_obj *self, PyObject *unused)
+{
+    struct img_sav_s *s=&self->sav;
+    (void)unused;
+    return Py_BuildValue("{s:K,s:K,s:K,s:K,s:K,s:d,s:i,s:i}","frames",(unsigned long long)s->n_frm,
+                         "dropped",(unsigned long long)s->n_drop,"waits",(unsigned long long)s->n_wait,
+                         "bytes",(unsigned long long)s->off,"writes",(unsigned long long)s->n_wr,
+                         "write_max_ms",s->t_wr_max/1e6,"queue_max",s->q_max,"direct",s->direct);
+}
+
+static PyObject *rec_enter(rec_obj *self, PyObject *unused)
+{
+    (void)unused;
+    Py_INCREF(self);
+    return (PyObject *)self;
+}
+
+static PyObject *rec_exit(rec_obj *self, PyObject *args)
+{
+    PyObject *r;
+    (void)args;
+    if ((r=rec_close(self,NULL))==NULL)
+        return NULL;
+    Py_DECREF(r);
+    Py_RETURN_FALSE;
+}
+
+static PyMethodDef rec_methods[]=
+{
+    { "put",       (PyCFunction)rec_put,   METH_O,
+      "put(frame) -> bool\nQueue one frame (any buffer of frame_bytes); False when it was dropped." },
+    { "close",     (PyCFunction)rec_close, METH_NOARGS,
+      "close()\nWrite the queued frames (and the .dz index) and close the file." },
+    { "stats",     (PyCFunction)rec_stats, METH_NOARGS,
+      "stats() -> dict\nFrames written and dropped, bytes, writes, longest write, queue high-water mark." },
+    { "__enter__", (PyCFunction)rec_enter, METH_NOARGS, NULL },
+    { "__exit__",  (PyCFunction)rec_exit,  METH_VARARGS, NULL },
+    { NULL }
+};
+
+static PyTypeObject rec_type=
+{
+    PyVarObject_HEAD_INIT(NULL,0)
+    .tp_name     ="_img_filter.Recorder",
+    .tp_basicsize=sizeof(rec_obj),
+    .tp_dealloc  =(destructor)rec_dealloc,
+    .tp_flags    =Py_TPFLAGS_DEFAULT,
+    .tp_doc      ="Recorder(fname, frame_bytes, buffers=16, wait_ms=0, dz=False)\n"
+                  "Asynchronous recorder (img_sav.h); wait_ms 0 drops frames when the queue is full, -1 blocks.",
+    .tp_methods  =rec_methods,
+    .tp_init     =(initproc)rec_init,
+    .tp_new      =PyType_GenericNew,
+};
+
+
+/*------------------------------- ShmReader -------------------------------*/
+
+typedef struct
+{
+    PyObject_HEAD
+    struct img_shm_s shm;
+    int              ok;            // 共享内存已映射
+    Py_ssize_t       n_exp;         // 导出的memoryview数，不为0时不能关闭
+} shm_obj;
+
+
+static int shm_init(shm_obj *self, PyObject *args, PyObject *kw)
+{
+    static char *kwlist[]={ "name", NULL };
+    const char *name=IMG_SHM_NAME_DEF;
+
+    if (!PyArg_ParseTupleAndKeywords(args,kw,"|s",kwlist,&name))
+        return -1;
+    if (self->ok)
+    {
+        PyErr_SetString(PyExc_RuntimeError,"ShmReader already open");
+        return -1;
+    }
+    if (img_shm_open(&self->shm,name))
+    {
+        PyErr_Format(PyExc_FileNotFoundError,"no frame shared memory '%s'",name);
+        return -1;
+    }
+    self->ok=1;
+    return 0;
+}
+
+static void shm_dealloc(shm_obj *self)
+{
+    if (self->ok)
+        img_shm_close(&self->shm);
+    Py_TYPE(self)->tp_free((PyObject *)self);
+}
+
+// 整个映射只读导出，frame返回的memoryview是它的切片，持有ShmReader的引用
+static int shm_getbuffer(shm_obj *self, Py_buffer *view, int flags)
+{
+    if (!self->ok)
+    {
+        PyErr_SetString(PyExc_ValueError,"ShmReader is closed");
+        return -1;
+    }
+    if (PyBuffer_FillInfo(view,(PyObject *)self,self->shm.base,(Py_ssize_t)self->shm.size,1,flags))
+        return -1;
+    self->n_exp++;
+    return 0;
+}
+
+static void shm_releasebuffer(shm_obj *self, Py_buffer *view)
+{
+    (void)view;
+    self->n_exp--;
+}
+
+static PyBufferProcs shm_as_buffer=
+{
+    (getbufferproc)shm_getbuffer,
+    (releasebufferproc)shm_releasebuffer,
+};
+
+static PyObject *shm_wait(shm_obj *self, PyObject *args, PyObject *kw)
+{
+    static char *kwlist[]={ "last", "timeout_ms", NULL };
+    unsigned long long last=0;
+    uint64_t seq=0;
+    int timeout_ms=-1,t;
+
+    if (!PyArg_ParseTupleAndKeywords(args,kw,"|Ki",kwlist,&last,&timeout_ms))
+        return NULL;
+    if (!self->ok)
+    {
+        PyErr_SetString(PyExc_ValueError,"ShmReader is closed");
+        return NULL;
+    }
+    // 每次最多等待100ms，之间检查信号，Ctrl-C可以中断
+    do
+    {
+        t=(timeout_ms<0 || timeout_ms>100) ? 100 : timeout_ms;
+        Py_BEGIN_ALLOW_THREADS
+        seq=img_shm_wait(&self->shm,last,t);
+        Py_END_ALLOW_THREADS
+        if (seq || PyErr_CheckSignals())
+            break;
+        if (timeout_ms>0)
+            timeout_ms-=t;
+    } while (timeout_ms!=0);
+
+    if (PyErr_Occurred())
+        return NULL;
+    return PyLong_FromUnsignedLongLong(seq);
+}
+
+static PyObject *shm_frame(shm_obj *self, PyObject *arg)
+{
+    struct img_shm_hdr_s *h;
+    unsigned long long seq=PyLong_AsUnsignedLongLong(arg);
+    const uint8_t *p;
+    uint64_t t_ns;
+    PyObject *mv,*sl,*img;
+    Py_ssize_t off;
+
+    if (PyErr_Occurred())
+        return NULL;
+    if (!self->ok)
+    {
+        PyErr_SetString(PyExc_ValueError,"ShmReader is closed");
+        return NULL;
+    }
+    h=self->shm.hdr;
+    if ((p=(const uint8_t *)img_shm_frame(&self->shm,seq,&t_ns))==NULL)
+        Py_RETURN_NONE;
+
+    off=p-self->shm.base;
+    if ((mv=PyMemoryView_FromObject((PyObject *)self))==NULL)
+        return NULL;
+    sl=PySequence_GetSlice(mv,off,off+h->frm_sz);
+    Py_DECREF(mv);
+    if (sl==NULL)
+        return NULL;
+    if (h->frm_sz==sizeof(float)*h->wid*h->hgt)
+    {
+        img=PyObject_CallMethod(sl,"cast","s(II)","f",h->hgt,h->wid);
+        Py_DECREF(sl);
+    }
+    else
+        img=sl;
+    if (img==NULL)
+        return NULL;
+    return Py_BuildValue("(NK)",img,(unsigned long long)t_ns);
+}
+
+static PyObject *shm_valid(shm_obj *self, PyObject *arg)
+{
+    unsigned long long seq=PyLong_AsUnsignedLongLong(arg);
+    if (PyErr_Occurred())
+        return NULL;
+    if (!self->ok)
+        Py_RETURN_FALSE;
+    return PyBool_FromLong(img_shm_valid(&self->shm,seq));
+}
+
+static PyObject *shm_latest(shm_obj *self, PyObject *unused)
+{
+    (void)unused;
+    return PyLong_FromUnsignedLongLong(self->ok ? self->shm.hdr->seq : 0);
+}
+
+static PyObject *shm_close(shm_obj *self, PyObject *unused)
+{
+    (void)unused;
+    if (self->n_exp)
+    {
+        PyErr_SetString(PyExc_BufferError,"frames returned by ShmReader are still in use");
+        return NULL;
+    }
+    if (self->ok)
+        img_shm_close(&self->shm);
+    self->ok=0;
+    Py_RETURN_NONE;
+}
+
+static PyMethodDef shm_methods[]=
+{
+    { "wait",   (PyCFunction)(void (*)(void))shm_wait, METH_VARARGS|METH_KEYWORDS,
+      "wait(last=0, timeout_ms=-1) -> int\nWait for a frame newer than last; returns the newest sequence number, 0 on timeout." },
+    { "frame",  (PyCFunction)shm_frame,  METH_O,
+      "frame(seq) -> (view, t_ns) or None\nRead-only view of frame seq in shared memory, None when already overwritten." },
+    { "valid",  (PyCFunction)shm_valid,  METH_O,
+      "valid(seq) -> bool\nTrue if frame seq has not been overwritten; check after using the view." },
+    { "latest", (PyCFunction)shm_latest, METH_NOARGS,
+      "latest() -> int\nSequence number of the newest published frame, 0 if none." },
+    { "close",  (PyCFunction)shm_close,  METH_NOARGS,
+      "close()\nUnmap the shared memory; fails while returned views are alive." },
+    { NULL }
+};
+
+static PyTypeObject shm_type=
+{
+    PyVarObject_HEAD_INIT(NULL,0)
+    .tp_name     ="_img_filter.ShmReader",
+    .tp_basicsize=sizeof(shm_obj),
+    .tp_dealloc  =(destructor)shm_dealloc,
+    .tp_as_buffer=&shm_as_buffer,
+    .tp_flags    =Py_TPFLAGS_DEFAULT,
+    .tp_doc      ="ShmReader(name='" IMG_SHM_NAME_DEF "')\nZero-copy reader of frames published by filter -S (img_shm.h).",
+    .tp_methods  =shm_methods,
+    .tp_init     =(initproc)shm_init,
+    .tp_new      =PyType_GenericNew,
+};
+
+
+/*-------------------------------- Deproj --------------------------------*/
+
+typedef struct
+{
+    PyObject_HEAD
+    struct img_pool_s   pool;
+    struct img_par_s   *par;
+    struct img_deproj_s dp;
+    int                 ok;         // 射线表已建立
+    int                 busy;       // 正在反投影（GIL已释放）
+} deproj_obj;
+
+
+static int deproj_init(deproj_obj *self, PyObject *args, PyObject *kw)
+{
+    static char *kwlist[]={ "fx", "fy", "cx", "cy", "skew", "dist", "threads", NULL };
+    struct img_cam_s cam;
+    PyObject *dist=Py_None;
+    int n_thr=1,ret;
+
+    memset(&cam,0,sizeof(cam));
+    if (!PyArg_ParseTupleAndKeywords(args,kw,"ffff|fOi",kwlist,&cam.fx,&cam.fy,&cam.cx,&cam.cy,&cam.skew,&dist,&n_thr))
+        return -1;
+    if (self->ok)
+    {
+        PyErr_SetString(PyExc_RuntimeError,"Deproj already initialized");
+        return -1;
+    }
+    if (dist!=Py_None)
+    {
+        PyObject *t=PySequence_Tuple(dist);
+        int ok=t && PyArg_ParseTuple(t,"ff|fff;dist: (k1, k2[, p1, p2[, k3]])",&cam.k1,&cam.k2,&cam.p1,&cam.p2,&cam.k3);
+        Py_XDECREF(t);
+        if (!ok)
+            return -1;
+    }
+
+    if (img_pool_init(&self->pool,sizeof(float)*IMG_SZ*2+(1u<<20),IMG_POOL_PREFAULT))
+    {
+        PyErr_NoMemory();
+        return -1;
+    }
+    Py_BEGIN_ALLOW_THREADS
+    ret=img_deproj_init(&self->dp,&cam,&self->pool);
+    Py_END_ALLOW_THREADS
+    if (ret)
+    {
+        img_pool_destroy(&self->pool);
+        PyErr_SetString(PyExc_ValueError,"bad camera intrinsics");
+        return -1;
+    }
+    if (n_thr>1)
+        self->par=img_par_create(n_thr);
+    self->ok=1;
+    return 0;
+}
+
+// int16深度的uint16副本（从帧内存池分配），负值（-1等无效标记）按0深度处理；
+// 直接把int16当作uint16时-1会变成65.5m的有效点。uint16/float32深度返回NULL
+static uint16_t *deproj_i16(deproj_obj *self, const Py_buffer *b)
+{
+    const char *fmt=b->format ? b->format : "B";
+    uint16_t *d;
+
+    if (fmt[strlen(fmt)-1]!='h')
+        return NULL;
+    if ((d=(uint16_t *)img_pool_alloc(&self->pool,sizeof(uint16_t)*IMG_SZ))==NULL)
+        PyErr_NoMemory();
+    return d;
+}
+
+static void i16_to_u16(uint16_t *d, const int16_t *s)
+{
+    int i;
+
+    for (i=0;i<IMG_SZ;i++)
+        d[i]=s[i]>0 ? (uint16_t)s[i] : 0;
+}
+
+static void deproj_dealloc(deproj_obj *self)
+{
+    if (self->ok)
+    {
+        img_deproj_release(&self->dp);
+        img_par_destroy(self->par);
+        img_pool_destroy(&self->pool);
+    }
+    Py_TYPE(self)->tp_free((PyObject *)self);
+}
+
+static PyObject *deproj_run(deproj_obj *self, PyObject *args, PyObject *kw)
+{
+    static char *kwlist[]={ "src", "out", "scale", NULL };
+    PyObject *src,*out=Py_None,*ret;
+    Py_buffer bi,bo;
+    float scale=0.001f,*x;
+    uint16_t *dep;
+    int u16;
+
+    if (!PyArg_ParseTupleAndKeywords(args,kw,"O|Of",kwlist,&src,&out,&scale))
+        return NULL;
+    if (!self->ok || self->busy)
+    {
+        PyErr_SetString(PyExc_RuntimeError,self->ok ? "Deproj is running in another thread" : "Deproj not initialized");
+        return NULL;
+    }
+    if (get_buf(src,&bi,0,"Hhf",IMG_SZ,"src"))
+        return NULL;
+    if (out==Py_None)
+        ret=new_img(&bo,3);
+    else if (get_buf(out,&bo,1,"f",3*IMG_SZ,"out")==0)
+    {
+        ret=out;
+        Py_INCREF(ret);
+    }
+    else
+        ret=NULL;
+    if (ret==NULL)
+    {
+        PyBuffer_Release(&bi);
+        return NULL;
+    }
+
+    x=(float *)bo.buf;
+    u16=(bi.itemsize==2);
+    if ((dep=deproj_i16(self,&bi))==NULL && PyErr_Occurred())
+    {
+        PyBuffer_Release(&bi);
+        PyBuffer_Release(&bo);
+        Py_DECREF(ret);
+        return NULL;
+    }
+    self->busy=1;
+    Py_BEGIN_ALLOW_THREADS
+    if (dep)
+        i16_to_u16(dep,(const int16_t *)bi.buf);
+    if (u16)
+        img_deproj_u16(&self->dp,x,x+IMG_SZ,x+2*IMG_SZ,dep ? dep : (const uint16_t *)bi.buf,scale,self->par);
+    else
+        img_deproj_f32(&self->dp,x,x+IMG_SZ,x+2*IMG_SZ,(const float *)bi.buf,self->par);
+    Py_END_ALLOW_THREADS
+    self->busy=0;
+
+    img_pool_release(&self->pool,dep);
+    PyBuffer_Release(&bi);
+    PyBuffer_Release(&bo);
+    return ret;
+}
+
+static PyObject *deproj_crop(deproj_obj *self, PyObject *args, PyObject *kw)
+{
+    static char *kwlist[]={ "src", "out", "idx", "dmin", "dmax", "T", "scale", NULL };
+    PyObject *src,*out,*idx=Py_None,*T=Py_None;
+    Py_buffer bi,bo,bx,bt;
+    float dmin,dmax,scale=0.001f,*x;
+    uint16_t *dep;
+    int n,u16;
+
+    if (!PyArg_ParseTupleAndKeywords(args,kw,"OOOff|Of",kwlist,&src,&out,&idx,&dmin,&dmax,&T,&scale))
+        return NULL;
+    if (!self->ok || self->busy)
+    {
+        PyErr_SetString(PyExc_RuntimeError,self->ok ? "Deproj is running in another thread" : "Deproj not initialized");
+        return NULL;
+    }
+    memset(&bx,0,sizeof(bx));
+    memset(&bt,0,sizeof(bt));
+    if (get_buf(src,&bi,0,"Hhf",IMG_SZ,"src"))
+        return NULL;
+    if (get_buf(out,&bo,1,"f",3*IMG_SZ,"out"))
+    {
+        PyBuffer_Release(&bi);
+        return NULL;
+    }
+    if ((idx!=Py_None && get_buf(idx,&bx,1,"i",IMG_SZ,"idx")) || (T!=Py_None && get_buf(T,&bt,0,"f",16,"T")))
+    {
+        PyBuffer_Release(&bi);
+        PyBuffer_Release(&bo);
+        if (bx.obj)
+            PyBuffer_Release(&bx);
+        return NULL;
+    }
+
+    x=(float *)bo.buf;
+    u16=(bi.itemsize==2);
+    if ((dep=deproj_i16(self,&bi))==NULL && PyErr_Occurred())
+    {
+        PyBuffer_Release(&bi);
+        PyBuffer_Release(&bo);
+        if (bx.obj)
+            PyBuffer_Release(&bx);
+        if (bt.obj)
+            PyBuffer_Release(&bt);
+        return NULL;
+    }
+    self->busy=1;
+    Py_BEGIN_ALLOW_THREADS
+    if (dep)
+        i16_to_u16(dep,(const int16_t *)bi.buf);
+    if (u16)
+        n=img_deproj_crop_u16(&self->dp,x,x+IMG_SZ,x+2*IMG_SZ,(int32_t *)bx.buf,dep ? dep : (const uint16_t *)bi.buf,scale,
+                              dmin,dmax,(const float *)bt.buf,self->par);
+    else
+        n=img_deproj_crop_f32(&self->dp,x,x+IMG_SZ,x+2*IMG_SZ,(int32_t *)bx.buf,(const float *)bi.buf,
+                              dmin,dmax,(const float *)bt.buf,self->par);
+    Py_END_ALLOW_THREADS
+    self->busy=0;
+
+    img_pool_release(&self->pool,dep);
+    PyBuffer_Release(&bi);
+    PyBuffer_Release(&bo);
+    if (bx.obj)
+        PyBuffer_Release(&bx);
+    if (bt.obj)
+        PyBuffer_Release(&bt);
+    return PyLong_FromLong(n);
+}
+
+static PyObject *deproj_plane_mf(deproj_obj *self, PyObject *args, PyObject *kw)
+{
+    static char *kwlist[]={ "src", "out", NULL };
+    PyObject *src,*out=Py_None,*ret;
+    Py_buffer bi,bo;
+    float *o;
+
+    if (!PyArg_ParseTupleAndKeywords(args,kw,"O|O",kwlist,&src,&out))
+        return NULL;
+    if (!self->ok || self->busy)
+    {
+        PyErr_SetString(PyExc_RuntimeError,self->ok ? "Deproj is running in another thread" : "Deproj not initialized");
+        return NULL;
+    }
+    if (get_buf(src,&bi,0,"f",IMG_SZ,"src"))
+        return NULL;
+    if (out==Py_None)
+        ret=new_img(&bo,5);
+    else if (get_buf(out,&bo,1,"f",5*IMG_SZ,"out")==0)
+    {
+        ret=out;
+        Py_INCREF(ret);
+    }
+    else
+        ret=NULL;
+    if (ret==NULL)
+    {
+        PyBuffer_Release(&bi);
+        return NULL;
+    }
+
+    // 斜率先写到nx、ny平面，img_normal_grad原址转换为法向量
+    o=(float *)bo.buf;
+    memset(o,0,sizeof(float)*IMG_SZ*5);
+    self->busy=1;
+    Py_BEGIN_ALLOW_THREADS
+    img_plane_mf_sqr3_ext_bat_mt(o,o+IMG_SZ,o+2*IMG_SZ,o+4*IMG_SZ,(float *)bi.buf,1,self->par);
+    img_normal_grad(&self->dp,o+IMG_SZ,o+2*IMG_SZ,o+3*IMG_SZ,o,o+IMG_SZ,o+2*IMG_SZ,self->par);
+    Py_END_ALLOW_THREADS
+    self->busy=0;
+
+    PyBuffer_Release(&bi);
+    PyBuffer_Release(&bo);
+    return ret;
+}
+
+static PyMethodDef deproj_methods[]=
+{
+    { "run", (PyCFunction)(void (*)(void))deproj_run, METH_VARARGS|METH_KEYWORDS,
+      "run(src, out=None, scale=0.001) -> out\nDeproject one depth frame (float32 in m, or uint16/int16 times scale)\n"
+      "to x/y/z planes, out is float32 (3, HGT, WID) and created when omitted; negative int16 depth is invalid (0)." },
+    { "crop", (PyCFunction)(void (*)(void))deproj_crop, METH_VARARGS|METH_KEYWORDS,
+      "crop(src, out, idx, dmin, dmax, T=None, scale=0.001) -> n\nDeproject, keep depths in [dmin, dmax] (zero and negative int16 depth dropped),\n"
+      "transform by the 4x4 float32 T and write the n kept points compacted to out[0..2][:n] (float32, 3*HGT*WID)\n"
+      "and their pixel indices to idx[:n] (int32, HGT*WID, may be None)." },
+    { "plane_mf", (PyCFunction)(void (*)(void))deproj_plane_mf, METH_VARARGS|METH_KEYWORDS,
+      "plane_mf(src, out=None) -> out\n3x3 plane matched filter of a float32 depth frame (m) that also keeps the winning plane:\n"
+      "out is float32 (5, HGT, WID) = filtered depth, nx, ny, nz (unit normal from the plane slope) and the fit\n"
+      "mean squared residual (m^2, a confidence), created when omitted; the 1-pixel border is 0." },
+    { NULL }
+};
+
+static PyTypeObject deproj_type=
+{
+    PyVarObject_HEAD_INIT(NULL,0)
+    .tp_name     ="_img_filter.Deproj",
+    .tp_basicsize=sizeof(deproj_obj),
+    .tp_dealloc  =(destructor)deproj_dealloc,
+    .tp_flags    =Py_TPFLAGS_DEFAULT,
+    .tp_doc      ="Deproj(fx, fy, cx, cy, skew=0, dist=None, threads=1)\nDepth deprojection with a per-pixel ray table (img_deproj.h),\n"
+                  "intrinsics in pixels of a WIDxHGT frame, dist=(k1, k2, p1, p2, k3).",
+    .tp_methods  =deproj_methods,
+    .tp_init     =(initproc)deproj_init,
+    .tp_new      =PyType_GenericNew,
+};
+
+
+/*-------------------------------- Normals --------------------------------*/
+
+typedef struct
+{
+    PyObject_HEAD
+    struct img_pool_s   pool;
+    struct img_par_s   *par;
+    struct img_normal_s ne;
+    int                 ok;         // 估计器已建立
+    int                 busy;       // 正在计算（GIL已释放）
+} normal_obj;
+
+
+static int normal_init(normal_obj *self, PyObject *args, PyObject *kw)
+{
+    static char *kwlist[]={ "mode", "r", "max_dz", "threads", NULL };
+    const char *mode="cross";
+    float max_dz=0.05f;
+    int r=0,n_thr=1,m;
+
+    if (!PyArg_ParseTupleAndKeywords(args,kw,"|sifi",kwlist,&mode,&r,&max_dz,&n_thr))
+        return -1;
+    if (self->ok)
+    {
+        PyErr_SetString(PyExc_RuntimeError,"Normals already initialized");
+        return -1;
+    }
+    if (strcmp(mode,"cross")==0)
+        m=IMG_NORMAL_CROSS;
+    else if (strcmp(mode,"cov")==0)
+        m=IMG_NORMAL_COV;
+    else
+    {
+        PyErr_Format(PyExc_ValueError,"mode '%s', expected 'cross' or 'cov'",mode);
+        return -1;
+    }
+    if (r<=0)
+        r=(m==IMG_NORMAL_COV) ? 3 : 1;
+
+    if (img_pool_init(&self->pool,sizeof(double)*(IMG_WID+1)*(IMG_HGT+1)*IMG_NORMAL_II+(1u<<20),IMG_POOL_PREFAULT))
+    {
+        PyErr_NoMemory();
+        return -1;
+    }
+    if (img_normal_init(&self->ne,m,r,max_dz,&self->pool))
+    {
+        img_pool_destroy(&self->pool);
+        PyErr_Format(PyExc_ValueError,"bad radius %d",r);
+        return -1;
+    }
+    if (n_thr>1)
+        self->par=img_par_create(n_thr);
+    self->ok=1;
+    return 0;
+}
+
+static void normal_dealloc(normal_obj *self)
+{
+    if (self->ok)
+    {
+        img_normal_release(&self->ne);
+        img_par_destroy(self->par);
+        img_pool_destroy(&self->pool);
+    }
+    Py_TYPE(self)->tp_free((PyObject *)self);
+}
+
+static PyObject *normal_run(normal_obj *self, PyObject *args, PyObject *kw)
+{
+    static char *kwlist[]={ "xyz", "out", "curv", NULL };
+    PyObject *src,*out=Py_None,*curv=Py_None,*ret;
+    Py_buffer bi,bo,bc;
+    float *p,*n;
+
+    if (!PyArg_ParseTupleAndKeywords(args,kw,"O|OO",kwlist,&src,&out,&curv))
+        return NULL;
+    if (!self->ok || self->busy)
+    {
+        PyErr_SetString(PyExc_RuntimeError,self->ok ? "Normals is running in another thread" : "Normals not initialized");
+        return NULL;
+    }
+    memset(&bc,0,sizeof(bc));
+    if (get_buf(src,&bi,0,"f",3*IMG_SZ,"xyz"))
+        return NULL;
+    if (out==Py_None)
+        ret=new_img(&bo,3);
+    else if (get_buf(out,&bo,1,"f",3*IMG_SZ,"out")==0)
+    {
+        ret=out;
+        Py_INCREF(ret);
+    }
+    else
+        ret=NULL;
+    if (ret && curv!=Py_None && get_buf(curv,&bc,1,"f",IMG_SZ,"curv"))
+    {
+        PyBuffer_Release(&bo);
+        Py_CLEAR(ret);
+    }
+    if (ret==NULL)
+    {
+        PyBuffer_Release(&bi);
+        return NULL;
+    }
+
+    p=(float *)bi.buf;
+    n=(float *)bo.buf;
+    self->busy=1;
+    Py_BEGIN_ALLOW_THREADS
+    img_normal_run(&self->ne,n,n+IMG_SZ,n+2*IMG_SZ,(float *)bc.buf,p,p+IMG_SZ,p+2*IMG_SZ,self->par);
+    Py_END_ALLOW_THREADS
+    self->busy=0;
+
+    PyBuffer_Release(&bi);
+    PyBuffer_Release(&bo);
+    if (bc.obj)
+        PyBuffer_Release(&bc);
+    return ret;
+}
+
+static PyMethodDef normal_methods[]=
+{
+    { "run", (PyCFunction)(void (*)(void))normal_run, METH_VARARGS|METH_KEYWORDS,
+      "run(xyz, out=None, curv=None) -> out\nEstimate unit normals (toward the camera, 0 where invalid) of an organized\n"
+      "float32 (3, HGT, WID) cloud; curv receives the curvature in 'cov' mode (float32 HGT*WID, may be None)." },
+    { NULL }
+};
+
+static PyTypeObject normal_type=
+{
+    PyVarObject_HEAD_INIT(NULL,0)
+    .tp_name     ="_img_filter.Normals",
+    .tp_basicsize=sizeof(normal_obj),
+    .tp_dealloc  =(destructor)normal_dealloc,
+    .tp_flags    =Py_TPFLAGS_DEFAULT,
+    .tp_doc      ="Normals(mode='cross', r=0, max_dz=0.05, threads=1)\nOrganized normal estimation (img_normal.h): 'cross' (difference\n"
+                  "distance r, default 1) or 'cov' (integral-image covariance, window radius r, default 3).",
+    .tp_methods  =normal_methods,
+    .tp_init     =(initproc)normal_init,
+    .tp_new      =PyType_GenericNew,
+};
+
+
+/*-------------------------------- Proj --------------------------------*/
+
+typedef struct
+{
+    PyObject_HEAD
+    struct img_pool_s   pool;
+    struct img_par_s   *par;
+    struct img_proj_s   pj;
+    int                 ok;         // 投影器已建立
+    int                 busy;       // 正在投影（GIL已释放）
+} proj_obj;
+
+
+static int proj_init(proj_obj *self, PyObject *args, PyObject *kw)
+{
+    static char *kwlist[]={ "fx", "fy", "cx", "cy", "skew", "dist", "threads", NULL };
+    struct img_cam_s cam;
+    PyObject *dist=Py_None;
+    int n_thr=1;
+
+    memset(&cam,0,sizeof(cam));
+    if (!PyArg_ParseTupleAndKeywords(args,kw,"ffff|fOi",kwlist,&cam.fx,&cam.fy,&cam.cx,&cam.cy,&cam.skew,&dist,&n_thr))
+        return -1;
+    if (self->ok)
+    {
+        PyErr_SetString(PyExc_RuntimeError,"Proj already initialized");
+        return -1;
+    }
+    if (dist!=Py_None)
+    {
+        PyObject *t=PySequence_Tuple(dist);
+        int ok=t && PyArg_ParseTuple(t,"ff|fff;dist: (k1, k2[, p1, p2[, k3]])",&cam.k1,&cam.k2,&cam.p1,&cam.p2,&cam.k3);
+        Py_XDECREF(t);
+        if (!ok)
+            return -1;
+    }
+
+    if (img_pool_init(&self->pool,sizeof(uint64_t)*IMG_SZ+(1u<<20),IMG_POOL_PREFAULT))
+    {
+        PyErr_NoMemory();
+        return -1;
+    }
+    if (img_proj_init(&self->pj,&cam,&self->pool))
+    {
+        img_pool_destroy(&self->pool);
+        PyErr_SetString(PyExc_ValueError,"bad camera intrinsics");
+        return -1;
+    }
+    if (n_thr>1)
+        self->par=img_par_create(n_thr);
+    self->ok=1;
+    return 0;
+}
+
+static void proj_dealloc(proj_obj *self)
+{
+    if (self->ok)
+    {
+        img_proj_release(&self->pj);
+        img_par_destroy(self->par);
+        img_pool_destroy(&self->pool);
+    }
+    Py_TYPE(self)->tp_free((PyObject *)self);
+}
+
+static PyObject *proj_run(proj_obj *self, PyObject *args, PyObject *kw)
+{
+    static char *kwlist[]={ "xyz", "out", "idx", "rgb", "rgb_out", "T", "r", NULL };
+    PyObject *src,*out=Py_None,*idx=Py_None,*rgb=Py_None,*rgb_out=Py_None,*T=Py_None,*ret=NULL;
+    Py_buffer bi,bo,bx,bc,bco,bt;
+    float *p;
+    int r=0,n;
+
+    if (!PyArg_ParseTupleAndKeywords(args,kw,"O|OOOOOi",kwlist,&src,&out,&idx,&rgb,&rgb_out,&T,&r))
+        return NULL;
+    if (!self->ok || self->busy)
+    {
+        PyErr_SetString(PyExc_RuntimeError,self->ok ? "Proj is running in another thread" : "Proj not initialized");
+        return NULL;
+    }
+    memset(&bo,0,sizeof(bo));
+    memset(&bx,0,sizeof(bx));
+    memset(&bc,0,sizeof(bc));
+    memset(&bco,0,sizeof(bco));
+    memset(&bt,0,sizeof(bt));
+    if (get_buf(src,&bi,0,"f",0,"xyz"))
+        return NULL;
+    n=(int)(bi.len/sizeof(float)/3);
+    if (bi.len!=(Py_ssize_t)sizeof(float)*3*n)
+        PyErr_SetString(PyExc_ValueError,"xyz: expected float32 (3, n)");
+    else if ((rgb==Py_None)!=(rgb_out==Py_None))
+        PyErr_SetString(PyExc_ValueError,"rgb and rgb_out go together");
+    else if ((idx!=Py_None && get_buf(idx,&bx,1,"i",IMG_SZ,"idx"))
+             || (rgb!=Py_None && (get_buf(rgb,&bc,0,"B",3*(Py_ssize_t)n,"rgb") || get_buf(rgb_out,&bco,1,"B",3*IMG_SZ,"rgb_out")))
+             || (T!=Py_None && get_buf(T,&bt,0,"f",16,"T")))
+        ;
+    else if (out==Py_None)
+        ret=new_img(&bo,1);
+    else if (get_buf(out,&bo,1,"f",IMG_SZ,"out")==0)
+    {
+        ret=out;
+        Py_INCREF(ret);
+    }
+
+    if (ret)
+    {
+        p=(float *)bi.buf;
+        self->busy=1;
+        Py_BEGIN_ALLOW_THREADS
+        img_proj_run(&self->pj,(float *)bo.buf,(int32_t *)bx.buf,(uint8_t *)bco.buf,p,p+n,p+2*(size_t)n,
+                     (const uint8_t *)bc.buf,n,(const float *)bt.buf,r,self->par);
+        Py_END_ALLOW_THREADS
+        self->busy=0;
+    }
+
+    PyBuffer_Release(&bi);
+    if (bo.obj)
+        PyBuffer_Release(&bo);
+    if (bx.obj)
+        PyBuffer_Release(&bx);
+    if (bc.obj)
+        PyBuffer_Release(&bc);
+    if (bco.obj)
+        PyBuffer_Release(&bco);
+    if (bt.obj)
+        PyBuffer_Release(&bt);
+    return ret;
+}
+
+static PyMethodDef proj_methods[]=
+{
+    { "run", (PyCFunction)(void (*)(void))proj_run, METH_VARARGS|METH_KEYWORDS,
+      "run(xyz, out=None, idx=None, rgb=None, rgb_out=None, T=None, r=0) -> out\nProject a float32 (3, n) cloud, transformed by\n"
+      "the 4x4 float32 T, to a float32 (HGT, WID) depth image keeping the nearest point per pixel (0 where empty);\n"
+      "idx receives the point index per pixel (int32 HGT*WID, -1 where empty), rgb_out the color of that point\n"
+      "(uint8 HGT*WID*3) from rgb (uint8 (n, 3)); r > 0 splats each point to a (2r+1)^2 square." },
+    { NULL }
+};
+
+static PyTypeObject proj_type=
+{
+    PyVarObject_HEAD_INIT(NULL,0)
+    .tp_name     ="_img_filter.Proj",
+    .tp_basicsize=sizeof(proj_obj),
+    .tp_dealloc  =(destructor)proj_dealloc,
+    .tp_flags    =Py_TPFLAGS_DEFAULT,
+    .tp_doc      ="Proj(fx, fy, cx, cy, skew=0, dist=None, threads=1)\nParallel z-buffer projection of point clouds (img_proj.h),\n"
+                  "intrinsics in pixels of a WIDxHGT frame, dist=(k1, k2, p1, p2, k3).",
+    .tp_methods  =proj_methods,
+    .tp_init     =(initproc)proj_init,
+    .tp_new      =PyType_GenericNew,
+};
+
+
+/*-------------------------------- Reg --------------------------------*/
+
+typedef struct
+{
+    PyObject_HEAD
+    struct img_pool_s   pool;
+    struct img_par_s   *par;
+    struct img_reg_s    reg;
+    int                 ok;         // 配准器已建立
+    int                 busy;       // 正在配准（GIL已释放）
+} reg_obj;
+
+
+// 相机参数序列(fx, fy, cx, cy[, skew[, k1, k2, p1, p2, k3]])
+static int get_cam(PyObject *o, struct img_cam_s *cam, const char *fmt)
+{
+    PyObject *t=PySequence_Tuple(o);
+    int ok;
+
+    memset(cam,0,sizeof(*cam));
+    ok=t && PyArg_ParseTuple(t,fmt,&cam->fx,&cam->fy,&cam->cx,&cam->cy,&cam->skew,&cam->k1,&cam->k2,&cam->p1,&cam->p2,&cam->k3);
+    Py_XDECREF(t);
+    return ok ? 0 : -1;
+}
+
+
+static int reg_init(reg_obj *self, PyObject *args, PyObject *kw)
+{
+    static char *kwlist[]={ "dcam", "ccam", "cw", "ch", "R", "t", "threads", NULL };
+    struct img_cam_s cam_d,cam_c;
+    PyObject *dcam,*ccam,*R,*t,*tu;
+    float r[9],tr[3];
+    int cw,ch,n_thr=1,ok;
+
+    if (!PyArg_ParseTupleAndKeywords(args,kw,"OOiiOO|i",kwlist,&dcam,&ccam,&cw,&ch,&R,&t,&n_thr))
+        return -1;
+    if (self->ok)
+    {
+        PyErr_SetString(PyExc_RuntimeError,"Reg already initialized");
+        return -1;
+    }
+    if (get_cam(dcam,&cam_d,"ffff|ffffff;dcam: (fx, fy, cx, cy[, skew[, k1, k2, p1, p2, k3]])")
+        || get_cam(ccam,&cam_c,"ffff|ffffff;ccam: (fx, fy, cx, cy[, skew[, k1, k2, p1, p2, k3]])"))
+        return -1;
+    tu=PySequence_Tuple(R);
+    ok=tu && PyArg_ParseTuple(tu,"fffffffff;R: 9 floats, row-major",r,r+1,r+2,r+3,r+4,r+5,r+6,r+7,r+8);
+    Py_XDECREF(tu);
+    if (!ok)
+        return -1;
+    tu=PySequence_Tuple(t);
+    ok=tu && PyArg_ParseTuple(tu,"fff;t: 3 floats",tr,tr+1,tr+2);
+    Py_XDECREF(tu);
+    if (!ok)
+        return -1;
+
+    if (cw<1 || ch<1 || img_pool_init(&self->pool,sizeof(float)*IMG_SZ*11+sizeof(uint32_t)*(cw+1)*(ch+3)+(1u<<20),IMG_POOL_PREFAULT))
+    {
+        PyErr_SetString(PyExc_ValueError,"bad color size or out of memory");
+        return -1;
+    }
+    if (img_reg_init(&self->reg,&cam_d,&cam_c,cw,ch,r,tr,&self->pool))
+    {
+        img_pool_destroy(&self->pool);
+        PyErr_SetString(PyExc_ValueError,"bad camera parameters");
+        return -1;
+    }
+    if (n_thr>1)
+        self->par=img_par_create(n_thr);
+    self->ok=1;
+    return 0;
+}
+
+static void reg_dealloc(reg_obj *self)
+{
+    if (self->ok)
+    {
+        img_reg_release(&self->reg);
+        img_par_destroy(self->par);
+        img_pool_destroy(&self->pool);
+    }
+    Py_TYPE(self)->tp_free((PyObject *)self);
+}
+
+static PyObject *reg_run(reg_obj *self, PyObject *args, PyObject *kw)
+{
+    static char *kwlist[]={ "dep", "rgb", "out", "idx", "dep_c", "tol", NULL };
+    PyObject *dep,*rgb=Py_None,*out=Py_None,*idx=Py_None,*dep_c=Py_None;
+    Py_buffer bi,bc,bo,bx,bd;
+    Py_ssize_t csz=(Py_ssize_t)self->reg.cw*self->reg.ch;
+    float tol=0.02f;
+    int err=0;
+
+    if (!PyArg_ParseTupleAndKeywords(args,kw,"O|OOOOf",kwlist,&dep,&rgb,&out,&idx,&dep_c,&tol))
+        return NULL;
+    if (!self->ok || self->busy)
+    {
+        PyErr_SetString(PyExc_RuntimeError,self->ok ? "Reg is running in another thread" : "Reg not initialized");
+        return NULL;
+    }
+    memset(&bc,0,sizeof(bc));
+    memset(&bo,0,sizeof(bo));
+    memset(&bx,0,sizeof(bx));
+    memset(&bd,0,sizeof(bd));
+    if (get_buf(dep,&bi,0,"f",IMG_SZ,"dep"))
+        return NULL;
+    if ((rgb==Py_None)!=(out==Py_None))
+    {
+        PyErr_SetString(PyExc_ValueError,"rgb and out go together");
+        err=1;
+    }
+    else if ((rgb!=Py_None && (get_buf(rgb,&bc,0,"B",3*csz,"rgb") || get_buf(out,&bo,1,"B",3*IMG_SZ,"out")))
+             || (idx!=Py_None && get_buf(idx,&bx,1,"i",IMG_SZ,"idx"))
+             || (dep_c!=Py_None && get_buf(dep_c,&bd,1,"f",csz,"dep_c")))
+        err=1;
+
+    if (!err)
+    {
+        self->busy=1;
+        Py_BEGIN_ALLOW_THREADS
+        img_reg_run(&self->reg,(uint8_t *)bo.buf,(int32_t *)bx.buf,(float *)bd.buf,(const float *)bi.buf,
+                    (const uint8_t *)bc.buf,tol,self->par);
+        Py_END_ALLOW_THREADS
+        self->busy=0;
+    }
+
+    PyBuffer_Release(&bi);
+    if (bc.obj)
+        PyBuffer_Release(&bc);
+    if (bo.obj)
+        PyBuffer_Release(&bo);
+    if (bx.obj)
+        PyBuffer_Release(&bx);
+    if (bd.obj)
+        PyBuffer_Release(&bd);
+    if (err)
+        return NULL;
+    Py_RETURN_NONE;
+}
+
+static PyMethodDef reg_methods[]=
+{
+    { "run", (PyCFunction)(void (*)(void))reg_run, METH_VARARGS|METH_KEYWORDS,
+      "run(dep, rgb=None, out=None, idx=None, dep_c=None, tol=0.02)\nRegister one float32 depth frame (m) with the color camera:\n"
+      "out receives rgb (uint8 ch*cw*3) sampled at every depth pixel (uint8 HGT*WID*3, 0 where invalid or occluded),\n"
+      "idx the color pixel index per depth pixel (int32 HGT*WID, -1 where invalid or occluded) and dep_c the depth\n"
+      "seen by the color camera (float32 ch*cw, nearest point, 0 where empty); tol is the relative occlusion tolerance." },
+    { NULL }
+};
+
+static PyTypeObject reg_type=
+{
+    PyVarObject_HEAD_INIT(NULL,0)
+    .tp_name     ="_img_filter.Reg",
+    .tp_basicsize=sizeof(reg_obj),
+    .tp_dealloc  =(destructor)reg_dealloc,
+    .tp_flags    =Py_TPFLAGS_DEFAULT,
+    .tp_doc      ="Reg(dcam, ccam, cw, ch, R, t, threads=1)\nDepth to color registration with cached mapping tables (img_reg.h),\n"
+                  "cameras are (fx, fy, cx, cy[, skew[, k1, k2, p1, p2, k3]]) in pixels of the WIDxHGT depth and cwxch color frames,\n"
+                  "R (row-major 3x3) and t (m) take depth camera points to the color camera.",
+    .tp_methods  =reg_methods,
+    .tp_init     =(initproc)reg_init,
+    .tp_new      =PyType_GenericNew,
+};
+
+
+/*-------------------------------- Cloud --------------------------------*/
+
+typedef struct
+{
+    PyObject_HEAD
+    struct img_pc_s     pc;
+    int                 ok;         // 点云已建立
+    int                 busy;       // 正在变换（GIL已释放）
+    Py_ssize_t          n_exp;      // 导出的列视图数，不为0时不能重新分配
+} cloud_obj;
+
+// 点云的一列或一组列（坐标、法向量为列间距cap的(3,n)跨步数组），只用于导出缓冲区：memoryview持有它，它持有点云
+typedef struct
+{
+    PyObject_HEAD
+    cloud_obj          *cl;
+    void               *buf;
+    const char         *fmt;
+    int                 ndim;
+    Py_ssize_t          itemsize;
+    Py_ssize_t          shape[2];
+    Py_ssize_t          strides[2];
+} col_obj;
+
+static PyTypeObject cloud_type;
+
+
+static void col_dealloc(col_obj *self)
+{
+    Py_XDECREF(self->cl);
+    Py_TYPE(self)->tp_free((PyObject *)self);
+}
+
+static int col_getbuffer(col_obj *self, Py_buffer *view, int flags)
+{
+    int contig=(self->ndim==1 || self->strides[0]==self->shape[1]*self->strides[1]);
+
+    if ((!contig && ((flags&PyBUF_STRIDES)!=PyBUF_STRIDES || (flags&PyBUF_C_CONTIGUOUS)==PyBUF_C_CONTIGUOUS
+                     || (flags&PyBUF_ANY_CONTIGUOUS)==PyBUF_ANY_CONTIGUOUS))
+        || (self->ndim>1 && (flags&PyBUF_F_CONTIGUOUS)==PyBUF_F_CONTIGUOUS))
+    {
+        PyErr_SetString(PyExc_BufferError,"Cloud view is not contiguous (column stride is the capacity)");
+        return -1;
+    }
+    view->obj=(PyObject *)self;
+    Py_INCREF(self);
+    view->buf=self->buf;
+    view->itemsize=self->itemsize;
+    view->len=self->shape[0]*(self->ndim>1 ? self->shape[1] : 1)*self->itemsize;
+    view->readonly=0;
+    view->format=(flags&PyBUF_FORMAT) ? (char *)self->fmt : NULL;
+    view->ndim=self->ndim;
+    view->shape=((flags&PyBUF_ND)==PyBUF_ND) ? self->shape : NULL;
+    view->strides=((flags&PyBUF_STRIDES)==PyBUF_STRIDES) ? self->strides : NULL;
+    view->suboffsets=NULL;
+    view->internal=NULL;
+    self->cl->n_exp++;
+    return 0;
+}
+
+static void col_releasebuffer(col_obj *self, Py_buffer *view)
+{
+    (void)view;
+    self->cl->n_exp--;
+}
+
+static PyBufferProcs col_as_buffer=
+{
+    (getbufferproc)col_getbuffer,
+    (releasebufferproc)col_releasebuffer,
+};
+
+static PyTypeObject col_type=
+{
+    PyVarObject_HEAD_INIT(NULL,0)
+    .tp_name     ="_img_filter.CloudColumn",
+    .tp_basicsize=sizeof(col_obj),
+    .tp_dealloc  =(destructor)col_dealloc,
+    .tp_as_buffer=&col_as_buffer,
+    .tp_flags    =Py_TPFLAGS_DEFAULT,
+    .tp_doc      ="Buffer exporter behind the views returned by Cloud.",
+};
+
+// 点云内存的memoryview（n0个元素，ndim为2时n0*n1个，第一维跨度s0字节），不拷贝
+static PyObject *cloud_view(cloud_obj *self, void *buf, const char *fmt, Py_ssize_t itemsize, int ndim,
+                            Py_ssize_t n0, Py_ssize_t n1, Py_ssize_t s0)
+{
+    col_obj *c;
+    PyObject *mv;
+
+    if (!self->ok)
+    {
+        PyErr_SetString(PyExc_RuntimeError,"Cloud not initialized");
+        return NULL;
+    }
+    if ((c=PyObject_New(col_obj,&col_type))==NULL)
+        return NULL;
+    Py_INCREF(self);
+    c->cl=self;
+    c->buf=buf;
+    c->fmt=fmt;
+    c->itemsize=itemsize;
+    c->ndim=ndim;
+    c->shape[0]=n0;
+    c->shape[1]=n1;
+    c->strides[0]=(ndim>1) ? s0 : itemsize;
+    c->strides[1]=itemsize;
+    mv=PyMemoryView_FromObject((PyObject *)c);
+    Py_DECREF(c);
+    return mv;
+}
+
+// 点云可以修改：已建立且没有在其他线程中变换
+static int cloud_check(cloud_obj *self)
+{
+    if (!self->ok || self->busy)
+    {
+        PyErr_SetString(PyExc_RuntimeError,self->ok ? "Cloud is busy in another thread" : "Cloud not initialized");
+        return -1;
+    }
+    return 0;
+}
+
+// 容量需要扩大到cap时重新分配，导出的视图会失效，不允许
+static int cloud_grow_check(cloud_obj *self, Py_ssize_t cap)
+{
+    if (cap>self->pc.cap && self->n_exp)
+    {
+        PyErr_SetString(PyExc_BufferError,"views of the Cloud are still in use, reserve the capacity before taking views");
+        return -1;
+    }
+    if (cap>INT32_MAX/3-IMG_PC_ALIGN)
+    {
+        PyErr_SetString(PyExc_OverflowError,"too many points");
+        return -1;
+    }
+    return 0;
+}
+
+
+static int cloud_init(cloud_obj *self, PyObject *args, PyObject *kw)
+{
+    static char *kwlist[]={ "n", "normals", "rgb", "fields", NULL };
+    PyObject *fields=NULL,*seq;
+    Py_ssize_t i;
+    int n=0,nrm=0,rgb=0;
+
+    if (!PyArg_ParseTupleAndKeywords(args,kw,"|ippO",kwlist,&n,&nrm,&rgb,&fields))
+        return -1;
+    if (self->ok)
+    {
+        PyErr_SetString(PyExc_RuntimeError,"Cloud already initialized");
+        return -1;
+    }
+    if (n<0 || cloud_grow_check(self,n))
+    {
+        if (n<0)
+            PyErr_SetString(PyExc_ValueError,"negative number of points");
+        return -1;
+    }
+    if (img_pc_init(&self->pc,n,(nrm ? IMG_PC_NRM : 0)|(rgb ? IMG_PC_RGB : 0)))
+    {
+        PyErr_NoMemory();
+        return -1;
+    }
+    self->ok=1;
+    if (fields==NULL || fields==Py_None)
+        return 0;
+
+    if ((seq=PySequence_Fast(fields,"fields: sequence of names"))==NULL)
+        return -1;
+    for (i=0;i<PySequence_Fast_GET_SIZE(seq);i++)
+    {
+        const char *name=PyUnicode_AsUTF8(PySequence_Fast_GET_ITEM(seq,i));
+        if (name==NULL || img_pc_add_field(&self->pc,name)<0)
+        {
+            if (name)
+                PyErr_Format(PyExc_ValueError,"bad field '%s' (at most %d fields of %d characters)",
+                             name,IMG_PC_FIELD_MAX,IMG_PC_NAME_MAX-1);
+            Py_DECREF(seq);
+            return -1;
+        }
+    }
+    Py_DECREF(seq);
+    return 0;
+}
+
+static void cloud_dealloc(cloud_obj *self)
+{
+    if (self->ok)
+        img_pc_release(&self->pc);
+    Py_TYPE(self)->tp_free((PyObject *)self);
+}
+
+static Py_ssize_t cloud_len(cloud_obj *self)
+{
+    return self->ok ? self->pc.n : 0;
+}
+
+static PyObject *cloud_get_xyz(cloud_obj *self, void *closure)
+{
+    (void)closure;
+    return cloud_view(self,self->pc.x,"f",sizeof(float),2,3,self->pc.n,sizeof(float)*(Py_ssize_t)self->pc.cap);
+}
+
+static PyObject *cloud_get_normals(cloud_obj *self, void *closure)
+{
+    (void)closure;
+    if (self->ok && self->pc.nx==NULL)
+        Py_RETURN_NONE;
+    return cloud_view(self,self->pc.nx,"f",sizeof(float),2,3,self->pc.n,sizeof(float)*(Py_ssize_t)self->pc.cap);
+}
+
+static PyObject *cloud_get_rgb(cloud_obj *self, void *closure)
+{
+    (void)closure;
+    if (self->ok && self->pc.rgb==NULL)
+        Py_RETURN_NONE;
+    return cloud_view(self,self->pc.rgb,"B",1,2,self->pc.n,3,3);
+}
+
+static PyObject *cloud_get_fields(cloud_obj *self, void *closure)
+{
+    PyObject *t=PyTuple_New(self->pc.n_f),*s;
+    int i;
+
+    (void)closure;
+    for (i=0;t && i<self->pc.n_f;i++)
+    {
+        if ((s=PyUnicode_FromString(self->pc.f_name[i]))==NULL)
+        {
+            Py_CLEAR(t);
+            break;
+        }
+        PyTuple_SET_ITEM(t,i,s);
+    }
+    return t;
+}
+
+static PyObject *cloud_get_cap(cloud_obj *self, void *closure)
+{
+    (void)closure;
+    return PyLong_FromLong(self->pc.cap);
+}
+
+static PyObject *cloud_field(cloud_obj *self, PyObject *arg)
+{
+    const char *name=PyUnicode_AsUTF8(arg);
+    int i;
+
+    if (name==NULL)
+        return NULL;
+    if ((i=img_pc_field(&self->pc,name))<0)
+    {
+        PyErr_Format(PyExc_KeyError,"no field '%s'",name);
+        return NULL;
+    }
+    return cloud_view(self,self->pc.f[i],"f",sizeof(float),1,self->pc.n,0,0);
+}
+
+static PyObject *cloud_add_field(cloud_obj *self, PyObject *arg)
+{
+    const char *name=PyUnicode_AsUTF8(arg);
+
+    if (name==NULL || cloud_check(self))
+        return NULL;
+    if (img_pc_add_field(&self->pc,name)<0)
+    {
+        PyErr_Format(PyExc_ValueError,"bad field '%s' (at most %d fields of %d characters)",name,IMG_PC_FIELD_MAX,IMG_PC_NAME_MAX-1);
+        return NULL;
+    }
+    return cloud_view(self,self->pc.f[img_pc_field(&self->pc,name)],"f",sizeof(float),1,self->pc.n,0,0);
+}
+
+static PyObject *cloud_add_cols(cloud_obj *self, PyObject *args, PyObject *kw)
+{
+    static char *kwlist[]={ "normals", "rgb", NULL };
+    int nrm=0,rgb=0;
+
+    if (!PyArg_ParseTupleAndKeywords(args,kw,"|pp",kwlist,&nrm,&rgb) || cloud_check(self))
+        return NULL;
+    if (img_pc_add_cols(&self->pc,(nrm ? IMG_PC_NRM : 0)|(rgb ? IMG_PC_RGB : 0)))
+        return PyErr_NoMemory();
+    Py_RETURN_NONE;
+}
+
+static PyObject *cloud_reserve(cloud_obj *self, PyObject *arg)
+{
+    Py_ssize_t cap=PyLong_AsSsize_t(arg);
+
+    if ((cap==-1 && PyErr_Occurred()) || cloud_check(self) || cloud_grow_check(self,cap))
+        return NULL;
+    if (img_pc_reserve(&self->pc,(int)cap))
+        return PyErr_NoMemory();
+    Py_RETURN_NONE;
+}
+
+static PyObject *cloud_resize(cloud_obj *self, PyObject *arg)
+{
+    Py_ssize_t n=PyLong_AsSsize_t(arg);
+
+    if ((n==-1 && PyErr_Occurred()) || cloud_check(self) || cloud_grow_check(self,n))
+        return NULL;
+    if (n<0)
+    {
+        PyErr_SetString(PyExc_ValueError,"negative number of points");
+        return NULL;
+    }
+    if (img_pc_resize(&self->pc,(int)n))
+        return PyErr_NoMemory();
+    Py_RETURN_NONE;
+}
+
+static PyObject *cloud_transform(cloud_obj *self, PyObject *arg)
+{
+    Py_buffer bt;
+
+    if (cloud_check(self) || get_buf(arg,&bt,0,"f",16,"T"))
+        return NULL;
+    self->busy=1;
+    Py_BEGIN_ALLOW_THREADS
+    img_pc_transform(&self->pc,(const float *)bt.buf);
+    Py_END_ALLOW_THREADS
+    self->busy=0;
+    PyBuffer_Release(&bt);
+    Py_RETURN_NONE;
+}
+
+static PyObject *cloud_subset(cloud_obj *self, PyObject *arg)
+{
+    Py_buffer b;
+    int ret=0;
+
+    if (cloud_check(self) || get_buf(arg,&b,0,"?Bbi",0,"sel"))
+        return NULL;
+    if (b.itemsize==sizeof(int32_t))
+    {
+        if (b.len/b.itemsize>self->pc.n || img_pc_subset_idx(&self->pc,(const int32_t *)b.buf,(int)(b.len/b.itemsize)))
+        {
+            PyErr_SetString(PyExc_IndexError,"sel: more indices than points or index out of range");
+            ret=-1;
+        }
+    }
+    else if (b.len!=self->pc.n)
+    {
+        PyErr_Format(PyExc_ValueError,"sel: mask of %zd elements, expected %d",b.len,self->pc.n);
+        ret=-1;
+    }
+    else
+        img_pc_subset_mask(&self->pc,(const uint8_t *)b.buf);
+    PyBuffer_Release(&b);
+    if (ret)
+        return NULL;
+    return PyLong_FromLong(self->pc.n);
+}
+
+static PyObject *cloud_concat(cloud_obj *self, PyObject *arg)
+{
+    cloud_obj *src=(cloud_obj *)arg;
+
+    if (!PyObject_TypeCheck(arg,&cloud_type))
+    {
+        PyErr_SetString(PyExc_TypeError,"concat: expected a Cloud");
+        return NULL;
+    }
+    if (cloud_check(self) || cloud_check(src) || cloud_grow_check(self,(Py_ssize_t)self->pc.n+src->pc.n))
+        return NULL;
+    if (img_pc_concat(&self->pc,&src->pc))
+        return PyErr_NoMemory();
+    Py_RETURN_NONE;
+}
+
+static PyGetSetDef cloud_getset[]=
+{
+    { "xyz",     (getter)cloud_get_xyz,     NULL, "float32 (3, n) view of the coordinates (column stride is the capacity)", NULL },
+    { "normals", (getter)cloud_get_normals, NULL, "float32 (3, n) view of the normals, None without normals", NULL },
+    { "rgb",     (getter)cloud_get_rgb,     NULL, "uint8 (n, 3) view of the colors, None without colors", NULL },
+    { "fields",  (getter)cloud_get_fields,  NULL, "names of the scalar fields", NULL },
+    { "cap",     (getter)cloud_get_cap,     NULL, "capacity in points", NULL },
+    { NULL }
+};
+
+static PyMethodDef cloud_methods[]=
+{
+    { "field",     (PyCFunction)cloud_field,     METH_O,
+      "field(name) -> view\nfloat32 (n,) view of a scalar field." },
+    { "add_field", (PyCFunction)cloud_add_field, METH_O,
+      "add_field(name) -> view\nAdd a zero scalar field (or return the existing one)." },
+    { "add_cols",  (PyCFunction)(void (*)(void))cloud_add_cols, METH_VARARGS|METH_KEYWORDS,
+      "add_cols(normals=False, rgb=False)\nAdd zero normal and/or color columns." },
+    { "reserve",   (PyCFunction)cloud_reserve,   METH_O,
+      "reserve(cap)\nGrow the capacity to at least cap points; fails while views are alive if it has to grow." },
+    { "resize",    (PyCFunction)cloud_resize,    METH_O,
+      "resize(n)\nSet the number of points, new points are zero." },
+    { "transform", (PyCFunction)cloud_transform, METH_O,
+      "transform(T)\nApply the row-major 4x4 float32 rigid transform in place (normals are rotated)." },
+    { "subset",    (PyCFunction)cloud_subset,    METH_O,
+      "subset(sel) -> n\nKeep the points selected by a bool/uint8 mask of n elements or by int32 indices, in place." },
+    { "concat",    (PyCFunction)cloud_concat,    METH_O,
+      "concat(other)\nAppend the points of another Cloud; columns it lacks are zero, extra columns are ignored,\n"
+      "scalar fields are matched by name." },
+    { NULL }
+};
+
+static PySequenceMethods cloud_as_seq=
+{
+    .sq_length=(lenfunc)cloud_len,
+};
+
+static PyTypeObject cloud_type=
+{
+    PyVarObject_HEAD_INIT(NULL,0)
+    .tp_name     ="_img_filter.Cloud",
+    .tp_basicsize=sizeof(cloud_obj),
+    .tp_dealloc  =(destructor)cloud_dealloc,
+    .tp_as_sequence=&cloud_as_seq,
+    .tp_flags    =Py_TPFLAGS_DEFAULT,
+    .tp_doc      ="Cloud(n=0, normals=False, rgb=False, fields=())\nStructure-of-arrays point cloud (img_pc.h) with aligned columns;\n"
+                  "xyz/normals/rgb/field() are zero-copy views of the current n points, taken again after subset/concat/resize.",
+    .tp_methods  =cloud_methods,
+    .tp_getset   =cloud_getset,
+    .tp_init     =(initproc)cloud_init,
+    .tp_new      =PyType_GenericNew,
+};
+
+
+/*-------------------------------- Rigid --------------------------------*/
+
+typedef struct
+{
+    PyObject_HEAD
+    struct img_par_s   *par;
+    int                 ok;         // 已初始化
+    int                 busy;       // 正在变换（GIL已释放）
+} rigid_obj;
+
+
+// 位姿缓冲区：k为每个位姿的float数（16为4x4矩阵，7为四元数加平移），返回位姿数，-1出错
+static Py_ssize_t get_poses(PyObject *o, Py_buffer *b, int writable, int k, const char *name)
+{
+    if (get_buf(o,b,writable,"f",0,name))
+        return -1;
+    if (b->len==0 || b->len%(sizeof(float)*k))
+    {
+        PyErr_Format(PyExc_ValueError,"%s: expected float32 (m, %s)",name,k==16 ? "4, 4" : "7");
+        PyBuffer_Release(b);
+        return -1;
+    }
+    return b->len/(sizeof(float)*k);
+}
+
+// 新建m个位姿的float32缓冲区，k为16时为(m,4,4)，否则为(m,k)
+static PyObject *new_poses(Py_buffer *b, Py_ssize_t m, int k)
+{
+    PyObject *ba,*mv,*ret;
+
+    if ((ba=PyByteArray_FromStringAndSize(NULL,sizeof(float)*k*m))==NULL)
+        return NULL;
+    mv=PyMemoryView_FromObject(ba);
+    Py_DECREF(ba);
+    if (mv==NULL)
+        return NULL;
+    if (k==16)
+        ret=PyObject_CallMethod(mv,"cast","s(nii)","f",m,4,4);
+    else
+        ret=PyObject_CallMethod(mv,"cast","s(ni)","f",m,k);
+    Py_DECREF(mv);
+    if (ret && PyObject_GetBuffer(ret,b,PyBUF_C_CONTIGUOUS|PyBUF_WRITABLE))
+        Py_CLEAR(ret);
+    return ret;
+}
+
+// 输出位姿缓冲区：out为None时新建，否则检查位姿数
+static PyObject *out_poses(PyObject *out, Py_buffer *b, Py_ssize_t m, int k)
+{
+    Py_ssize_t mo;
+
+    if (out==Py_None)
+        return new_poses(b,m,k);
+    if ((mo=get_poses(out,b,1,k,"out"))<0)
+        return NULL;
+    if (mo!=m)
+    {
+        PyErr_Format(PyExc_ValueError,"out: %zd poses, expected %zd",mo,m);
+        PyBuffer_Release(b);
+        return NULL;
+    }
+    Py_INCREF(out);
+    return out;
+}
+
+
+static int rigid_init(rigid_obj *self, PyObject *args, PyObject *kw)
+{
+    static char *kwlist[]={ "threads", NULL };
+    int n_thr=1;
+
+    if (!PyArg_ParseTupleAndKeywords(args,kw,"|i",kwlist,&n_thr))
+        return -1;
+    if (self->ok)
+    {
+        PyErr_SetString(PyExc_RuntimeError,"Rigid already initialized");
+        return -1;
+    }
+    if (n_thr>1)
+        self->par=img_par_create(n_thr);
+    self->ok=1;
+    return 0;
+}
+
+static void rigid_dealloc(rigid_obj *self)
+{
+    if (self->ok)
+        img_par_destroy(self->par);
+    Py_TYPE(self)->tp_free((PyObject *)self);
+}
+
+static PyObject *rigid_apply(rigid_obj *self, PyObject *args, PyObject *kw)
+{
+    static char *kwlist[]={ "dst", "T", "normals", NULL };
+    PyObject *dst,*T,*nrm=Py_None;
+    cloud_obj *cl=NULL;
+    Py_buffer bt,bp,bn;
+    float M[16],*p=NULL,*q=NULL;
+    Py_ssize_t n=0;
+    int err=0;
+
+    if (!PyArg_ParseTupleAndKeywords(args,kw,"OO|O",kwlist,&dst,&T,&nrm))
+        return NULL;
+    if (!self->ok || self->busy)
+    {
+        PyErr_SetString(PyExc_RuntimeError,self->ok ? "Rigid is running in another thread" : "Rigid not initialized");
+        return NULL;
+    }
+    if (get_buf(T,&bt,0,"f",0,"T"))
+        return NULL;
+    if (bt.len==sizeof(float)*16)
+        memcpy(M,bt.buf,sizeof(M));
+    else if (bt.len==sizeof(float)*7)
+        img_rigid_from_qt(M,(const float *)bt.buf,1);
+    else
+    {
+        PyErr_SetString(PyExc_ValueError,"T: expected a float32 4x4 matrix or (qw, qx, qy, qz, tx, ty, tz)");
+        err=1;
+    }
+    PyBuffer_Release(&bt);
+    if (err)
+        return NULL;
+
+    memset(&bp,0,sizeof(bp));
+    memset(&bn,0,sizeof(bn));
+    if (PyObject_TypeCheck(dst,&cloud_type))
+    {
+        cl=(cloud_obj *)dst;
+        if (nrm!=Py_None)
+        {
+            PyErr_SetString(PyExc_ValueError,"normals: a Cloud transforms its own normals");
+            return NULL;
+        }
+        if (cloud_check(cl))
+            return NULL;
+    }
+    else
+    {
+        if (get_buf(dst,&bp,1,"f",0,"dst"))
+            return NULL;
+        n=bp.len/(sizeof(float)*3);
+        if (bp.len!=(Py_ssize_t)sizeof(float)*3*n || n>INT32_MAX)
+        {
+            PyErr_SetString(PyExc_ValueError,"dst: expected a Cloud or float32 (3, n)");
+            err=1;
+        }
+        else if (nrm!=Py_None && get_buf(nrm,&bn,1,"f",3*n,"normals"))
+            err=1;
+        if (err)
+        {
+            PyBuffer_Release(&bp);
+            return NULL;
+        }
+        p=(float *)bp.buf;
+        q=(float *)bn.buf;
+    }
+
+    self->busy=1;
+    if (cl)
+        cl->busy=1;
+    Py_BEGIN_ALLOW_THREADS
+    if (cl)
+        img_rigid_apply_pc(&cl->pc,M,self->par);
+    else
+        img_rigid_apply(p,p+n,p+2*n,q,q ? q+n : NULL,q ? q+2*n : NULL,(int)n,M,self->par);
+    Py_END_ALLOW_THREADS
+    if (cl)
+        cl->busy=0;
+    self->busy=0;
+
+    if (bp.obj)
+        PyBuffer_Release(&bp);
+    if (bn.obj)
+        PyBuffer_Release(&bn);
+    Py_RETURN_NONE;
+}
+
+static PyObject *rigid_compose(rigid_obj *self, PyObject *args, PyObject *kw)
+{
+    static char *kwlist[]={ "A", "B", "out", NULL };
+    PyObject *A,*B,*out=Py_None,*ret=NULL;
+    Py_buffer ba,bb,bo;
+    Py_ssize_t na,nb;
+
+    (void)self;
+    if (!PyArg_ParseTupleAndKeywords(args,kw,"OO|O",kwlist,&A,&B,&out))
+        return NULL;
+    if ((na=get_poses(A,&ba,0,16,"A"))<0)
+        return NULL;
+    if ((nb=get_poses(B,&bb,0,16,"B"))<0)
+    {
+        PyBuffer_Release(&ba);
+        return NULL;
+    }
+    if (na!=nb && na!=1 && nb!=1)
+        PyErr_Format(PyExc_ValueError,"A and B: %zd and %zd poses, expected equal counts or one pose",na,nb);
+    else if (na>INT32_MAX || nb>INT32_MAX)
+        PyErr_SetString(PyExc_OverflowError,"too many poses");
+    else if ((ret=out_poses(out,&bo,(na>nb) ? na : nb,16))!=NULL)
+    {
+        img_rigid_compose((float *)bo.buf,(const float *)ba.buf,(int)na,(const float *)bb.buf,(int)nb);
+        PyBuffer_Release(&bo);
+    }
+    PyBuffer_Release(&ba);
+    PyBuffer_Release(&bb);
+    return ret;
+}
+
+// 逐个位姿的转换：inverse、from_qt、to_qt
+static PyObject *rigid_map(PyObject *args, PyObject *kw, int ki, int ko, void (*fn)(float *, const float *, int))
+{
+    static char *kwlist[]={ "src", "out", NULL };
+    PyObject *src,*out=Py_None,*ret;
+    Py_buffer bi,bo;
+    Py_ssize_t m;
+
+    if (!PyArg_ParseTupleAndKeywords(args,kw,"O|O",kwlist,&src,&out))
+        return NULL;
+    if ((m=get_poses(src,&bi,0,ki,"src"))<0)
+        return NULL;
+    if (m>INT32_MAX)
+    {
+        PyErr_SetString(PyExc_OverflowError,"too many poses");
+        ret=NULL;
+    }
+    else if ((ret=out_poses(out,&bo,m,ko))!=NULL)
+    {
+        fn((float *)bo.buf,(const float *)bi.buf,(int)m);
+        PyBuffer_Release(&bo);
+    }
+    PyBuffer_Release(&bi);
+    return ret;
+}
+
+static PyObject *rigid_inverse(rigid_obj *self, PyObject *args, PyObject *kw)
+{
+    (void)self;
+    return rigid_map(args,kw,16,16,img_rigid_inverse);
+}
+
+static PyObject *rigid_from_qt(rigid_obj *self, PyObject *args, PyObject *kw)
+{
+    (void)self;
+    return rigid_map(args,kw,7,16,img_rigid_from_qt);
+}
+
+static PyObject *rigid_to_qt(rigid_obj *self, PyObject *args, PyObject *kw)
+{
+    (void)self;
+    return rigid_map(args,kw,16,7,img_rigid_to_qt);
+}
+
+static PyMethodDef rigid_methods[]=
+{
+    { "apply",   (PyCFunction)(void (*)(void))rigid_apply,   METH_VARARGS|METH_KEYWORDS,
+      "apply(dst, T, normals=None)\nTransform a Cloud (points and normals) or a float32 (3, n) array (and float32 (3, n)\n"
+      "normals, rotated only) in place by T, a float32 4x4 matrix or (qw, qx, qy, qz, tx, ty, tz);\n"
+      "threaded from 2^20 points." },
+    { "compose", (PyCFunction)(void (*)(void))rigid_compose, METH_VARARGS|METH_KEYWORDS,
+      "compose(A, B, out=None) -> out\nA[i] @ B[i] for float32 (m, 4, 4) poses, either side may be a single pose." },
+    { "inverse", (PyCFunction)(void (*)(void))rigid_inverse, METH_VARARGS|METH_KEYWORDS,
+      "inverse(src, out=None) -> out\nInverse of float32 (m, 4, 4) rigid poses, out may be src." },
+    { "from_qt", (PyCFunction)(void (*)(void))rigid_from_qt, METH_VARARGS|METH_KEYWORDS,
+      "from_qt(src, out=None) -> out\nfloat32 (m, 7) (qw, qx, qy, qz, tx, ty, tz) to (m, 4, 4) matrices." },
+    { "to_qt",   (PyCFunction)(void (*)(void))rigid_to_qt,   METH_VARARGS|METH_KEYWORDS,
+      "to_qt(src, out=None) -> out\nfloat32 (m, 4, 4) matrices to (m, 7) (qw, qx, qy, qz, tx, ty, tz), qw >= 0." },
+    { NULL }
+};
+
+static PyTypeObject rigid_type=
+{
+    PyVarObject_HEAD_INIT(NULL,0)
+    .tp_name     ="_img_filter.Rigid",
+    .tp_basicsize=sizeof(rigid_obj),
+    .tp_dealloc  =(destructor)rigid_dealloc,
+    .tp_flags    =Py_TPFLAGS_DEFAULT,
+    .tp_doc      ="Rigid(threads=1)\nBatched rigid transforms (img_rigid.h): in-place transform of clouds,\n"
+                  "composition, inversion and quaternion conversion of many poses at once.",
+    .tp_methods  =rigid_methods,
+    .tp_init     =(initproc)rigid_init,
+    .tp_new      =PyType_GenericNew,
+};
+
+
+/*-------------------------------- KDTree --------------------------------*/
+
+typedef struct
+{
+    PyObject_HEAD
+    struct img_par_s   *par;
+    struct img_kdt_s    kt;
+    int                 ok;         // 已初始化
+    int                 busy;       // 正在建树或查询（GIL已释放）
+} kdt_obj;
+
+
+// 点：Cloud或者float32 (3,n)数组，Cloud时*cl为该点云（调用者在释放GIL期间置busy），否则b为数组的缓冲区
+static int get_xyz(PyObject *o, Py_buffer *b, cloud_obj **cl, const float **p, Py_ssize_t *n, Py_ssize_t *stride,
+                   const char *name)
+{
+    memset(b,0,sizeof(*b));
+    *cl=NULL;
+    if (PyObject_TypeCheck(o,&cloud_type))
+    {
+        if (cloud_check((cloud_obj *)o))
+            return -1;
+        *cl=(cloud_obj *)o;
+        *p=(*cl)->pc.x;
+        *n=(*cl)->pc.n;
+        *stride=(*cl)->pc.cap;
+        return 0;
+    }
+    if (get_buf(o,b,0,"f",0,name))
+        return -1;
+    *n=b->len/(sizeof(float)*3);
+    if (b->len!=(Py_ssize_t)sizeof(float)*3*(*n) || *n>INT32_MAX)
+    {
+        PyErr_Format(PyExc_ValueError,"%s: expected a Cloud or float32 (3, n)",name);
+        PyBuffer_Release(b);
+        return -1;
+    }
+    *p=(const float *)b->buf;
+    *stride=*n;
+    return 0;
+}
+
+
+static int kdt_init(kdt_obj *self, PyObject *args, PyObject *kw)
+{
+    static char *kwlist[]={ "threads", NULL };
+    int n_thr=1;
+
+    if (!PyArg_ParseTupleAndKeywords(args,kw,"|i",kwlist,&n_thr))
+        return -1;
+    if (self->ok)
+    {
+        PyErr_SetString(PyExc_RuntimeError,"KDTree already initialized");
+        return -1;
+    }
+    if (n_thr>1)
+        self->par=img_par_create(n_thr);
+    self->ok=1;
+    return 0;
+}
+
+static void kdt_dealloc(kdt_obj *self)
+{
+    if (self->ok)
+    {
+        img_kdt_release(&self->kt);
+        img_par_destroy(self->par);
+    }
+    Py_TYPE(self)->tp_free((PyObject *)self);
+}
+
+static Py_ssize_t kdt_len(kdt_obj *self)
+{
+    return self->kt.n;
+}
+
+static PyObject *kdt_build(kdt_obj *self, PyObject *args, PyObject *kw)
+{
+    static char *kwlist[]={ "src", "leaf", NULL };
+    PyObject *src;
+    cloud_obj *cl;
+    Py_buffer b;
+    const float *p;
+    Py_ssize_t n,s;
+    int leaf=16,ret;
+
+    if (!PyArg_ParseTupleAndKeywords(args,kw,"O|i",kwlist,&src,&leaf))
+        return NULL;
+    if (!self->ok || self->busy)
+    {
+        PyErr_SetString(PyExc_RuntimeError,self->ok ? "KDTree is running in another thread" : "KDTree not initialized");
+        return NULL;
+    }
+    if (leaf<1 || leaf>IMG_KDT_LEAF_MAX)
+    {
+        PyErr_Format(PyExc_ValueError,"leaf: 1 to %d points",IMG_KDT_LEAF_MAX);
+        return NULL;
+    }
+    if (get_xyz(src,&b,&cl,&p,&n,&s,"src"))
+        return NULL;
+
+    self->busy=1;
+    if (cl)
+        cl->busy=1;
+    Py_BEGIN_ALLOW_THREADS
+    ret=img_kdt_build(&self->kt,p,p+s,p+2*s,(int)n,leaf,self->par);
+    Py_END_ALLOW_THREADS
+    if (cl)
+        cl->busy=0;
+    self->busy=0;
+
+    if (b.obj)
+        PyBuffer_Release(&b);
+    if (ret)
+        return PyErr_NoMemory();
+    Py_RETURN_NONE;
+}
+
+static PyObject *kdt_query(kdt_obj *self, PyObject *args, PyObject *kw)
+{
+    static char *kwlist[]={ "q", "k", "idx", "dist", "r", "cnt", NULL };
+    PyObject *q,*idx,*dist=Py_None,*cnt=Py_None;
+    cloud_obj *cl;
+    Py_buffer b,bx,bd,bc;
+    const float *p;
+    Py_ssize_t m,s;
+    float r=0;
+    int k,err=0;
+
+    if (!PyArg_ParseTupleAndKeywords(args,kw,"OiO|OfO",kwlist,&q,&k,&idx,&dist,&r,&cnt))
+        return NULL;
+    if (!self->ok || self->busy)
+    {
+        PyErr_SetString(PyExc_RuntimeError,self->ok ? "KDTree is running in another thread" : "KDTree not initialized");
+        return NULL;
+    }
+    if (k<1 || k>IMG_KDT_K_MAX)
+    {
+        PyErr_Format(PyExc_ValueError,"k: 1 to %d neighbours",IMG_KDT_K_MAX);
+        return NULL;
+    }
+    if (get_xyz(q,&b,&cl,&p,&m,&s,"q"))
+        return NULL;
+    memset(&bx,0,sizeof(bx));
+    memset(&bd,0,sizeof(bd));
+    memset(&bc,0,sizeof(bc));
+    if (get_buf(idx,&bx,1,"i",0,"idx") || (dist!=Py_None && get_buf(dist,&bd,1,"f",0,"dist"))
+        || (cnt!=Py_None && get_buf(cnt,&bc,1,"i",0,"cnt")))
+        err=1;
+    else if (bx.len!=(Py_ssize_t)sizeof(int32_t)*k*m || (bd.obj && bd.len!=(Py_ssize_t)sizeof(float)*k*m)
+             || (bc.obj && bc.len!=(Py_ssize_t)sizeof(int32_t)*m))
+    {
+        PyErr_Format(PyExc_ValueError,"idx/dist: expected (%zd, %d), cnt: expected (%zd,)",m,k,m);
+        err=1;
+    }
+
+    if (!err)
+    {
+        self->busy=1;
+        if (cl)
+            cl->busy=1;
+        Py_BEGIN_ALLOW_THREADS
+        img_kdt_query(&self->kt,p,p+s,p+2*s,(int)m,k,r,(int32_t *)bx.buf,(float *)bd.buf,(int32_t *)bc.buf,self->par);
+        Py_END_ALLOW_THREADS
+        if (cl)
+            cl->busy=0;
+        self->busy=0;
+    }
+
+    if (b.obj)
+        PyBuffer_Release(&b);
+    if (bx.obj)
+        PyBuffer_Release(&bx);
+    if (bd.obj)
+        PyBuffer_Release(&bd);
+    if (bc.obj)
+        PyBuffer_Release(&bc);
+    if (err)
+        return NULL;
+    Py_RETURN_NONE;
+}
+
+static PyMethodDef kdt_methods[]=
+{
+    { "build", (PyCFunction)(void (*)(void))kdt_build, METH_VARARGS|METH_KEYWORDS,
+      "build(src, leaf=16)\nBuild the tree over a Cloud or float32 (3, n) points (copied into the tree)." },
+    { "query", (PyCFunction)(void (*)(void))kdt_query, METH_VARARGS|METH_KEYWORDS,
+      "query(q, k, idx, dist=None, r=0, cnt=None)\nk nearest neighbours (closer than r when r > 0) of every point of\n"
+      "a Cloud or float32 (3, m) q, nearest first: idx receives int32 (m, k) point indices (-1 when fewer),\n"
+      "dist float32 (m, k) distances (inf when fewer), cnt int32 (m,) neighbour counts." },
+    { NULL }
+};
+
+static PySequenceMethods kdt_as_seq=
+{
+    .sq_length=(lenfunc)kdt_len,
+};
+
+static PyTypeObject kdt_type=
+{
+    PyVarObject_HEAD_INIT(NULL,0)
+    .tp_name     ="_img_filter.KDTree",
+    .tp_basicsize=sizeof(kdt_obj),
+    .tp_dealloc  =(destructor)kdt_dealloc,
+    .tp_as_sequence=&kdt_as_seq,
+    .tp_flags    =Py_TPFLAGS_DEFAULT,
+    .tp_doc      ="KDTree(threads=1)\nKD-tree with implicit node layout (img_kdt.h), bulk k-NN and radius queries\n"
+                  "threaded across query points; rebuilding with no more points reuses the memory.",
+    .tp_methods  =kdt_methods,
+    .tp_init     =(initproc)kdt_init,
+    .tp_new      =PyType_GenericNew,
+};
+
+
+/*-------------------------------- Outlier --------------------------------*/
+
+typedef struct
+{
+    PyObject_HEAD
+    struct img_par_s   *par;
+    int                 w,k;        // 窗口半径、近邻数（含点自己）
+    float              *md;         // SOR的平均距离，调用者不需要时使用
+    int                 ok;         // 已初始化
+    int                 busy;       // 正在计算（GIL已释放）
+} outlier_obj;
+
+
+static int outlier_init(outlier_obj *self, PyObject *args, PyObject *kw)
+{
+    static char *kwlist[]={ "w", "k", "threads", NULL };
+    int w=2,k=8,n_thr=1;
+
+    if (!PyArg_ParseTupleAndKeywords(args,kw,"|iii",kwlist,&w,&k,&n_thr))
+        return -1;
+    if (self->ok)
+    {
+        PyErr_SetString(PyExc_RuntimeError,"Outlier already initialized");
+        return -1;
+    }
+    if (w<1 || w>IMG_OUTLIER_W_MAX || k<2 || k>IMG_OUTLIER_K_MAX || k>(2*w+1)*(2*w+1))
+    {
+        PyErr_Format(PyExc_ValueError,"bad window radius %d (1 to %d) or neighbour count %d (2 to %d, within the window)",
+                     w,IMG_OUTLIER_W_MAX,k,IMG_OUTLIER_K_MAX);
+        return -1;
+    }
+    if ((self->md=(float *)PyMem_Malloc(sizeof(float)*IMG_SZ))==NULL)
+    {
+        PyErr_NoMemory();
+        return -1;
+    }
+    self->w=w;
+    self->k=k;
+    if (n_thr>1)
+        self->par=img_par_create(n_thr);
+    self->ok=1;
+    return 0;
+}
+
+static void outlier_dealloc(outlier_obj *self)
+{
+    if (self->ok)
+        img_par_destroy(self->par);
+    PyMem_Free(self->md);
+    Py_TYPE(self)->tp_free((PyObject *)self);
+}
+
+// ror和sor共用：md为NULL时是ror（thr为半径），否则是sor（thr为z分数上限）
+static PyObject *outlier_run(outlier_obj *self, PyObject *src, PyObject *mask, PyObject *md, float thr, int sor)
+{
+    Py_buffer bi,bm,bd;
+    const float *p;
+    float *d;
+    int ret;
+
+    if (!self->ok || self->busy)
+    {
+        PyErr_SetString(PyExc_RuntimeError,self->ok ? "Outlier is running in another thread" : "Outlier not initialized");
+        return NULL;
+    }
+    if (!sor && !(thr>0))
+    {
+        PyErr_SetString(PyExc_ValueError,"r: expected a positive radius");
+        return NULL;
+    }
+    memset(&bd,0,sizeof(bd));
+    if (get_buf(src,&bi,0,"f",3*IMG_SZ,"xyz"))
+        return NULL;
+    if (get_buf(mask,&bm,1,"B?",IMG_SZ,"mask"))
+    {
+        PyBuffer_Release(&bi);
+        return NULL;
+    }
+    if (md!=Py_None && get_buf(md,&bd,1,"f",IMG_SZ,"md"))
+    {
+        PyBuffer_Release(&bi);
+        PyBuffer_Release(&bm);
+        return NULL;
+    }
+
+    p=(const float *)bi.buf;
+    d=bd.obj ? (float *)bd.buf : self->md;
+    self->busy=1;
+    Py_BEGIN_ALLOW_THREADS
+    if (sor)
+        ret=img_outlier_sor((uint8_t *)bm.buf,d,p,p+IMG_SZ,p+2*IMG_SZ,self->w,self->k,thr,self->par);
+    else
+        ret=img_outlier_ror((uint8_t *)bm.buf,p,p+IMG_SZ,p+2*IMG_SZ,self->w,self->k,thr,self->par);
+    Py_END_ALLOW_THREADS
+    self->busy=0;
+
+    PyBuffer_Release(&bi);
+    PyBuffer_Release(&bm);
+    if (bd.obj)
+        PyBuffer_Release(&bd);
+    return PyLong_FromLong(ret);
+}
+
+static PyObject *outlier_ror(outlier_obj *self, PyObject *args, PyObject *kw)
+{
+    static char *kwlist[]={ "xyz", "mask", "r", NULL };
+    PyObject *src,*mask;
+    float r;
+
+    if (!PyArg_ParseTupleAndKeywords(args,kw,"OOf",kwlist,&src,&mask,&r))
+        return NULL;
+    return outlier_run(self,src,mask,Py_None,r,0);
+}
+
+static PyObject *outlier_sor(outlier_obj *self, PyObject *args, PyObject *kw)
+{
+    static char *kwlist[]={ "xyz", "mask", "z_max", "md", NULL };
+    PyObject *src,*mask,*md=Py_None;
+    float z_max;
+
+    if (!PyArg_ParseTupleAndKeywords(args,kw,"OOf|O",kwlist,&src,&mask,&z_max,&md))
+        return NULL;
+    return outlier_run(self,src,mask,md,z_max,1);
+}
+
+static PyMethodDef outlier_methods[]=
+{
+    { "ror", (PyCFunction)(void (*)(void))outlier_ror, METH_VARARGS|METH_KEYWORDS,
+      "ror(xyz, mask, r) -> kept\nRadius outlier removal of an organized float32 (3, HGT, WID) cloud: mask (uint8/bool HGT*WID)\n"
+      "is 1 where all k nearest neighbours (the point included) lie closer than r, 0 elsewhere and where z is 0." },
+    { "sor", (PyCFunction)(void (*)(void))outlier_sor, METH_VARARGS|METH_KEYWORDS,
+      "sor(xyz, mask, z_max, md=None) -> kept\nStatistical outlier removal: mask is 1 where the z-score (ddof=1) of the mean\n"
+      "k-NN distance is within z_max; md receives the mean distances (float32 HGT*WID, inf where z is 0 or with too few neighbours)." },
+    { NULL }
+};
+
+static PyTypeObject outlier_type=
+{
+    PyVarObject_HEAD_INIT(NULL,0)
+    .tp_name     ="_img_filter.Outlier",
+    .tp_basicsize=sizeof(outlier_obj),
+    .tp_dealloc  =(destructor)outlier_dealloc,
+    .tp_flags    =Py_TPFLAGS_DEFAULT,
+    .tp_doc      ="Outlier(w=2, k=8, threads=1)\nOrganized cloud outlier removal (img_outlier.h): neighbours are searched in a\n"
+                  "(2w+1)^2 pixel window with 3D distances, k counts the point itself like the KD-tree filters.",
+    .tp_methods  =outlier_methods,
+    .tp_init     =(initproc)outlier_init,
+    .tp_new      =PyType_GenericNew,
+};
+
+
+/*-------------------------------- 模块函数 --------------------------------*/
+
+static PyObject *py_to_f32(PyObject *mod, PyObject *args, PyObject *kw)
+{
+    static char *kwlist[]={ "src", "out", "scale", NULL };
+    PyObject *src,*out=Py_None,*ret;
+    Py_buffer bi,bo;
+    const char *fmt;
+    float scale=0.001f;
+    int type;
+
+    (void)mod;
+    if (!PyArg_ParseTupleAndKeywords(args,kw,"O|Of",kwlist,&src,&out,&scale))
+        return NULL;
+    if (get_buf(src,&bi,0,"BHhf",IMG_SZ,"src"))
+        return NULL;
+    if (out==Py_None)
+        ret=new_img(&bo,1);
+    else if (get_buf(out,&bo,1,"f",IMG_SZ,"out")==0)
+    {
+        ret=out;
+        Py_INCREF(ret);
+    }
+    else
+        ret=NULL;
+    if (ret==NULL)
+    {
+        PyBuffer_Release(&bi);
+        return NULL;
+    }
+
+    fmt=bi.format ? bi.format : "B";
+    switch (fmt[strlen(fmt)-1])
+    {
+    case 'B': type=IMG_REC_U8;  break;
+    case 'H': type=IMG_REC_U16; break;
+    case 'h': type=IMG_REC_I16; break;
+    default : type=IMG_REC_F32; break;
+    }
+    Py_BEGIN_ALLOW_THREADS
+    img_rec_to_f32((float *)bo.buf,bi.buf,type,IMG_SZ,scale);
+    Py_END_ALLOW_THREADS
+
+    PyBuffer_Release(&bi);
+    PyBuffer_Release(&bo);
+    return ret;
+}
+
+static PyObject *py_stages(PyObject *mod, PyObject *unused)
+{
+    const struct img_stage_desc_s *d;
+    PyObject *lst=PyList_New(0);
+    int i,j;
+
+    (void)mod; (void)unused;
+    for (i=0;lst && (d=img_stage_get(i))!=NULL;i++)
+    {
+        PyObject *par=PyTuple_New(d->n_par),*e;
+        if (par==NULL)
+        {
+            Py_CLEAR(lst);
+            break;
+        }
+        for (j=0;j<d->n_par;j++)
+            PyTuple_SET_ITEM(par,j,PyFloat_FromDouble(d->par_def[j]));
+        e=Py_BuildValue("(sN)",d->name,par);
+        if (e==NULL || PyList_Append(lst,e))
+            Py_CLEAR(lst);
+        Py_XDECREF(e);
+    }
+    return lst;
+}
+
+static PyObject *py_tune(PyObject *mod, PyObject *args, PyObject *kw)
+{
+    static char *kwlist[]={ "cache", "threads", "force", NULL };
+    const struct img_stage_desc_s *d;
+    const struct img_stage_var_s *v;
+    struct img_par_s *par=NULL;
+    const char *cache=NULL;
+    int n_thr=1,force=0,ret,i;
+    PyObject *lst;
+
+    (void)mod;
+    if (!PyArg_ParseTupleAndKeywords(args,kw,"|zip",kwlist,&cache,&n_thr,&force))
+        return NULL;
+    Py_BEGIN_ALLOW_THREADS
+    if (n_thr>1)
+        par=img_par_create(n_thr);
+    ret=img_tune(cache,par,force,NULL);
+    img_par_destroy(par);
+    Py_END_ALLOW_THREADS
+    if (ret<0)
+        return PyErr_NoMemory();
+
+    lst=PyList_New(0);
+    for (i=0;lst && (d=img_stage_get(i))!=NULL;i++)
+    {
+        PyObject *e;
+        if ((v=img_stage_selected(d->name))==NULL || img_stage_var(d->name,1)==NULL)
+            continue;
+        e=Py_BuildValue("(ss)",d->name,v->name);
+        if (e==NULL || PyList_Append(lst,e))
+            Py_CLEAR(lst);
+        Py_XDECREF(e);
+    }
+    return lst;
+}
+
+static PyMethodDef mod_methods[]=
+{
+    { "to_f32", (PyCFunction)(void (*)(void))py_to_f32, METH_VARARGS|METH_KEYWORDS,
+      "to_f32(src, out=None, scale=0.001) -> out\nConvert a uint8/uint16/int16/float32 depth frame to float32 times scale." },
+    { "stages", (PyCFunction)py_stages, METH_NOARGS,
+      "stages() -> list\n(name, default parameters) of every stage usable in a chain spec." },
+    { "tune",   (PyCFunction)(void (*)(void))py_tune, METH_VARARGS|METH_KEYWORDS,
+      "tune(cache=None, threads=1, force=False) -> list\nBenchmark the implementations of each stage and select the fastest\n"
+      "for Chains created afterwards; the choice is cached per host in the cache file. Returns (stage, implementation)." },
+    { NULL }
+};
+
+static struct PyModuleDef mod_def=
+{
+    PyModuleDef_HEAD_INIT, "_img_filter", "Native depth image filters (img_chain.h), recorder (img_sav.h), shared-memory reader (img_shm.h), deprojection (img_deproj.h), normals (img_normal.h), projection (img_proj.h), registration (img_reg.h), point clouds (img_pc.h), rigid transforms (img_rigid.h), KD-trees (img_kdt.h) and organized outlier removal (img_outlier.h).", -1, mod_methods,
+    NULL, NULL, NULL, NULL
+};
+
+PyMODINIT_FUNC PyInit__img_filter(void)
+{
+    PyObject *m;
+
+    if (PyType_Ready(&chain_type)<0 || PyType_Ready(&rec_type)<0 || PyType_Ready(&shm_type)<0
+        || PyType_Ready(&deproj_type)<0 || PyType_Ready(&normal_type)<0 || PyType_Ready(&proj_type)<0
+        || PyType_Ready(&reg_type)<0 || PyType_Ready(&col_type)<0 || PyType_Ready(&cloud_type)<0
+        || PyType_Ready(&rigid_type)<0 || PyType_Ready(&kdt_type)<0
+        || PyType_Ready(&outlier_type)<0)
+        return NULL;
+    if ((m=PyModule_Create(&mod_def))==NULL)
+        return NULL;
+    Py_INCREF(&chain_type);
+    Py_INCREF(&rec_type);
+    Py_INCREF(&shm_type);
+    Py_INCREF(&deproj_type);
+    Py_INCREF(&normal_type);
+    Py_INCREF(&proj_type);
+    Py_INCREF(&reg_type);
+    Py_INCREF(&cloud_type);
+    Py_INCREF(&rigid_type);
+    Py_INCREF(&kdt_type);
+    Py_INCREF(&outlier_type);
+    if (PyModule_AddObject(m,"Chain",(PyObject *)&chain_type) || PyModule_AddObject(m,"Recorder",(PyObject *)&rec_type)
+        || PyModule_AddObject(m,"ShmReader",(PyObject *)&shm_type) || PyModule_AddObject(m,"Deproj",(PyObject *)&deproj_type)
+        || PyModule_AddObject(m,"Normals",(PyObject *)&normal_type) || PyModule_AddObject(m,"Proj",(PyObject *)&proj_type)
+        || PyModule_AddObject(m,"Reg",(PyObject *)&reg_type) || PyModule_AddObject(m,"Cloud",(PyObject *)&cloud_type)
+        || PyModule_AddObject(m,"Rigid",(PyObject *)&rigid_type) || PyModule_AddObject(m,"KDTree",(PyObject *)&kdt_type)
+        || PyModule_AddObject(m,"Outlier",(PyObject *)&outlier_type)
+        || PyModule_AddIntConstant(m,"WID",IMG_WID) || PyModule_AddIntConstant(m,"HGT",IMG_HGT))
+    {
+        Py_DECREF(m);
+        return NULL;
+    }
+    return m;
+}
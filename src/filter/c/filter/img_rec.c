@@ -0,0 +1,299 @@
+/**
+ * @file    img_rec.c
+ * @author  YRD
+ * @version 1.0
+ * @date    2026-10-18
+ * @brief   录制数据文件读取
+ * @details 整个文件只读映射，关闭内核自己的缺页预读(MADV_RANDOM)，由img_rec_frame按访问位置发出WILLNEED预读：
+ *          顺序访问时预读窗口剩一半时再向后预读ra帧，跳转时从新位置重新开始。压缩文件按帧索引计算预读范围
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "img_const.h"
+#include "img_rec.h"
+#include "img_dz.h"
+
+#ifdef WIN32
+#include <malloc.h>
+#else
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+static const size_t type_sz[]={ 1, 2, 2, 4 };
+static const char  *type_name[]={ "u8", "u16", "i16", "f32" };
+
+
+// 解析帧格式
+static int parse_layout(struct img_rec_s *rec, const char *layout)
+{
+    char buf[256];
+    char *tok,*save=NULL;
+    size_t off=0;
+
+    if (strlen(layout)>=sizeof(buf))
+        return -1;
+    strcpy(buf,layout);
+
+    for (tok=strtok_r(buf,",",&save);tok;tok=strtok_r(NULL,",",&save))
+    {
+        struct img_rec_plane_s *pl=&rec->plane[rec->n_plane];
+        char *ty=strchr(tok,':'),*cnt,*x;
+        int t;
+
+        if (rec->n_plane>=IMG_REC_PLANE_MAX || ty==NULL)
+            return -1;
+        *ty++=0;
+        if ((cnt=strchr(ty,':'))!=NULL)
+            *cnt++=0;
+        pl->cnt=IMG_SZ;
+        if ((x=strchr(ty,'x'))!=NULL)
+        {
+            *x++=0;
+            pl->cnt=IMG_SZ*(size_t)atol(x);
+        }
+        if (cnt)
+            pl->cnt=(size_t)atol(cnt);
+
+        for (t=0;t<4;t++)
+            if (strcmp(ty,type_name[t])==0)
+                break;
+        if (t==4 || pl->cnt==0 || strlen(tok)>=sizeof(pl->name))
+            return -1;
+
+        strcpy(pl->name,tok);
+        pl->type=t;
+        pl->off =off;
+        pl->sz  =pl->cnt*type_sz[t];
+        off+=pl->sz;
+        rec->n_plane++;
+    }
+    rec->stride=off;
+    return rec->n_plane ? 0 : -1;
+}
+
+
+int img_rec_open(struct img_rec_s *rec, const char *fname, const char *layout)
+{
+    memset(rec,0,sizeof(*rec));
+    rec->fd  =-1;
+    rec->ra  =IMG_REC_RA_DEF;
+    rec->last=-2;
+
+    if (parse_layout(rec,layout))
+    {
+        fprintf(stderr,"img_rec: bad layout '%s'\n",layout);
+        return -1;
+    }
+
+#ifdef WIN32
+    {
+        FILE *fp=fopen(fname,"rb");
+        if (fp==NULL)
+        {
+            perror(fname);
+            return -1;
+        }
+        fseek(fp,0,SEEK_END);
+        rec->size=ftell(fp);
+        fseek(fp,0,SEEK_SET);
+        rec->base=(uint8_t *)malloc(rec->size ? rec->size : 1);
+        if (rec->base==NULL || fread(rec->base,1,rec->size,fp)!=rec->size)
+        {
+            fprintf(stderr,"%s: read error\n",fname);
+            fclose(fp);
+            free(rec->base);
+            rec->base=NULL;
+            return -1;
+        }
+        fclose(fp);
+    }
+#else
+    {
+        struct stat st;
+
+        rec->fd=open(fname,O_RDONLY);
+        if (rec->fd<0 || fstat(rec->fd,&st))
+        {
+            perror(fname);
+            img_rec_close(rec);
+            return -1;
+        }
+        rec->size=(size_t)st.st_size;
+        if (rec->size)
+        {
+            void *p=mmap(NULL,rec->size,PROT_READ,MAP_SHARED,rec->fd,0);
+            if (p==MAP_FAILED)
+            {
+                perror(fname);
+                img_rec_close(rec);
+                return -1;
+            }
+            rec->base=(uint8_t *)p;
+            madvise(rec->base,rec->size,MADV_RANDOM);
+        }
+    }
+#endif
+
+    if (img_dz_is_dz(rec->base,rec->size))
+    {
+        // 压缩文件只有一个深度平面
+        memset(rec->plane,0,sizeof(rec->plane));
+        strcpy(rec->plane[0].name,"dep");
+        rec->plane[0].type=IMG_REC_U16;
+        rec->plane[0].cnt =IMG_SZ;
+        rec->plane[0].sz  =sizeof(uint16_t)*IMG_SZ;
+        rec->n_plane=1;
+        rec->stride =0;
+        rec->dz_cur =-1;
+        rec->n_frm  =img_dz_index(rec->base,rec->size,&rec->dz_idx);
+        rec->dz_buf =(uint16_t *)malloc(sizeof(uint16_t)*IMG_SZ);
+        if (rec->n_frm<=0 || rec->dz_buf==NULL)
+        {
+            fprintf(stderr,"%s: bad compressed file or size not %dx%d\n",fname,IMG_WID,IMG_HGT);
+            img_rec_close(rec);
+            return -1;
+        }
+        return 0;
+    }
+
+    rec->n_frm=(long)(rec->size/rec->stride);
+    if (rec->n_frm==0)
+    {
+        fprintf(stderr,"%s: less than one frame of %zu bytes\n",fname,rec->stride);
+        img_rec_close(rec);
+        return -1;
+    }
+    return 0;
+}
+
+
+void img_rec_close(struct img_rec_s *rec)
+{
+#ifdef WIN32
+    free(rec->base);
+#else
+    if (rec->base)
+        munmap(rec->base,rec->size);
+    if (rec->fd>=0)
+        close(rec->fd);
+#endif
+    free(rec->dz_idx);
+    free(rec->dz_buf);
+    memset(rec,0,sizeof(*rec));
+    rec->fd=-1;
+}
+
+
+int img_rec_plane(struct img_rec_s *rec, const char *name)
+{
+    int i;
+    for (i=0;i<rec->n_plane;i++)
+        if (strcmp(rec->plane[i].name,name)==0)
+            return i;
+    return -1;
+}
+
+
+// 第idx帧在文件中的偏移，idx==n_frm时为最后一帧的结束位置
+static size_t frame_off(struct img_rec_s *rec, long idx)
+{
+    size_t off;
+    if (rec->dz_idx==NULL)
+        return idx*rec->stride;
+    if (idx<rec->n_frm)
+        return (size_t)rec->dz_idx[idx];
+    off=(size_t)rec->dz_idx[idx-1]+*(const uint32_t *)(rec->base+rec->dz_idx[idx-1]);
+    return off<rec->size ? off : rec->size;
+}
+
+
+// 预读第f0~f1-1帧
+static void rec_willneed(struct img_rec_s *rec, long f0, long f1)
+{
+#ifndef WIN32
+    static size_t pg=0;
+    uintptr_t a0,a1;
+
+    if (pg==0)
+        pg=(size_t)sysconf(_SC_PAGESIZE);
+    if (f1>rec->n_frm)
+        f1=rec->n_frm;
+    if (f0>=f1)
+        return;
+    a0=(uintptr_t)(rec->base+frame_off(rec,f0))&~(uintptr_t)(pg-1);
+    a1=(uintptr_t)(rec->base+frame_off(rec,f1));
+    madvise((void *)a0,a1-a0,MADV_WILLNEED);
+#else
+    (void)rec; (void)f0; (void)f1;
+#endif
+}
+
+
+const void *img_rec_frame(struct img_rec_s *rec, long idx, int plane)
+{
+    if (idx<0 || idx>=rec->n_frm || plane<0 || plane>=rec->n_plane)
+        return NULL;
+
+    if (idx!=rec->last && idx!=rec->last+1)
+        rec->ra_end=idx;                                    // 跳转，从新位置开始预读
+    if (rec->ra_end-idx<=rec->ra/2)
+    {
+        rec_willneed(rec,rec->ra_end,idx+rec->ra);
+        rec->ra_end=idx+rec->ra;
+    }
+    rec->last=idx;
+
+    if (rec->dz_idx)
+    {
+        if (idx!=rec->dz_cur)
+        {
+            size_t off=frame_off(rec,idx),sz=*(const uint32_t *)(rec->base+off);
+            rec->dz_cur=-1;
+            if (sz>rec->size-off || img_dz_dec(rec->dz_buf,rec->base+off,sz,rec->par))
+                return NULL;
+            rec->dz_cur=idx;
+        }
+        return rec->dz_buf;
+    }
+    return rec->base+idx*rec->stride+rec->plane[plane].off;
+}
+
+
+float *img_rec_to_f32(float *img_out, const void *src, int type, size_t n, float scale)
+{
+    float *q=img_out,*q_end=img_out+n;
+
+    switch (type)
+    {
+    case IMG_REC_U8:
+        {
+            const uint8_t *p=(const uint8_t *)src;
+            for (;q<q_end;q++,p++) *q=*p*scale;
+        }
+        break;
+    case IMG_REC_U16:
+        {
+            const uint16_t *p=(const uint16_t *)src;
+            for (;q<q_end;q++,p++) *q=*p*scale;
+        }
+        break;
+    case IMG_REC_I16:
+        {
+            const int16_t *p=(const int16_t *)src;
+            for (;q<q_end;q++,p++) *q=*p*scale;
+        }
+        break;
+    default:
+        {
+            const float *p=(const float *)src;
+            for (;q<q_end;q++,p++) *q=*p*scale;
+        }
+        break;
+    }
+    return img_out;
+}
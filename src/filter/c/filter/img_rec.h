@@ -0,0 +1,111 @@
+/**
+ * @file    img_rec.h
+ * @author  YRD
+ * @version 1.0
+ * @date    2026-10-18
+ * @brief   录制数据文件读取
+ * @details 把录制的原始数据文件（global_cfg.py中的KINECT_SAV_FNAME等）映射到内存，按帧号直接返回各数据平面的指针，
+ *          不拷贝数据。文件由若干帧组成，每帧依次存放若干数据平面，帧格式用字符串描述：
+ *              名字:类型[xN][:个数],名字:类型...
+ *          类型为u8/u16/i16/f32，个数省略时为IMG_SZ，xN表示每像素N个值（个数为N*IMG_SZ），例如
+ *              "dep:i16"                   Kinect深度图（read_depth_image）
+ *              "dep:u16,ir:i16"            深度图和红外图（read_ir_image）
+ *              "pc:f32x4"                  每像素x/y/z/强度点云（read_pc）
+ *              "dep:i16,pad:u8:1024"       每帧后面有1024字节其他数据
+ *          顺序读取时提前通知内核读入后面几帧(madvise WILLNEED)，跳转时从新位置开始预读，随机访问不会读入无用数据。
+ *          压缩文件（img_dz.h）按文件头自动识别，忽略layout，只有一个u16平面"dep"，img_rec_frame解压到内部缓冲区
+*/
+
+#ifndef __IMG_REC_H__
+#define __IMG_REC_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include "img_par.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define IMG_REC_PLANE_MAX   8           ///< 每帧最多数据平面数
+#define IMG_REC_RA_DEF      8           ///< 默认预读帧数
+
+/// 数据类型
+enum { IMG_REC_U8, IMG_REC_U16, IMG_REC_I16, IMG_REC_F32 };
+
+/**
+ * @brief           数据平面
+ */
+struct img_rec_plane_s
+{
+    char        name[16];
+    int         type;               ///< 数据类型
+    size_t      cnt;                ///< 数据个数
+    size_t      sz;                 ///< 字节数
+    size_t      off;                ///< 在帧内的偏移（字节）
+};
+
+/**
+ * @brief           录制文件
+ */
+struct img_rec_s
+{
+    uint8_t    *base;               ///< 映射地址
+    size_t      size;               ///< 文件长度
+    size_t      stride;             ///< 每帧字节数
+    long        n_frm;              ///< 帧数（不完整的最后一帧不计）
+    struct img_rec_plane_s plane[IMG_REC_PLANE_MAX];
+    int         n_plane;
+    int         fd;
+    int         ra;                 ///< 预读帧数
+    long        last;               ///< 上次访问的帧号
+    long        ra_end;             ///< 已预读到的帧号
+    uint64_t   *dz_idx;             ///< 压缩文件的帧偏移，非压缩文件为NULL
+    uint16_t   *dz_buf;             ///< 解压缓冲区
+    long        dz_cur;             ///< 解压缓冲区中的帧号
+    struct img_par_s *par;          ///< 解压用的线程池，NULL时单线程，不能和其他线程同时使用同一个线程池
+};
+
+/**
+ * @fn              int img_rec_open(struct img_rec_s *rec, const char *fname, const char *layout)
+ * @brief           打开录制文件
+ * @param [out]     struct img_rec_s *rec：录制文件
+ * @param [in]      const char *fname：文件名
+ * @param [in]      const char *layout：帧格式，见文件说明
+ * @retval          int：0成功，-1失败（错误信息输出到stderr）
+ */
+int img_rec_open(struct img_rec_s *rec, const char *fname, const char *layout);
+
+/**
+ * @fn              void img_rec_close(struct img_rec_s *rec)
+ * @brief           关闭录制文件，之前返回的指针失效
+ */
+void img_rec_close(struct img_rec_s *rec);
+
+/**
+ * @fn              int img_rec_plane(struct img_rec_s *rec, const char *name)
+ * @brief           按名字查找数据平面
+ * @retval          int：平面序号，没有时返回-1
+ */
+int img_rec_plane(struct img_rec_s *rec, const char *name);
+
+/**
+ * @fn              const void *img_rec_frame(struct img_rec_s *rec, long idx, int plane)
+ * @brief           返回第idx帧中数据平面plane的指针（只读，直接指向映射的文件内容；压缩文件指向解压缓冲区，下次调用前有效）
+ * @param [in]      long idx：帧号，0~n_frm-1
+ * @param [in]      int plane：平面序号
+ * @retval          const void *：帧号或平面序号超出范围、压缩数据错误时返回NULL
+ */
+const void *img_rec_frame(struct img_rec_s *rec, long idx, int plane);
+
+/**
+ * @fn              float *img_rec_to_f32(float *img_out, const void *src, int type, size_t n, float scale)
+ * @brief           把数据平面转换为float，乘以scale（例如深度值mm转换为m时为0.001）
+ * @retval          float *：和img_out相同
+ */
+float *img_rec_to_f32(float *img_out, const void *src, int type, size_t n, float scale);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
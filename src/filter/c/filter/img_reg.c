@@ -0,0 +1,291 @@
+/**
+ * @file    img_reg.c
+ * @author  YRD
+ * @version 1.0
+ * @date    2026-10-18
+ * @brief   深度图和彩色图配准
+ * @details 每帧三次img_par_run：清z缓冲（按彩色图行分块）、深度像素映射到彩色像素并写入z缓冲（按深度图行分块）、
+ *          遮挡判断和取色（按深度图行分块）同时输出对齐到彩色图的深度（按彩色图行分块）。
+ *          映射按行计算到栈上的行缓存，无分支，可向量化
+*/
+
+#include <stdio.h>
+#include <string.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#include "img_const.h"
+#include "img_algo.h"
+#include "img_reg.h"
+
+#define ZBUF_EMPTY      0xffffffffu
+#define ZBUF_SZ(w,h)    ((w)*((h)+2)+2)     // z缓冲上下各加1行、前后各加1个像素，3x3邻域不需要判断边界
+#define ZBUF_OFF(w)     ((w)+1)             // 彩色像素序号到z缓冲序号的偏移
+
+
+// 彩色相机坐标系的点(qx,qy,qz)投影为彩色像素坐标（加0.5，取整即为四舍五入）
+static inline void cam_c_proj(const struct img_cam_s *c, float qx, float qy, float qz, float *u, float *v)
+{
+    float iz=1/qz;                                              // qz<=0时结果无效，由调用者判断
+    float xn=qx*iz,yn=qy*iz,r2=xn*xn+yn*yn;
+    float k=1+r2*(c->k1+r2*(c->k2+r2*c->k3));
+    float xd=xn*k+2*c->p1*xn*yn+c->p2*(r2+2*xn*xn);
+    float yd=yn*k+c->p1*(r2+2*yn*yn)+2*c->p2*xn*yn;
+
+    *u=c->fx*xd+c->skew*yd+c->cx+0.5f;
+    *v=c->fy*yd+c->cy+0.5f;
+}
+
+
+int img_reg_init(struct img_reg_s *reg, const struct img_cam_s *cam_d, const struct img_cam_s *cam_c,
+                 int cw, int ch, const float *R, const float *t, struct img_pool_s *pool)
+{
+    int flat=(t[0]==0 && t[1]==0 && t[2]==0),i;
+
+    memset(reg,0,sizeof(*reg));
+    if (cw<1 || ch<1 || !(cam_c->fx>0) || !(cam_c->fy>0))
+    {
+        fprintf(stderr,"img_reg: bad color camera %dx%d, focal length %g/%g\n",cw,ch,cam_c->fx,cam_c->fy);
+        return -1;
+    }
+    if (img_deproj_init(&reg->dp,cam_d,pool))
+        return -1;
+    reg->cam_c=*cam_c;
+    reg->cw=cw;
+    reg->ch=ch;
+    memcpy(reg->t,t,sizeof(reg->t));
+    reg->pool=pool;
+    reg->ax=img_pool_alloc_img(pool,1);
+    reg->ay=img_pool_alloc_img(pool,1);
+    reg->az=img_pool_alloc_img(pool,1);
+    reg->cz=img_pool_alloc_img(pool,1);
+    reg->ci=(int32_t *)img_pool_alloc(pool,sizeof(int32_t)*IMG_SZ);
+    reg->zbuf=(uint32_t *)img_pool_alloc(pool,sizeof(uint32_t)*ZBUF_SZ(cw,ch));
+    if (flat)
+    {
+        reg->su=img_pool_alloc_img(pool,1);
+        reg->sv=img_pool_alloc_img(pool,1);
+    }
+    if (reg->ax==NULL || reg->ay==NULL || reg->az==NULL || reg->cz==NULL || reg->ci==NULL || reg->zbuf==NULL
+        || (flat && (reg->su==NULL || reg->sv==NULL)))
+    {
+        fprintf(stderr,"img_reg: frame pool too small\n");
+        img_reg_release(reg);
+        return -1;
+    }
+
+    for (i=0;i<IMG_SZ;i++)
+    {
+        float rx=reg->dp.rx[i],ry=reg->dp.ry[i];
+        reg->ax[i]=R[0]*rx+R[1]*ry+R[2];
+        reg->ay[i]=R[3]*rx+R[4]*ry+R[5];
+        reg->az[i]=R[6]*rx+R[7]*ry+R[8];
+        if (reg->su)
+        {
+            // 没有视差时映射和深度无关，射线方向在彩色相机后方的像素映射到图像外
+            cam_c_proj(cam_c,reg->ax[i],reg->ay[i],reg->az[i],reg->su+i,reg->sv+i);
+            if (!(reg->az[i]>0))
+                reg->su[i]=-1;
+        }
+    }
+    return 0;
+}
+
+
+void img_reg_release(struct img_reg_s *reg)
+{
+    if (reg->pool)
+    {
+        img_pool_release(reg->pool,reg->ax);
+        img_pool_release(reg->pool,reg->ay);
+        img_pool_release(reg->pool,reg->az);
+        img_pool_release(reg->pool,reg->cz);
+        img_pool_release(reg->pool,reg->ci);
+        img_pool_release(reg->pool,reg->zbuf);
+        img_pool_release(reg->pool,reg->su);
+        img_pool_release(reg->pool,reg->sv);
+    }
+    img_deproj_release(&reg->dp);
+    reg->ax=reg->ay=reg->az=reg->cz=reg->su=reg->sv=NULL;
+    reg->ci=NULL;
+    reg->zbuf=NULL;
+}
+
+
+// 多线程任务参数
+struct reg_arg_s
+{
+    struct img_reg_s *reg;
+    uint8_t     *rgb_out;
+    int32_t     *idx;
+    float       *dep_c;
+    const float *dep;
+    const uint8_t *rgb;
+    float        tol;
+    int          mt;                // 多线程，z缓冲需要原子操作
+};
+
+
+static void clear_task(void *arg, int i, int n)
+{
+    struct reg_arg_s *a=(struct reg_arg_s *)arg;
+    int sz=ZBUF_SZ(a->reg->cw,a->reg->ch),k0,k1;
+
+    img_par_band(0,sz,i,n,&k0,&k1);
+    memset(a->reg->zbuf+k0,0xff,sizeof(uint32_t)*(k1-k0));
+}
+
+
+// z缓冲取最小值：先读一次，比当前值近时才做原子比较交换，被其他线程抢先改写时重新比较；
+// MSVC没有GCC的__sync原子操作，用Interlocked函数
+static inline void zbuf_min(uint32_t *p, uint32_t k)
+{
+    uint32_t c=*(volatile uint32_t *)p,o;
+
+    while (k<c)
+    {
+#ifdef _MSC_VER
+        o=(uint32_t)_InterlockedCompareExchange((volatile long *)p,(long)k,(long)c);
+#else
+        o=__sync_val_compare_and_swap(p,c,k);
+#endif
+        if (o==c)
+            break;
+        c=o;
+    }
+}
+
+
+// 深度像素映射到彩色像素：行[y0,y1)，输出彩色像素序号ci和彩色相机坐标系深度cz，并写入z缓冲
+static void map_task(void *arg, int i, int n)
+{
+    struct reg_arg_s *a=(struct reg_arg_s *)arg;
+    struct img_reg_s *reg=a->reg;
+    const struct img_cam_s *c=&reg->cam_c;
+    float bz[IMG_WID],fw=(float)reg->cw,fh=(float)reg->ch;
+    int32_t bc[IMG_WID];
+    uint32_t *zbuf=reg->zbuf+ZBUF_OFF(reg->cw);
+    int cw=reg->cw,y0,y1,u,v;
+
+    img_par_band(0,IMG_HGT,i,n,&y0,&y1);
+    for (v=y0;v<y1;v++)
+    {
+        const float *z=a->dep+v*IMG_WID,*ax=reg->ax+v*IMG_WID,*ay=reg->ay+v*IMG_WID,*az=reg->az+v*IMG_WID;
+
+        if (reg->su)
+        {
+            // 没有视差：查表
+            const float *su=reg->su+v*IMG_WID,*sv=reg->sv+v*IMG_WID;
+            for (u=0;u<IMG_WID;u++)
+            {
+                float qz=z[u]*az[u],uf=su[u],vf=sv[u];
+                int ok=(z[u]>0) & (qz>0) & (uf>=0) & (uf<fw) & (vf>=0) & (vf<fh);
+                int cu=(int)(ok ? uf : 0.0f),cv=(int)(ok ? vf : 0.0f);  // 先选择再转换，超出int范围的值不参与转换
+                bz[u]=qz;
+                bc[u]=ok ? cv*cw+cu : -1;
+            }
+        }
+        else
+        {
+            const float *t=reg->t;
+            for (u=0;u<IMG_WID;u++)
+            {
+                float qz=z[u]*az[u]+t[2],uf,vf;
+                int ok,cu,cv;
+
+                cam_c_proj(c,z[u]*ax[u]+t[0],z[u]*ay[u]+t[1],qz,&uf,&vf);
+                ok=(z[u]>0) & (qz>0) & (uf>=0) & (uf<fw) & (vf>=0) & (vf<fh);
+                cu=(int)(ok ? uf : 0.0f);
+                cv=(int)(ok ? vf : 0.0f);
+                bz[u]=qz;
+                bc[u]=ok ? cv*cw+cu : -1;
+            }
+        }
+        memcpy(reg->cz+v*IMG_WID,bz,sizeof(bz));
+        memcpy(reg->ci+v*IMG_WID,bc,sizeof(bc));
+
+        // 单线程时没有其他线程写z缓冲，不需要原子操作
+        for (u=0;u<IMG_WID;u++)
+            if (bc[u]>=0)
+            {
+                uint32_t zb,*p=zbuf+bc[u];
+                memcpy(&zb,bz+u,sizeof(zb));
+                if (a->mt)
+                    zbuf_min(p,zb);
+                else if (zb<*p)
+                    *p=zb;
+            }
+    }
+}
+
+
+// 遮挡判断和取色（深度图行分块），对齐到彩色图的深度（彩色图行分块）
+static void out_task(void *arg, int i, int n)
+{
+    struct reg_arg_s *a=(struct reg_arg_s *)arg;
+    struct img_reg_s *reg=a->reg;
+    const uint32_t *zb=reg->zbuf+ZBUF_OFF(reg->cw);
+    float tol=1+a->tol;
+    int w=reg->cw,y0,y1,k;
+
+    img_par_band(0,IMG_HGT,i,n,&y0,&y1);
+    if (a->rgb_out || a->idx)
+        for (k=y0*IMG_WID;k<y1*IMG_WID;k++)
+        {
+            int p=reg->ci[k],vis=0;
+
+            if (p>=0)
+            {
+                // 3x3邻域的最小深度，最左（右）列的左（右）邻点是上（下）一行的最后（第一）个像素，不影响遮挡判断；
+                // 邻域包括自己，不会是空值
+                const uint32_t *q=zb+p;
+                uint32_t m=q[-w-1];
+                float zmin;
+                m=MIN2(m,q[-w]); m=MIN2(m,q[-w+1]);
+                m=MIN2(m,q[-1]); m=MIN2(m,q[ 0]); m=MIN2(m,q[   1]);
+                m=MIN2(m,q[w-1]); m=MIN2(m,q[ w]); m=MIN2(m,q[ w+1]);
+                memcpy(&zmin,&m,sizeof(zmin));
+                vis=(reg->cz[k]<=zmin*tol);
+            }
+            if (a->idx)
+                a->idx[k]=vis ? reg->ci[k] : -1;
+            if (a->rgb_out)
+            {
+                uint8_t *d=a->rgb_out+3*k;
+                if (vis)
+                {
+                    const uint8_t *s=a->rgb+3*(size_t)reg->ci[k];
+                    d[0]=s[0]; d[1]=s[1]; d[2]=s[2];
+                }
+                else
+                    d[0]=d[1]=d[2]=0;
+            }
+        }
+
+    img_par_band(0,reg->ch,i,n,&y0,&y1);
+    if (a->dep_c)
+        for (;y0<y1;y0++)
+        {
+            const uint32_t *q=zb+(size_t)y0*w;
+            float *d=a->dep_c+(size_t)y0*reg->cw;
+            for (k=0;k<reg->cw;k++)
+            {
+                float z;
+                memcpy(&z,q+k,sizeof(z));
+                d[k]=(q[k]==ZBUF_EMPTY) ? 0 : z;
+            }
+        }
+}
+
+
+void img_reg_run(struct img_reg_s *reg, uint8_t *rgb_out, int32_t *idx, float *dep_c,
+                 const float *dep, const uint8_t *rgb, float tol, struct img_par_s *par)
+{
+    struct reg_arg_s a;
+    int n_thr=img_par_threads(par);
+
+    a.reg=reg; a.rgb_out=rgb ? rgb_out : NULL; a.idx=idx; a.dep_c=dep_c; a.dep=dep; a.rgb=rgb; a.tol=tol; a.mt=(n_thr>1);
+    img_par_run(par,clear_task,&a,n_thr);
+    img_par_run(par,map_task,&a,n_thr);
+    img_par_run(par,out_task,&a,n_thr);
+}
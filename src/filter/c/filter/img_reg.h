@@ -0,0 +1,86 @@
+/**
+ * @file    img_reg.h
+ * @author  YRD
+ * @version 1.0
+ * @date    2026-10-18
+ * @brief   深度图和彩色图配准
+ * @details 深度相机（IMG_WID*IMG_HGT）和彩色相机（cw*ch，Kinect为640x480）的内参、畸变和外参（p_c=R*p_d+t）在初始化时确定，
+ *          每个深度像素的去畸变射线r（img_deproj.h的射线表）和旋转后的射线a=R*r建表缓存，
+ *          每帧每个像素只需计算 q=z*a+t、透视除法、彩色相机畸变（多项式，不需要迭代）和内参。
+ *          视差项t只在t不为0时计算：t为0（同轴相机）时映射和深度无关，初始化时直接建立像素映射表，每帧只查表。
+ *          遮挡用彩色图像素上的z缓冲处理：每个深度像素把自己在彩色相机坐标系的深度原子取最小写入对应的彩色像素，
+ *          取色时和该彩色像素3x3邻域内的最小深度比较，远于最小深度(1+tol)倍的深度像素被遮挡，不取颜色。
+ *          一次img_reg_run同时输出两个方向的结果：
+ *              彩色到深度：对齐到深度图的彩色图（IMG_SZ*3）和每个深度像素对应的彩色像素序号；
+ *              深度到彩色：对齐到彩色图的深度图（cw*ch，最近点的深度）。
+ *          多线程时深度图、彩色图都按行分块并行
+*/
+
+#ifndef __IMG_REG_H__
+#define __IMG_REG_H__
+
+#include <stdint.h>
+#include "img_pool.h"
+#include "img_par.h"
+#include "img_deproj.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief           配准器
+ */
+struct img_reg_s
+{
+    struct img_deproj_s dp;                 ///< 深度相机射线表
+    struct img_cam_s    cam_c;              ///< 彩色相机内参和畸变系数
+    int                 cw,ch;              ///< 彩色图尺寸
+    float               t[3];               ///< 平移（m）
+    float              *ax,*ay,*az;         ///< 旋转后的射线R*r，各IMG_SZ个float
+    float              *su,*sv;             ///< t为0时的像素映射表（彩色像素坐标），各IMG_SZ个float，t不为0时为NULL
+    float              *cz;                 ///< 每帧每个深度像素在彩色相机坐标系的深度，IMG_SZ个float
+    int32_t            *ci;                 ///< 每帧每个深度像素对应的彩色像素序号（v*cw+u），-1为无效，IMG_SZ个int32
+    uint32_t           *zbuf;               ///< 彩色图z缓冲（float的位模式），上下各加1行，cw*(ch+2)+2个
+    struct img_pool_s  *pool;
+};
+
+/**
+ * @fn              int img_reg_init(struct img_reg_s *reg, const struct img_cam_s *cam_d, const struct img_cam_s *cam_c,
+ *                                   int cw, int ch, const float *R, const float *t, struct img_pool_s *pool)
+ * @brief           建立配准器，映射表和z缓冲从内存池分配（约IMG_SZ*36+cw*ch*4字节）
+ * @param [in]      const struct img_cam_s *cam_d：深度相机内参（IMG_WID*IMG_HGT图像上的像素值）
+ * @param [in]      const struct img_cam_s *cam_c：彩色相机内参（cw*ch图像上的像素值）
+ * @param [in]      int cw,ch：彩色图尺寸
+ * @param [in]      const float *R：深度相机到彩色相机的旋转矩阵（行优先，9个float）
+ * @param [in]      const float *t：深度相机到彩色相机的平移（m，3个float）
+ * @retval          int：0成功，-1参数无效或内存不足（错误信息输出到stderr）
+ */
+int img_reg_init(struct img_reg_s *reg, const struct img_cam_s *cam_d, const struct img_cam_s *cam_c,
+                 int cw, int ch, const float *R, const float *t, struct img_pool_s *pool);
+
+/**
+ * @fn              void img_reg_release(struct img_reg_s *reg)
+ * @brief           释放映射表和z缓冲（归还内存池）
+ */
+void img_reg_release(struct img_reg_s *reg);
+
+/**
+ * @fn              void img_reg_run(struct img_reg_s *reg, uint8_t *rgb_out, int32_t *idx, float *dep_c,
+ *                                   const float *dep, const uint8_t *rgb, float tol, struct img_par_s *par)
+ * @brief           配准一帧
+ * @param [in]      const float *dep：深度图（m），IMG_SZ个float
+ * @param [in]      const uint8_t *rgb：彩色图，cw*ch*3个uint8（3通道交织，通道顺序不限），rgb_out为NULL时可以为NULL
+ * @param [in]      float tol：遮挡判断的相对深度容差，例如0.02为2%
+ * @param [out]     uint8_t *rgb_out：IMG_SZ*3个uint8，对齐到深度图的彩色图，无效或被遮挡的像素为0，可以为NULL
+ * @param [out]     int32_t *idx：IMG_SZ个int32，每个深度像素对应的彩色像素序号（v*cw+u），无效或被遮挡为-1，可以为NULL
+ * @param [out]     float *dep_c：cw*ch个float，对齐到彩色图的深度图（彩色相机坐标系的z，m），没有深度的像素为0，可以为NULL
+ * @param [in]      struct img_par_s *par：线程池，可以为NULL
+ */
+void img_reg_run(struct img_reg_s *reg, uint8_t *rgb_out, int32_t *idx, float *dep_c,
+                 const float *dep, const uint8_t *rgb, float tol, struct img_par_s *par);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -0,0 +1,182 @@
+/**
+ * @file    img_rigid.c
+ * @author  YRD
+ * @version 1.0
+ * @date    2026-10-18
+ * @brief   批量刚体变换
+ * @details 位姿运算逐个位姿计算（先算到局部变量，输出可以和输入相同）；
+ *          点变换的矩阵元素先取到局部变量，循环内只有乘加，坐标和法向量各一个循环
+*/
+
+#include <string.h>
+#include <math.h>
+#include "img_rigid.h"
+
+#define SEG_ALIGN       16          // 多线程分段边界对齐的点数（64字节）
+
+
+void img_rigid_from_qt(float *T, const float *qt, int n)
+{
+    int i;
+
+    for (i=0;i<n;i++,T+=16,qt+=7)
+    {
+        float w=qt[0],a=qt[1],b=qt[2],c=qt[3],nq=w*w+a*a+b*b+c*c,s;
+
+        // 和transformations.quaternion_matrix一样，接近0的四元数为单位旋转
+        if (!(nq>1e-12f))
+        {
+            w=1; a=b=c=0; nq=1;
+        }
+        s=2/nq;
+        T[ 0]=1-s*(b*b+c*c); T[ 1]=s*(a*b-c*w);   T[ 2]=s*(a*c+b*w);   T[ 3]=qt[4];
+        T[ 4]=s*(a*b+c*w);   T[ 5]=1-s*(a*a+c*c); T[ 6]=s*(b*c-a*w);   T[ 7]=qt[5];
+        T[ 8]=s*(a*c-b*w);   T[ 9]=s*(b*c+a*w);   T[10]=1-s*(a*a+b*b); T[11]=qt[6];
+        T[12]=T[13]=T[14]=0; T[15]=1;
+    }
+}
+
+
+void img_rigid_to_qt(float *qt, const float *T, int n)
+{
+    int i;
+
+    for (i=0;i<n;i++,T+=16,qt+=7)
+    {
+        float tr=T[0]+T[5]+T[10],s,w,x,y,z;
+
+        // 取绝对值最大的分量做除数，避免小数相除
+        if (tr>0)
+        {
+            s=2*sqrtf(tr+1);
+            w=s/4; x=(T[9]-T[6])/s; y=(T[2]-T[8])/s; z=(T[4]-T[1])/s;
+        }
+        else if (T[0]>T[5] && T[0]>T[10])
+        {
+            s=2*sqrtf(1+T[0]-T[5]-T[10]);
+            w=(T[9]-T[6])/s; x=s/4; y=(T[1]+T[4])/s; z=(T[2]+T[8])/s;
+        }
+        else if (T[5]>T[10])
+        {
+            s=2*sqrtf(1+T[5]-T[0]-T[10]);
+            w=(T[2]-T[8])/s; x=(T[1]+T[4])/s; y=s/4; z=(T[6]+T[9])/s;
+        }
+        else
+        {
+            s=2*sqrtf(1+T[10]-T[0]-T[5]);
+            w=(T[4]-T[1])/s; x=(T[2]+T[8])/s; y=(T[6]+T[9])/s; z=s/4;
+        }
+        s=(w<0) ? -1.0f : 1.0f;
+        qt[0]=s*w; qt[1]=s*x; qt[2]=s*y; qt[3]=s*z;
+        qt[4]=T[3]; qt[5]=T[7]; qt[6]=T[11];
+    }
+}
+
+
+void img_rigid_compose(float *T, const float *A, int na, const float *B, int nb)
+{
+    int n=(na>nb) ? na : nb,sa=(na>1) ? 16 : 0,sb=(nb>1) ? 16 : 0,i,r,c;
+    float a1[12],b1[12];
+
+    // 只有一个的位姿先复制出来，T和它相同时第0个结果会覆盖它
+    if (na==1)
+    {
+        memcpy(a1,A,sizeof(a1));
+        A=a1;
+    }
+    if (nb==1)
+    {
+        memcpy(b1,B,sizeof(b1));
+        B=b1;
+    }
+    for (i=0;i<n;i++,T+=16,A+=sa,B+=sb)
+    {
+        float t[12];
+
+        for (r=0;r<3;r++)
+            for (c=0;c<4;c++)
+                t[4*r+c]=A[4*r]*B[c]+A[4*r+1]*B[4+c]+A[4*r+2]*B[8+c]+(c==3 ? A[4*r+3] : 0);
+        memcpy(T,t,sizeof(t));
+        T[12]=T[13]=T[14]=0; T[15]=1;
+    }
+}
+
+
+void img_rigid_inverse(float *Ti, const float *T, int n)
+{
+    int i,r;
+
+    for (i=0;i<n;i++,Ti+=16,T+=16)
+    {
+        float t[12];
+
+        for (r=0;r<3;r++)
+        {
+            t[4*r]=T[r]; t[4*r+1]=T[4+r]; t[4*r+2]=T[8+r];
+            t[4*r+3]=-(T[r]*T[3]+T[4+r]*T[7]+T[8+r]*T[11]);
+        }
+        memcpy(Ti,t,sizeof(t));
+        Ti[12]=Ti[13]=Ti[14]=0; Ti[15]=1;
+    }
+}
+
+
+// 多线程任务参数
+struct rigid_arg_s
+{
+    float       *x,*y,*z,*nx,*ny,*nz;
+    int          n;
+    const float *T;
+};
+
+
+// 点[i0,i1)变换：p=R*p+t*w，w为0时只旋转（法向量）
+static void apply_seg(float *x, float *y, float *z, int i0, int i1, const float *T, float w)
+{
+    float r0=T[0],r1=T[1],r2=T[2],r3=T[4],r4=T[5],r5=T[6],r6=T[8],r7=T[9],r8=T[10];
+    float t0=T[3]*w,t1=T[7]*w,t2=T[11]*w;
+    int i;
+
+    for (i=i0;i<i1;i++)
+    {
+        float px=x[i],py=y[i],pz=z[i];
+        x[i]=r0*px+r1*py+r2*pz+t0;
+        y[i]=r3*px+r4*py+r5*pz+t1;
+        z[i]=r6*px+r7*py+r8*pz+t2;
+    }
+}
+
+
+static void apply_task(void *arg, int i, int n)
+{
+    struct rigid_arg_s *a=(struct rigid_arg_s *)arg;
+    int i0,i1;
+
+    // 按SEG_ALIGN个点的块分段，列起点对齐时各段的边界都在cache line上
+    img_par_band(0,(a->n+SEG_ALIGN-1)/SEG_ALIGN,i,n,&i0,&i1);
+    i0*=SEG_ALIGN;
+    i1=(i1*SEG_ALIGN<a->n) ? i1*SEG_ALIGN : a->n;
+    apply_seg(a->x,a->y,a->z,i0,i1,a->T,1);
+    if (a->nx)
+        apply_seg(a->nx,a->ny,a->nz,i0,i1,a->T,0);
+}
+
+
+void img_rigid_apply(float *x, float *y, float *z, float *nx, float *ny, float *nz, int n,
+                     const float *T, struct img_par_s *par)
+{
+    struct rigid_arg_s a;
+    int n_thr=img_par_threads(par);
+
+    a.x=x; a.y=y; a.z=z; a.nx=nx; a.ny=ny; a.nz=nz; a.n=n; a.T=T;
+    if (n<IMG_RIGID_MT_MIN || n_thr<2)
+        apply_task(&a,0,1);
+    else
+        img_par_run(par,apply_task,&a,n_thr);
+}
+
+
+void img_rigid_apply_pc(struct img_pc_s *pc, const float *T, struct img_par_s *par)
+{
+    img_rigid_apply(pc->x,pc->y,pc->z,pc->nx,pc->ny,pc->nz,pc->n,T,par);
+}
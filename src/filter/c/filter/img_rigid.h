@@ -0,0 +1,81 @@
+/**
+ * @file    img_rigid.h
+ * @author  YRD
+ * @version 1.0
+ * @date    2026-10-18
+ * @brief   批量刚体变换
+ * @details 代替src/ref/rigid_transformations.py、transformations.py中每次调用都做numpy矩阵运算、新建临时数组的做法：
+ *              位姿是4x4矩阵（行优先，16个float，只使用前3行），或者四元数加平移（qw,qx,qy,qz,tx,ty,tz，7个float，
+ *              四元数顺序和RigidTransform.quaternion相同）；
+ *              多个位姿连续存放，一次调用完成全部位姿的转换、复合或求逆；
+ *              点和法向量按列存储（img_pc.h的x/y/z、nx/ny/nz），原地变换：p=R*p+t，n=R*n。
+ *          变换循环无分支，可以被编译器向量化；点数不少于IMG_RIGID_MT_MIN时按点分段多线程，
+ *          分段边界按cache line对齐，各线程不写同一个cache line
+*/
+
+#ifndef __IMG_RIGID_H__
+#define __IMG_RIGID_H__
+
+#include "img_par.h"
+#include "img_pc.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define IMG_RIGID_MT_MIN    (1<<20)     ///< 多线程变换的最少点数，点数少时线程调度的开销大于收益
+
+/**
+ * @fn              void img_rigid_from_qt(float *T, const float *qt, int n)
+ * @brief           四元数加平移转换为4x4矩阵，四元数不必归一化，全0时为单位旋转
+ * @param [in]      const float *qt：n个位姿，各7个float
+ * @param [out]     float *T：n个4x4矩阵，各16个float
+ */
+void img_rigid_from_qt(float *T, const float *qt, int n);
+
+/**
+ * @fn              void img_rigid_to_qt(float *qt, const float *T, int n)
+ * @brief           4x4矩阵转换为四元数加平移，qw不小于0
+ * @param [in]      const float *T：n个4x4矩阵
+ * @param [out]     float *qt：n个位姿，各7个float
+ */
+void img_rigid_to_qt(float *qt, const float *T, int n);
+
+/**
+ * @fn              void img_rigid_compose(float *T, const float *A, int na, const float *B, int nb)
+ * @brief           位姿复合T[i]=A[i]*B[i]（先B后A），na或nb为1时该位姿和另一组的每个位姿复合
+ * @param [in]      const float *A,*B：na、nb个4x4矩阵，na、nb为1或者相等
+ * @param [out]     float *T：max(na,nb)个4x4矩阵，可以和A或B相同（包括na或nb为1时）
+ */
+void img_rigid_compose(float *T, const float *A, int na, const float *B, int nb);
+
+/**
+ * @fn              void img_rigid_inverse(float *Ti, const float *T, int n)
+ * @brief           刚体变换求逆：[R' -R'*t]
+ * @param [in]      const float *T：n个4x4矩阵
+ * @param [out]     float *Ti：n个4x4矩阵，可以和T相同
+ */
+void img_rigid_inverse(float *Ti, const float *T, int n);
+
+/**
+ * @fn              void img_rigid_apply(float *x, float *y, float *z, float *nx, float *ny, float *nz, int n,
+ *                                       const float *T, struct img_par_s *par)
+ * @brief           n个点原地刚体变换
+ * @param [inout]   float *x,*y,*z：点坐标，各n个float
+ * @param [inout]   float *nx,*ny,*nz：法向量，各n个float，只旋转；nx为NULL时没有法向量
+ * @param [in]      const float *T：4x4矩阵
+ * @param [in]      struct img_par_s *par：线程池，可以为NULL；点数少于IMG_RIGID_MT_MIN时不使用
+ */
+void img_rigid_apply(float *x, float *y, float *z, float *nx, float *ny, float *nz, int n,
+                     const float *T, struct img_par_s *par);
+
+/**
+ * @fn              void img_rigid_apply_pc(struct img_pc_s *pc, const float *T, struct img_par_s *par)
+ * @brief           点云原地刚体变换，坐标和法向量（有法向量列时）都变换
+ */
+void img_rigid_apply_pc(struct img_pc_s *pc, const float *T, struct img_par_s *par);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -0,0 +1,348 @@
+/**
+ * @file    img_sav.c
+ * @author  YRD
+ * @version 1.0
+ * @date    2026-10-18
+ * @brief   异步录制
+ * @details 只有一个采集线程，队列用固定顺序轮流使用的缓冲区实现：采集线程填写buf[head]，写线程按提交顺序取走。
+ *          O_DIRECT要求写入的地址、长度和文件偏移都按IMG_SAV_ALIGN对齐，每次只写出批量缓冲区中对齐的部分，
+ *          剩下不足一页的数据移到缓冲区开头；关闭时补0写出最后一页，再把文件截断到实际长度
+*/
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "img_const.h"
+#include "img_par.h"
+#include "img_dz.h"
+#include "img_sav.h"
+
+#define ALIGN_UP(x,a)   (((x)+(a)-1)/(a)*(a))
+
+
+// 写出批量缓冲区中对齐的部分，final时全部写出
+static void sav_flush(struct img_sav_s *s, int final)
+{
+    size_t len=s->fill/IMG_SAV_ALIGN*IMG_SAV_ALIGN,pad=0,done=0;
+    uint64_t t0,t;
+
+    if (final && len<s->fill)
+    {
+        pad=ALIGN_UP(s->fill,IMG_SAV_ALIGN)-s->fill;
+        memset(s->batch+s->fill,0,pad);
+        len=s->fill+pad;
+    }
+    if (len==0)
+        return;
+
+    t0=img_time_ns();
+    while (s->err==0 && done<len)
+    {
+        ssize_t n=write(s->fd,s->batch+done,len-done);
+        if (n<0 && errno==EINTR)
+            continue;
+#ifdef O_DIRECT
+        if (n<0 && errno==EINVAL && s->direct)
+        {
+            // 文件系统不支持O_DIRECT写入，改用普通写入
+            fcntl(s->fd,F_SETFL,fcntl(s->fd,F_GETFL)&~O_DIRECT);
+            s->direct=0;
+            continue;
+        }
+#endif
+        if (n<=0)
+            s->err=n<0 ? errno : EIO;
+        else
+            done+=(size_t)n;
+    }
+    t=img_time_ns()-t0;
+    s->t_wr+=t;
+    if (t>s->t_wr_max) s->t_wr_max=t;
+    s->n_wr++;
+
+    if (final)
+    {
+        s->off+=len-pad;
+        s->fill=0;
+        if (pad && s->err==0 && ftruncate(s->fd,(off_t)s->off))
+            s->err=errno;
+        return;
+    }
+    s->off+=len;
+    s->fill-=len;
+    memmove(s->batch,s->batch+len,s->fill);
+}
+
+// 追加数据到批量缓冲区
+static void sav_append(struct img_sav_s *s, const void *data, size_t sz)
+{
+    const uint8_t *p=(const uint8_t *)data;
+
+    while (sz)
+    {
+        size_t n=s->batch_sz-s->fill;
+        if (n>sz) n=sz;
+        memcpy(s->batch+s->fill,p,n);
+        s->fill+=n;
+        p+=n;
+        sz-=n;
+        if (s->fill==s->batch_sz)
+            sav_flush(s,0);
+    }
+}
+
+// 写入一帧
+static void sav_write(struct img_sav_s *s, const void *frm)
+{
+    if (s->fmt==IMG_SAV_RAW)
+    {
+        sav_append(s,frm,s->frm_sz);
+        s->n_frm++;
+        return;
+    }
+
+    if ((long)s->n_frm==s->cap)
+    {
+        long cap=s->cap ? s->cap*2 : 1024;
+        uint64_t *idx=(uint64_t *)realloc(s->idx,sizeof(uint64_t)*cap);
+        if (idx==NULL)
+        {
+            s->err=ENOMEM;
+            return;
+        }
+        s->idx=idx;
+        s->cap=cap;
+    }
+    if (s->batch_sz-s->fill<img_dz_bound(IMG_DZ_BAND_DEF))
+        sav_flush(s,0);
+    s->idx[s->n_frm++]=s->off+s->fill;
+    s->fill+=img_dz_enc(s->batch+s->fill,(const uint16_t *)frm,IMG_DZ_BAND_DEF,NULL);
+    if (s->fill>=s->batch_sz-IMG_SAV_ALIGN)
+        sav_flush(s,0);
+}
+
+
+static void *sav_thread(void *arg)
+{
+    struct img_sav_s *s=(struct img_sav_s *)arg;
+    int tail,n,i;
+
+    pthread_mutex_lock(&s->mtx);
+    for (;;)
+    {
+        while (s->cnt==0 && !s->quit)
+            pthread_cond_wait(&s->cv_put,&s->mtx);
+        if (s->cnt==0)
+            break;
+        n=s->cnt;
+        tail=(s->head-n+s->n_buf)%s->n_buf;
+        pthread_mutex_unlock(&s->mtx);
+
+        // 取出的帧一起处理，处理期间采集线程可以继续提交；
+        // 每帧拷贝（或压缩）到批量缓冲区后立即归还，不等整批写完
+        for (i=0;i<n;i++)
+        {
+            if (s->err==0)
+                sav_write(s,s->buf[(tail+i)%s->n_buf]);
+            pthread_mutex_lock(&s->mtx);
+            s->cnt--;
+            pthread_cond_signal(&s->cv_free);
+            pthread_mutex_unlock(&s->mtx);
+        }
+        pthread_mutex_lock(&s->mtx);
+    }
+    pthread_mutex_unlock(&s->mtx);
+    return NULL;
+}
+
+
+int img_sav_open(struct img_sav_s *s, const char *fname, size_t frm_sz, int n_buf, int fmt, int wait_ms)
+{
+    size_t batch_sz=IMG_SAV_BATCH_DEF;
+    int flags=O_WRONLY|O_CREAT|O_TRUNC,i;
+    uint8_t *p;
+
+    memset(s,0,sizeof(*s));
+    s->fd=-1;
+    if (n_buf<1 || n_buf>IMG_SAV_BUF_MAX || frm_sz==0 || (fmt==IMG_SAV_DZ && frm_sz!=IMG_SZ*sizeof(uint16_t)))
+    {
+        fprintf(stderr,"img_sav: bad parameters\n");
+        return -1;
+    }
+    if (fmt==IMG_SAV_DZ && batch_sz<2*img_dz_bound(IMG_DZ_BAND_DEF))
+        batch_sz=ALIGN_UP(2*img_dz_bound(IMG_DZ_BAND_DEF),IMG_SAV_ALIGN);
+    s->fmt     =fmt;
+    s->wait_ms =wait_ms;
+    s->frm_sz  =frm_sz;
+    s->n_buf   =n_buf;
+    s->batch_sz=batch_sz;
+
+    // 帧缓冲区和批量缓冲区都从内存池分配
+    if (img_pool_init(&s->pool,batch_sz+2*IMG_SAV_ALIGN+n_buf*(ALIGN_UP(frm_sz,IMG_POOL_ALIGN)+IMG_POOL_ALIGN),
+                      IMG_POOL_PREFAULT))
+    {
+        fprintf(stderr,"img_sav: cannot allocate buffers\n");
+        return -1;
+    }
+    p=(uint8_t *)img_pool_alloc(&s->pool,batch_sz+IMG_SAV_ALIGN);
+    img_pool_reserve(&s->pool,frm_sz,n_buf);
+    for (i=0;i<n_buf;i++)
+        s->buf[i]=img_pool_alloc(&s->pool,frm_sz);
+    if (p==NULL || s->buf[n_buf-1]==NULL)
+    {
+        fprintf(stderr,"img_sav: cannot allocate buffers\n");
+        img_pool_destroy(&s->pool);
+        return -1;
+    }
+    s->batch=(uint8_t *)ALIGN_UP((uintptr_t)p,IMG_SAV_ALIGN);
+
+#ifdef O_DIRECT
+    s->fd=open(fname,flags|O_DIRECT,0644);
+    s->direct=(s->fd>=0);
+#endif
+    if (s->fd<0)
+        s->fd=open(fname,flags,0644);
+    if (s->fd<0)
+    {
+        perror(fname);
+        img_pool_destroy(&s->pool);
+        return -1;
+    }
+
+    if (fmt==IMG_SAV_DZ)
+    {
+        img_dz_hdr(s->batch,IMG_DZ_BAND_DEF);
+        s->fill=IMG_DZ_HDR_SZ;
+    }
+
+    pthread_mutex_init(&s->mtx,NULL);
+    pthread_cond_init(&s->cv_put,NULL);
+    pthread_cond_init(&s->cv_free,NULL);
+    if (pthread_create(&s->thr,NULL,sav_thread,s))
+    {
+        fprintf(stderr,"img_sav: cannot create writer thread\n");
+        pthread_cond_destroy(&s->cv_free);
+        pthread_cond_destroy(&s->cv_put);
+        pthread_mutex_destroy(&s->mtx);
+        close(s->fd);
+        img_pool_destroy(&s->pool);
+        return -1;
+    }
+    return 0;
+}
+
+
+void *img_sav_get(struct img_sav_s *s)
+{
+    void *buf=NULL;
+
+    pthread_mutex_lock(&s->mtx);
+    if (s->cnt==s->n_buf && s->wait_ms!=0)
+    {
+        s->n_wait++;
+        if (s->wait_ms<0)
+        {
+            while (s->cnt==s->n_buf)
+                pthread_cond_wait(&s->cv_free,&s->mtx);
+        }
+        else
+        {
+            struct timespec ts;
+            clock_gettime(CLOCK_REALTIME,&ts);
+            ts.tv_sec +=s->wait_ms/1000;
+            ts.tv_nsec+=(s->wait_ms%1000)*1000000L;
+            if (ts.tv_nsec>=1000000000L)
+            {
+                ts.tv_sec++;
+                ts.tv_nsec-=1000000000L;
+            }
+            while (s->cnt==s->n_buf)
+                if (pthread_cond_timedwait(&s->cv_free,&s->mtx,&ts)==ETIMEDOUT)
+                    break;
+        }
+    }
+    if (s->cnt<s->n_buf)
+        buf=s->buf[s->head];
+    else
+        s->n_drop++;
+    pthread_mutex_unlock(&s->mtx);
+    return buf;
+}
+
+
+void img_sav_put(struct img_sav_s *s, void *buf)
+{
+    (void)buf;                                              // 一定是buf[head]
+    pthread_mutex_lock(&s->mtx);
+    s->head=(s->head+1)%s->n_buf;
+    s->cnt++;
+    s->n_put++;
+    if (s->cnt>s->q_max) s->q_max=s->cnt;
+    pthread_cond_signal(&s->cv_put);
+    pthread_mutex_unlock(&s->mtx);
+}
+
+
+int img_sav_frame(struct img_sav_s *s, const void *frm)
+{
+    void *buf=img_sav_get(s);
+    if (buf==NULL)
+        return 1;
+    memcpy(buf,frm,s->frm_sz);
+    img_sav_put(s,buf);
+    return 0;
+}
+
+
+int img_sav_close(struct img_sav_s *s)
+{
+    if (s->fd<0)
+        return -1;
+
+    pthread_mutex_lock(&s->mtx);
+    s->quit=1;
+    pthread_cond_signal(&s->cv_put);
+    pthread_mutex_unlock(&s->mtx);
+    pthread_join(s->thr,NULL);
+
+    if (s->fmt==IMG_SAV_DZ && s->err==0)
+    {
+        uint8_t tail[IMG_DZ_TAIL_SZ];
+        img_dz_tail(tail,s->n_frm);
+        sav_append(s,s->idx,sizeof(uint64_t)*s->n_frm);
+        sav_append(s,tail,IMG_DZ_TAIL_SZ);
+    }
+    sav_flush(s,1);
+    if (close(s->fd) && s->err==0)
+        s->err=errno;
+    s->fd=-1;
+    if (s->err)
+        fprintf(stderr,"img_sav: %s\n",strerror(s->err));
+
+    pthread_mutex_destroy(&s->mtx);
+    pthread_cond_destroy(&s->cv_put);
+    pthread_cond_destroy(&s->cv_free);
+    free(s->idx);
+    s->idx=NULL;
+    img_pool_destroy(&s->pool);
+    return s->err ? -1 : 0;
+}
+
+
+void img_sav_report(struct img_sav_s *s, FILE *fp)
+{
+    double t=s->t_wr/1e9;
+    fprintf(fp,"record: %llu frames, %llu dropped, %llu waits, %.1f MB at %.1f MB/s%s, "
+            "%llu writes, max %.1f ms, queue max %d/%d\n",
+            (unsigned long long)s->n_frm,(unsigned long long)s->n_drop,(unsigned long long)s->n_wait,
+            s->off/1048576.0,t>0 ? s->off/1048576.0/t : 0.0,s->direct ? " (O_DIRECT)" : "",
+            (unsigned long long)s->n_wr,s->t_wr_max/1e6,s->q_max,s->n_buf);
+}
@@ -0,0 +1,123 @@
+/**
+ * @file    img_sav.h
+ * @author  YRD
+ * @version 1.0
+ * @date    2026-10-18
+ * @brief   异步录制
+ * @details 采集线程把帧放入有界队列后立即返回，由单独的写线程写文件（global_cfg.py中KINECT_SAV_FNAME的原始格式，
+ *          或img_dz.h的压缩格式），磁盘慢时不会阻塞采集：
+ *          1. 帧缓冲区在打开时从内部内存池一次分配，采集线程用img_sav_get取空闲缓冲区、填入数据后img_sav_put提交；
+ *          2. 队列满时按wait_ms处理：0立即丢弃该帧，>0最多等待wait_ms毫秒（反压），<0一直等待；
+ *          3. 写线程每次取出队列中全部的帧，拷贝（或压缩）到按页对齐的批量缓冲区，满batch字节后一次写出，
+ *             文件用O_DIRECT打开，不经过页缓存，不会挤占滤波用到的缓存和内存带宽，不支持O_DIRECT时用普通写入；
+ *          4. 写文件出错后不再写入，但继续取走队列中的帧，采集线程不受影响。
+ *          只允许一个采集线程调用img_sav_get/img_sav_put/img_sav_frame
+*/
+
+#ifndef __IMG_SAV_H__
+#define __IMG_SAV_H__
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <pthread.h>
+#include "img_pool.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define IMG_SAV_BUF_MAX     64              ///< 最多帧缓冲区数
+#define IMG_SAV_BUF_DEF     16              ///< 默认帧缓冲区数
+#define IMG_SAV_BATCH_DEF   (8u<<20)        ///< 默认批量写入字节数
+#define IMG_SAV_ALIGN       4096            ///< O_DIRECT写入的对齐字节数
+
+/// 文件格式
+enum { IMG_SAV_RAW, IMG_SAV_DZ };
+
+/**
+ * @brief           异步录制
+ */
+struct img_sav_s
+{
+    int             fd;
+    int             fmt;                ///< 文件格式，IMG_SAV_xxx
+    int             direct;             ///< 实际使用了O_DIRECT
+    int             wait_ms;            ///< 队列满时的等待时间
+    size_t          frm_sz;             ///< 每帧字节数
+    struct img_pool_s pool;             ///< 帧缓冲区内存池
+    void           *buf[IMG_SAV_BUF_MAX];
+    int             n_buf;
+    int             head,cnt;           ///< 队列（环形，head为下一个空闲缓冲区）
+    int             quit;
+    pthread_t       thr;
+    pthread_mutex_t mtx;
+    pthread_cond_t  cv_put,cv_free;
+
+    uint8_t        *batch;              ///< 批量写入缓冲区，IMG_SAV_ALIGN对齐
+    size_t          batch_sz,fill;
+    uint64_t        off;                ///< 已写入文件的字节数
+    uint64_t       *idx;                ///< 压缩格式的帧偏移
+    long            cap;
+    int             err;                ///< 写文件出错时的errno
+
+    // 统计
+    uint64_t        n_put;              ///< 提交的帧数
+    uint64_t        n_drop;             ///< 队列满丢弃的帧数
+    uint64_t        n_wait;             ///< 队列满等待的次数
+    uint64_t        n_frm;              ///< 写入的帧数
+    uint64_t        n_wr;               ///< 写文件次数
+    uint64_t        t_wr,t_wr_max;      ///< 写文件时间（ns）
+    int             q_max;              ///< 队列最大长度
+};
+
+/**
+ * @fn              int img_sav_open(struct img_sav_s *s, const char *fname, size_t frm_sz, int n_buf, int fmt, int wait_ms)
+ * @brief           创建录制文件，启动写线程
+ * @param [out]     struct img_sav_s *s：录制
+ * @param [in]      const char *fname：文件名
+ * @param [in]      size_t frm_sz：每帧字节数，压缩格式时必须为IMG_SZ*2（uint16/int16深度图）
+ * @param [in]      int n_buf：帧缓冲区数（队列长度），1~IMG_SAV_BUF_MAX
+ * @param [in]      int fmt：文件格式，IMG_SAV_xxx
+ * @param [in]      int wait_ms：队列满时的等待时间（毫秒），0丢弃，<0一直等待
+ * @retval          int：0成功，-1失败（错误信息输出到stderr）
+ */
+int img_sav_open(struct img_sav_s *s, const char *fname, size_t frm_sz, int n_buf, int fmt, int wait_ms);
+
+/**
+ * @fn              void *img_sav_get(struct img_sav_s *s)
+ * @brief           取一个空闲帧缓冲区，队列满时按wait_ms等待
+ * @retval          void *：帧缓冲区，NULL表示该帧被丢弃
+ */
+void *img_sav_get(struct img_sav_s *s);
+
+/**
+ * @fn              void img_sav_put(struct img_sav_s *s, void *buf)
+ * @brief           提交img_sav_get取得的帧缓冲区
+ */
+void img_sav_put(struct img_sav_s *s, void *buf);
+
+/**
+ * @fn              int img_sav_frame(struct img_sav_s *s, const void *frm)
+ * @brief           拷贝一帧数据并提交
+ * @retval          int：0已提交，1丢弃
+ */
+int img_sav_frame(struct img_sav_s *s, const void *frm);
+
+/**
+ * @fn              int img_sav_close(struct img_sav_s *s)
+ * @brief           写完队列中的帧（压缩格式还写入帧索引），停止写线程并关闭文件
+ * @retval          int：0成功，-1录制过程中写文件出错
+ */
+int img_sav_close(struct img_sav_s *s);
+
+/**
+ * @fn              void img_sav_report(struct img_sav_s *s, FILE *fp)
+ * @brief           输出统计：写入、丢弃帧数，写入速度，最长写文件时间，队列最大长度
+ */
+void img_sav_report(struct img_sav_s *s, FILE *fp);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -0,0 +1,268 @@
+/**
+ * @file    img_shm.c
+ * @author  YRD
+ * @version 1.0
+ * @date    2026-10-18
+ * @brief   共享内存帧传递
+ * @details futex用FUTEX_WAIT/FUTEX_WAKE（不带PRIVATE标志，用于进程间）；读取方只读映射，无法登记等待者，
+ *          所以写入方每帧都调用一次FUTEX_WAKE（没有等待者时约1us）
+*/
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "img_const.h"
+#include "img_shm.h"
+
+#ifdef __linux__
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#endif
+
+#define SHM_PAGE        4096
+#define ALIGN_UP(x,a)   (((x)+(a)-1)/(a)*(a))
+
+static const char shm_magic[8]={ 'I','M','G','S','H','M',0,1 };
+
+
+static void shm_path(char *path, size_t sz, const char *name)
+{
+    snprintf(path,sz,"/%s",name);
+}
+
+
+int img_shm_create(struct img_shm_s *shm, const char *name, size_t frm_sz, int n_slot)
+{
+    struct img_shm_hdr_s *h;
+    char path[80];
+    size_t stride,off;
+    void *p;
+    int fd;
+
+    memset(shm,0,sizeof(*shm));
+    if (n_slot<2 || n_slot>IMG_SHM_SLOT_MAX || frm_sz==0 || strlen(name)>=sizeof(shm->name))
+    {
+        fprintf(stderr,"img_shm: bad parameters\n");
+        return -1;
+    }
+    off   =ALIGN_UP(sizeof(struct img_shm_hdr_s),SHM_PAGE);
+    stride=ALIGN_UP(frm_sz,SHM_PAGE);
+    shm->size=off+stride*n_slot;
+
+    shm_path(path,sizeof(path),name);
+    fd=shm_open(path,O_RDWR|O_CREAT|O_TRUNC,0644);
+    if (fd<0 || ftruncate(fd,(off_t)shm->size))
+    {
+        perror(path);
+        if (fd>=0)
+        {
+            close(fd);
+            shm_unlink(path);
+        }
+        return -1;
+    }
+    p=mmap(NULL,shm->size,PROT_READ|PROT_WRITE,MAP_SHARED,fd,0);
+    close(fd);
+    if (p==MAP_FAILED)
+    {
+        perror(path);
+        shm_unlink(path);
+        return -1;
+    }
+
+    // 先写好文件头其他部分，最后写标志，读取方看到标志时文件头已经完整
+    shm->base=(uint8_t *)p;
+    shm->hdr =h=(struct img_shm_hdr_s *)p;
+    shm->owner=1;
+    strcpy(shm->name,name);
+    h->wid        =IMG_WID;
+    h->hgt        =IMG_HGT;
+    h->frm_sz     =(uint32_t)frm_sz;
+    h->n_slot     =n_slot;
+    h->slot_off   =off;
+    h->slot_stride=stride;
+    h->pid        =(uint32_t)getpid();
+    __sync_synchronize();
+    memcpy(h->magic,shm_magic,8);
+    return 0;
+}
+
+
+void *img_shm_begin(struct img_shm_s *shm)
+{
+    struct img_shm_hdr_s *h=shm->hdr;
+    uint64_t seq=h->seq+1;
+    int s=(int)(seq%h->n_slot);
+
+    shm->seq=seq;
+    h->slot[s].lock=2*seq-1;
+    __sync_synchronize();
+    return shm->base+h->slot_off+s*h->slot_stride;
+}
+
+
+void img_shm_commit(struct img_shm_s *shm, uint64_t t_ns)
+{
+    struct img_shm_hdr_s *h=shm->hdr;
+    uint64_t seq=shm->seq;
+    int s=(int)(seq%h->n_slot);
+
+    h->slot[s].t_ns=t_ns;
+    __sync_synchronize();
+    h->slot[s].lock=2*seq;
+    h->seq=seq;
+    __sync_fetch_and_add(&h->futex,1);
+#ifdef __linux__
+    syscall(SYS_futex,&h->futex,FUTEX_WAKE,0x7fffffff,NULL,NULL,0);
+#endif
+}
+
+
+void img_shm_publish(struct img_shm_s *shm, const void *frm, uint64_t t_ns)
+{
+    memcpy(img_shm_begin(shm),frm,shm->hdr->frm_sz);
+    img_shm_commit(shm,t_ns);
+}
+
+
+int img_shm_open(struct img_shm_s *shm, const char *name)
+{
+    struct img_shm_hdr_s *h;
+    struct stat st;
+    char path[80];
+    void *p;
+    int fd;
+
+    memset(shm,0,sizeof(*shm));
+    if (strlen(name)>=sizeof(shm->name))
+        return -1;
+    shm_path(path,sizeof(path),name);
+    fd=shm_open(path,O_RDONLY,0);
+    if (fd<0)
+        return -1;
+    if (fstat(fd,&st) || (size_t)st.st_size<sizeof(struct img_shm_hdr_s))
+    {
+        close(fd);
+        return -1;
+    }
+    p=mmap(NULL,(size_t)st.st_size,PROT_READ,MAP_SHARED,fd,0);
+    close(fd);
+    if (p==MAP_FAILED)
+        return -1;
+
+    h=(struct img_shm_hdr_s *)p;
+    if (memcmp(h->magic,shm_magic,8) || h->n_slot<2 || h->n_slot>IMG_SHM_SLOT_MAX
+        || h->slot_off+h->slot_stride*h->n_slot>(uint64_t)st.st_size || h->frm_sz>h->slot_stride)
+    {
+        munmap(p,(size_t)st.st_size);
+        return -1;
+    }
+    shm->base=(uint8_t *)p;
+    shm->hdr =h;
+    shm->size=(size_t)st.st_size;
+    strcpy(shm->name,name);
+    return 0;
+}
+
+
+uint64_t img_shm_wait(struct img_shm_s *shm, uint64_t last, int timeout_ms)
+{
+    struct img_shm_hdr_s *h=shm->hdr;
+    struct timespec t_end,now,ts;
+    uint64_t seq;
+    uint32_t fx;
+
+    clock_gettime(CLOCK_MONOTONIC,&t_end);
+    if (timeout_ms>0)
+    {
+        t_end.tv_sec +=timeout_ms/1000;
+        t_end.tv_nsec+=(timeout_ms%1000)*1000000L;
+        if (t_end.tv_nsec>=1000000000L)
+        {
+            t_end.tv_sec++;
+            t_end.tv_nsec-=1000000000L;
+        }
+    }
+
+    for (;;)
+    {
+        // 先读计数再读序号，计数变化后才等待，不会漏掉两次读取之间发布的帧
+        fx=h->futex;
+        __sync_synchronize();
+        if ((seq=h->seq)>last)
+            return seq;
+        if (timeout_ms==0)
+            return 0;
+
+        ts.tv_sec=1;
+        ts.tv_nsec=0;
+        if (timeout_ms>0)
+        {
+            clock_gettime(CLOCK_MONOTONIC,&now);
+            ts.tv_sec =t_end.tv_sec-now.tv_sec;
+            ts.tv_nsec=t_end.tv_nsec-now.tv_nsec;
+            if (ts.tv_nsec<0)
+            {
+                ts.tv_sec--;
+                ts.tv_nsec+=1000000000L;
+            }
+            if (ts.tv_sec<0)
+                return 0;
+        }
+#ifdef __linux__
+        syscall(SYS_futex,&h->futex,FUTEX_WAIT,fx,&ts,NULL,0);
+#else
+        (void)fx;
+        usleep(100);
+#endif
+    }
+}
+
+
+const void *img_shm_frame(struct img_shm_s *shm, uint64_t seq, uint64_t *t_ns)
+{
+    struct img_shm_hdr_s *h=shm->hdr;
+    int s;
+
+    if (seq==0)
+        return NULL;
+    s=(int)(seq%h->n_slot);
+    if (h->slot[s].lock!=2*seq)
+        return NULL;
+    if (t_ns)
+        *t_ns=h->slot[s].t_ns;
+    __sync_synchronize();
+    return shm->base+h->slot_off+s*h->slot_stride;
+}
+
+
+int img_shm_valid(struct img_shm_s *shm, uint64_t seq)
+{
+    __sync_synchronize();
+    return seq && shm->hdr->slot[seq%shm->hdr->n_slot].lock==2*seq;
+}
+
+
+void img_shm_close(struct img_shm_s *shm)
+{
+    char path[80];
+
+    if (shm->base)
+        munmap(shm->base,shm->size);
+    if (shm->owner)
+    {
+        shm_path(path,sizeof(path),shm->name);
+        shm_unlink(path);
+    }
+    memset(shm,0,sizeof(*shm));
+}
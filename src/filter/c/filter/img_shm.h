@@ -0,0 +1,139 @@
+/**
+ * @file    img_shm.h
+ * @author  YRD
+ * @version 1.0
+ * @date    2026-10-18
+ * @brief   共享内存帧传递
+ * @details 滤波程序把处理后的帧写入共享内存中的环形帧槽，其他进程（Python检测、显示程序等）只读映射后直接读取，不拷贝数据：
+ *          1. 共享内存（/dev/shm/<name>）开头是文件头，记录尺寸、帧槽数和最新帧序号，后面是按页对齐的n_slot个帧槽，
+ *             第seq帧（从1开始）写在第seq%n_slot个帧槽；
+ *          2. 每个帧槽有一个顺序锁(seqlock)：写入前设为2*seq-1（奇数），写完后设为2*seq，读取方读数据前后各检查一次，
+ *             不等于2*seq说明读取期间帧槽被覆盖，丢弃该帧即可，写入方从不等待读取方；
+ *          3. 发布后对文件头中的计数做futex唤醒，读取方在futex上等待新帧，通知延迟为微秒级；非Linux系统轮询。
+ *          读取方只读映射，不修改共享内存，任意多个读取方互不影响，也不会拖慢写入方（Python的GIL只影响读取进程自己）。
+ *          只允许一个写入方
+*/
+
+#ifndef __IMG_SHM_H__
+#define __IMG_SHM_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define IMG_SHM_SLOT_MAX    64              ///< 最多帧槽数
+#define IMG_SHM_SLOT_DEF    8               ///< 默认帧槽数
+#define IMG_SHM_NAME_DEF    "img_filter"    ///< 默认共享内存名
+
+/**
+ * @brief           帧槽信息
+ */
+struct img_shm_slot_s
+{
+    volatile uint64_t lock;                 ///< 顺序锁，2*seq表示第seq帧已写完，奇数表示正在写
+    volatile uint64_t t_ns;                 ///< 帧的采集时间（img_time_ns，CLOCK_MONOTONIC，进程间可比较）
+};
+
+/**
+ * @brief           共享内存文件头，读取方按此结构解析（Python端见img_py.c的ShmReader）
+ */
+struct img_shm_hdr_s
+{
+    char        magic[8];                   ///< "IMGSHM\0\1"
+    uint32_t    wid,hgt;                    ///< 图像尺寸
+    uint32_t    frm_sz;                     ///< 每帧字节数
+    uint32_t    n_slot;                     ///< 帧槽数
+    uint64_t    slot_off;                   ///< 第一个帧槽相对于文件头的偏移
+    uint64_t    slot_stride;                ///< 帧槽间隔（按页对齐）
+    volatile uint64_t seq;                  ///< 最新帧序号，0表示还没有帧
+    volatile uint32_t futex;                ///< 发布计数（低32位），用于futex等待
+    uint32_t    pid;                        ///< 写入进程号
+    struct img_shm_slot_s slot[IMG_SHM_SLOT_MAX];
+};
+
+/**
+ * @brief           共享内存（写入方或读取方）
+ */
+struct img_shm_s
+{
+    struct img_shm_hdr_s *hdr;
+    uint8_t    *base;                       ///< 映射地址（和hdr相同）
+    size_t      size;                       ///< 映射长度
+    int         owner;                      ///< 写入方，关闭时删除共享内存
+    uint64_t    seq;                        ///< 写入方正在写的帧序号
+    char        name[64];
+};
+
+/**
+ * @fn              int img_shm_create(struct img_shm_s *shm, const char *name, size_t frm_sz, int n_slot)
+ * @brief           写入方创建共享内存，已存在时覆盖
+ * @param [in]      const char *name：共享内存名（不带'/'）
+ * @param [in]      size_t frm_sz：每帧字节数
+ * @param [in]      int n_slot：帧槽数，2~IMG_SHM_SLOT_MAX，读取方处理一帧的时间内写入的帧数应小于n_slot-1
+ * @retval          int：0成功，-1失败（错误信息输出到stderr）
+ */
+int img_shm_create(struct img_shm_s *shm, const char *name, size_t frm_sz, int n_slot);
+
+/**
+ * @fn              void *img_shm_begin(struct img_shm_s *shm)
+ * @brief           写入方取下一帧的帧槽，直接写入后调用img_shm_commit发布
+ */
+void *img_shm_begin(struct img_shm_s *shm);
+
+/**
+ * @fn              void img_shm_commit(struct img_shm_s *shm, uint64_t t_ns)
+ * @brief           发布img_shm_begin取得的帧，唤醒等待的读取方
+ * @param [in]      uint64_t t_ns：帧的采集时间
+ */
+void img_shm_commit(struct img_shm_s *shm, uint64_t t_ns);
+
+/**
+ * @fn              void img_shm_publish(struct img_shm_s *shm, const void *frm, uint64_t t_ns)
+ * @brief           拷贝一帧到帧槽并发布
+ */
+void img_shm_publish(struct img_shm_s *shm, const void *frm, uint64_t t_ns);
+
+/**
+ * @fn              int img_shm_open(struct img_shm_s *shm, const char *name)
+ * @brief           读取方只读打开共享内存
+ * @retval          int：0成功，-1不存在或格式错误
+ */
+int img_shm_open(struct img_shm_s *shm, const char *name);
+
+/**
+ * @fn              uint64_t img_shm_wait(struct img_shm_s *shm, uint64_t last, int timeout_ms)
+ * @brief           等待序号大于last的帧
+ * @param [in]      uint64_t last：已处理的最后一帧序号，0表示还没有处理过
+ * @param [in]      int timeout_ms：最长等待时间，<0一直等待
+ * @retval          uint64_t：最新帧序号，0表示超时
+ */
+uint64_t img_shm_wait(struct img_shm_s *shm, uint64_t last, int timeout_ms);
+
+/**
+ * @fn              const void *img_shm_frame(struct img_shm_s *shm, uint64_t seq, uint64_t *t_ns)
+ * @brief           取第seq帧的数据指针（直接指向共享内存），用完后用img_shm_valid确认读取期间没有被覆盖
+ * @param [out]     uint64_t *t_ns：帧的采集时间，可以为NULL
+ * @retval          const void *：该帧已被覆盖或尚未写入时返回NULL
+ */
+const void *img_shm_frame(struct img_shm_s *shm, uint64_t seq, uint64_t *t_ns);
+
+/**
+ * @fn              int img_shm_valid(struct img_shm_s *shm, uint64_t seq)
+ * @brief           检查第seq帧是否仍然完整
+ * @retval          int：1完整，0已被覆盖
+ */
+int img_shm_valid(struct img_shm_s *shm, uint64_t seq);
+
+/**
+ * @fn              void img_shm_close(struct img_shm_s *shm)
+ * @brief           解除映射，写入方同时删除共享内存
+ */
+void img_shm_close(struct img_shm_s *shm);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -0,0 +1,313 @@
+/**
+ * @file    img_trace.c
+ * @author  YRD
+ * @version 1.0
+ * @date    2026-10-18
+ * @brief   处理时间跟踪
+ * @details 直方图所有线程共享，用原子操作更新；事件环形缓冲区每个线程一个，只有所属线程写入，记录时不加锁
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "img_trace.h"
+
+#define HIST_SUB_BITS   5                               // 每个2的幂区间分2^5个桶
+#define HIST_SUB        (1<<HIST_SUB_BITS)
+#define HIST_N          ((64-HIST_SUB_BITS+1)*HIST_SUB)
+
+// 事件记录
+struct trace_ev_s
+{
+    uint64_t t0;
+    uint32_t dur;
+    uint32_t frame;
+    int      id;
+};
+
+// 线程的环形缓冲区
+struct trace_ring_s
+{
+    struct trace_ev_s *ev;
+    volatile uint64_t  n;                               // 累计记录数
+    const char        *name;
+    int                tid;
+};
+
+// 延迟直方图（ns）
+struct trace_hist_s
+{
+    uint32_t cnt[HIST_N];
+    uint64_t n,sum,max;
+};
+
+volatile int img_trace_flags=0;
+
+static pthread_mutex_t trace_mtx=PTHREAD_MUTEX_INITIALIZER;
+static const char *id_name[IMG_TRACE_ID_MAX];
+static struct trace_hist_s *id_hist[IMG_TRACE_ID_MAX];
+static int n_id=0;
+static struct trace_ring_s ring_tab[IMG_TRACE_THR_MAX];
+static int n_ring=0;
+static int ring_mask=IMG_TRACE_RING_DEF-1;
+static struct trace_ring_s ring_none;                   // 线程太多或内存不足时使用，不记录
+static __thread struct trace_ring_s *ring_cur;
+
+
+// 值到桶序号：小于2*HIST_SUB时每个值一个桶，之后每个2的幂区间HIST_SUB个桶
+static inline int hist_idx(uint64_t v)
+{
+    int b;
+    if (v<2*HIST_SUB)
+        return (int)v;
+    b=63-__builtin_clzll(v)-HIST_SUB_BITS;
+    return b*HIST_SUB+(int)(v>>b);
+}
+
+// 桶序号到值（桶的中点）
+static inline double hist_val(int idx)
+{
+    int b;
+    if (idx<2*HIST_SUB)
+        return idx;
+    b=idx/HIST_SUB-1;
+    return ((uint64_t)(idx%HIST_SUB+HIST_SUB)<<b)+((1ull<<b)-1)*0.5;
+}
+
+
+int img_trace_init(int ring_sz, int flags)
+{
+    int sz=1;
+
+    if (ring_sz<=0)
+        ring_sz=IMG_TRACE_RING_DEF;
+    while (sz<ring_sz)
+        sz<<=1;
+
+    pthread_mutex_lock(&trace_mtx);
+    ring_mask=sz-1;
+    pthread_mutex_unlock(&trace_mtx);
+
+    img_trace_enable(flags);
+    return 0;
+}
+
+
+void img_trace_enable(int flags)
+{
+    img_trace_flags=flags;
+}
+
+
+int img_trace_id(const char *name)
+{
+    int i;
+
+    pthread_mutex_lock(&trace_mtx);
+    for (i=0;i<n_id;i++)
+        if (strcmp(id_name[i],name)==0)
+            break;
+    if (i==n_id)
+    {
+        if (n_id<IMG_TRACE_ID_MAX && (id_hist[i]=(struct trace_hist_s *)calloc(1,sizeof(struct trace_hist_s)))!=NULL)
+        {
+            id_name[i]=name;
+            __sync_synchronize();
+            n_id++;
+        }
+        else
+            i=-1;
+    }
+    pthread_mutex_unlock(&trace_mtx);
+    return i;
+}
+
+
+// 当前线程的环形缓冲区，第一次调用时分配
+static struct trace_ring_s *ring_get(void)
+{
+    struct trace_ring_s *r=ring_cur;
+
+    if (r)
+        return r;
+
+    pthread_mutex_lock(&trace_mtx);
+    r=&ring_none;
+    if (n_ring<IMG_TRACE_THR_MAX)
+    {
+        struct trace_ev_s *ev=(struct trace_ev_s *)malloc(sizeof(struct trace_ev_s)*(ring_mask+1));
+        if (ev)
+        {
+            r=&ring_tab[n_ring];
+            r->ev  =ev;
+            r->n   =0;
+            r->tid =n_ring+1;
+            if (r->name==NULL)
+                r->name="thread";
+            n_ring++;
+        }
+    }
+    pthread_mutex_unlock(&trace_mtx);
+
+    ring_cur=r;
+    return r;
+}
+
+
+void img_trace_thread_name(const char *name)
+{
+    ring_get()->name=name;
+}
+
+
+void img_trace_rec_(int id, uint64_t t0, uint64_t t1, uint32_t frame)
+{
+    int flags=img_trace_flags;
+    uint64_t dt=t1-t0;
+
+    if ((unsigned)id>=(unsigned)n_id)
+        return;
+
+    if (flags&IMG_TRACE_HIST)
+    {
+        struct trace_hist_s *h=id_hist[id];
+        uint64_t m;
+        int i=hist_idx(dt);
+
+        __sync_fetch_and_add(&h->cnt[i],1);
+        __sync_fetch_and_add(&h->n,1);
+        __sync_fetch_and_add(&h->sum,dt);
+        while ((m=h->max)<dt && !__sync_bool_compare_and_swap(&h->max,m,dt))
+            ;
+    }
+
+    if (flags&IMG_TRACE_EV)
+    {
+        struct trace_ring_s *r=ring_get();
+        struct trace_ev_s *e;
+
+        if (r->ev==NULL)
+            return;
+        e=&r->ev[r->n&ring_mask];
+        e->t0   =t0;
+        e->dur  =dt>0xffffffffu ? 0xffffffffu : (uint32_t)dt;
+        e->frame=frame;
+        e->id   =id;
+        __sync_synchronize();
+        r->n++;
+    }
+}
+
+
+double img_trace_pct(int id, double p)
+{
+    struct trace_hist_s *h;
+    uint64_t k,s=0;
+    int i;
+
+    if ((unsigned)id>=(unsigned)n_id || id_hist[id]->n==0)
+        return 0;
+    h=id_hist[id];
+
+    k=(uint64_t)(p*h->n+0.5);
+    if (k<1) k=1;
+    if (k>h->n) k=h->n;
+    for (i=0;i<HIST_N;i++)
+    {
+        s+=h->cnt[i];
+        if (s>=k)
+            break;
+    }
+    if (p>=1 || i>=HIST_N || hist_val(i)>h->max)
+        return h->max/1e3;
+    return hist_val(i)/1e3;
+}
+
+
+void img_trace_summary(FILE *fp, int json)
+{
+    int i;
+
+    if (json)
+        fprintf(fp,"{");
+    else
+        fprintf(fp,"%-16s %8s %10s %10s %10s %10s %10s %10s\n",
+                "stage","count","avg(us)","p50","p90","p99","p99.9","max");
+
+    for (i=0;i<n_id;i++)
+    {
+        struct trace_hist_s *h=id_hist[i];
+        double avg=h->n ? h->sum/1e3/h->n : 0;
+
+        if (json)
+            fprintf(fp,"%s\n \"%s\":{\"count\":%llu,\"avg\":%.2f,\"p50\":%.2f,\"p90\":%.2f,\"p99\":%.2f,\"p999\":%.2f,\"max\":%.2f}",
+                    i ? "," : "",id_name[i],(unsigned long long)h->n,avg,img_trace_pct(i,0.5),img_trace_pct(i,0.9),
+                    img_trace_pct(i,0.99),img_trace_pct(i,0.999),h->max/1e3);
+        else
+            fprintf(fp,"%-16s %8llu %10.1f %10.1f %10.1f %10.1f %10.1f %10.1f\n",
+                    id_name[i],(unsigned long long)h->n,avg,img_trace_pct(i,0.5),img_trace_pct(i,0.9),
+                    img_trace_pct(i,0.99),img_trace_pct(i,0.999),h->max/1e3);
+    }
+
+    if (json)
+        fprintf(fp,"\n}\n");
+}
+
+
+int img_trace_write_chrome(const char *fname)
+{
+    FILE *fp=fopen(fname,"w");
+    uint64_t t_base=~0ull,k,k0;
+    int i,n_ev=0,first=1;
+
+    if (fp==NULL)
+    {
+        perror(fname);
+        return -1;
+    }
+
+    // 时间从最早的事件开始，以免数值太大
+    for (i=0;i<n_ring;i++)
+    {
+        struct trace_ring_s *r=&ring_tab[i];
+        k0=r->n>(uint64_t)ring_mask+1 ? r->n-ring_mask-1 : 0;
+        if (r->n>k0 && r->ev[k0&ring_mask].t0<t_base)
+            t_base=r->ev[k0&ring_mask].t0;
+    }
+
+    fprintf(fp,"{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+    for (i=0;i<n_ring;i++)
+    {
+        struct trace_ring_s *r=&ring_tab[i];
+
+        fprintf(fp,"%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+                first ? "" : ",",r->tid,r->name);
+        first=0;
+
+        k0=r->n>(uint64_t)ring_mask+1 ? r->n-ring_mask-1 : 0;
+        for (k=k0;k<r->n;k++)
+        {
+            struct trace_ev_s *e=&r->ev[k&ring_mask];
+            fprintf(fp,",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"frame\":%u}}",
+                    id_name[e->id],r->tid,(e->t0-t_base)/1e3,e->dur/1e3,e->frame);
+            n_ev++;
+        }
+    }
+    fprintf(fp,"\n]}\n");
+    fclose(fp);
+    return n_ev;
+}
+
+
+void img_trace_reset(void)
+{
+    int i;
+
+    pthread_mutex_lock(&trace_mtx);
+    for (i=0;i<n_id;i++)
+        memset(id_hist[i],0,sizeof(struct trace_hist_s));
+    for (i=0;i<n_ring;i++)
+        ring_tab[i].n=0;
+    pthread_mutex_unlock(&trace_mtx);
+}
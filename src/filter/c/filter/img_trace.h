@@ -0,0 +1,108 @@
+/**
+ * @file    img_trace.h
+ * @author  YRD
+ * @version 1.0
+ * @date    2026-10-18
+ * @brief   处理时间跟踪
+ * @details 记录各处理阶段（滤波级、整帧等）的运行时间，分两部分，可以在运行时分别打开和关闭：
+ *          1. 延迟直方图(IMG_TRACE_HIST)：对数-线性分桶（每个2的幂区间分32个桶，相对误差约3%），
+ *             所有线程共享，原子累加，开销很小，可以一直打开，用于输出各阶段延迟的百分位数；
+ *          2. 事件记录(IMG_TRACE_EV)：每个线程一个环形缓冲区（线程局部），记录每次运行的开始时间、时长和帧号，
+ *             缓冲区满后覆盖最老的记录，可导出为Chrome trace event格式（chrome://tracing或Perfetto打开）。
+ *          每个阶段用img_trace_id按名字注册，得到的编号用于记录。
+ *          导出函数应在被跟踪的线程停止记录后调用
+*/
+
+#ifndef __IMG_TRACE_H__
+#define __IMG_TRACE_H__
+
+#include <stdio.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define IMG_TRACE_HIST      1           ///< 延迟直方图
+#define IMG_TRACE_EV        2           ///< 事件记录
+
+#define IMG_TRACE_ID_MAX    64          ///< 最多阶段数
+#define IMG_TRACE_THR_MAX   64          ///< 最多线程数
+#define IMG_TRACE_RING_DEF  16384       ///< 每个线程默认记录的事件数
+
+/// 当前打开的功能（IMG_TRACE_HIST|IMG_TRACE_EV），用于在记录前快速判断
+extern volatile int img_trace_flags;
+
+/**
+ * @fn              int img_trace_init(int ring_sz, int flags)
+ * @brief           初始化
+ * @param [in]      int ring_sz：每个线程环形缓冲区的事件数，取整为2的幂，<=0时使用IMG_TRACE_RING_DEF
+ * @param [in]      int flags：初始打开的功能
+ * @retval          int：0成功，-1失败
+ */
+int img_trace_init(int ring_sz, int flags);
+
+/**
+ * @fn              void img_trace_enable(int flags)
+ * @brief           设置打开的功能，可以在运行中随时调用（例如在信号处理函数中）
+ */
+void img_trace_enable(int flags);
+
+/**
+ * @fn              int img_trace_id(const char *name)
+ * @brief           按名字注册阶段，同名返回同一编号，name需一直有效
+ * @retval          int：阶段编号，超过IMG_TRACE_ID_MAX时返回-1（之后的记录被忽略）
+ */
+int img_trace_id(const char *name);
+
+/**
+ * @fn              void img_trace_thread_name(const char *name)
+ * @brief           设置当前线程的名字，在Chrome trace中显示
+ */
+void img_trace_thread_name(const char *name);
+
+void img_trace_rec_(int id, uint64_t t0, uint64_t t1, uint32_t frame);
+
+/**
+ * @fn              void img_trace_rec(int id, uint64_t t0, uint64_t t1, uint32_t frame)
+ * @brief           记录阶段id的一次运行，时间为img_time_ns的值，全部功能关闭时只有一次判断
+ * @param [in]      int id：阶段编号
+ * @param [in]      uint64_t t0,t1：开始和结束时间（ns）
+ * @param [in]      uint32_t frame：帧号
+ */
+static inline void img_trace_rec(int id, uint64_t t0, uint64_t t1, uint32_t frame)
+{
+    if (img_trace_flags)
+        img_trace_rec_(id,t0,t1,frame);
+}
+
+/**
+ * @fn              double img_trace_pct(int id, double p)
+ * @brief           阶段id延迟的百分位数（us），p为0~1
+ */
+double img_trace_pct(int id, double p);
+
+/**
+ * @fn              void img_trace_summary(FILE *fp, int json)
+ * @brief           输出各阶段的次数、平均、p50/p90/p99/p99.9、最大延迟（us）
+ * @param [in]      int json：非0时输出JSON，否则输出表格
+ */
+void img_trace_summary(FILE *fp, int json);
+
+/**
+ * @fn              int img_trace_write_chrome(const char *fname)
+ * @brief           把各线程环形缓冲区中的事件导出为Chrome trace event格式的JSON文件
+ * @retval          int：导出的事件数，-1失败
+ */
+int img_trace_write_chrome(const char *fname);
+
+/**
+ * @fn              void img_trace_reset(void)
+ * @brief           清除直方图和事件记录
+ */
+void img_trace_reset(void);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
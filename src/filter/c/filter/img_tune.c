@@ -0,0 +1,218 @@
+/**
+ * @file    img_tune.c
+ * @author  YRD
+ * @version 1.0
+ * @date    2026-10-18
+ * @brief   滤波级实现的启动测速选择
+ * @details 测速使用自己的内存池，不占用调用者的内存池；每个实现单独建立只有一级的滤波链，
+ *          先用img_chain_run运行2帧（填充历史图像），再直接调用该级的执行函数计时
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "img_const.h"
+#include "img_pool.h"
+#include "img_chain.h"
+#include "img_tune.h"
+
+#define TUNE_MAGIC      "# img_tune 1"
+#define TUNE_LINE_MAX   64          // 缓存文件最多行数
+#define TUNE_VAR_MAX    8           // 每级最多实现数
+#define TUNE_MARGIN     0.98        // 比默认实现快2%以上才换，避免测速误差导致每台机器选择不同
+
+
+// 主机标识：CPU型号、核数、图像尺寸、线程数、编译器版本
+static void tune_key(char *key, size_t sz, struct img_par_s *par)
+{
+    char line[256],model[128]="unknown";
+    FILE *fp=fopen("/proc/cpuinfo","r");
+
+    if (fp)
+    {
+        while (fgets(line,sizeof(line),fp))
+        {
+            char *p=strchr(line,':');
+            if (p && (strncmp(line,"model name",10)==0 || strncmp(line,"Hardware",8)==0))
+            {
+                for (p++;*p==' ' || *p=='\t';p++) ;
+                p[strcspn(p,"\r\n")]=0;
+                snprintf(model,sizeof(model),"%s",p);
+                break;
+            }
+        }
+        fclose(fp);
+    }
+#ifdef __VERSION__
+    snprintf(key,sz,"%s|cpu %ld|%dx%d|thr %d|%s",model,sysconf(_SC_NPROCESSORS_ONLN),
+             IMG_WID,IMG_HGT,img_par_threads(par),__VERSION__);
+#else
+    snprintf(key,sz,"%s|cpu %ld|%dx%d|thr %d",model,sysconf(_SC_NPROCESSORS_ONLN),
+             IMG_WID,IMG_HGT,img_par_threads(par));
+#endif
+}
+
+
+// 读取缓存，主机标识相同且所有实现名有效时应用选择，返回0成功
+static int tune_load(const char *cache, const char *key, FILE *log)
+{
+    char line[512],stage[TUNE_LINE_MAX][64],var[TUNE_LINE_MAX][32];
+    int n=0,i,ok;
+    FILE *fp=fopen(cache,"r");
+
+    if (fp==NULL)
+        return -1;
+    ok=fgets(line,sizeof(line),fp) && strncmp(line,TUNE_MAGIC,strlen(TUNE_MAGIC))==0
+       && fgets(line,sizeof(line),fp) && (line[strcspn(line,"\r\n")]=0,strcmp(line,key)==0);
+    while (ok && fgets(line,sizeof(line),fp))
+    {
+        if (line[0]=='#' || line[0]=='\n')
+            continue;
+        if (n>=TUNE_LINE_MAX || sscanf(line,"%63s %31s",stage[n],var[n])!=2)
+            ok=0;
+        else
+            n++;
+    }
+    fclose(fp);
+
+    // 先检查全部实现名，程序更新后实现名可能已经不存在
+    for (i=0;ok && i<n;i++)
+    {
+        const struct img_stage_var_s *v;
+        int j;
+        for (j=0;(v=img_stage_var(stage[i],j))!=NULL && strcmp(v->name,var[i]);j++) ;
+        ok=(v!=NULL);
+    }
+    if (!ok)
+        return -1;
+    for (i=0;i<n;i++)
+    {
+        img_stage_select(stage[i],var[i]);
+        if (log)
+            fprintf(log,"img_tune: %-16s %s (cached)\n",stage[i],var[i]);
+    }
+    return 0;
+}
+
+
+// 模拟深度图：倾斜平面（0.8~3m）加噪声，约3%的空洞
+static void tune_input(float *img)
+{
+    uint32_t r=12345;
+    int x,y;
+
+    for (y=0;y<IMG_HGT;y++)
+        for (x=0;x<IMG_WID;x++)
+        {
+            r=r*1664525u+1013904223u;
+            img[y*IMG_WID+x]=(r>>24)<8 ? 0.0f : 0.8f+2.2f*x/IMG_WID+0.3f*y/IMG_HGT+((r>>8)&0xff)*4e-5f;
+        }
+}
+
+
+static int cmp_u64(const void *a, const void *b)
+{
+    uint64_t x=*(const uint64_t *)a,y=*(const uint64_t *)b;
+    return x<y ? -1 : x>y;
+}
+
+
+// 当前选择的实现测速，返回中值（ns），内存不足返回0
+static uint64_t tune_time(const char *name, struct img_pool_s *pool, struct img_par_s *par, float *img_in, float *img_out)
+{
+    struct img_chain_s chain;
+    struct img_stage_s *s;
+    uint64_t t[IMG_TUNE_RUNS],t0;
+    int i;
+
+    if (img_chain_init(&chain,name,pool,par))
+        return 0;
+    img_chain_run(&chain,img_out,img_in);
+    img_chain_run(&chain,img_out,img_in);
+    s=&chain.stg[0];
+    for (i=0;i<IMG_TUNE_RUNS;i++)
+    {
+        t0=img_time_ns();
+        s->run(s,s->img_out,img_in);
+        t[i]=img_time_ns()-t0;
+    }
+    img_chain_release(&chain);
+    qsort(t,IMG_TUNE_RUNS,sizeof(t[0]),cmp_u64);
+    return t[IMG_TUNE_RUNS/2] ? t[IMG_TUNE_RUNS/2] : 1;
+}
+
+
+int img_tune(const char *cache, struct img_par_s *par, int force, FILE *log)
+{
+    const struct img_stage_desc_s *d;
+    struct img_pool_s pool;
+    char key[512],tmp[1024];
+    float *img_in,*img_out;
+    FILE *fp=NULL;
+    int i,j;
+
+    tune_key(key,sizeof(key),par);
+    if (cache && !force && tune_load(cache,key,log)==0)
+        return 0;
+
+    // 每级最多1+4+2帧，加上输入输出
+    if (img_pool_init(&pool,sizeof(float)*IMG_SZ*10+(1u<<20),0))
+        return -1;
+    img_in =img_pool_alloc_img(&pool,1);
+    img_out=img_pool_alloc_img(&pool,1);
+    if (img_in==NULL || img_out==NULL)
+    {
+        img_pool_destroy(&pool);
+        return -1;
+    }
+    tune_input(img_in);
+
+    if (cache)
+    {
+        snprintf(tmp,sizeof(tmp),"%s.tmp",cache);
+        if ((fp=fopen(tmp,"w"))==NULL)
+            perror(tmp);
+        else
+            fprintf(fp,"%s\n%s\n",TUNE_MAGIC,key);
+    }
+
+    for (i=0;(d=img_stage_get(i))!=NULL;i++)
+    {
+        const struct img_stage_var_s *v,*best=NULL;
+        uint64_t t[TUNE_VAR_MAX],t_best=0;
+
+        if (img_stage_var(d->name,1)==NULL)
+            continue;
+        if (log)
+            fprintf(log,"img_tune: %-16s",d->name);
+        for (j=0;j<TUNE_VAR_MAX && (v=img_stage_var(d->name,j))!=NULL;j++)
+        {
+            img_stage_select(d->name,v->name);
+            t[j]=tune_time(d->name,&pool,par,img_in,img_out);
+            if (log)
+                fprintf(log," %s %.1f us",v->name,t[j]/1e3);
+            if (t[j] && (best==NULL || t[j]<t_best*(j ? TUNE_MARGIN : 1.0)))
+            {
+                best=v;
+                t_best=t[j];
+            }
+        }
+        img_stage_select(d->name,best ? best->name : NULL);
+        if (log)
+            fprintf(log," -> %s\n",best ? best->name : "default");
+        if (fp && best)
+            fprintf(fp,"%s %s %.1f\n",d->name,best->name,t_best/1e3);
+    }
+
+    if (fp)
+    {
+        if (fclose(fp) || rename(tmp,cache))
+        {
+            perror(cache);
+            remove(tmp);
+        }
+    }
+    img_pool_destroy(&pool);
+    return 1;
+}
@@ -0,0 +1,40 @@
+/**
+ * @file    img_tune.h
+ * @author  YRD
+ * @version 1.0
+ * @date    2026-10-18
+ * @brief   滤波级实现的启动测速选择
+ * @details 同一个滤波级的单帧、批处理、多线程实现（img_chain.h的img_stage_var）哪个最快取决于CPU、核数和图像尺寸，
+ *          编译时固定一种实现在一部分机器上总是慢的。启动时对每个有多个实现的滤波级，
+ *          在当前图像尺寸（IMG_WID*IMG_HGT）的模拟深度图上逐个测速（取中值），用img_stage_select选择最快的实现。
+ *          结果保存在缓存文件中，第一行为主机标识（CPU型号、核数、图像尺寸、线程数、编译器版本），
+ *          之后每行为"级名 实现名 时间(us)"；标识相同时直接读取缓存，跳过测速；标识不同（换了机器或程序）时重新测速
+*/
+
+#ifndef __IMG_TUNE_H__
+#define __IMG_TUNE_H__
+
+#include <stdio.h>
+#include "img_par.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define IMG_TUNE_RUNS       9       ///< 每个实现测速次数（另有2次预热）
+
+/**
+ * @fn              int img_tune(const char *cache, struct img_par_s *par, int force, FILE *log)
+ * @brief           选择各滤波级最快的实现，在建立滤波链之前调用
+ * @param [in]      const char *cache：缓存文件，NULL时每次都测速且不保存
+ * @param [in]      struct img_par_s *par：之后滤波链使用的线程池，多线程实现用它测速，可以为NULL
+ * @param [in]      int force：忽略缓存，重新测速
+ * @param [in]      FILE *log：输出测速结果和选择，可以为NULL
+ * @retval          int：0使用了缓存，1重新测速，-1内存不足（保持默认实现）
+ */
+int img_tune(const char *cache, struct img_par_s *par, int force, FILE *log);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -1,7 +1,584 @@
+/**
+ * @file    main.c
+ * @author  YRD
+ * @version 1.0
+ * @date    2026-10-18
+ * @brief   深度图像流滤波程序
+ * @details 读取原始深度数据文件（Kinect保存的kinect_data0格式，每帧IMG_WID*IMG_HGT个int16或float32深度值，
+ *          参见global_cfg.py中的KINECT_SIM_FNAME和io.py中的read_depth_image，文件映射到内存读取，见img_rec.h；
+ *          也可以是depth_dz压缩的.dz文件，见img_dz.h），
+ *          经过滤波链（img_chain.h）处理后，以float32格式写入输出文件，并统计帧率和各级处理时间。
+ *          读文件、滤波和写文件分别在3个线程中流水执行，线程之间用有界队列传递帧缓冲区，
+ *          帧缓冲区是引用计数帧（img_frm.h），帧池和滤波链的图像都从内存池分配，稳态运行时没有内存分配；
+ *          第一级是时间滤波器时直接引用最近的输入帧作为历史图像，不再拷贝。
+ *          各阶段的延迟直方图一直记录（img_trace.h），-T打开事件记录并在结束时导出Chrome trace，
+ *          运行中发送SIGUSR1可以打开/关闭事件记录。
+ *          -R把读入的深度平面原样录制到文件（文件名以.dz结尾时压缩），由img_sav.h的写线程异步写入，
+ *          磁盘慢时按-W丢帧或等待，不阻塞读入和滤波。
+ *          -S把滤波结果发布到共享内存(img_shm.h)，其他进程（Python的ShmReader）不拷贝直接读取，
+ *          发布在单独的线程中进行，通过信箱只取最新帧，发布慢时跳帧，不阻塞滤波。
+ *          -D给出每帧的时间预算（从读入算起），滤波链按实测时间在超时前降级（img_chain_qos），
+ *          每次降级决定写入-Q指定的文件（默认stderr）。
+ *          -A在启动时测速选择各滤波级最快的实现（img_tune.h），结果缓存在给定文件中，同一台机器再次启动时不再测速
+*/
+
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <signal.h>
+#include <pthread.h>
+#include "img_const.h"
+#include "img_pool.h"
+#include "img_par.h"
+#include "img_chain.h"
+#include "img_trace.h"
+#include "img_perf.h"
+#include "img_rec.h"
+#include "img_sav.h"
+#include "img_shm.h"
+#include "img_frm.h"
+#include "img_tune.h"
 
-int main(int argc, char *argv[])
+#define FRM_Q_MAX       (IMG_ARENA_MAX-IMG_HIST_MAX)    // 队列最大长度，帧池还要容纳历史帧和各线程正在处理的帧
+
+// 有界队列，队列满时put阻塞，队列空时get阻塞，关闭后get返回NULL
+struct frm_q_s
+{
+    struct img_frm_s *frm[FRM_Q_MAX];
+    int             head,cnt,sz;
+    int             closed;
+    pthread_mutex_t mtx;
+    pthread_cond_t  cv;
+};
+
+static void frm_q_init(struct frm_q_s *q, int sz)
+{
+    memset(q,0,sizeof(*q));
+    q->sz=sz;
+    pthread_mutex_init(&q->mtx,NULL);
+    pthread_cond_init(&q->cv,NULL);
+}
+
+static void frm_q_put(struct frm_q_s *q, struct img_frm_s *f)
+{
+    pthread_mutex_lock(&q->mtx);
+    while (q->cnt==q->sz)
+        pthread_cond_wait(&q->cv,&q->mtx);
+    q->frm[(q->head+q->cnt)%q->sz]=f;
+    q->cnt++;
+    pthread_cond_broadcast(&q->cv);
+    pthread_mutex_unlock(&q->mtx);
+}
+
+static struct img_frm_s *frm_q_get(struct frm_q_s *q)
+{
+    struct img_frm_s *f=NULL;
+    pthread_mutex_lock(&q->mtx);
+    while (q->cnt==0 && !q->closed)
+        pthread_cond_wait(&q->cv,&q->mtx);
+    if (q->cnt)
+    {
+        f=q->frm[q->head];
+        q->head=(q->head+1)%q->sz;
+        q->cnt--;
+        pthread_cond_broadcast(&q->cv);
+    }
+    pthread_mutex_unlock(&q->mtx);
+    return f;
+}
+
+static void frm_q_close(struct frm_q_s *q)
+{
+    pthread_mutex_lock(&q->mtx);
+    q->closed=1;
+    pthread_cond_broadcast(&q->cv);
+    pthread_mutex_unlock(&q->mtx);
+}
+
+
+// 运行参数
+struct cfg_s
 {
-    printf("Hello World!\n");
+    const char *fin;                // 输入文件
+    const char *fout;               // 输出文件，NULL时不输出
+    const char *chain;              // 滤波链配置
+    int         f32;                // 输入数据为float32（NEW_TOF），否则为int16（KINECT）
+    float       scale;              // 深度值缩放系数，默认把mm转换为m
+    long        skip;               // 每帧深度数据后跳过的字节数（例如红外图）
+    const char *layout;             // 帧格式（img_rec.h），NULL时由f32和skip决定
+    const char *plane;              // 滤波的数据平面名
+    long        first;              // 开始帧号
+    double      fps;                // 按给定帧率读入（模拟传感器），0表示尽快读入
+    long        n_max;              // 最多处理帧数，0表示不限
+    int         loop;               // 文件结束后从头重新读
+    int         n_thr;              // 滤波线程池线程数
+    int         q_len;              // 队列长度
+    int         verbose;
+    const char *trace;              // Chrome trace输出文件
+    const char *summary;            // 延迟统计JSON输出文件
+    int         perf;               // 统计硬件性能计数
+    const char *sav;                // 录制文件，NULL时不录制
+    int         sav_wait;           // 录制队列满时的等待时间（ms），0丢弃，<0一直等待
+    const char *shm;                // 共享内存名，NULL时不发布
+    double      budget;             // 每帧时间预算（ms），0表示不降级
+    const char *qos_log;            // 降级日志文件，NULL时输出到stderr
+    const char *tune;               // 实现选择缓存文件，NULL时使用默认实现
+};
+
+// 流水线
+struct pipe_s
+{
+    struct cfg_s     cfg;
+    struct img_rec_s rec;           // 输入文件
+    struct img_sav_s sav;           // 录制
+    int              sav_on;
+    struct img_shm_s shm;           // 共享内存发布
+    int              shm_on;
+    struct img_mbox_s mb_shm;       // 共享内存发布线程的信箱
+    struct img_bcast_s bc;          // 滤波结果的广播，-o以外的使用者都从这里取最新帧
+    int              plane;         // 滤波的数据平面
+    long             idx;           // 下一帧帧号
+    FILE            *fp_out;
+    struct img_chain_s chain;
+    struct img_arena_s arena_in,arena_out;  // 输入、输出帧池
+    struct frm_q_s   q_in,q_out;
+
+    uint64_t         n_rd,n_wr;
+    uint64_t         t_rd,t_wr;     // 读、写累计时间（ns）
+    uint64_t         lat_sum,lat_max;
+    int              id_rd,id_wr,id_lat;    // 跟踪编号
+    volatile int     quit;          // 出错停止：读线程不再读入新帧，滤波循环退出
+};
+
+
+static void usage(const char *prog)
+{
+    fprintf(stderr,
+        "usage: %s [options] input\n"
+        "  -o file     write filtered float32 frames to file\n"
+        "  -c chain    filter chain, default \"mid3_t,plane_mf_sqr3\"\n"
+        "  -t i16|f32  input depth type (KINECT int16 / NEW_TOF float32)\n"
+        "  -s scale    depth scale, default 0.001 (mm -> m)\n"
+        "  -k bytes    bytes to skip after each depth frame\n"
+        "  -l layout   frame layout, e.g. \"dep:u16,ir:i16\" (overrides -t/-k)\n"
+        "  -p plane    plane of the layout to filter, default dep\n"
+        "  -b frame    start at the given frame\n"
+        "  -r fps      read at the given frame rate (simulate sensor)\n"
+        "  -n frames   stop after the given number of frames\n"
+        "  -L          loop the input file\n"
+        "  -j threads  threads for the spatial filters, default 1\n"
+        "  -q length   queue length, default 4\n"
+        "  -v          print statistics every second\n"
+        "  -T file     record events and write a Chrome trace (SIGUSR1 toggles)\n"
+        "  -J file     write per-stage latency percentiles as JSON\n"
+        "  -P          read hardware performance counters per stage\n"
+        "  -R file     record the input depth plane (compressed if file ends with .dz)\n"
+        "  -W ms       wait up to ms for a free record buffer, 0 drops (default), -1 blocks\n"
+        "  -S name     publish filtered frames to shared memory /dev/shm/name\n"
+        "  -D ms       per-frame deadline from frame arrival (sensor time with -r,\n"
+        "              else read start), degrade stages to meet it (16.6 for 60 fps)\n"
+        "  -Q file     log degradation decisions to file, default stderr\n"
+        "  -A file     benchmark stage implementations at startup, cache the choice in file\n"
+        "frame size %dx%d, stages:\n",prog,IMG_WID,IMG_HGT);
+    img_chain_list(stderr);
+}
+
+
+// 取一帧数据并转换为float，返回0成功
+static int read_frame(struct pipe_s *p, float *img)
+{
+    const void *src;
+
+    if (p->idx>=p->rec.n_frm)
+    {
+        if (!p->cfg.loop)
+            return -1;
+        p->idx=0;
+    }
+    src=img_rec_frame(&p->rec,p->idx++,p->plane);
+    if (p->sav_on)
+        img_sav_frame(&p->sav,src);
+    img_rec_to_f32(img,src,p->rec.plane[p->plane].type,IMG_SZ,p->cfg.scale);
     return 0;
 }
+
+
+static void *reader_thread(void *arg)
+{
+    struct pipe_s *p=(struct pipe_s *)arg;
+    uint64_t t_start=img_time_ns(),t0,t1,t_arr;
+    struct img_frm_s *f;
+
+    img_trace_thread_name("read");
+    while ((p->cfg.n_max==0 || (long)p->n_rd<p->cfg.n_max) && !p->quit)
+    {
+        // 帧的到达时刻：按帧率读入时为传感器给出这一帧的时刻（读线程落后时也从这里算起），
+        // 否则为开始取这一帧的时刻；等待空闲帧、读入和排队的时间都计入延迟和截止时间
+        if (p->cfg.fps>0)
+        {
+            // 按帧率等待下一帧的时刻
+            t_arr=t_start+(uint64_t)(p->n_rd*1e9/p->cfg.fps);
+            t0=img_time_ns();
+            if (t_arr>t0)
+                usleep((useconds_t)((t_arr-t0)/1000));
+        }
+        else
+            t_arr=img_time_ns();
+
+        if ((f=img_frm_alloc(&p->arena_in,1))==NULL)
+        {
+            // 停止时帧池被关闭，不是错误
+            if (!p->quit)
+            {
+                fprintf(stderr,"reader: no free input frame\n");
+                p->quit=1;
+            }
+            break;
+        }
+        t0=img_time_ns();
+        if (read_frame(p,f->img))
+        {
+            img_frm_release(f);
+            break;
+        }
+        t1=img_time_ns();
+        f->t_in=t_arr;
+        f->seq=p->n_rd++;
+        p->t_rd+=t1-t0;
+        img_trace_rec(p->id_rd,t0,t1,(uint32_t)f->seq);
+        frm_q_put(&p->q_in,f);
+    }
+    frm_q_close(&p->q_in);
+    return NULL;
+}
+
+
+static void *writer_thread(void *arg)
+{
+    struct pipe_s *p=(struct pipe_s *)arg;
+    struct img_frm_s *f;
+    uint64_t t0,t1,lat;
+
+    img_trace_thread_name("write");
+    while ((f=frm_q_get(&p->q_out))!=NULL)
+    {
+        t0=img_time_ns();
+        if (p->fp_out)
+            fwrite(f->img,sizeof(float),IMG_SZ,p->fp_out);
+        t1=img_time_ns();
+        p->t_wr+=t1-t0;
+        img_trace_rec(p->id_wr,t0,t1,(uint32_t)f->seq);
+        img_trace_rec(p->id_lat,f->t_in,t1,(uint32_t)f->seq);
+
+        lat=t1-f->t_in;
+        p->lat_sum+=lat;
+        if (lat>p->lat_max) p->lat_max=lat;
+        p->n_wr++;
+        img_frm_release(f);
+    }
+    return NULL;
+}
+
+
+static void *shm_thread(void *arg)
+{
+    struct pipe_s *p=(struct pipe_s *)arg;
+    struct img_frm_s *f;
+
+    img_trace_thread_name("shm");
+    while ((f=img_mbox_get(&p->mb_shm,1))!=NULL)
+    {
+        img_shm_publish(&p->shm,f->img,f->t_in);
+        img_frm_release(f);
+    }
+    return NULL;
+}
+
+
+// SIGUSR1：打开/关闭事件记录
+static void trace_toggle(int sig)
+{
+    (void)sig;
+    img_trace_enable(img_trace_flags^IMG_TRACE_EV);
+}
+
+
+static void report(struct pipe_s *p, double t, FILE *fp)
+{
+    uint64_t n=p->n_wr;
+    fprintf(fp,"frames %llu, %.2f s, %.1f fps, read %.1f us, write %.1f us, latency avg %.1f us max %.1f us\n",
+            (unsigned long long)n,t,t>0 ? n/t : 0.0,
+            p->n_rd ? p->t_rd/1e3/p->n_rd : 0.0,n ? p->t_wr/1e3/n : 0.0,
+            n ? p->lat_sum/1e3/n : 0.0,p->lat_max/1e3);
+}
+
+
+int main(int argc, char *argv[])
+{
+    static struct pipe_s pipe;
+    struct pipe_s *p=&pipe;
+    struct img_pool_s pool;
+    struct img_perf_s perf;
+    struct img_par_s *par=NULL;
+    pthread_t thr_rd,thr_wr,thr_shm;
+    struct img_frm_s *fi,*fo;
+    FILE *fp_qos=NULL;
+    uint64_t t_start,t_rep;
+    int opt,n_hist,rd_on,wr_on,shm_run=0;
+
+    p->cfg.chain="mid3_t,plane_mf_sqr3";
+    p->cfg.f32=(IMG_WID==320);          // NEW_TOF尺寸时默认float32
+    p->cfg.scale=0.001f;
+    p->cfg.plane="dep";
+    p->cfg.n_thr=1;
+    p->cfg.q_len=4;
+
+    while ((opt=getopt(argc,argv,"o:c:t:s:k:l:p:b:r:n:Lj:q:vT:J:PR:W:S:D:Q:A:h"))!=-1)
+    {
+        switch (opt)
+        {
+        case 'o': p->cfg.fout =optarg; break;
+        case 'c': p->cfg.chain=optarg; break;
+        case 't': p->cfg.f32  =(strcmp(optarg,"f32")==0); break;
+        case 's': p->cfg.scale=strtof(optarg,NULL); break;
+        case 'k': p->cfg.skip =atol(optarg); break;
+        case 'l': p->cfg.layout=optarg; break;
+        case 'p': p->cfg.plane=optarg; break;
+        case 'b': p->cfg.first=atol(optarg); break;
+        case 'r': p->cfg.fps  =atof(optarg); break;
+        case 'n': p->cfg.n_max=atol(optarg); break;
+        case 'L': p->cfg.loop =1; break;
+        case 'j': p->cfg.n_thr=atoi(optarg); break;
+        case 'q': p->cfg.q_len=atoi(optarg); break;
+        case 'v': p->cfg.verbose=1; break;
+        case 'T': p->cfg.trace  =optarg; break;
+        case 'J': p->cfg.summary=optarg; break;
+        case 'P': p->cfg.perf   =1; break;
+        case 'R': p->cfg.sav    =optarg; break;
+        case 'W': p->cfg.sav_wait=atoi(optarg); break;
+        case 'S': p->cfg.shm    =optarg; break;
+        case 'D': p->cfg.budget =atof(optarg); break;
+        case 'Q': p->cfg.qos_log=optarg; break;
+        case 'A': p->cfg.tune   =optarg; break;
+        default : usage(argv[0]); return 1;
+        }
+    }
+    if (optind>=argc)
+    {
+        usage(argv[0]);
+        return 1;
+    }
+    p->cfg.fin=argv[optind];
+    if (p->cfg.q_len<1) p->cfg.q_len=1;
+    if (p->cfg.q_len>FRM_Q_MAX) p->cfg.q_len=FRM_Q_MAX;
+
+    if (p->cfg.layout==NULL)
+    {
+        static char layout[64];
+        sprintf(layout,p->cfg.f32 ? "dep:f32" : "dep:i16");
+        if (p->cfg.skip)
+            sprintf(layout+strlen(layout),",pad:u8:%ld",p->cfg.skip);
+        p->cfg.layout=layout;
+    }
+    if (img_rec_open(&p->rec,p->cfg.fin,p->cfg.layout))
+        return 1;
+    p->plane=img_rec_plane(&p->rec,p->cfg.plane);
+    if (p->plane<0 || p->rec.plane[p->plane].cnt<IMG_SZ || p->rec.plane[p->plane].type==IMG_REC_U8)
+    {
+        fprintf(stderr,"%s: no %dx%d depth plane '%s' in layout '%s'\n",
+                p->cfg.fin,IMG_WID,IMG_HGT,p->cfg.plane,p->cfg.layout);
+        return 1;
+    }
+    p->idx=p->cfg.first;
+    if (p->idx<0 || p->idx>=p->rec.n_frm)
+    {
+        fprintf(stderr,"%s: start frame %ld out of range, %ld frames\n",p->cfg.fin,p->idx,p->rec.n_frm);
+        return 1;
+    }
+    if (p->cfg.fout)
+    {
+        p->fp_out=fopen(p->cfg.fout,"wb");
+        if (p->fp_out==NULL)
+        {
+            perror(p->cfg.fout);
+            return 1;
+        }
+    }
+
+    if (p->cfg.sav)
+    {
+        size_t n=strlen(p->cfg.sav);
+        int dz=(n>3 && strcmp(p->cfg.sav+n-3,".dz")==0);
+        if (dz && p->rec.plane[p->plane].sz!=sizeof(uint16_t)*IMG_SZ)
+        {
+            fprintf(stderr,"%s: only int16/uint16 depth can be compressed\n",p->cfg.sav);
+            return 1;
+        }
+        if (img_sav_open(&p->sav,p->cfg.sav,p->rec.plane[p->plane].sz,IMG_SAV_BUF_DEF,
+                         dz ? IMG_SAV_DZ : IMG_SAV_RAW,p->cfg.sav_wait))
+            return 1;
+        p->sav_on=1;
+    }
+
+    if (p->cfg.shm)
+    {
+        if (img_shm_create(&p->shm,p->cfg.shm,sizeof(float)*IMG_SZ,IMG_SHM_SLOT_DEF))
+            return 1;
+        p->shm_on=1;
+    }
+
+    // 内存池：输入输出帧池（各为队列长度加上历史帧和正在处理的帧）和滤波链（每级最多1+4+2帧）
+    if (img_pool_init(&pool,sizeof(float)*IMG_SZ*(2*p->cfg.q_len+IMG_HIST_MAX+8+7*IMG_CHAIN_MAX)+(1u<<20),
+                      IMG_POOL_HUGE|IMG_POOL_PREFAULT|IMG_POOL_LOCK))
+    {
+        fprintf(stderr,"cannot allocate frame pool\n");
+        return 1;
+    }
+    if (p->cfg.n_thr>1)
+        par=img_par_create(p->cfg.n_thr);
+    if (p->cfg.tune)
+        img_tune(p->cfg.tune,par,0,p->cfg.verbose ? stderr : NULL);
+    if (img_chain_init(&p->chain,p->cfg.chain,&pool,par))
+        return 1;
+    n_hist=img_chain_share_hist(&p->chain);
+    if (n_hist<0)
+        n_hist=0;
+    if (p->cfg.budget>0)
+    {
+        fp_qos=p->cfg.qos_log ? fopen(p->cfg.qos_log,"w") : stderr;
+        if (fp_qos==NULL)
+        {
+            perror(p->cfg.qos_log);
+            return 1;
+        }
+        img_chain_qos(&p->chain,(uint64_t)(p->cfg.budget*1e6),fp_qos);
+    }
+    memset(&perf,0,sizeof(perf));
+    if (p->cfg.perf)
+    {
+        // 滤波在主线程中进行，计数器也在主线程中打开
+        if (img_perf_open(&perf)==0)
+            p->chain.perf=&perf;
+        else
+            fprintf(stderr,"hardware performance counters not available\n");
+    }
+
+    // 输入帧：队列中的帧、读线程、滤波线程、信箱或录制各1帧、滤波链历史引用的帧
+    // 输出帧：队列中的帧、滤波线程和写线程各1帧、信箱和发布线程各1帧
+    frm_q_init(&p->q_in ,p->cfg.q_len);
+    frm_q_init(&p->q_out,p->cfg.q_len);
+    if (img_arena_init(&p->arena_in ,&pool,p->cfg.q_len+3+n_hist)
+        || img_arena_init(&p->arena_out,&pool,p->cfg.q_len+4))
+    {
+        fprintf(stderr,"frame pool too small\n");
+        return 1;
+    }
+    if (p->shm_on)
+    {
+        img_mbox_init(&p->mb_shm);
+        img_bcast_sub(&p->bc,&p->mb_shm);
+    }
+
+    img_trace_init(0,IMG_TRACE_HIST|(p->cfg.trace ? IMG_TRACE_EV : 0));
+    img_trace_thread_name("filter");
+    p->id_rd =img_trace_id("read");
+    p->id_wr =img_trace_id("write");
+    p->id_lat=img_trace_id("latency");
+    signal(SIGUSR1,trace_toggle);
+
+    t_start=t_rep=img_time_ns();
+    rd_on=(pthread_create(&thr_rd,NULL,reader_thread,p)==0);
+    wr_on=(pthread_create(&thr_wr,NULL,writer_thread,p)==0);
+    if (p->shm_on)
+        shm_run=(pthread_create(&thr_shm,NULL,shm_thread,p)==0);
+    if (!rd_on || !wr_on || shm_run!=p->shm_on)
+    {
+        fprintf(stderr,"cannot create threads\n");
+        p->quit=1;
+    }
+    if (!rd_on)
+        frm_q_close(&p->q_in);                              // 没有读线程，没有帧会放入
+
+    // 滤波在主线程中进行
+    while (!p->quit && (fi=frm_q_get(&p->q_in))!=NULL)
+    {
+        if ((fo=img_frm_alloc(&p->arena_out,1))==NULL)
+        {
+            fprintf(stderr,"filter: no free output frame\n");
+            img_frm_release(fi);
+            p->quit=1;
+            break;
+        }
+        img_chain_run_frm(&p->chain,fo->img,fi);
+        fo->seq =fi->seq;
+        fo->t_in=fi->t_in;
+        img_frm_release(fi);
+        img_bcast_pub(&p->bc,fo);                           // 其他使用者各自增加引用
+        frm_q_put(&p->q_out,fo);                            // 本线程的引用交给写线程
+
+        if (p->cfg.verbose && img_time_ns()-t_rep>1000000000u)
+        {
+            t_rep=img_time_ns();
+            report(p,(t_rep-t_start)/1e9,stderr);
+        }
+    }
+    if (p->quit)
+    {
+        // 唤醒等待空闲帧的读线程，取走队列中剩下的帧，直到读线程关闭队列
+        img_arena_close(&p->arena_in);
+        while ((fi=frm_q_get(&p->q_in))!=NULL)
+            img_frm_release(fi);
+    }
+    frm_q_close(&p->q_out);
+    if (rd_on)
+        pthread_join(thr_rd,NULL);
+    if (wr_on)
+        pthread_join(thr_wr,NULL);
+    if (p->shm_on)
+    {
+        img_mbox_close(&p->mb_shm);
+        if (shm_run)
+            pthread_join(thr_shm,NULL);
+        fprintf(stderr,"shm: %llu frames published, %llu skipped\n",
+                (unsigned long long)(p->mb_shm.n_put-p->mb_shm.n_drop),(unsigned long long)p->mb_shm.n_drop);
+    }
+
+    report(p,(img_time_ns()-t_start)/1e9,stderr);
+    if (p->sav_on)
+    {
+        img_sav_close(&p->sav);
+        img_sav_report(&p->sav,stderr);
+    }
+    img_trace_summary(stderr,0);
+    if (p->chain.perf || p->chain.qos_budget)
+        img_chain_report(&p->chain,stderr);
+    if (p->cfg.summary)
+    {
+        FILE *fp=fopen(p->cfg.summary,"w");
+        if (fp)
+        {
+            img_trace_summary(fp,1);
+            fclose(fp);
+        }
+        else
+            perror(p->cfg.summary);
+    }
+    if (p->cfg.trace)
+        img_trace_write_chrome(p->cfg.trace);
+
+    img_rec_close(&p->rec);
+    if (p->shm_on)
+        img_shm_close(&p->shm);
+    if (p->fp_out)
+        fclose(p->fp_out);
+    if (fp_qos && fp_qos!=stderr)
+        fclose(fp_qos);
+    img_chain_release(&p->chain);
+    img_arena_destroy(&p->arena_in);
+    img_arena_destroy(&p->arena_out);
+    img_perf_close(&perf);
+    img_par_destroy(par);
+    img_pool_destroy(&pool);
+    return p->quit ? 1 : 0;
+}
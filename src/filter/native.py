@@ -0,0 +1,482 @@
+import os
+import sys
+import numpy as np
+from ..global_cfg import *
+
+
+def _load_native():
+    """ import the _img_filter extension built by src/filter/c/filter/CMakeLists.txt,
+        looked up on sys.path, $IMG_FILTER_PATH and the usual build directories next to the sources """
+    try:
+        import _img_filter
+        return _img_filter
+    except ImportError:
+        pass
+    src=os.path.join(os.path.dirname(os.path.abspath(__file__)),'c','filter')
+    for d in (os.environ.get('IMG_FILTER_PATH'),os.path.join(src,'build'),src):
+        if d and os.path.isdir(d) and d not in sys.path:
+            sys.path.insert(0,d)
+            try:
+                import _img_filter
+                return _img_filter
+            except ImportError:
+                sys.path.remove(d)
+    raise ImportError('_img_filter not found, build the _img_filter target in src/filter/c/filter')
+
+
+_native=_load_native()
+if (_native.WID,_native.HGT)!=(IMG_WID,IMG_HGT):
+    raise ImportError('_img_filter built for %dx%d, TOF_TYPE needs %dx%d, rebuild with -DTOF_TYPE=%s'
+                      %(_native.WID,_native.HGT,IMG_WID,IMG_HGT,TOF_TYPE))
+
+
+class native_filter:
+    """ native filter chain (img_chain.h) for one depth stream, frames are passed without copying
+        spec: stages separated by ',', e.g. 'mid3_t,plane_mf_sqr3', see native_stages()
+        the GIL is released while filtering, one native_filter per stream/thread """
+    def __init__(self,spec='mid3_t,plane_mf_sqr3',threads=1,scale=0.001,tune_cache=None):
+        """ tune_cache: file caching the fastest implementation of each stage on this host (see native_tune) """
+        if tune_cache is not None:
+            native_tune(tune_cache,threads)
+        self.chain=_native.Chain(spec,threads)
+        self.scale=scale
+        self.img_f32=np.empty((IMG_HGT,IMG_WID),np.float32)
+
+    def __call__(self,dep,out=None):
+        """ filter one depth frame (int16/uint16 in mm, or float32 in m), returns float32 (IMG_HGT,IMG_WID) in m """
+        dep=np.ascontiguousarray(dep)
+        if dep.dtype!=np.float32:
+            dep=_native.to_f32(dep,self.img_f32,self.scale)
+        if out is None:
+            out=np.empty((IMG_HGT,IMG_WID),np.float32)
+        self.chain.run(dep,out)
+        return out
+
+    def stats(self):
+        """ frames and average/maximum time (us) of the chain and of each stage """
+        return self.chain.stats()
+
+
+class native_deproj:
+    """ depth deprojection with a per-pixel ray table built once per intrinsics (img_deproj.h), replaces
+        CameraIntrinsics.deproject: each frame costs two multiplies per pixel, output is x/y/z planes (SoA)
+        K: 3x3 intrinsics in pixels of a K_width wide image (default K_ir, scaled to IMG_WID)
+        dist: (k1, k2, p1, p2, k3) distortion, None for a pinhole camera """
+    def __init__(self,K=K_ir,dist=None,K_width=512,threads=1):
+        K=np.asarray(K,np.float64)*(IMG_WID/float(K_width))
+        self.dp=_native.Deproj(K[0,0],K[1,1],K[0,2],K[1,2],K[0,1],dist,threads)
+        self.pts=np.empty((3,IMG_SZ),np.float32)
+        self.idx=np.empty(IMG_SZ,np.int32)
+
+    def __call__(self,dep,out=None,scale=0.001):
+        """ deproject one depth frame (float32 in m straight from native_filter, or uint16/int16 times scale)
+            returns float32 (3,IMG_HGT,IMG_WID) x/y/z in m, zero (or negative int16) depth gives (0,0,0) """
+        dep=np.ascontiguousarray(dep)
+        if out is None:
+            out=np.empty((3,IMG_HGT,IMG_WID),np.float32)
+        self.dp.run(dep,out,scale)
+        return out
+
+    def crop(self,dep,dmin=dmin,dmax=dmax,T=T,scale=0.001):
+        """ deproject, drop points outside dmin~dmax and zero points, and apply the 4x4 transform T in one native pass
+            (instead of deproject + range filter + remove_zero_points + transform, each a full numpy pass)
+            returns (xyz, idx): float32 (3,n) kept points in pixel order and int32 (n,) pixel indices (v*IMG_WID+u),
+            both are views into buffers reused by the next call, copy them to keep """
+        dep=np.ascontiguousarray(dep)
+        if T is not None:
+            T=np.ascontiguousarray(T,np.float32)
+        n=self.dp.crop(dep,self.pts,self.idx,dmin,dmax,T,scale)
+        return self.pts[:,:n],self.idx[:n]
+
+    def plane_mf(self,dep,out=None):
+        """ 3x3 plane matched filter (same depth as the plane_mf_sqr3 stage) that keeps the slope of the winning plane,
+            so a normal map and a confidence come for free: returns float32 (5,IMG_HGT,IMG_WID) = filtered depth,
+            nx, ny, nz (unit normal facing the camera) and the fit mean squared residual (m^2), 1-pixel border is 0 """
+        if out is None:
+            out=np.empty((5,IMG_HGT,IMG_WID),np.float32)
+        self.dp.plane_mf(np.ascontiguousarray(dep,np.float32),out)
+        return out
+
+
+class native_normals:
+    """ normals of organized clouds (native_deproj output) from image-space neighbours (img_normal.h), no KD-tree
+        mode 'cross': cross product of the horizontal and vertical differences at distance r (default 1)
+        mode 'cov': smallest eigenvector of the covariance in a (2r+1)^2 window (default r=3) via integral images,
+                    also gives the curvature; neighbours across depth jumps over max_dz*z are not used """
+    def __init__(self,mode='cross',r=0,max_dz=0.05,threads=1):
+        self.ne=_native.Normals(mode,r,max_dz,threads)
+
+    def __call__(self,xyz,out=None,curv=None):
+        """ xyz: float32 (3,IMG_HGT,IMG_WID), returns float32 (3,IMG_HGT,IMG_WID) unit normals facing the camera,
+            (0,0,0) where invalid; curv: optional float32 (IMG_HGT,IMG_WID) filled with the curvature ('cov' mode) """
+        if out is None:
+            out=np.empty((3,IMG_HGT,IMG_WID),np.float32)
+        self.ne.run(np.ascontiguousarray(xyz,np.float32),out,curv)
+        return out
+
+
+class native_projector:
+    """ parallel z-buffer projection of point clouds to depth images (img_proj.h), replaces
+        CameraIntrinsics.project_to_image: the nearest point wins every pixel (ties go to the lower index)
+        instead of whichever numpy wrote last; used to re-project fused clouds and render virtual views
+        K: 3x3 intrinsics in pixels of a K_width wide image (default K_ir, scaled to IMG_WID)
+        dist: (k1, k2, p1, p2, k3) distortion of the target camera, None for a pinhole camera """
+    def __init__(self,K=K_ir,dist=None,K_width=512,threads=1):
+        K=np.asarray(K,np.float64)*(IMG_WID/float(K_width))
+        self.pj=_native.Proj(K[0,0],K[1,1],K[0,2],K[1,2],K[0,1],dist,threads)
+        self.idx=np.empty((IMG_HGT,IMG_WID),np.int32)
+        self.rgb=np.empty((IMG_HGT,IMG_WID,3),np.uint8)
+
+    def __call__(self,pts,rgb=None,T=None,r=0,index=False,out=None):
+        """ pts: (3,n) points in m (PointCloud.data layout), transformed by the 4x4 T into the camera first
+            rgb: optional uint8 (n,3) point colors; r: splat radius in pixels (0 = one pixel per point)
+            returns float32 (IMG_HGT,IMG_WID) depth (0 where no point), followed by the uint8 (IMG_HGT,IMG_WID,3)
+            color image when rgb is given and the int32 (IMG_HGT,IMG_WID) point index (-1 where empty) when index
+            is True; color and index images are reused by the next call, copy them to keep """
+        pts=np.ascontiguousarray(pts,np.float32)
+        if out is None:
+            out=np.empty((IMG_HGT,IMG_WID),np.float32)
+        if T is not None:
+            T=np.ascontiguousarray(T,np.float32)
+        if rgb is not None:
+            rgb=np.ascontiguousarray(rgb,np.uint8)
+        self.pj.run(pts,out,self.idx if index else None,rgb,None if rgb is None else self.rgb,T,r)
+        ret=(out,)
+        if rgb is not None:
+            ret+=(self.rgb,)
+        if index:
+            ret+=(self.idx,)
+        return ret if len(ret)>1 else out
+
+
+class native_registration:
+    """ depth to color registration with cached mapping tables (img_reg.h), replaces the generic per-frame
+        alignment: depth rays and their rotation into the color camera are tabulated once, each frame only adds
+        the depth-dependent parallax (skipped entirely when t is 0), occlusion is resolved with a z-buffer
+        K_d/K_c: 3x3 depth/color intrinsics, K_d in pixels of a K_width wide image (scaled to IMG_WID)
+        R, t: depth camera to color camera, t in mm like T_temp; dist_d/dist_c: (k1, k2, p1, p2, k3) or None """
+    def __init__(self,K_d=K_ir,K_c=K_rgb,R=R_ir2rgb,t=T_temp,color_size=(640,480),dist_d=None,dist_c=None,
+                 K_width=512,threads=1):
+        K_d=np.asarray(K_d,np.float64)*(IMG_WID/float(K_width))
+        K_c=np.asarray(K_c,np.float64)
+        cam=lambda K,dist: (K[0,0],K[1,1],K[0,2],K[1,2],K[0,1])+tuple(dist if dist is not None else (0,)*5)
+        self.cw,self.ch=color_size
+        self.reg=_native.Reg(cam(K_d,dist_d),cam(K_c,dist_c),self.cw,self.ch,
+                             np.asarray(R,np.float64).ravel().tolist(),(np.asarray(t,np.float64).ravel()*0.001).tolist(),threads)
+        self.idx=np.empty((IMG_HGT,IMG_WID),np.int32)
+        self.dep_c=np.empty((self.ch,self.cw),np.float32)
+
+    def __call__(self,dep,rgb,out=None,tol=0.02):
+        """ dep: depth frame (float32 in m, or uint16/int16 in mm), rgb: uint8 (ch,cw,3) color frame
+            returns uint8 (IMG_HGT,IMG_WID,3) color registered to the depth frame, 0 where invalid or occluded;
+            the depth pixel -> color pixel index map (-1 where invalid or occluded) is left in self.idx """
+        if out is None:
+            out=np.empty((IMG_HGT,IMG_WID,3),np.uint8)
+        self.reg.run(self._f32(dep),np.ascontiguousarray(rgb,np.uint8),out,self.idx,None,tol)
+        return out
+
+    def depth_to_color(self,dep,out=None):
+        """ depth frame registered to the color frame: float32 (ch,cw), z in the color camera (m), nearest point wins,
+            0 where no depth pixel lands """
+        if out is None:
+            out=self.dep_c
+        self.reg.run(self._f32(dep),None,None,None,out)
+        return out
+
+    @staticmethod
+    def _f32(dep):
+        dep=np.ascontiguousarray(dep)
+        return dep if dep.dtype==np.float32 else _native.to_f32(dep)
+
+
+class native_cloud:
+    """ structure-of-arrays point cloud (img_pc.h) shared by the native geometry code, replaces the 3xN
+        BagOfPoints/PointCloud arrays of src/ref/points.py whose arithmetic allocates a new array per operation:
+        coordinates, normals, colors and named scalar fields live in aligned native columns, transform/subset/concat
+        work in place and xyz/normals/rgb/field() are numpy views without copies
+        views reflect the points at the time they are taken, take them again after subset/concat/resize;
+        the capacity cannot grow while views are alive, reserve() it first when concatenating """
+    def __init__(self,pts=None,normals=None,rgb=None,fields=None,n=0):
+        """ pts: (3,n) points in m (PointCloud.data layout), normals: (3,n), rgb: uint8 (n,3), fields: {name: (n,)} """
+        if pts is not None:
+            n=np.shape(pts)[1]
+        fields=fields or {}
+        self.pc=_native.Cloud(n,normals is not None,rgb is not None,tuple(fields))
+        if pts is not None:
+            self.xyz[...]=pts
+        if normals is not None:
+            self.normals[...]=normals
+        if rgb is not None:
+            self.rgb[...]=rgb
+        for k,v in fields.items():
+            self.field(k)[...]=v
+
+    def __len__(self):
+        return len(self.pc)
+
+    @property
+    def xyz(self):
+        """ float32 (3,n) view of the coordinates (rows are strided by the capacity) """
+        return np.asarray(self.pc.xyz)
+
+    data=xyz
+
+    @property
+    def normals(self):
+        """ float32 (3,n) view of the normals, None without normals """
+        v=self.pc.normals
+        return None if v is None else np.asarray(v)
+
+    @property
+    def rgb(self):
+        """ uint8 (n,3) view of the colors, None without colors """
+        v=self.pc.rgb
+        return None if v is None else np.asarray(v)
+
+    @property
+    def fields(self):
+        return self.pc.fields
+
+    def field(self,name,add=False):
+        """ float32 (n,) view of a scalar field, add=True creates it (zero) when missing """
+        return np.asarray(self.pc.add_field(name) if add else self.pc.field(name))
+
+    def add_cols(self,normals=False,rgb=False):
+        self.pc.add_cols(normals,rgb)
+        return self
+
+    def reserve(self,cap):
+        self.pc.reserve(cap)
+        return self
+
+    def transform(self,T):
+        """ p=R*p+t and n=R*n in place with the 4x4 rigid transform T """
+        self.pc.transform(np.ascontiguousarray(T,np.float32))
+        return self
+
+    def subset(self,sel):
+        """ keep the points selected by a bool mask (n,) or by indices, in place (replaces remove_zero_points,
+            box_mask and subsample) """
+        sel=np.asarray(sel)
+        sel=sel.view(np.uint8) if sel.dtype==np.bool_ else np.ascontiguousarray(sel,np.int32)
+        self.pc.subset(np.ascontiguousarray(sel))
+        return self
+
+    def concat(self,other):
+        """ append the points of another native_cloud in place, columns it lacks are zero """
+        self.pc.concat(other.pc)
+        return self
+
+    __iadd__=concat
+
+
+class native_rigid:
+    """ batched rigid transforms (img_rigid.h), replaces the per-call numpy matrix math of RigidTransform.apply/dot/inverse
+        (src/ref/rigid_transformations.py) and transformations.quaternion_matrix/quaternion_from_matrix:
+        clouds are transformed in place (threaded from 2^20 points), poses are float32 (m,4,4) matrices or
+        (m,7) (qw, qx, qy, qz, tx, ty, tz) in RigidTransform.quaternion order, converted/composed/inverted in one call """
+    def __init__(self,threads=1):
+        self.rt=_native.Rigid(threads)
+
+    def apply(self,pts,T=T,normals=None):
+        """ pts: native_cloud (points and its normals) or float32 C-contiguous (3,n) array, transformed in place
+            T: 4x4 matrix (default the global T) or 7 element quaternion + translation; normals: (3,n) rotated in place """
+        T=np.ascontiguousarray(T,np.float32)
+        self.rt.apply(pts.pc if isinstance(pts,native_cloud) else pts,T,normals)
+        return pts
+
+    def compose(self,A,B,out=None):
+        """ A[i] @ B[i] (apply B first) for (m,4,4) poses, either side may be a single 4x4 pose """
+        return np.asarray(self.rt.compose(np.ascontiguousarray(A,np.float32),np.ascontiguousarray(B,np.float32),out))
+
+    def inverse(self,T,out=None):
+        return np.asarray(self.rt.inverse(np.ascontiguousarray(T,np.float32),out))
+
+    def from_qt(self,qt,out=None):
+        """ (m,7) quaternion + translation to (m,4,4) matrices """
+        return np.asarray(self.rt.from_qt(np.ascontiguousarray(qt,np.float32),out))
+
+    def to_qt(self,T,out=None):
+        """ (m,4,4) matrices to (m,7) quaternion + translation, qw >= 0 """
+        return np.asarray(self.rt.to_qt(np.ascontiguousarray(T,np.float32),out))
+
+
+class native_kdtree:
+    """ multithreaded KD-tree (img_kdt.h), drop-in for the scipy cKDTree of src/ref/structures/kdtree.py in the
+        k_neighbors/r_neighbors/outlier filter call patterns: bulk queries run natively across threads and write into
+        preallocated arrays, the tree copies the points so the source may change after building """
+    K_MAX=1024                      # IMG_KDT_K_MAX, neighbours per query point
+
+    def __init__(self,pts,leafsize=16,threads=1):
+        """ pts: native_cloud, (n,3) points (cKDTree layout) or (3,n) (PointCloud.data layout) """
+        self.kt=_native.KDTree(threads)
+        self.data=None
+        self.build(pts,leafsize)
+
+    @staticmethod
+    def _xyz(pts):
+        if isinstance(pts,native_cloud):
+            return pts.pc
+        pts=np.asarray(pts,np.float32)
+        if pts.ndim==1:
+            pts=pts[None,:]
+        if pts.shape[-1]==3:
+            pts=pts.T
+        return np.ascontiguousarray(pts)
+
+    def build(self,pts,leafsize=16):
+        """ rebuild over new points, the memory is reused when they are not more than before """
+        q=self._xyz(pts)
+        self.kt.build(q,min(max(int(leafsize),1),64))
+        self.data=(pts.xyz if isinstance(pts,native_cloud) else q).T.copy()
+        return self
+
+    @property
+    def n(self):
+        return len(self.kt)
+
+    def _query(self,x,k,r):
+        q=self._xyz(x)
+        m=len(q) if isinstance(q,_native.Cloud) else q.shape[1]
+        idx=np.empty((m,k),np.int32)
+        d=np.empty((m,k),np.float32)
+        cnt=np.empty(m,np.int32)
+        self.kt.query(q,k,idx,d,r,cnt)
+        return d,idx,cnt
+
+    def query(self,x,k=1,eps=0,p=2,distance_upper_bound=np.inf,n_jobs=None,workers=None):
+        """ (d, i) of the k nearest points as cKDTree.query: missing neighbours have d=inf and i=n, k=1 drops the last
+            axis; eps/p/n_jobs/workers are accepted for compatibility (exact euclidean search, threads set at construction) """
+        r=float(distance_upper_bound) if np.isfinite(distance_upper_bound) else 0
+        d,idx,_=self._query(x,int(k),r)
+        idx[idx<0]=self.n
+        if np.ndim(x)==1:
+            d,idx=d[0],idx[0]
+        if k==1:
+            d,idx=d[...,0],idx[...,0]
+        return d,idx
+
+    def query_ball_point(self,x,r,p=2.,eps=0,n_jobs=None,workers=None,return_sorted=None,return_length=False):
+        """ indices of the points of this tree within r (distance <= r, as cKDTree) of each point of x, nearest first,
+            a single list for one point; p/eps/n_jobs/workers/return_sorted are accepted for compatibility
+            queries that fill the neighbour arrays are repeated with 4 times the capacity up to K_MAX (img_kdt.h),
+            points with K_MAX or more neighbours are then searched by brute force, so no list is truncated """
+        r=np.nextafter(np.float32(r),np.float32(np.inf))     # the native bound is strict (distance < r)
+        k=64
+        while True:
+            _,idx,cnt=self._query(x,k,float(r))
+            if cnt.max(initial=0)<k or k==self.K_MAX:
+                break
+            k=min(4*k,self.K_MAX)
+        res=[row[:c].tolist() for row,c in zip(idx,cnt)]
+        full=np.flatnonzero(cnt==self.K_MAX)
+        if len(full):
+            q=x.xyz if isinstance(x,native_cloud) else self._xyz(x)
+            for i in full:
+                d2=((self.data-q[:,i])**2).sum(axis=1)
+                sel=np.flatnonzero(d2<r*r)
+                res[i]=sel[np.argsort(d2[sel],kind='stable')].tolist()
+                cnt[i]=len(sel)
+        if return_length:
+            return cnt[0] if np.ndim(x)==1 else cnt
+        return res[0] if np.ndim(x)==1 else res
+
+    def query_ball_tree(self,other,r,p=2.,eps=0):
+        """ as cKDTree.query_ball_tree: for each point of this tree, the indices of the points of other within r """
+        if not isinstance(other,native_kdtree):
+            raise TypeError("query_ball_tree: other must be a native_kdtree")
+        return other.query_ball_point(self.data,r)
+
+
+class native_outlier:
+    """ radius (ROR) and statistical (SOR) outlier removal of organized clouds (native_deproj output) in image space
+        (img_outlier.h), replaces the per-frame KD-tree build and k-NN query of RadiusOutlierRemovalFilter and
+        StatisticalOutlierRemovalFilter (src/ref/filters/kdtree.py): neighbours are the k-1 closest valid points (3D distance)
+        in the (2w+1)^2 pixel window, k counts the point itself as in the KD-tree filters, so the masks match them when the
+        k nearest neighbours lie in the window; points with too few valid neighbours in the window are removed """
+    def __init__(self,w=2,k=8,threads=1):
+        self.ol=_native.Outlier(w,k,threads)
+
+    def ror(self,xyz,r,mask=None):
+        """ xyz: float32 (3,IMG_HGT,IMG_WID), returns a bool (IMG_HGT,IMG_WID) mask of the points whose k nearest
+            neighbours are all closer than r, False where z is 0 """
+        if mask is None:
+            mask=np.empty((IMG_HGT,IMG_WID),np.bool_)
+        self.ol.ror(np.ascontiguousarray(xyz,np.float32),mask,r)
+        return mask
+
+    def sor(self,xyz,z_max,mask=None,md=None):
+        """ bool mask of the points whose mean k-NN distance has a z-score (ddof=1) within z_max;
+            md: optional float32 (IMG_HGT,IMG_WID) filled with the mean distances (inf where z is 0 or too few neighbours) """
+        if mask is None:
+            mask=np.empty((IMG_HGT,IMG_WID),np.bool_)
+        self.ol.sor(np.ascontiguousarray(xyz,np.float32),mask,z_max,md)
+        return mask
+
+
+class native_recorder:
+    """ asynchronous recorder (img_sav.h), frames are written by a native thread so capture never waits on the disk
+        fname ending with .dz is compressed losslessly (int16/uint16 depth only)
+        wait_ms: 0 drops the frame when all buffers are queued, >0 waits up to wait_ms, -1 always waits """
+    def __init__(self,fname=KINECT_SAV_FNAME,frame_bytes=None,buffers=16,wait_ms=0):
+        if frame_bytes is None:
+            frame_bytes=IMG_WID*IMG_HGT*np.dtype(NEWTOF_DATA_TYPE if TOF_TYPE=='NEW_TOF' else KINECT_DATA_TYPE).itemsize
+        self.rec=_native.Recorder(fname,frame_bytes,buffers,wait_ms,fname.endswith('.dz'))
+
+    def put(self,frame):
+        """ queue one frame, returns False if it was dropped """
+        return self.rec.put(np.ascontiguousarray(frame))
+
+    def close(self):
+        self.rec.close()
+
+    def stats(self):
+        return self.rec.stats()
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self,*exc):
+        self.close()
+        return False
+
+
+class native_shm_reader:
+    """ frames published by the filter program (-S name) in shared memory (img_shm.h), read without copying
+        the producer never waits for readers: frames a slow reader did not take in time are skipped,
+        next() always returns the newest frame """
+    def __init__(self,name='img_filter'):
+        self.shm=_native.ShmReader(name)
+        self.last=0
+
+    def next(self,timeout_ms=-1):
+        """ wait for a frame newer than the last one, returns (seq, t_ns, img) or None on timeout
+            img is a read-only float32 (IMG_HGT,IMG_WID) view into shared memory, t_ns the capture time
+            (time.monotonic_ns); call valid(seq) after using img to check it was not overwritten meanwhile """
+        while True:
+            seq=self.shm.wait(self.last,timeout_ms)
+            if seq==0:
+                return None
+            self.last=seq
+            r=self.shm.frame(seq)
+            if r is not None:
+                return seq,r[1],np.asarray(r[0])
+
+    def valid(self,seq):
+        return self.shm.valid(seq)
+
+    def close(self):
+        """ all images returned by next() must be released first """
+        self.shm.close()
+
+
+def native_tune(cache=None,threads=1,force=False):
+    """ benchmark the implementations (scalar, batched, threaded) of each stage on this host and select the fastest
+        for native_filter created afterwards, the choice is cached in cache and reused while the host is the same
+        returns a list of (stage, implementation) """
+    return _native.tune(cache,threads,force)
+
+
+def native_stages():
+    """ list of (name, default parameters) of the stages usable in a filter spec """
+    return _native.stages()
@@ -259,6 +259,67 @@ def read_ir_image(fp,mask=None):
     frame_ir = frame_tmp.reshape([KINECT_IR_WID, KINECT_IR_HGT]) / 100
     return frame_ir
 
+class rec_reader:
+    """ memory-mapped reader for recorded sessions, frames are zero-copy views into the file
+        layout: list of (name, dtype, count) per frame, e.g.
+            [('dep',KINECT_DATA_TYPE,KINECT_DEP_SZ),('ir',np.int16,KINECT_IR_SZ)]
+            [('pc',NEWTOF_DATA_TYPE,NEWTOF_DEP_SZ*4)]
+        frames are read ahead with madvise(WILLNEED) while reading sequentially,
+        seeking starts read-ahead at the new position"""
+    def __init__(self,fname,layout=None,ra=8):
+        import mmap
+        if layout is None:
+            if TOF_TYPE=='NEW_TOF':
+                layout=[('dep',NEWTOF_DATA_TYPE,NEWTOF_DEP_SZ)]
+            else:
+                layout=[('dep',KINECT_DATA_TYPE,KINECT_DEP_SZ)]
+        self.dtype=np.dtype([(n,t,(c,)) for n,t,c in layout])
+        self.fp=open(fname,'rb')
+        self.mm=mmap.mmap(self.fp.fileno(),0,access=mmap.ACCESS_READ)
+        self.n_frm=len(self.mm)//self.dtype.itemsize
+        self.frames=np.frombuffer(self.mm,dtype=self.dtype,count=self.n_frm)
+        self.ra=ra
+        self.last=-2
+        self.ra_end=0
+        self.idx=0
+        if hasattr(self.mm,'madvise'):
+            self.mm.madvise(mmap.MADV_RANDOM)
+
+    def __len__(self):
+        return self.n_frm
+
+    def _willneed(self,f0,f1):
+        import mmap
+        f1=min(f1,self.n_frm)
+        if f0>=f1 or not hasattr(self.mm,'madvise'):
+            return
+        a0=f0*self.dtype.itemsize//mmap.PAGESIZE*mmap.PAGESIZE
+        self.mm.madvise(mmap.MADV_WILLNEED,a0,f1*self.dtype.itemsize-a0)
+
+    def frame(self,idx,name='dep'):
+        """ read-only view of plane 'name' of frame idx, no copy """
+        if idx!=self.last and idx!=self.last+1:
+            self.ra_end=idx
+        if self.ra_end-idx<=self.ra//2:
+            self._willneed(self.ra_end,idx+self.ra)
+            self.ra_end=idx+self.ra
+        self.last=idx
+        return self.frames[idx][name]
+
+    def seek(self,idx):
+        self.idx=idx
+
+    def read_depth_image(self):
+        """ same result as read_depth_image(fp), reads the next frame """
+        frame=self.frame(self.idx,'dep').astype(np.float32)/1000.0
+        self.idx+=1
+        return frame
+
+    def close(self):
+        self.frames=None
+        self.mm.close()
+        self.fp.close()
+
 points = (
     (1, -1, -1),
     (1, 1, -1),